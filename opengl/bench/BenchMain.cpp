@@ -0,0 +1,1747 @@
+#include "Benchmark.h"
+#include "Comparison.h"
+#include "HeadlessContext.h"
+
+#include "Renderer.h"
+#include "VertexBuffer.h"
+#include "IndexBuffer.h"
+#include "Shader.h"
+#include "ResourceManager.h"
+#include "GeometryPool.h"
+#include "Profiler.h"
+#include "FrameArena.h"
+#include "AllocationTracker.h"
+#include "GpuMemory.h"
+#include "Texture.h"
+#include "TextureAtlas.h"
+#include "TextureStreamer.h"
+#include "TextureResidency.h"
+#include "WorkerPool.h"
+#include "BlockEncoder.h"
+#include "MipGenerator.h"
+#include "PageFile.h"
+#include "VirtualTexture.h"
+#include "GeometryCodec.h"
+#include "MeshCache.h"
+#include "FileSystem.h"
+#include "Lz4.h"
+#include "AssetPipeline.h"
+#include "VectorMath.h"
+#include "SceneGraph.h"
+#include "EntityManager.h"
+#include "InstanceBuffer.h"
+#include "FrustumCuller.h"
+#include "OcclusionBuffer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifndef OPENGL_RES_DIR
+#define OPENGL_RES_DIR "res"
+#endif
+
+static const std::string s_ShaderPath{ std::string(OPENGL_RES_DIR) + "/shader/Basic.shader" };
+
+static std::string SizeLabel(unsigned int bytes)
+{
+    if (bytes >= 1024 * 1024)
+        return std::to_string(bytes / (1024 * 1024)) + "M";
+    if (bytes >= 1024)
+        return std::to_string(bytes / 1024) + "K";
+    return std::to_string(bytes);
+}
+
+static void AddBufferBenchmarks(BenchmarkRunner& runner)
+{
+    static const unsigned int sizes[] { 1024, 64 * 1024, 1024 * 1024, 16 * 1024 * 1024 };
+    static std::vector<unsigned char> data(16 * 1024 * 1024, 0x5a);
+
+    for (unsigned int size : sizes)
+    {
+        //allocation only, no data
+        runner.Add({ "VertexBuffer/Create/" + SizeLabel(size), 0.0, nullptr, [size]() {
+            VertexBuffer vb(nullptr, size);
+            glFinish();
+        }, nullptr });
+
+        runner.Add({ "VertexBuffer/Upload/" + SizeLabel(size), (double)size, nullptr, [size]() {
+            VertexBuffer vb(data.data(), size);
+            glFinish();
+        }, nullptr });
+
+        runner.Add({ "IndexBuffer/Upload/" + SizeLabel(size), (double)size, nullptr, [size]() {
+            IndexBuffer ib((const unsigned int*)data.data(), size / sizeof(unsigned int));
+            glFinish();
+        }, nullptr });
+    }
+}
+
+//editor style edits: a few small scattered writes into a large dynamic buffer per frame,
+//flushed as merged dirty ranges (the Full case re-uploads everything for comparison)
+static void AddPartialUpdateBenchmarks(BenchmarkRunner& runner)
+{
+    static const unsigned int size{ 4 * 1024 * 1024 };
+    static std::unique_ptr<VertexBuffer> buffer;
+    static std::vector<unsigned char> data(size, 0x5a);
+    static unsigned int frame{ 0 };
+    static const unsigned int edits[] { 4, 64 };
+
+    for (unsigned int count : edits)
+    {
+        runner.Add({ "VertexBuffer/PartialUpdate/4M/" + std::to_string(count), 0.0,
+            []() { buffer = std::make_unique<VertexBuffer>(data.data(), size, true); },
+            [count]() {
+                frame++;
+                for (unsigned int i = 0; i < count; i++)
+                {
+                    unsigned int offset{ ((frame * 7919u + i * 104729u) % (size / 256)) * 256 };
+                    buffer->Update(offset, data.data() + offset, 48);
+                }
+                buffer->Flush();
+                Profiler::Get().EndFrame();
+                glFinish();
+            },
+            []() { buffer.reset(); } });
+    }
+
+    runner.Add({ "VertexBuffer/FullUpdate/4M", (double)size,
+        []() { buffer = std::make_unique<VertexBuffer>(data.data(), size); },
+        []() {
+            buffer->Update(0, data.data(), size);
+            glFinish();
+        },
+        []() { buffer.reset(); } });
+}
+
+//scheduler overhead: empty jobs through the shared queue, a chain of dependent jobs, and a
+//parallel-for small enough per item that the split matters
+static void AddJobBenchmarks(BenchmarkRunner& runner)
+{
+    static const unsigned int s_Jobs{ 4096 };
+    static std::unique_ptr<WorkerPool> workers;
+    auto setup = []() { workers = std::make_unique<WorkerPool>(); };
+    auto teardown = []() { workers.reset(); };
+
+    runner.Add({ "Jobs/Submit/" + std::to_string(s_Jobs), 0.0, setup,
+        []() {
+            JobCounter counter;
+            for (unsigned int i = 0; i < s_Jobs; i++)
+                workers->Submit([]() {}, &counter);
+            workers->WaitFor(counter);
+        }, teardown });
+    runner.Add({ "Jobs/Chain/256", 0.0, setup,
+        []() {
+            std::vector<std::unique_ptr<JobCounter>> counters;
+            for (unsigned int i = 0; i < 256; i++)
+            {
+                counters.push_back(std::make_unique<JobCounter>());
+                workers->Submit([]() {}, counters.back().get(), i ? counters[i - 1].get() : nullptr);
+            }
+            workers->WaitFor(*counters.back());
+        }, teardown });
+
+    static std::vector<float> values(1 << 20, 1.0f);
+    runner.Add({ "Jobs/ParallelFor/Auto", (double)(values.size() * sizeof(float)), setup,
+        []() {
+            workers->ParallelFor((unsigned int)values.size(), 0, [](unsigned int begin, unsigned int end) {
+                for (unsigned int i = begin; i < end; i++)
+                    values[i] = values[i] * 0.5f + 0.5f;
+            });
+        }, teardown });
+}
+
+//plain per-element reference code for the VectorMath batch kernels, the way the math would be
+//written without them
+static void ReferenceMultiply(const float* a, const float* b, float* out)
+{
+    for (unsigned int column = 0; column < 4; column++)
+    {
+        for (unsigned int row = 0; row < 4; row++)
+        {
+            float sum{ 0.0f };
+            for (unsigned int k = 0; k < 4; k++)
+                sum += a[k * 4 + row] * b[column * 4 + k];
+            out[column * 4 + row] = sum;
+        }
+    }
+}
+
+static void ReferenceCompose(const Vec3& t, const Quat& q, const Vec3& s, float* out)
+{
+    float rotation[16], scaling[16], translation[16], rotationScale[16];
+    std::fill(scaling, scaling + 16, 0.0f);
+    scaling[0] = s.X;
+    scaling[5] = s.Y;
+    scaling[10] = s.Z;
+    scaling[15] = 1.0f;
+    std::fill(translation, translation + 16, 0.0f);
+    translation[0] = translation[5] = translation[10] = translation[15] = 1.0f;
+    translation[12] = t.X;
+    translation[13] = t.Y;
+    translation[14] = t.Z;
+    float rows[16] {
+        1.0f - 2.0f * (q.Y * q.Y + q.Z * q.Z), 2.0f * (q.X * q.Y + q.W * q.Z), 2.0f * (q.X * q.Z - q.W * q.Y), 0.0f,
+        2.0f * (q.X * q.Y - q.W * q.Z), 1.0f - 2.0f * (q.X * q.X + q.Z * q.Z), 2.0f * (q.Y * q.Z + q.W * q.X), 0.0f,
+        2.0f * (q.X * q.Z + q.W * q.Y), 2.0f * (q.Y * q.Z - q.W * q.X), 1.0f - 2.0f * (q.X * q.X + q.Y * q.Y), 0.0f,
+        0.0f, 0.0f, 0.0f, 1.0f };
+    std::copy(rows, rows + 16, rotation);
+    ReferenceMultiply(rotation, scaling, rotationScale);
+    ReferenceMultiply(translation, rotationScale, out);
+}
+
+static bool NearlyEqual(const float* a, const float* b, unsigned int count)
+{
+    for (unsigned int i = 0; i < count; i++)
+    {
+        if (std::fabs(a[i] - b[i]) > 1e-4f * std::max(1.0f, std::fabs(b[i])))
+            return false;
+    }
+    return true;
+}
+
+//every batch kernel once against the reference, with counts that leave SSE2 and AVX2 tails
+//and in place where the kernel allows it
+static void CheckMathKernels(const std::vector<Vec3>& translations, const std::vector<Quat>& rotations, const std::vector<Vec3>& scales,
+    const std::vector<Vec3>& points, const Mat4& viewProjection)
+{
+    for (unsigned int count : { 1u, 3u, 4u, 5u, 7u, 8u, 9u, 13u, 17u, 31u })
+    {
+        std::vector<Mat4> models(count), mvps(count), pairs(count);
+        std::vector<Vec3> transformed(count), inPlace(points.begin(), points.begin() + count);
+        std::vector<Vec4> projected(count);
+        ComposeMatrices(translations.data(), rotations.data(), scales.data(), models.data(), count);
+        MultiplyMatrices(viewProjection, models.data(), mvps.data(), count);
+        MultiplyMatrices(mvps.data(), models.data(), pairs.data(), count);
+        TransformPoints(models[0], points.data(), transformed.data(), count);
+        TransformPoints(models[0], inPlace.data(), inPlace.data(), count);
+        ProjectPoints(viewProjection, points.data(), projected.data(), count);
+
+        const float* m{ &models[0].Columns[0].X };
+        const float* vp{ &viewProjection.Columns[0].X };
+        for (unsigned int i = 0; i < count; i++)
+        {
+            float model[16], mvp[16], pair[16];
+            ReferenceCompose(translations[i], rotations[i], scales[i], model);
+            ASSERT(NearlyEqual(&models[i].Columns[0].X, model, 16));
+            ReferenceMultiply(vp, model, mvp);
+            ASSERT(NearlyEqual(&mvps[i].Columns[0].X, mvp, 16));
+            ReferenceMultiply(mvp, model, pair);
+            ASSERT(NearlyEqual(&pairs[i].Columns[0].X, pair, 16));
+
+            const Vec3& p{ points[i] };
+            float point[3]{ m[0] * p.X + m[4] * p.Y + m[8] * p.Z + m[12], m[1] * p.X + m[5] * p.Y + m[9] * p.Z + m[13],
+                m[2] * p.X + m[6] * p.Y + m[10] * p.Z + m[14] };
+            ASSERT(NearlyEqual(&transformed[i].X, point, 3));
+            ASSERT(NearlyEqual(&inPlace[i].X, point, 3));
+            float clip[4];
+            for (unsigned int row = 0; row < 4; row++)
+                clip[row] = vp[row] * p.X + vp[4 + row] * p.Y + vp[8 + row] * p.Z + vp[12 + row];
+            ASSERT(NearlyEqual(&projected[i].X, clip, 4));
+        }
+    }
+}
+
+//batch kernels against the reference: model matrices from TRS, model-view-projection matrices
+//and world space points for s_Objects objects
+static void AddMathBenchmarks(BenchmarkRunner& runner)
+{
+    static const unsigned int s_Objects{ 4096 };
+    static std::vector<Vec3> translations, scales, points, transformed;
+    static std::vector<Quat> rotations;
+    static std::vector<Mat4> models, mvps;
+    static Mat4 viewProjection;
+    static float checksum{ 0.0f };
+    auto setup = []() {
+        if (translations.empty())
+        {
+            for (unsigned int i = 0; i < s_Objects; i++)
+            {
+                float f{ (float)i };
+                translations.push_back({ f, f * 0.5f, -f });
+                scales.push_back({ 1.0f + f * 0.001f, 1.0f, 2.0f });
+                rotations.push_back(Quat::FromAxisAngle(Normalize(Vec3{ 1.0f, f, 0.5f }), f * 0.01f));
+                points.push_back({ f * 0.25f, 1.0f - f, f * 2.0f });
+            }
+            transformed.resize(s_Objects);
+            models.resize(s_Objects);
+            mvps.resize(s_Objects);
+            viewProjection = Mat4::Perspective(1.0f, 4.0f / 3.0f, 0.1f, 1000.0f) *
+                Mat4::LookAt({ 0.0f, 10.0f, 50.0f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f });
+            CheckMathKernels(translations, rotations, scales, points, viewProjection);
+        }
+        ComposeMatrices(translations.data(), rotations.data(), scales.data(), models.data(), s_Objects);
+    };
+    std::string count{ std::to_string(s_Objects) };
+
+    runner.Add({ "Math/Compose/" + count, (double)(s_Objects * sizeof(Mat4)), setup,
+        []() {
+            ComposeMatrices(translations.data(), rotations.data(), scales.data(), models.data(), s_Objects);
+            checksum += models[s_Objects / 2].Columns[0].X;
+        }, nullptr });
+    runner.Add({ "Math/Compose/" + count + "/Scalar", (double)(s_Objects * sizeof(Mat4)), setup,
+        []() {
+            for (unsigned int i = 0; i < s_Objects; i++)
+                ReferenceCompose(translations[i], rotations[i], scales[i], &models[i].Columns[0].X);
+            checksum += models[s_Objects / 2].Columns[0].X;
+        }, nullptr });
+
+    runner.Add({ "Math/Mvp/" + count, (double)(s_Objects * sizeof(Mat4)), setup,
+        []() {
+            MultiplyMatrices(viewProjection, models.data(), mvps.data(), s_Objects);
+            checksum += mvps[s_Objects / 2].Columns[3].W;
+        }, nullptr });
+    runner.Add({ "Math/Mvp/" + count + "/Scalar", (double)(s_Objects * sizeof(Mat4)), setup,
+        []() {
+            for (unsigned int i = 0; i < s_Objects; i++)
+                ReferenceMultiply(&viewProjection.Columns[0].X, &models[i].Columns[0].X, &mvps[i].Columns[0].X);
+            checksum += mvps[s_Objects / 2].Columns[3].W;
+        }, nullptr });
+
+    runner.Add({ "Math/TransformPoints/" + count, (double)(s_Objects * sizeof(Vec3)), setup,
+        []() {
+            TransformPoints(models[1], points.data(), transformed.data(), s_Objects);
+            checksum += transformed[s_Objects / 2].Y;
+        }, nullptr });
+    runner.Add({ "Math/TransformPoints/" + count + "/Scalar", (double)(s_Objects * sizeof(Vec3)), setup,
+        []() {
+            const float* m{ &models[1].Columns[0].X };
+            for (unsigned int i = 0; i < s_Objects; i++)
+            {
+                const Vec3& p{ points[i] };
+                transformed[i] = {
+                    m[0] * p.X + m[4] * p.Y + m[8] * p.Z + m[12],
+                    m[1] * p.X + m[5] * p.Y + m[9] * p.Z + m[13],
+                    m[2] * p.X + m[6] * p.Y + m[10] * p.Z + m[14] };
+            }
+            checksum += transformed[s_Objects / 2].Y;
+        }, nullptr });
+}
+
+//a million nodes: 1000 roots with 999 descendants each, ten children per node. All moves every
+//node (compose and multiply everything), Roots only the roots (every world matrix, no local
+//ones), Sparse one node in a hundred somewhere in the trees
+static void AddSceneGraphBenchmarks(BenchmarkRunner& runner)
+{
+    static const unsigned int s_Roots{ 1000 };
+    static const unsigned int s_NodesPerRoot{ 1000 };
+    static std::unique_ptr<WorkerPool> workers;
+    static std::unique_ptr<SceneGraph> scene;
+    static std::vector<SceneNode> nodes;
+    static float angle{ 0.0f };
+    //incremental updates against worlds built up parent first from the reference compose, after
+    //creating the nodes, moving a few, reparenting a subtree and moving nothing. WasUpdated() has
+    //to name exactly the nodes that moved or sit below one that did
+    static auto checkScene = [](WorkerPool* pool) {
+        static const unsigned int s_CheckRoots{ 4 }, s_CheckNodes{ 5000 };   //the widest level is split over the workers
+        SceneGraph graph;
+        std::vector<SceneNode> handles;
+        std::vector<int> parents;
+        std::vector<Vec3> translations, scales;
+        std::vector<Quat> rotations;
+        for (unsigned int i = 0; i < s_CheckRoots * s_CheckNodes; i++)
+        {
+            unsigned int first{ i / s_CheckNodes * s_CheckNodes };
+            float f{ (float)i };
+            parents.push_back(i == first ? -1 : (int)(first + (i - first - 1) / 10));
+            translations.push_back({ std::sin(f), 1.0f, std::cos(f) * 0.5f });
+            rotations.push_back(Quat::FromAxisAngle(Normalize(Vec3{ 1.0f, f, 0.5f }), f * 0.01f));
+            scales.push_back({ 0.9f, 1.0f + (i % 3) * 0.05f, 0.95f });
+            handles.push_back(graph.Create(parents[i] < 0 ? SceneNode() : handles[parents[i]], translations[i], rotations[i], scales[i]));
+        }
+        //parents always come before their children, so one pass in creation order resolves them
+        std::vector<unsigned char> changed(handles.size(), 1), moved(handles.size());
+        std::vector<float> worlds(handles.size() * 16);
+        auto check = [&]() {
+            graph.Update(pool);
+            for (size_t i = 0; i < handles.size(); i++)
+            {
+                float local[16];
+                ReferenceCompose(translations[i], rotations[i], scales[i], local);
+                if (parents[i] < 0)
+                    std::copy(local, local + 16, &worlds[i * 16]);
+                else
+                    ReferenceMultiply(&worlds[parents[i] * 16], local, &worlds[i * 16]);
+                moved[i] = changed[i] || (parents[i] >= 0 && moved[parents[i]]);
+                ASSERT(NearlyEqual(&graph.GetWorld(handles[i]).Columns[0].X, &worlds[i * 16], 16));
+                ASSERT(graph.WasUpdated(handles[i]) == (moved[i] != 0));
+            }
+            std::fill(changed.begin(), changed.end(), 0);
+        };
+        check();
+        for (size_t i = 5; i < handles.size(); i += 97)
+        {
+            rotations[i] = Quat::FromAxisAngle({ 0.0f, 1.0f, 0.0f }, (float)i);
+            graph.SetRotation(handles[i], rotations[i]);
+            changed[i] = 1;
+        }
+        check();
+        ASSERT(graph.SetParent(handles[s_CheckNodes + 5], handles[3]));
+        parents[s_CheckNodes + 5] = 3;
+        changed[s_CheckNodes + 5] = 1;
+        check();
+        check();
+    };
+    auto setup = []() {
+        workers = std::make_unique<WorkerPool>();
+        checkScene(nullptr);
+        checkScene(workers.get());
+        scene = std::make_unique<SceneGraph>();
+        nodes.clear();
+        nodes.reserve(s_Roots * s_NodesPerRoot);
+        for (unsigned int root = 0; root < s_Roots; root++)
+        {
+            unsigned int first{ (unsigned int)nodes.size() };
+            nodes.push_back(scene->Create({}, { (float)root, 0.0f, 0.0f }));
+            for (unsigned int i = 1; i < s_NodesPerRoot; i++)
+                nodes.push_back(scene->Create(nodes[first + (i - 1) / 10], { 0.0f, 1.0f, 0.0f }, Quat::Identity(), { 0.9f, 0.9f, 0.9f }));
+        }
+        scene->Update(workers.get());
+    };
+    auto teardown = []() {
+        scene.reset();
+        nodes.clear();
+        nodes.shrink_to_fit();
+        workers.reset();
+    };
+    std::string count{ std::to_string(s_Roots * s_NodesPerRoot / 1000000) + "M" };
+
+    runner.Add({ "Scene/Update/" + count + "/All", (double)(s_Roots * s_NodesPerRoot * sizeof(Mat4)), setup,
+        []() {
+            angle += 0.01f;
+            Quat rotation{ Quat::FromAxisAngle({ 0.0f, 1.0f, 0.0f }, angle) };
+            for (SceneNode node : nodes)
+                scene->SetRotation(node, rotation);
+            scene->Update(workers.get());
+        }, teardown });
+    runner.Add({ "Scene/Update/" + count + "/Roots", 0.0, setup,
+        []() {
+            angle += 0.01f;
+            Quat rotation{ Quat::FromAxisAngle({ 0.0f, 1.0f, 0.0f }, angle) };
+            for (unsigned int root = 0; root < s_Roots; root++)
+                scene->SetRotation(nodes[root * s_NodesPerRoot], rotation);
+            scene->Update(workers.get());
+        }, teardown });
+    runner.Add({ "Scene/Update/" + count + "/Sparse", 0.0, setup,
+        []() {
+            angle += 0.01f;
+            Quat rotation{ Quat::FromAxisAngle({ 0.0f, 1.0f, 0.0f }, angle) };
+            for (size_t i = 37; i < nodes.size(); i += 100)
+                scene->SetRotation(nodes[i], rotation);
+            scene->Update(workers.get());
+        }, teardown });
+}
+
+struct BenchPosition
+{
+    Vec3 Value;
+};
+
+struct BenchVelocity
+{
+    Vec3 Value;
+};
+
+struct BenchInstance
+{
+    float Values[4];
+};
+
+//ForEach integrates a million positions, once on this thread and once spread over the chunks
+//with the workers. Sync uploads the instances of 64K entities after a run of one in a hundred
+//(Sparse, a chunk or two) or all of them (All) were written, only changed chunks go to the GPU
+static void AddEntityBenchmarks(BenchmarkRunner& runner)
+{
+    static const unsigned int s_Entities{ 1000000 };
+    static const unsigned int s_Instances{ 64 * 1024 };
+    static std::unique_ptr<WorkerPool> workers;
+    static std::unique_ptr<EntityManager> entities;
+    static std::unique_ptr<InstanceBuffer> instances;
+    static std::vector<Entity> handles;
+    static float step{ 0.0f };
+    auto setupMoving = []() {
+        workers = std::make_unique<WorkerPool>();
+        entities = std::make_unique<EntityManager>();
+        for (unsigned int i = 0; i < s_Entities; i++)
+            entities->Create(BenchPosition{ { (float)i, 0.0f, 0.0f } }, BenchVelocity{ { 0.0f, 1.0f, (float)(i % 7) } });
+    };
+    auto setupInstances = []() {
+        entities = std::make_unique<EntityManager>();
+        handles.clear();
+        for (unsigned int i = 0; i < s_Instances; i++)
+            handles.push_back(entities->Create(BenchInstance{ { (float)i, 0.0f, 1.0f, 0.0f } }));
+        VertexBufferLayout layout;
+        layout.Push<float>(4);
+        instances = std::make_unique<InstanceBuffer>(ComponentTypes::Of<BenchInstance>(), layout, 2);
+        instances->Sync(*entities);
+    };
+    auto teardown = []() {
+        instances.reset();
+        entities.reset();
+        handles.clear();
+        handles.shrink_to_fit();
+        workers.reset();
+    };
+    std::string count{ std::to_string(s_Entities / 1000000) + "M" };
+    std::string instanceCount{ std::to_string(s_Instances / 1024) + "K" };
+
+    runner.Add({ "Ecs/ForEach/" + count, (double)(s_Entities * 2 * sizeof(Vec3)), setupMoving,
+        []() {
+            entities->ForEach<BenchPosition, const BenchVelocity>([](Entity, BenchPosition& position, const BenchVelocity& velocity) {
+                position.Value = position.Value + velocity.Value * 0.016f;
+            });
+        }, teardown });
+    runner.Add({ "Ecs/ForEach/" + count + "/Parallel", (double)(s_Entities * 2 * sizeof(Vec3)), setupMoving,
+        []() {
+            entities->ParallelForEach<BenchPosition, const BenchVelocity>(*workers, [](Entity, BenchPosition& position, const BenchVelocity& velocity) {
+                position.Value = position.Value + velocity.Value * 0.016f;
+            });
+        }, teardown });
+    runner.Add({ "Ecs/Sync/" + instanceCount + "/Sparse", 0.0, setupInstances,
+        []() {
+            step += 1.0f;
+            for (size_t i = handles.size() / 2; i < handles.size() / 2 + handles.size() / 100; i++)
+                entities->Write<BenchInstance>(handles[i])->Values[1] = step;
+            instances->Sync(*entities);
+        }, teardown });
+    runner.Add({ "Ecs/Sync/" + instanceCount + "/All", (double)(s_Instances * sizeof(BenchInstance)), setupInstances,
+        []() {
+            step += 1.0f;
+            entities->ForEach<BenchInstance>([](Entity, BenchInstance& instance) { instance.Values[1] = step; });
+            instances->Sync(*entities);
+        }, teardown });
+}
+
+//256K boxes scattered over a 2 km square, a camera turning in the middle sees a few percent.
+//Linear is the reference: every box against every plane, one at a time
+static void AddCullingBenchmarks(BenchmarkRunner& runner)
+{
+    static const unsigned int s_Objects{ 256 * 1024 };
+    static std::unique_ptr<WorkerPool> workers;
+    static std::unique_ptr<FrustumCuller> culler;
+    static std::vector<Vec3> centers, extents;
+    static std::vector<unsigned int> visible;
+    static float angle{ 0.0f };
+    //every box against every plane, one at a time
+    static auto linearCull = [](const Frustum& planes, unsigned int count, std::vector<unsigned int>& out) {
+        out.clear();
+        for (unsigned int i = 0; i < count; i++)
+        {
+            bool inside{ true };
+            for (const Vec4& plane : planes.Planes)
+            {
+                float distance{ plane.X * centers[i].X + plane.Y * centers[i].Y + plane.Z * centers[i].Z + plane.W };
+                float radius{ std::fabs(plane.X) * extents[i].X + std::fabs(plane.Y) * extents[i].Y + std::fabs(plane.Z) * extents[i].Z };
+                if (distance + radius < 0.0f)
+                {
+                    inside = false;
+                    break;
+                }
+            }
+            if (inside)
+                out.push_back(i);
+        }
+    };
+    auto setup = []() {
+        workers = std::make_unique<WorkerPool>();
+        culler = std::make_unique<FrustumCuller>();
+        centers.resize(s_Objects);
+        extents.resize(s_Objects);
+        unsigned int seed{ 12345 };
+        auto random = [&seed]() {
+            seed = seed * 1664525u + 1013904223u;
+            return (float)(seed >> 8) / (float)(1u << 24);
+        };
+        for (unsigned int i = 0; i < s_Objects; i++)
+        {
+            centers[i] = { random() * 2000.0f - 1000.0f, random() * 20.0f, random() * 2000.0f - 1000.0f };
+            extents[i] = { 0.5f + random() * 2.0f, 0.5f + random() * 2.0f, 0.5f + random() * 2.0f };
+        }
+        culler->Build(centers.data(), extents.data(), s_Objects);
+        visible.reserve(s_Objects);
+
+        //the BVH, serial and parallel, sees exactly what the per-object test sees. the second
+        //tree has a count that is no multiple of the leaf size, so some leaves carry padding
+        Frustum planes{ Frustum::FromMatrix(Mat4::Perspective(1.0f, 4.0f / 3.0f, 0.5f, 500.0f) *
+            Mat4::LookAt({ 0.0f, 10.0f, 0.0f }, { 1.0f, 10.0f, 0.3f }, { 0.0f, 1.0f, 0.0f })) };
+        FrustumCuller padded;
+        padded.Build(centers.data(), extents.data(), s_Objects - 5);
+        for (FrustumCuller* tree : { culler.get(), &padded })
+        {
+            linearCull(planes, tree->GetObjectCount(), visible);
+            std::sort(visible.begin(), visible.end());
+            for (WorkerPool* pool : { (WorkerPool*)nullptr, workers.get() })
+            {
+                unsigned int count{ tree->Cull(planes, pool) };
+                std::vector<unsigned int> result(tree->GetVisible(), tree->GetVisible() + count);
+                std::sort(result.begin(), result.end());
+                ASSERT(!result.empty() && result == visible);
+            }
+        }
+    };
+    auto teardown = []() {
+        culler.reset();
+        workers.reset();
+        centers.clear();
+        centers.shrink_to_fit();
+        extents.clear();
+        extents.shrink_to_fit();
+        visible.clear();
+        visible.shrink_to_fit();
+    };
+    auto frustum = []() {
+        angle += 0.05f;
+        Mat4 projection{ Mat4::Perspective(1.0f, 4.0f / 3.0f, 0.5f, 500.0f) };
+        return Frustum::FromMatrix(projection * Mat4::LookAt({ 0.0f, 10.0f, 0.0f }, { std::cos(angle), 10.0f, std::sin(angle) }, { 0.0f, 1.0f, 0.0f }));
+    };
+    std::string count{ std::to_string(s_Objects / 1024) + "K" };
+
+    runner.Add({ "Cull/Frustum/" + count, 0.0, setup, [frustum]() { culler->Cull(frustum()); }, teardown });
+    runner.Add({ "Cull/Frustum/" + count + "/Parallel", 0.0, setup, [frustum]() { culler->Cull(frustum(), workers.get()); }, teardown });
+    runner.Add({ "Cull/Frustum/" + count + "/Linear", 0.0, setup, [frustum]() { linearCull(frustum(), s_Objects, visible); }, teardown });
+}
+
+//a street level view of a city: 32x32 box buildings as occluders (12 triangles each) in a
+//256x128 buffer, 64K small boxes between them as occludees. Rasterize fills the buffer, Test
+//runs every occludee against it
+static void AddOcclusionBenchmarks(BenchmarkRunner& runner)
+{
+    static const unsigned int s_Buildings{ 32 };
+    static const unsigned int s_Objects{ 64 * 1024 };
+    static std::unique_ptr<WorkerPool> workers;
+    static std::unique_ptr<OcclusionBuffer> occlusion;
+    static std::vector<Vec3> vertices;
+    static std::vector<unsigned int> indices;
+    static std::vector<Vec3> centers, extents;
+    static std::vector<unsigned int> objects;
+    static Mat4 viewProjection;
+    static auto addBox = [](const Vec3& center, const Vec3& extent, std::vector<Vec3>& boxVertices, std::vector<unsigned int>& boxIndices) {
+        static const unsigned int s_Faces[6][4]{ { 0, 1, 3, 2 }, { 4, 5, 7, 6 }, { 0, 1, 5, 4 }, { 2, 3, 7, 6 }, { 0, 2, 6, 4 }, { 1, 3, 7, 5 } };
+        unsigned int base{ (unsigned int)boxVertices.size() };
+        for (unsigned int corner = 0; corner < 8; corner++)
+        {
+            boxVertices.push_back({ center.X + (corner & 1 ? extent.X : -extent.X), center.Y + (corner & 2 ? extent.Y : -extent.Y),
+                center.Z + (corner & 4 ? extent.Z : -extent.Z) });
+        }
+        for (const unsigned int* face : s_Faces)
+        {
+            for (unsigned int corner : { face[0], face[1], face[2], face[0], face[2], face[3] })
+                boxIndices.push_back(base + corner);
+        }
+    };
+    //one wall whose edges fall inside SIMD blocks: a box behind it is culled, boxes in front of
+    //it or peeking past its edge are kept, with and without workers
+    static auto checkWall = [](WorkerPool* pool) {
+        OcclusionBuffer buffer(100, 40);
+        std::vector<Vec3> wallVertices;
+        std::vector<unsigned int> wallIndices;
+        addBox({ 0.3f, 0.0f, -10.0f }, { 3.0f, 2.0f, 0.1f }, wallVertices, wallIndices);
+        buffer.Begin(Mat4::Perspective(1.2f, (float)buffer.GetWidth() / buffer.GetHeight(), 0.5f, 200.0f) *
+            Mat4::LookAt({ 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, -1.0f }, { 0.0f, 1.0f, 0.0f }));
+        buffer.AddOccluder(wallVertices.data(), (unsigned int)wallVertices.size(), wallIndices.data(), (unsigned int)wallIndices.size(), Mat4::Identity());
+        buffer.Rasterize(pool);
+        ASSERT(!buffer.IsVisible({ 0.3f, 0.0f, -20.0f }, { 1.0f, 1.0f, 1.0f }));
+        ASSERT(buffer.IsVisible({ 0.3f, 0.0f, -5.0f }, { 1.0f, 1.0f, 1.0f }));
+        ASSERT(buffer.IsVisible({ 6.3f, 0.0f, -20.0f }, { 0.5f, 0.5f, 0.5f }));
+        ASSERT(buffer.IsVisible({ -5.7f, 0.0f, -20.0f }, { 0.5f, 0.5f, 0.5f }));
+    };
+    auto setup = []() {
+        workers = std::make_unique<WorkerPool>();
+        checkWall(nullptr);
+        checkWall(workers.get());
+        occlusion = std::make_unique<OcclusionBuffer>(256, 128);
+        unsigned int seed{ 777 };
+        auto random = [&seed]() {
+            seed = seed * 1664525u + 1013904223u;
+            return (float)(seed >> 8) / (float)(1u << 24);
+        };
+        vertices.clear();
+        indices.clear();
+        for (unsigned int i = 0; i < s_Buildings * s_Buildings; i++)
+        {
+            float height{ 10.0f + random() * 30.0f };
+            addBox({ (i % s_Buildings) * 20.0f - 310.0f, height * 0.5f, (i / s_Buildings) * 20.0f - 310.0f }, { 6.0f, height * 0.5f, 6.0f }, vertices, indices);
+        }
+        centers.clear();
+        extents.clear();
+        for (unsigned int i = 0; i < s_Objects; i++)
+        {
+            centers.push_back({ random() * 640.0f - 320.0f, 1.0f, random() * 640.0f - 320.0f });
+            extents.push_back({ 0.5f, 1.0f, 0.5f });
+        }
+        objects.resize(s_Objects);
+        viewProjection = Mat4::Perspective(1.0f, 2.0f, 0.5f, 1000.0f) * Mat4::LookAt({ 0.0f, 2.0f, 0.0f }, { 0.3f, 2.0f, -1.0f }, { 0.0f, 1.0f, 0.0f });
+        occlusion->Begin(viewProjection);
+        occlusion->AddOccluder(vertices.data(), (unsigned int)vertices.size(), indices.data(), (unsigned int)indices.size(), Mat4::Identity());
+        occlusion->Rasterize(workers.get());
+
+        //batches in parallel keep the same objects in the same order
+        std::vector<unsigned int> serial(s_Objects);
+        for (unsigned int i = 0; i < s_Objects; i++)
+            objects[i] = serial[i] = i;
+        serial.resize(occlusion->Cull(centers.data(), extents.data(), serial.data(), s_Objects, serial.data()));
+        objects.resize(occlusion->Cull(centers.data(), extents.data(), objects.data(), s_Objects, objects.data(), workers.get()));
+        ASSERT(!serial.empty() && serial.size() < s_Objects && objects == serial);
+        objects.resize(s_Objects);
+    };
+    auto teardown = []() {
+        occlusion.reset();
+        workers.reset();
+        for (std::vector<Vec3>* array : { &vertices, &centers, &extents })
+        {
+            array->clear();
+            array->shrink_to_fit();
+        }
+        indices.clear();
+        indices.shrink_to_fit();
+        objects.clear();
+        objects.shrink_to_fit();
+    };
+    auto rasterize = [](WorkerPool* pool) {
+        occlusion->Begin(viewProjection);
+        occlusion->AddOccluder(vertices.data(), (unsigned int)vertices.size(), indices.data(), (unsigned int)indices.size(), Mat4::Identity());
+        occlusion->Rasterize(pool);
+    };
+    auto test = [](WorkerPool* pool) {
+        for (unsigned int i = 0; i < s_Objects; i++)
+            objects[i] = i;
+        occlusion->Cull(centers.data(), extents.data(), objects.data(), s_Objects, objects.data(), pool);
+    };
+    std::string size{ "256x128" };
+    std::string count{ std::to_string(s_Objects / 1024) + "K" };
+
+    runner.Add({ "Occlusion/Rasterize/" + size, 0.0, setup, [rasterize]() { rasterize(nullptr); }, teardown });
+    runner.Add({ "Occlusion/Rasterize/" + size + "/Parallel", 0.0, setup, [rasterize]() { rasterize(workers.get()); }, teardown });
+    runner.Add({ "Occlusion/Test/" + count, 0.0, setup, [test]() { test(nullptr); }, teardown });
+    runner.Add({ "Occlusion/Test/" + count + "/Parallel", 0.0, setup, [test]() { test(workers.get()); }, teardown });
+}
+
+//request + create + release through the handle manager, the deletes land frames later
+static void AddResourceBenchmarks(BenchmarkRunner& runner)
+{
+    static std::unique_ptr<ResourceManager> resources;
+    static std::vector<unsigned char> data(64 * 1024, 0x5a);
+    runner.Add({ "ResourceManager/Churn/64K", (double)data.size(),
+        []() { resources = std::make_unique<ResourceManager>(); },
+        []() {
+            VertexBufferHandle handle{ resources->RequestVertexBuffer(data.data(), (unsigned int)data.size()) };
+            resources->ProcessRequests();
+            ASSERT(resources->Get(handle) != nullptr);
+            resources->Release(handle);
+            ASSERT(resources->Get(handle) == nullptr);
+            resources->EndFrame();
+            FrameArena::EndFrame();
+            glFinish();
+        },
+        []() { resources.reset(); } });
+}
+
+static void AddShaderBenchmarks(BenchmarkRunner& runner)
+{
+    runner.Add({ "Shader/Parse", 0.0, nullptr, []() {
+        ShaderProgramSource source{ ParseShader(s_ShaderPath) };
+        ASSERT(!source.VertexSource.empty());
+        FrameArena::EndFrame();
+    }, nullptr });
+
+    static ShaderProgramSource source;
+    runner.Add({ "Shader/Create", 0.0, []() { source = ParseShader(s_ShaderPath); }, []() {
+        unsigned int program{ CreateShader(source.VertexSource, source.FragmentSouce) };
+        GLCall(glDeleteProgram(program));
+    }, nullptr });
+}
+
+//the quad path from main(): one VAO, a VertexBuffer, an IndexBuffer and a u_Color update per draw
+struct QuadScene
+{
+    unsigned int VertexArrayID { 0 };
+    std::unique_ptr<VertexBuffer> Vertices;
+    std::unique_ptr<IndexBuffer> Indices;
+    unsigned int Shader { 0 };
+    int Location { -1 };
+
+    void Create()
+    {
+        float positions[] {
+            -0.5f, -0.5f,
+             0.5f, -0.5f,
+             0.5f,  0.5f,
+            -0.5f,  0.5f
+        };
+        unsigned int indices[] {
+            0, 1, 2,
+            2, 3, 0
+        };
+
+        GLCall(glGenVertexArrays(1, &VertexArrayID));
+        GLCall(glBindVertexArray(VertexArrayID));
+        Vertices = std::make_unique<VertexBuffer>(positions, 4 * 2 * sizeof(float));
+        GLCall(glEnableVertexAttribArray(0));
+        GLCall(glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 2, 0));
+        Indices = std::make_unique<IndexBuffer>(indices, 6);
+
+        ShaderProgramSource source{ ParseShader(s_ShaderPath) };
+        Shader = CreateShader(source.VertexSource, source.FragmentSouce);
+        GLCall(glUseProgram(Shader));
+        GLCall(Location = glGetUniformLocation(Shader, "u_Color"));
+        ASSERT(Location != -1);
+    }
+
+    void Draw(unsigned int quads)
+    {
+        GLCall(glClear(GL_COLOR_BUFFER_BIT));
+        for (unsigned int i = 0; i < quads; i++)
+        {
+            GLCall(glUniform4f(Location, (i % 256) / 255.0f, 0.3f, 0.8f, 1.0f));
+            GLCall(glBindVertexArray(VertexArrayID));
+            Indices->Bind();
+            GLCall(glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr));
+        }
+        glFinish();
+    }
+
+    void Destroy()
+    {
+        Indices.reset();
+        Vertices.reset();
+        GLCall(glDeleteVertexArrays(1, &VertexArrayID));
+        GLCall(glDeleteProgram(Shader));
+    }
+};
+
+static void AddDrawBenchmarks(BenchmarkRunner& runner)
+{
+    static QuadScene scene;
+    static const unsigned int counts[] { 1, 100, 1000 };
+    for (unsigned int quads : counts)
+    {
+        runner.Add({ "Draw/Quad/" + std::to_string(quads), 0.0,
+            []() { scene.Create(); },
+            [quads]() { scene.Draw(quads); },
+            []() { scene.Destroy(); } });
+    }
+}
+
+//many tiny quads so the cost is the per mesh binding, not the rasterization.
+//"Separate" is one VAO/VertexBuffer/IndexBuffer per mesh, "Pooled" one GeometryPool
+struct MeshScene
+{
+    static constexpr unsigned int s_Meshes{ 1000 };
+
+    std::vector<unsigned int> VertexArrays;
+    std::vector<VertexBuffer> Vertices;
+    std::vector<IndexBuffer> Indices;
+    std::unique_ptr<GeometryPool> Pool;
+    std::vector<GeometryHandle> Handles;
+    unsigned int Shader { 0 };
+
+    static void MakeQuad(unsigned int i, float* positions)
+    {
+        float x{ -1.0f + 2.0f * (i % 40) / 40.0f };
+        float y{ -1.0f + 2.0f * (i / 40) / 25.0f };
+        float quad[] { x, y, x + 0.01f, y, x + 0.01f, y + 0.01f, x, y + 0.01f };
+        std::memcpy(positions, quad, sizeof(quad));
+    }
+
+    void Create(bool pooled)
+    {
+        unsigned int indices[] { 0, 1, 2, 2, 3, 0 };
+        VertexBufferLayout layout;
+        layout.Push<float>(2);
+        if (pooled)
+            Pool = std::make_unique<GeometryPool>(layout, 1024, 1024);
+
+        for (unsigned int i = 0; i < s_Meshes; i++)
+        {
+            float positions[8];
+            MakeQuad(i, positions);
+            if (pooled)
+            {
+                Handles.push_back(Pool->Add(positions, 4, indices, 6));
+                continue;
+            }
+            unsigned int vao;
+            GLCall(glGenVertexArrays(1, &vao));
+            GLCall(glBindVertexArray(vao));
+            Vertices.emplace_back(positions, (unsigned int)sizeof(positions));
+            layout.Apply();
+            Indices.emplace_back(indices, 6);
+            VertexArrays.push_back(vao);
+        }
+
+        ShaderProgramSource source{ ParseShader(s_ShaderPath) };
+        Shader = CreateShader(source.VertexSource, source.FragmentSouce);
+        GLCall(glUseProgram(Shader));
+    }
+
+    void Draw()
+    {
+        GLCall(glClear(GL_COLOR_BUFFER_BIT));
+        if (Pool)
+        {
+            Pool->Bind();
+            for (GeometryHandle handle : Handles)
+                Pool->Draw(handle);
+        }
+        else
+        {
+            for (unsigned int vao : VertexArrays)
+            {
+                GLCall(glBindVertexArray(vao));
+                GLCall(glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr));
+            }
+        }
+        glFinish();
+    }
+
+    void Destroy()
+    {
+        if (!VertexArrays.empty())
+        {
+            GLCall(glDeleteVertexArrays((GLsizei)VertexArrays.size(), VertexArrays.data()));
+        }
+        VertexArrays.clear();
+        Vertices.clear();
+        Indices.clear();
+        Handles.clear();
+        Pool.reset();
+        GLCall(glDeleteProgram(Shader));
+    }
+};
+
+static void AddMeshBenchmarks(BenchmarkRunner& runner)
+{
+    static MeshScene scene;
+    runner.Add({ "Draw/Meshes/Separate/1000", 0.0,
+        []() { scene.Create(false); }, []() { scene.Draw(); }, []() { scene.Destroy(); } });
+    runner.Add({ "Draw/Meshes/Pooled/1000", 0.0,
+        []() { scene.Create(true); }, []() { scene.Draw(); }, []() { scene.Destroy(); } });
+}
+
+//decode of the sample asset and a 2048x2048 upload: straight from client memory vs through
+//the PBO ring (the streamed case also pays for copying the image into the queue)
+static void AddTextureBenchmarks(BenchmarkRunner& runner)
+{
+    static const std::string texturePath{ std::string(OPENGL_RES_DIR) + "/textures/checker.tga" };
+    runner.Add({ "Texture/Decode/TGA/256", 0.0, nullptr, []() {
+        Image image;
+        DecodeImage(texturePath, image);
+        ASSERT(image.IsValid());
+    }, nullptr });
+
+    static const unsigned int size{ 2048 };
+    static Image image;
+    image.Width = image.Height = size;
+    image.Pixels.assign((size_t)size * size * 4, 0x5a);
+
+    runner.Add({ "Texture/Upload/Direct/2048", (double)image.GetSize(), nullptr, []() {
+        Texture texture(size, size);
+        texture.SetData(0, 0, 0, size, size, image.Pixels.data());
+        glFinish();
+    }, nullptr });
+
+    static std::unique_ptr<WorkerPool> workers;
+    static std::unique_ptr<TextureStreamer> streamer;
+    runner.Add({ "Texture/Upload/Streamed/2048", (double)image.GetSize(),
+        []() {
+            workers = std::make_unique<WorkerPool>(1);
+            streamer = std::make_unique<TextureStreamer>(*workers, 0);
+        },
+        []() {
+            TextureHandle handle{ streamer->Load(image, false) };
+            streamer->Flush();
+            glFinish();
+            streamer->Release(handle);
+        },
+        []() {
+            streamer.reset();
+            workers.reset();
+        } });
+}
+
+//smooth gradients with a little noise on top, closer to real textures than a flat color
+static Image MakeEncodeImage(unsigned int size)
+{
+    Image image;
+    image.Width = image.Height = size;
+    image.Pixels.resize(image.GetRowSize() * size);
+    unsigned int seed{ 1 };
+    for (unsigned int y = 0; y < size; y++)
+    {
+        for (unsigned int x = 0; x < size; x++)
+        {
+            seed = seed * 1103515245 + 12345;
+            int noise{ (int)((seed >> 16) % 9) - 4 };
+            unsigned char* pixel{ image.Pixels.data() + (y * size + x) * 4 };
+            pixel[0] = (unsigned char)std::min(std::max((int)(128 + 100 * std::sin(x * 0.02) * std::cos(y * 0.03)) + noise, 0), 255);
+            pixel[1] = (unsigned char)std::min(std::max((int)(x * 255 / size) + noise, 0), 255);
+            pixel[2] = (unsigned char)std::min(std::max((int)(y * 255 / size) - noise, 0), 255);
+            pixel[3] = (unsigned char)((x ^ y) & 255);
+        }
+    }
+    return image;
+}
+
+struct EncodeFormat
+{
+    const char* Name;
+    unsigned int InternalFormat;
+};
+
+static const EncodeFormat s_EncodeFormats[]{
+    { "BC1", GL_COMPRESSED_RGB_S3TC_DXT1_EXT },
+    { "BC3", GL_COMPRESSED_RGBA_S3TC_DXT5_EXT },
+    { "BC4", GL_COMPRESSED_RED_RGTC1 },
+    { "BC5", GL_COMPRESSED_RG_RGTC2 }
+};
+static const unsigned int s_EncodeSize{ 1024 };
+
+//BytesPerOp is the RGBA8 source, so MiB/s here is input consumed. ReportEncodeQuality() turns
+//the timings into MPixels/s next to the PSNR of each format
+static void AddEncodeBenchmarks(BenchmarkRunner& runner)
+{
+    static Image image{ MakeEncodeImage(s_EncodeSize) };
+    static std::unique_ptr<WorkerPool> workers;
+    std::string size{ std::to_string(s_EncodeSize) };
+    for (const EncodeFormat& format : s_EncodeFormats)
+    {
+        unsigned int internalFormat{ format.InternalFormat };
+        runner.Add({ std::string("Texture/Encode/") + format.Name + "/" + size, (double)image.GetSize(), nullptr,
+            [internalFormat]() {
+                CompressedImage compressed;
+                EncodeImage(image, internalFormat, compressed);
+            }, nullptr });
+        runner.Add({ std::string("Texture/Encode/") + format.Name + "/" + size + "/Parallel", (double)image.GetSize(),
+            []() { workers = std::make_unique<WorkerPool>(); },
+            [internalFormat]() {
+                CompressedImage compressed;
+                EncodeImage(image, internalFormat, compressed, workers.get());
+            },
+            []() { workers.reset(); } });
+    }
+
+    //same 2048^2 as Texture/Upload/Direct, a quarter of the bytes cross the bus
+    static CompressedImage compressed;
+    runner.Add({ "Texture/Upload/BC3/2048", 0.0,
+        []() { EncodeImage(MakeEncodeImage(2048), GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, compressed); },
+        []() {
+            Texture texture(compressed);
+            glFinish();
+        },
+        []() { compressed = CompressedImage(); } });
+}
+
+//glGenerateMipmap against MipGenerator. the CPU cases include uploading every level, so both
+//end with the same texture on the GPU
+static void AddMipmapBenchmarks(BenchmarkRunner& runner)
+{
+    struct CpuVariant
+    {
+        const char* Name;
+        MipOptions Options;
+    };
+    static const CpuVariant s_Variants[]{
+        { "Box", { MipFilter::Box, false } },
+        { "Box/sRGB", { MipFilter::Box, true } },
+        { "Kaiser", { MipFilter::Kaiser, false } }
+    };
+    static std::unique_ptr<WorkerPool> workers;
+    static std::unique_ptr<Texture> texture;
+
+    for (unsigned int size : { 512u, 2048u })
+    {
+        std::shared_ptr<Image> image{ std::make_shared<Image>(MakeEncodeImage(size)) };
+        runner.Add({ "Texture/Mipmaps/GPU/" + std::to_string(size), 0.0,
+            [image]() {
+                texture = std::make_unique<Texture>(image->Width, image->Height, 0);
+                texture->SetData(0, 0, 0, image->Width, image->Height, image->Pixels.data());
+            },
+            []() {
+                texture->GenerateMipmaps();
+                glFinish();
+            },
+            []() { texture.reset(); } });
+
+        for (const CpuVariant& variant : s_Variants)
+        {
+            MipOptions options{ variant.Options };
+            runner.Add({ std::string("Texture/Mipmaps/CPU/") + variant.Name + "/" + std::to_string(size), 0.0,
+                [image]() {
+                    workers = std::make_unique<WorkerPool>();
+                    texture = std::make_unique<Texture>(image->Width, image->Height, 0);
+                },
+                [image, options]() {
+                    std::vector<Image> mips;
+                    GenerateMipChain(*image, mips, options, workers.get());
+                    for (unsigned int level = 0; level < mips.size(); level++)
+                        texture->SetData(level + 1, 0, 0, mips[level].Width, mips[level].Height, mips[level].Pixels.data());
+                    glFinish();
+                },
+                []() {
+                    texture.reset();
+                    workers.reset();
+                } });
+        }
+    }
+}
+
+static void ReportEncodeQuality(const std::vector<BenchmarkResult>& results, std::vector<std::pair<std::string, std::string>>& info)
+{
+    Image image{ MakeEncodeImage(s_EncodeSize) };
+    double pixels{ (double)image.Width * image.Height };
+    for (const EncodeFormat& format : s_EncodeFormats)
+    {
+        std::string prefix{ std::string("Texture/Encode/") + format.Name + "/" };
+        bool measured{ false };
+        for (const BenchmarkResult& result : results)
+        {
+            if (result.Name.compare(0, prefix.size(), prefix) != 0)
+                continue;
+            measured = true;
+            std::cerr << std::left << std::setw(40) << result.Name << std::right << std::fixed << std::setprecision(1)
+                << std::setw(10) << pixels / result.MedianNs() * 1e3 << " MPixels/s" << std::defaultfloat << std::endl;
+        }
+        if (!measured)
+            continue;
+
+        CompressedImage compressed;
+        EncodeImage(image, format.InternalFormat, compressed);
+        double psnr{ ComputePsnr(image, compressed) };
+        std::cerr << std::left << std::setw(40) << (std::string(format.Name) + " PSNR") << std::right << std::fixed
+            << std::setprecision(2) << std::setw(10) << psnr << " dB" << std::defaultfloat << std::endl;
+        std::string name{ format.Name };
+        std::transform(name.begin(), name.end(), name.begin(), [](char c) { return (char)std::tolower(c); });
+        info.push_back({ "psnr_" + name, std::to_string(psnr) });
+    }
+}
+
+//many small sprites that each have their own image. "Separate" binds one Texture per sprite
+//and draws them one by one, "Atlas" packs the images into a TextureAtlas so a single bind
+//and a single draw cover all of them
+struct SpriteScene
+{
+    static constexpr unsigned int s_Sprites{ 1000 };
+    static constexpr unsigned int s_ImageSize{ 32 };
+
+    unsigned int VertexArrayID { 0 };
+    std::unique_ptr<VertexBuffer> Vertices;
+    std::unique_ptr<IndexBuffer> Indices;
+    std::vector<Texture> Textures;
+    std::unique_ptr<TextureAtlas> Atlas;
+    std::vector<AtlasHandle> Handles;
+    unsigned int Shader { 0 };
+
+    static Image MakeImage(unsigned int i)
+    {
+        Image image;
+        image.Width = image.Height = s_ImageSize;
+        image.Pixels.resize(image.GetRowSize() * image.Height);
+        for (size_t p = 0; p < image.Pixels.size(); p += 4)
+        {
+            image.Pixels[p + 0] = (unsigned char)(i * 37);
+            image.Pixels[p + 1] = (unsigned char)(i * 91 + p / 128);
+            image.Pixels[p + 2] = (unsigned char)(i * 13);
+            image.Pixels[p + 3] = 255;
+        }
+        return image;
+    }
+
+    void Create(bool atlas)
+    {
+        GLCall(glGenVertexArrays(1, &VertexArrayID));
+        GLCall(glBindVertexArray(VertexArrayID));
+        if (atlas)
+            Atlas = std::make_unique<TextureAtlas>(1024, 2, 2);
+
+        std::vector<float> vertices;
+        std::vector<unsigned int> indices;
+        for (unsigned int i = 0; i < s_Sprites; i++)
+        {
+            float x{ -1.0f + 2.0f * (i % 40) / 40.0f };
+            float y{ -1.0f + 2.0f * (i / 40) / 25.0f };
+            float u0{ 0.0f }, v0{ 0.0f }, u1{ 1.0f }, v1{ 1.0f }, layer{ 0.0f };
+            if (atlas)
+            {
+                Handles.push_back(Atlas->Insert(MakeImage(i)));
+                const AtlasRegion* region{ Atlas->Get(Handles.back()) };
+                ASSERT(region);
+                u0 = region->U0; v0 = region->V0; u1 = region->U1; v1 = region->V1;
+                layer = (float)region->Layer;
+            }
+            else
+            {
+                Image image{ MakeImage(i) };
+                Textures.emplace_back(s_ImageSize, s_ImageSize);
+                Textures.back().SetData(0, 0, 0, s_ImageSize, s_ImageSize, image.Pixels.data());
+            }
+
+            float corners[][4] { { x, y, u0, v0 }, { x + 0.04f, y, u1, v0 }, { x + 0.04f, y + 0.07f, u1, v1 }, { x, y + 0.07f, u0, v1 } };
+            for (const float* corner : corners)
+            {
+                vertices.insert(vertices.end(), corner, corner + 4);
+                if (atlas)
+                    vertices.push_back(layer);
+            }
+            //the separate path draws each quad with a base vertex, the atlas path all at once
+            unsigned int base{ atlas ? i * 4 : 0 };
+            if (atlas || i == 0)
+                indices.insert(indices.end(), { base, base + 1, base + 2, base + 2, base + 3, base });
+        }
+        if (Atlas)
+            Atlas->Update();
+
+        Vertices = std::make_unique<VertexBuffer>(vertices.data(), (unsigned int)(vertices.size() * sizeof(float)));
+        VertexBufferLayout layout;
+        layout.Push<float>(2);
+        layout.Push<float>(atlas ? 3 : 2);
+        layout.Apply();
+        Indices = std::make_unique<IndexBuffer>(indices.data(), (unsigned int)indices.size());
+
+        ShaderProgramSource source{ ParseShader(std::string(OPENGL_RES_DIR) + (atlas ? "/shader/Sprite.shader" : "/shader/Texture.shader")) };
+        Shader = CreateShader(source.VertexSource, source.FragmentSouce);
+        GLCall(glUseProgram(Shader));
+        GLCall(int location = glGetUniformLocation(Shader, atlas ? "u_Atlas" : "u_Texture"));
+        GLCall(glUniform1i(location, 0));
+        if (!atlas)
+        {
+            GLCall(location = glGetUniformLocation(Shader, "u_Color"));
+            GLCall(glUniform4f(location, 1.0f, 1.0f, 1.0f, 1.0f));
+        }
+    }
+
+    void Draw()
+    {
+        GLCall(glClear(GL_COLOR_BUFFER_BIT));
+        GLCall(glBindVertexArray(VertexArrayID));
+        if (Atlas)
+        {
+            Atlas->Bind(0);
+            GLCall(glDrawElements(GL_TRIANGLES, 6 * s_Sprites, GL_UNSIGNED_INT, nullptr));
+        }
+        else
+        {
+            for (unsigned int i = 0; i < s_Sprites; i++)
+            {
+                Textures[i].Bind(0);
+                GLCall(glDrawElementsBaseVertex(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr, i * 4));
+            }
+        }
+        glFinish();
+    }
+
+    void Destroy()
+    {
+        Indices.reset();
+        Vertices.reset();
+        Textures.clear();
+        Handles.clear();
+        Atlas.reset();
+        GLCall(glDeleteVertexArrays(1, &VertexArrayID));
+        GLCall(glDeleteProgram(Shader));
+    }
+};
+
+static void AddSpriteBenchmarks(BenchmarkRunner& runner)
+{
+    static SpriteScene scene;
+    runner.Add({ "Draw/Sprites/Separate/1000", 0.0,
+        []() { scene.Create(false); }, []() { scene.Draw(); }, []() { scene.Destroy(); } });
+    runner.Add({ "Draw/Sprites/Atlas/1000", 0.0,
+        []() { scene.Create(true); }, []() { scene.Draw(); }, []() { scene.Destroy(); } });
+
+    //half of the images removed, then a full repack of the remaining 500
+    static std::unique_ptr<TextureAtlas> atlas;
+    runner.Add({ "TextureAtlas/Repack/500", 0.0,
+        []() {
+            atlas = std::make_unique<TextureAtlas>(1024, 2, 2);
+            atlas->SetRepackThreshold(1.0f);
+            for (unsigned int i = 0; i < SpriteScene::s_Sprites; i++)
+            {
+                AtlasHandle handle{ atlas->Insert(SpriteScene::MakeImage(i)) };
+                if (i % 2)
+                    atlas->Remove(handle);
+            }
+        },
+        []() {
+            atlas->Compact();
+            glFinish();
+        },
+        []() { atlas.reset(); } });
+}
+
+//a 4096x4096 virtual texture on a fullscreen quad that pans and zooms every frame: feedback
+//pass, readback, page reads on the pool, uploads within the per frame limit and the real pass
+struct VirtualTextureScene
+{
+    static constexpr unsigned int s_Size{ 4096 };
+
+    std::string PagePath;
+    std::unique_ptr<WorkerPool> Workers;
+    std::unique_ptr<VirtualTexture> Virtual;
+    std::unique_ptr<VertexBuffer> Vertices;
+    unsigned int VertexArrayID { 0 };
+    unsigned int Shader { 0 };
+    unsigned int Frame { 0 };
+
+    void Create()
+    {
+        PagePath = (std::filesystem::temp_directory_path() / "opengl_bench.vtp").string();
+        Workers = std::make_unique<WorkerPool>();
+        PageFile::Write(PagePath, MakeEncodeImage(s_Size), 128, 4, Workers.get());
+        Virtual = std::make_unique<VirtualTexture>(PagePath, *Workers, 12);
+        ASSERT(Virtual->IsValid());
+
+        GLCall(glGenVertexArrays(1, &VertexArrayID));
+        GLCall(glBindVertexArray(VertexArrayID));
+        const float vertices[]{ -1.0f, -1.0f, 0.0f, 0.0f, 1.0f, -1.0f, 1.0f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f, -1.0f, 1.0f, 0.0f, 1.0f };
+        Vertices = std::make_unique<VertexBuffer>(vertices, (unsigned int)sizeof(vertices));
+        VertexBufferLayout layout;
+        layout.Push<float>(2);
+        layout.Push<float>(2);
+        layout.Apply();
+
+        ShaderProgramSource source{ ParseShader(std::string(OPENGL_RES_DIR) + "/shader/VirtualTexture.shader") };
+        Shader = CreateShader(source.VertexSource, source.FragmentSouce);
+        Frame = 0;
+    }
+
+    void Draw()
+    {
+        //zooms between a quarter and all of the texture while drifting across it
+        float t{ Frame++ * 0.01f };
+        float scale{ 0.25f + 0.375f * (1.0f + std::sin(t * 0.7f)) };
+        float x{ (1.0f - scale) * 0.5f * (1.0f + std::sin(t)) };
+        float y{ (1.0f - scale) * 0.5f * (1.0f + std::cos(t * 1.3f)) };
+
+        GLint viewport[4];
+        GLCall(glGetIntegerv(GL_VIEWPORT, viewport));
+        GLCall(glBindVertexArray(VertexArrayID));
+        Virtual->BeginFeedback(Shader, viewport[2]);
+        GLCall(glUniform4f(glGetUniformLocation(Shader, "u_TexCoordTransform"), scale, scale, x, y));
+        GLCall(glDrawArrays(GL_TRIANGLE_FAN, 0, 4));
+        Virtual->EndFeedback();
+        Virtual->Update();
+
+        GLCall(glClear(GL_COLOR_BUFFER_BIT));
+        Virtual->Bind(Shader);
+        GLCall(glDrawArrays(GL_TRIANGLE_FAN, 0, 4));
+        glFinish();
+    }
+
+    void Destroy()
+    {
+        Virtual.reset();
+        Workers.reset();
+        Vertices.reset();
+        GLCall(glDeleteVertexArrays(1, &VertexArrayID));
+        GLCall(glDeleteProgram(Shader));
+        std::filesystem::remove(PagePath);
+    }
+};
+
+static void AddVirtualTextureBenchmarks(BenchmarkRunner& runner)
+{
+    static VirtualTextureScene scene;
+    runner.Add({ "VirtualTexture/Frame/" + std::to_string(VirtualTextureScene::s_Size), 0.0,
+        []() { scene.Create(); }, []() { scene.Draw(); }, []() { scene.Destroy(); } });
+}
+
+//64 textures of 512x512 against a 16 MiB budget, several times less than the whole set. each
+//frame draws a window of 8 of them at mixed footprints and the window slides every 10 frames,
+//so the manager keeps streaming levels in and trimming the least recently used ones
+static void AddResidencyBenchmarks(BenchmarkRunner& runner)
+{
+    static const unsigned int s_Count{ 64 }, s_Size{ 512 }, s_Window{ 8 };
+    static std::unique_ptr<WorkerPool> workers;
+    static std::unique_ptr<TextureResidency> residency;
+    static std::vector<ResidentTextureHandle> handles;
+    static unsigned int frame;
+
+    runner.Add({ "Texture/Residency/Frame/" + std::to_string(s_Count) + "x" + std::to_string(s_Size), 0.0,
+        []() {
+            workers = std::make_unique<WorkerPool>();
+            residency = std::make_unique<TextureResidency>(*workers, 16ull * 1024 * 1024, 4ull * 1024 * 1024);
+            Image image{ MakeEncodeImage(s_Size) };
+            for (unsigned int i = 0; i < s_Count; i++)
+                handles.push_back(residency->Load(image));
+            residency->Flush();
+            frame = 0;
+        },
+        []() {
+            unsigned int first{ frame / 10 * 3 };
+            for (unsigned int i = 0; i < s_Window; i++)
+                residency->Touch(handles[(first + i) % s_Count], (float)(s_Size >> (i % 3)));
+            residency->Update();
+            glFinish();
+            frame++;
+        },
+        []() {
+            handles.clear();
+            residency.reset();
+            workers.reset();
+        } });
+}
+
+//a displaced grid of (size + 1)^2 vertices with uvs and no normals, a material per 64 rows
+static std::string MakeGridObj(unsigned int size)
+{
+    std::string text;
+    char line[128];
+    for (unsigned int y = 0; y <= size; y++)
+    {
+        for (unsigned int x = 0; x <= size; x++)
+        {
+            std::snprintf(line, sizeof(line), "v %u %u %.6f\nvt %.6f %.6f\n", x, y, std::sin(x * 0.1) * std::cos(y * 0.1),
+                x / (double)size, y / (double)size);
+            text += line;
+        }
+    }
+    for (unsigned int y = 0; y < size; y++)
+    {
+        std::snprintf(line, sizeof(line), "usemtl row%u\n", y / 64);
+        text += line;
+        for (unsigned int x = 0; x < size; x++)
+        {
+            unsigned int a{ y * (size + 1) + x + 1 }, b{ a + 1 }, c{ a + size + 2 }, d{ a + size + 1 };
+            std::snprintf(line, sizeof(line), "f %u/%u %u/%u %u/%u %u/%u\n", a, a, b, b, c, c, d, d);
+            text += line;
+        }
+    }
+    return text;
+}
+
+//parsing, welding and normal generation of about 6 MiB of OBJ on the calling thread vs spread
+//over the pool
+static void AddMeshImportBenchmarks(BenchmarkRunner& runner)
+{
+    static const unsigned int s_Size{ 256 };
+    static std::string text;
+    static std::unique_ptr<WorkerPool> workers;
+    if (text.empty())
+        text = MakeGridObj(s_Size);
+
+    std::string name{ "Mesh/Import/Obj/" + std::to_string(s_Size) };
+    runner.Add({ name, (double)text.size(), nullptr,
+        []() {
+            MeshData mesh;
+            LoadObj(text.data(), text.size(), mesh);
+        }, nullptr });
+    runner.Add({ name + "/Parallel", (double)text.size(),
+        []() { workers = std::make_unique<WorkerPool>(); },
+        []() {
+            MeshData mesh;
+            LoadObj(text.data(), text.size(), mesh, workers.get());
+        },
+        []() { workers.reset(); } });
+
+    //the same model through the mesh cache once it is converted: hashing the source, mapping the
+    //cache file and uploading from the mapping, against parsing and uploading every time
+    static std::string sourcePath, cacheDirectory;
+    runner.Add({ name + "/Upload", (double)text.size(), nullptr,
+        []() {
+            MeshData mesh;
+            LoadObj(text.data(), text.size(), mesh);
+            VertexBuffer vertices(mesh.Vertices.data(), mesh.GetVertexBytes());
+            IndexBuffer indices(mesh.Indices.data(), mesh.GetIndexCount());
+            glFinish();
+        }, nullptr });
+    runner.Add({ name + "/Cached", (double)text.size(),
+        []() {
+            std::filesystem::path temp{ std::filesystem::temp_directory_path() };
+            sourcePath = (temp / "opengl_bench.obj").string();
+            cacheDirectory = (temp / "opengl_bench_meshes").string();
+            std::ofstream(sourcePath, std::ios::binary) << text;
+            MeshCache cache(cacheDirectory);
+            MeshFile file;
+            cache.Load(sourcePath, file);
+        },
+        []() {
+            MeshCache cache(cacheDirectory);
+            MeshFile file;
+            cache.Load(sourcePath, file);
+            VertexBuffer vertices(file.GetVertexData(), file.GetVertexBytes());
+            IndexBuffer indices(file.GetIndexData(), file.GetIndexCount());
+            glFinish();
+        },
+        []() {
+            std::filesystem::remove(sourcePath);
+            std::filesystem::remove_all(cacheDirectory);
+        } });
+}
+
+//decoding the grid mesh out of GeometryCodec, bytes are the decoded size so the numbers compare
+//with reading raw buffers
+static void AddGeometryCodecBenchmarks(BenchmarkRunner& runner)
+{
+    static const unsigned int s_Size{ 256 };
+    static MeshData mesh;
+    static std::vector<unsigned char> vertices, indices;
+    static std::vector<unsigned char> decoded;
+    auto setup = []() {
+        if (!mesh.Vertices.empty())
+            return;
+        std::string text{ MakeGridObj(s_Size) };
+        ASSERT(LoadObj(text.data(), text.size(), mesh));
+        EncodeVertexBuffer(mesh.Vertices.data(), mesh.GetVertexCount(), sizeof(MeshVertex), vertices);
+        EncodeIndexBuffer(mesh.Indices.data(), mesh.GetIndexCount(), indices);
+        decoded.resize(std::max<size_t>(mesh.GetVertexBytes(), mesh.Indices.size() * sizeof(unsigned int)));
+
+        //both streams decode back to the exact buffers they were encoded from
+        ASSERT(DecodeVertexBuffer(decoded.data(), mesh.GetVertexCount(), sizeof(MeshVertex), vertices.data(), vertices.size()));
+        ASSERT(std::memcmp(decoded.data(), mesh.Vertices.data(), mesh.GetVertexBytes()) == 0);
+        ASSERT(DecodeIndexBuffer((unsigned int*)decoded.data(), mesh.GetIndexCount(), indices.data(), indices.size()));
+        ASSERT(std::memcmp(decoded.data(), mesh.Indices.data(), mesh.Indices.size() * sizeof(unsigned int)) == 0);
+    };
+    //the grid welds to one vertex per grid point and two triangles per cell
+    size_t vertexBytes{ (size_t)(s_Size + 1) * (s_Size + 1) * sizeof(MeshVertex) };
+    size_t indexBytes{ (size_t)s_Size * s_Size * 6 * sizeof(unsigned int) };
+
+    runner.Add({ "Mesh/Codec/Vertex/Decode", (double)vertexBytes, setup,
+        []() {
+            DecodeVertexBuffer(decoded.data(), mesh.GetVertexCount(), sizeof(MeshVertex), vertices.data(), vertices.size());
+        }, nullptr });
+    runner.Add({ "Mesh/Codec/Index/Decode", (double)indexBytes, setup,
+        []() {
+            DecodeIndexBuffer((unsigned int*)decoded.data(), mesh.GetIndexCount(), indices.data(), indices.size());
+        }, nullptr });
+}
+
+//the grid OBJ from request to drawable through the AssetPipeline (IO thread, decode on the
+//workers, fenced upload). Mesh/Import/Obj/256/Upload plus reading the file from disk
+static void AddAssetPipelineBenchmarks(BenchmarkRunner& runner)
+{
+    static std::string sourcePath;
+    static std::unique_ptr<WorkerPool> workers;
+    static std::unique_ptr<ResourceManager> resources;
+    static std::unique_ptr<AssetPipeline> assets;
+    static std::string text;
+    if (text.empty())
+        text = MakeGridObj(256);
+    runner.Add({ "Asset/Load/Obj/256", (double)text.size(),
+        []() {
+            sourcePath = (std::filesystem::temp_directory_path() / "opengl_bench_asset.obj").string();
+            std::ofstream(sourcePath, std::ios::binary) << text;
+            workers = std::make_unique<WorkerPool>();
+            resources = std::make_unique<ResourceManager>();
+            assets = std::make_unique<AssetPipeline>(*workers, *resources);
+        },
+        []() {
+            MeshHandle mesh{ assets->LoadMesh(sourcePath) };
+            assets->Wait(mesh);
+            assets->Release(mesh);
+            resources->FlushRetired();
+        },
+        []() {
+            assets.reset();
+            resources.reset();
+            workers.reset();
+            std::filesystem::remove(sourcePath);
+        } });
+}
+
+//many small assets (shader sized text) read one by one: a loose file per asset against entries
+//of a pack, compressed and stored. bytes are the file contents read
+static void AddFileSystemBenchmarks(BenchmarkRunner& runner)
+{
+    static const unsigned int s_Files{ 256 };
+    static std::string directory, packPath, storedPath;
+    static std::vector<std::string> loosePaths, packPaths;
+    static std::string text;
+    if (text.empty())
+    {
+        //grid OBJ lines, repetitive like most text assets
+        text = MakeGridObj(256).substr(0, 4096 * s_Files);
+        std::filesystem::path temp{ std::filesystem::temp_directory_path() };
+        directory = (temp / "opengl_bench_assets").string();
+        packPath = (temp / "opengl_bench_assets.pack").string();
+        storedPath = (temp / "opengl_bench_assets_stored.pack").string();
+        for (unsigned int i = 0; i < s_Files; i++)
+        {
+            std::string name{ "asset" + std::to_string(i) + ".txt" };
+            loosePaths.push_back((std::filesystem::path(directory) / name).string());
+            packPaths.push_back("pack/" + name);
+        }
+    }
+    auto setup = []() {
+        std::filesystem::create_directories(directory);
+        for (unsigned int i = 0; i < s_Files; i++)
+            std::ofstream(loosePaths[i], std::ios::binary) << text.substr((size_t)i * 4096, 4096);
+        PackFile::Write(packPath, directory);
+        PackFile::Write(storedPath, directory, nullptr, false);
+    };
+    auto teardown = []() {
+        FileSystem::Get().UnmountAll();
+        std::filesystem::remove_all(directory);
+        std::filesystem::remove(packPath);
+        std::filesystem::remove(storedPath);
+    };
+    //touches the last byte so mapped files are faulted in as well
+    auto readAll = [](const std::vector<std::string>& paths) {
+        static unsigned int s_Checksum;
+        VirtualFile file;
+        for (const std::string& path : paths)
+        {
+            FileSystem::Get().Open(path, file);
+            if (file.GetSize())
+                s_Checksum += file.GetData()[file.GetSize() - 1];
+        }
+    };
+
+    //a few entries of the mounted pack read back the same as their loose files
+    auto checkPack = []() {
+        VirtualFile packed, loose;
+        for (unsigned int i : { 0u, 1u, s_Files / 2, s_Files - 1 })
+        {
+            ASSERT(FileSystem::Get().Open(packPaths[i], packed) && FileSystem::Get().Open(loosePaths[i], loose));
+            ASSERT(packed.GetSize() == loose.GetSize() && packed.GetSize() > 0);
+            ASSERT(std::memcmp(packed.GetData(), loose.GetData(), loose.GetSize()) == 0);
+        }
+    };
+
+    std::string name{ "Vfs/Read/" + std::to_string(s_Files) };
+    runner.Add({ name + "/Loose", (double)text.size(), setup, [readAll]() { readAll(loosePaths); }, teardown });
+    runner.Add({ name + "/Pack", (double)text.size(),
+        [setup, checkPack]() { setup(); FileSystem::Get().Mount(packPath, "pack"); checkPack(); },
+        [readAll]() { readAll(packPaths); }, teardown });
+    runner.Add({ name + "/Pack/Stored", (double)text.size(),
+        [setup, checkPack]() { setup(); FileSystem::Get().Mount(storedPath, "pack"); checkPack(); },
+        [readAll]() { readAll(packPaths); }, teardown });
+
+    static std::vector<unsigned char> compressed, decompressed;
+    runner.Add({ "Vfs/Lz4/Decompress", (double)text.size(),
+        []() {
+            Lz4Compress((const unsigned char*)text.data(), text.size(), compressed);
+            decompressed.resize(text.size());
+            ASSERT(Lz4Decompress(decompressed.data(), decompressed.size(), compressed.data(), compressed.size()));
+            ASSERT(std::memcmp(decompressed.data(), text.data(), text.size()) == 0);
+        },
+        []() { Lz4Decompress(decompressed.data(), decompressed.size(), compressed.data(), compressed.size()); },
+        []() {
+            compressed.clear();
+            compressed.shrink_to_fit();
+            decompressed.clear();
+            decompressed.shrink_to_fit();
+        } });
+}
+
+static void PrintUsage()
+{
+    std::cerr << "usage: opengl_bench [--out file.json] [--filter substring] [--repetitions n] [--min-time ms]\n"
+        "                    [--baseline file.json [--alpha p] [--threshold percent]]\n"
+        "exits with 2 when a case is significantly slower than the baseline, or allocates more per\n"
+        "operation (allocations are only counted with OPENGL_TRACK_ALLOCATIONS)" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    std::string outPath;
+    std::string baselinePath;
+    BenchmarkOptions options;
+    ComparisonOptions comparisonOptions;
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue{ i + 1 < argc };
+        if (!std::strcmp(argv[i], "--out") && hasValue)
+            outPath = argv[++i];
+        else if (!std::strcmp(argv[i], "--filter") && hasValue)
+            options.Filter = argv[++i];
+        else if ((!std::strcmp(argv[i], "--repetitions") || !std::strcmp(argv[i], "--samples")) && hasValue)
+            options.Samples = (unsigned int)std::stoul(argv[++i]);
+        else if (!std::strcmp(argv[i], "--min-time") && hasValue)
+            options.MinSampleMs = std::stod(argv[++i]);
+        else if (!std::strcmp(argv[i], "--baseline") && hasValue)
+            baselinePath = argv[++i];
+        else if (!std::strcmp(argv[i], "--alpha") && hasValue)
+            comparisonOptions.Alpha = std::stod(argv[++i]);
+        else if (!std::strcmp(argv[i], "--threshold") && hasValue)
+            comparisonOptions.ThresholdPercent = std::stod(argv[++i]);
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    std::vector<BenchmarkResult> baseline;
+    if (!baselinePath.empty() && !LoadBaseline(baselinePath, baseline))
+        return 1;
+
+    HeadlessContext context(1024, 768);
+    if (!context.IsValid())
+        return 1;
+    std::cerr << context.GetVersion() << " | " << context.GetRendererName() << std::endl;
+
+    BenchmarkRunner runner;
+    AddBufferBenchmarks(runner);
+    AddResourceBenchmarks(runner);
+    AddJobBenchmarks(runner);
+    AddMathBenchmarks(runner);
+    AddSceneGraphBenchmarks(runner);
+    AddEntityBenchmarks(runner);
+    AddCullingBenchmarks(runner);
+    AddOcclusionBenchmarks(runner);
+    AddPartialUpdateBenchmarks(runner);
+    AddShaderBenchmarks(runner);
+    AddDrawBenchmarks(runner);
+    AddMeshBenchmarks(runner);
+    AddTextureBenchmarks(runner);
+    AddEncodeBenchmarks(runner);
+    AddMipmapBenchmarks(runner);
+    AddSpriteBenchmarks(runner);
+    AddVirtualTextureBenchmarks(runner);
+    AddResidencyBenchmarks(runner);
+    AddMeshImportBenchmarks(runner);
+    AddGeometryCodecBenchmarks(runner);
+    AddFileSystemBenchmarks(runner);
+    AddAssetPipelineBenchmarks(runner);
+
+    //the renderer logs to std::cout (link status etc.), keep that out of the report
+    std::cout.setstate(std::ios::failbit);
+    std::vector<BenchmarkResult> results{ runner.RunAll(options) };
+    std::cout.clear();
+    Profiler::Get().Report(std::cerr);
+    GpuMemory::Get().Report(std::cerr);
+    if (AllocationTracker::IsEnabled())
+        AllocationTracker::Report(std::cerr);
+
+    std::vector<std::pair<std::string, std::string>> info {
+        { "gl_version", context.GetVersion() },
+        { "gl_renderer", context.GetRendererName() },
+        { "min_sample_ms", std::to_string(options.MinSampleMs) },
+        { "samples", std::to_string(options.Samples) },
+        { "allocation_tracking", AllocationTracker::IsEnabled() ? "on" : "off" }
+    };
+    ReportEncodeQuality(results, info);
+
+    std::vector<BenchmarkComparison> comparisons;
+    unsigned int regressions{ 0 };
+    if (!baseline.empty())
+    {
+        comparisons = CompareToBaseline(baseline, results, comparisonOptions);
+        regressions = PrintComparison(std::cerr, comparisons);
+        info.push_back({ "baseline", baselinePath });
+    }
+
+    if (outPath.empty())
+        WriteJson(std::cout, info, results, comparisons);
+    else
+    {
+        std::ofstream out(outPath);
+        if (!out)
+        {
+            std::cerr << "Failed to open " << outPath << std::endl;
+            return 1;
+        }
+        WriteJson(out, info, results, comparisons);
+    }
+    return regressions ? 2 : 0;
+}
@@ -0,0 +1,173 @@
+#include "Benchmark.h"
+#include "Statistics.h"
+#include "AllocationTracker.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <ostream>
+
+using Clock = std::chrono::steady_clock;
+
+double BenchmarkResult::MeanNs() const
+{
+    return Mean(SamplesNs);
+}
+
+double BenchmarkResult::MedianNs() const
+{
+    if (SamplesNs.empty())
+        return 0.0;
+    std::vector<double> sorted(SamplesNs);
+    std::sort(sorted.begin(), sorted.end());
+    size_t mid{ sorted.size() / 2 };
+    return sorted.size() % 2 ? sorted[mid] : 0.5 * (sorted[mid - 1] + sorted[mid]);
+}
+
+double BenchmarkResult::MinNs() const
+{
+    return SamplesNs.empty() ? 0.0 : *std::min_element(SamplesNs.begin(), SamplesNs.end());
+}
+
+double BenchmarkResult::BytesPerSecond() const
+{
+    double median{ MedianNs() };
+    return median > 0.0 ? BytesPerOp * 1e9 / median : 0.0;
+}
+
+void BenchmarkRunner::Add(BenchmarkCase benchmark)
+{
+    m_Cases.push_back(std::move(benchmark));
+}
+
+static double TimeBatch(const BenchmarkCase& benchmark, unsigned long long iterations)
+{
+    auto start{ Clock::now() };
+    for (unsigned long long i = 0; i < iterations; i++)
+        benchmark.Run();
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+std::vector<BenchmarkResult> BenchmarkRunner::RunAll(const BenchmarkOptions& options) const
+{
+    std::vector<BenchmarkResult> results;
+    for (const BenchmarkCase& benchmark : m_Cases)
+    {
+        if (!options.Filter.empty() && benchmark.Name.find(options.Filter) == std::string::npos)
+            continue;
+
+        if (benchmark.Setup)
+            benchmark.Setup();
+
+        //grow the batch until one sample takes at least MinSampleMs, this also warms up
+        double minNs{ options.MinSampleMs * 1e6 };
+        unsigned long long iterations{ 1 };
+        double elapsed{ TimeBatch(benchmark, iterations) };
+        while (elapsed < minNs && iterations < (1ull << 30))
+        {
+            double scale{ elapsed > 0.0 ? minNs / elapsed : 10.0 };
+            iterations = (unsigned long long)(iterations * std::min(std::max(scale * 1.2, 2.0), 10.0));
+            elapsed = TimeBatch(benchmark, iterations);
+        }
+
+        BenchmarkResult result{ benchmark.Name, iterations, benchmark.BytesPerOp, {} };
+        result.SamplesNs.reserve(options.Samples);
+        unsigned long long allocations{ AllocationTracker::GetTotalAllocations() };
+        for (unsigned int s = 0; s < options.Samples; s++)
+            result.SamplesNs.push_back(TimeBatch(benchmark, iterations) / iterations);
+        if (AllocationTracker::IsEnabled() && options.Samples)
+            result.AllocationsPerOp = (double)(AllocationTracker::GetTotalAllocations() - allocations) / ((double)iterations * options.Samples);
+
+        if (benchmark.Teardown)
+            benchmark.Teardown();
+
+        std::cerr << std::left << std::setw(40) << result.Name << std::right
+            << std::setw(14) << std::fixed << std::setprecision(1) << result.MedianNs() << " ns";
+        if (result.BytesPerOp > 0.0)
+            std::cerr << std::setw(12) << std::setprecision(1) << result.BytesPerSecond() / (1024.0 * 1024.0) << " MiB/s";
+        if (result.AllocationsPerOp >= 0.0)
+            std::cerr << std::setw(12) << std::setprecision(2) << result.AllocationsPerOp << " allocs/op";
+        std::cerr << std::endl;
+
+        results.push_back(std::move(result));
+    }
+    return results;
+}
+
+static void WriteString(std::ostream& out, const std::string& value)
+{
+    out << '"';
+    for (char c : value)
+    {
+        if (c == '"' || c == '\\')
+            out << '\\' << c;
+        else if ((unsigned char)c < 0x20)
+            out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)c << std::dec << std::setfill(' ');
+        else
+            out << c;
+    }
+    out << '"';
+}
+
+void WriteJson(std::ostream& out, const std::vector<std::pair<std::string, std::string>>& context,
+    const std::vector<BenchmarkResult>& results, const std::vector<BenchmarkComparison>& comparisons)
+{
+    out << std::setprecision(17) << "{\n  \"context\": {";
+    for (size_t i = 0; i < context.size(); i++)
+    {
+        out << (i ? ",\n    " : "\n    ");
+        WriteString(out, context[i].first);
+        out << ": ";
+        WriteString(out, context[i].second);
+    }
+    out << "\n  },\n  \"benchmarks\": [";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const BenchmarkResult& r{ results[i] };
+        ConfidenceInterval interval{ MeanConfidenceInterval95(r.SamplesNs) };
+        out << (i ? ",\n    {" : "\n    {") << "\n      \"name\": ";
+        WriteString(out, r.Name);
+        out << ",\n      \"iterations\": " << r.Iterations
+            << ",\n      \"mean_ns\": " << r.MeanNs()
+            << ",\n      \"median_ns\": " << r.MedianNs()
+            << ",\n      \"min_ns\": " << r.MinNs()
+            << ",\n      \"stddev_ns\": " << StandardDeviation(r.SamplesNs)
+            << ",\n      \"ci95_low_ns\": " << interval.Low
+            << ",\n      \"ci95_high_ns\": " << interval.High
+            << ",\n      \"bytes_per_op\": " << r.BytesPerOp
+            << ",\n      \"bytes_per_second\": " << r.BytesPerSecond();
+        if (r.AllocationsPerOp >= 0.0)
+            out << ",\n      \"allocations_per_op\": " << r.AllocationsPerOp;
+        out << ",\n      \"samples_ns\": [";
+        for (size_t s = 0; s < r.SamplesNs.size(); s++)
+            out << (s ? ", " : "") << r.SamplesNs[s];
+        out << "]\n    }";
+    }
+    out << "\n  ]";
+    if (!comparisons.empty())
+    {
+        out << ",\n  \"comparison\": [";
+        for (size_t i = 0; i < comparisons.size(); i++)
+        {
+            const BenchmarkComparison& c{ comparisons[i] };
+            out << (i ? ",\n    {" : "\n    {") << "\n      \"name\": ";
+            WriteString(out, c.Name);
+            out << ",\n      \"baseline_median_ns\": " << c.BaselineMedianNs
+                << ",\n      \"current_median_ns\": " << c.CurrentMedianNs
+                << ",\n      \"delta_percent\": " << c.DeltaPercent
+                << ",\n      \"p_value\": " << c.PValue
+                << ",\n      \"regression\": " << (c.Regression ? "true" : "false")
+                << ",\n      \"improvement\": " << (c.Improvement ? "true" : "false");
+            if (c.BaselineAllocationsPerOp >= 0.0 && c.CurrentAllocationsPerOp >= 0.0)
+            {
+                out << ",\n      \"baseline_allocations_per_op\": " << c.BaselineAllocationsPerOp
+                    << ",\n      \"current_allocations_per_op\": " << c.CurrentAllocationsPerOp
+                    << ",\n      \"allocation_regression\": " << (c.AllocationRegression ? "true" : "false");
+            }
+            out << "\n    }";
+        }
+        out << "\n  ]";
+    }
+    out << "\n}\n";
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+//one named scenario; Run() is a single operation and gets timed in batches
+struct BenchmarkCase
+{
+	std::string Name;
+	double BytesPerOp;                  //0 when the case is not a throughput case
+	std::function<void()> Setup;        //optional, runs once before timing
+	std::function<void()> Run;
+	std::function<void()> Teardown;     //optional, runs once after timing
+};
+
+struct BenchmarkResult
+{
+	std::string Name;
+	unsigned long long Iterations;      //operations per sample
+	double BytesPerOp;
+	std::vector<double> SamplesNs;      //mean ns per operation of each sample
+	double AllocationsPerOp { -1.0 };   //heap allocations per operation, -1 without allocation tracking
+
+	double MeanNs() const;
+	double MedianNs() const;
+	double MinNs() const;
+	double BytesPerSecond() const;
+};
+
+//one case measured against the stored baseline run
+struct BenchmarkComparison
+{
+	std::string Name;
+	double BaselineMedianNs;
+	double CurrentMedianNs;
+	double DeltaPercent;                //positive == slower than baseline
+	double PValue;
+	bool Regression;                    //significant and slower than the threshold
+	bool Improvement;                   //significant and faster than the threshold
+	double BaselineAllocationsPerOp { -1.0 };
+	double CurrentAllocationsPerOp { -1.0 };
+	bool AllocationRegression { false };    //allocates more per operation than the baseline
+};
+
+struct BenchmarkOptions
+{
+	std::string Filter;                 //substring match on the case name, empty runs all
+	double MinSampleMs { 20.0 };        //each sample runs at least this long
+	unsigned int Samples { 5 };         //repetitions of each case, raise for baseline comparisons
+};
+
+class BenchmarkRunner
+{
+private:
+	std::vector<BenchmarkCase> m_Cases;
+public:
+	void Add(BenchmarkCase benchmark);
+	std::vector<BenchmarkResult> RunAll(const BenchmarkOptions& options) const;
+};
+
+//machine readable report, "context" is a flat list of string key/values
+void WriteJson(std::ostream& out, const std::vector<std::pair<std::string, std::string>>& context,
+	const std::vector<BenchmarkResult>& results, const std::vector<BenchmarkComparison>& comparisons = {});
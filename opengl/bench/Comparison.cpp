@@ -0,0 +1,169 @@
+#include "Comparison.h"
+#include "Statistics.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+//minimal reader for our own report layout, not a general json parser
+static bool ReadStringAfter(const std::string& text, size_t& pos, const char* key, std::string& value)
+{
+    size_t found{ text.find(key, pos) };
+    if (found == std::string::npos)
+        return false;
+    size_t open{ text.find('"', found + std::char_traits<char>::length(key)) };
+    if (open == std::string::npos)
+        return false;
+    value.clear();
+    size_t i{ open + 1 };
+    for (; i < text.size() && text[i] != '"'; i++)
+    {
+        if (text[i] == '\\' && i + 1 < text.size())
+            i++;
+        value += text[i];
+    }
+    pos = i + 1;
+    return true;
+}
+
+static bool ReadNumbersAfter(const std::string& text, size_t& pos, const char* key, std::vector<double>& values)
+{
+    size_t found{ text.find(key, pos) };
+    if (found == std::string::npos)
+        return false;
+    size_t open{ text.find('[', found) };
+    size_t close{ text.find(']', open) };
+    if (open == std::string::npos || close == std::string::npos)
+        return false;
+
+    values.clear();
+    const char* cursor{ text.c_str() + open + 1 };
+    const char* end{ text.c_str() + close };
+    while (cursor < end)
+    {
+        char* next{ nullptr };
+        double value{ std::strtod(cursor, &next) };
+        if (next == cursor)
+        {
+            cursor++;
+            continue;
+        }
+        values.push_back(value);
+        cursor = next;
+    }
+    pos = close + 1;
+    return true;
+}
+
+//optional scalar, only looked for between pos and the next occurrence of "before"
+static void ReadOptionalNumber(const std::string& text, size_t pos, const char* key, const char* before, double& value)
+{
+    size_t limit{ text.find(before, pos) };
+    size_t found{ text.find(key, pos) };
+    if (found == std::string::npos || found > limit)
+        return;
+    size_t colon{ text.find(':', found) };
+    if (colon != std::string::npos)
+        value = std::strtod(text.c_str() + colon + 1, nullptr);
+}
+
+bool LoadBaseline(const std::string& filepath, std::vector<BenchmarkResult>& baseline)
+{
+    std::ifstream stream(filepath);
+    if (!stream)
+    {
+        std::cerr << "Failed to open baseline " << filepath << std::endl;
+        return false;
+    }
+    std::stringstream ss;
+    ss << stream.rdbuf();
+    std::string text{ ss.str() };
+
+    size_t pos{ text.find("\"benchmarks\"") };
+    if (pos == std::string::npos)
+    {
+        std::cerr << "No benchmarks in baseline " << filepath << std::endl;
+        return false;
+    }
+    //the comparison section of an older report also has names, stop before it
+    size_t stop{ text.find("\"comparison\"", pos) };
+    if (stop != std::string::npos)
+        text.resize(stop);
+
+    baseline.clear();
+    BenchmarkResult result{ "", 0, 0.0, {} };
+    while (ReadStringAfter(text, pos, "\"name\"", result.Name))
+    {
+        result.AllocationsPerOp = -1.0;
+        ReadOptionalNumber(text, pos, "\"allocations_per_op\"", "\"samples_ns\"", result.AllocationsPerOp);
+        if (!ReadNumbersAfter(text, pos, "\"samples_ns\"", result.SamplesNs))
+            break;
+        baseline.push_back(result);
+    }
+    return !baseline.empty();
+}
+
+std::vector<BenchmarkComparison> CompareToBaseline(const std::vector<BenchmarkResult>& baseline,
+    const std::vector<BenchmarkResult>& current, const ComparisonOptions& options)
+{
+    std::vector<BenchmarkComparison> comparisons;
+    for (const BenchmarkResult& now : current)
+    {
+        for (const BenchmarkResult& before : baseline)
+        {
+            if (before.Name != now.Name || before.SamplesNs.empty() || now.SamplesNs.empty())
+                continue;
+
+            BenchmarkComparison c{ now.Name, before.MedianNs(), now.MedianNs(), 0.0, 1.0, false, false };
+            if (c.BaselineMedianNs > 0.0)
+                c.DeltaPercent = 100.0 * (c.CurrentMedianNs - c.BaselineMedianNs) / c.BaselineMedianNs;
+            c.PValue = MannWhitneyU(before.SamplesNs, now.SamplesNs);
+
+            bool significant{ c.PValue < options.Alpha };
+            c.Regression = significant && c.DeltaPercent > options.ThresholdPercent;
+            c.Improvement = significant && c.DeltaPercent < -options.ThresholdPercent;
+
+            //allocation counts are deterministic, any growth past rounding noise is a regression
+            c.BaselineAllocationsPerOp = before.AllocationsPerOp;
+            c.CurrentAllocationsPerOp = now.AllocationsPerOp;
+            c.AllocationRegression = before.AllocationsPerOp >= 0.0 && now.AllocationsPerOp >= 0.0
+                && now.AllocationsPerOp > before.AllocationsPerOp + options.AllocationTolerance;
+            comparisons.push_back(c);
+            break;
+        }
+    }
+    return comparisons;
+}
+
+unsigned int PrintComparison(std::ostream& out, const std::vector<BenchmarkComparison>& comparisons)
+{
+    unsigned int regressions{ 0 };
+    out << std::left << std::setw(40) << "benchmark" << std::right
+        << std::setw(16) << "baseline ns" << std::setw(16) << "current ns"
+        << std::setw(10) << "delta" << std::setw(10) << "p" << std::endl;
+    for (const BenchmarkComparison& c : comparisons)
+    {
+        out << std::left << std::setw(40) << c.Name << std::right << std::fixed
+            << std::setw(16) << std::setprecision(1) << c.BaselineMedianNs
+            << std::setw(16) << c.CurrentMedianNs
+            << std::setw(9) << std::showpos << std::setprecision(1) << c.DeltaPercent << '%' << std::noshowpos
+            << std::setw(10) << std::setprecision(4) << c.PValue;
+        if (c.Regression)
+        {
+            out << "  REGRESSION";
+            regressions++;
+        }
+        else if (c.Improvement)
+            out << "  improved";
+        if (c.AllocationRegression)
+        {
+            out << "  ALLOCATIONS " << std::setprecision(2) << c.BaselineAllocationsPerOp << " -> " << c.CurrentAllocationsPerOp << "/op";
+            if (!c.Regression)
+                regressions++;
+        }
+        out << std::endl;
+    }
+    return regressions;
+}
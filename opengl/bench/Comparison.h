@@ -0,0 +1,23 @@
+#pragma once
+
+#include "Benchmark.h"
+
+#include <string>
+#include <vector>
+
+struct ComparisonOptions
+{
+	double Alpha { 0.05 };              //significance level of the Mann-Whitney test
+	double ThresholdPercent { 5.0 };    //smaller deltas are never flagged, even when significant
+	double AllocationTolerance { 0.01 };    //allowed growth of allocations per operation
+};
+
+//reads "name", "samples_ns" and, when present, "allocations_per_op" of every benchmark from a report written by WriteJson
+bool LoadBaseline(const std::string& filepath, std::vector<BenchmarkResult>& baseline);
+
+//cases missing from either side are skipped
+std::vector<BenchmarkComparison> CompareToBaseline(const std::vector<BenchmarkResult>& baseline,
+	const std::vector<BenchmarkResult>& current, const ComparisonOptions& options);
+
+//human readable table, returns the number of regressions (slower or allocating more)
+unsigned int PrintComparison(std::ostream& out, const std::vector<BenchmarkComparison>& comparisons);
@@ -0,0 +1,103 @@
+#include "HeadlessContext.h"
+#include "Renderer.h"
+#include "GpuMemory.h"
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <iostream>
+
+HeadlessContext::HeadlessContext(int width, int height)
+    : m_Display(nullptr), m_Context(nullptr), m_Surface(nullptr),
+      m_Framebuffer(0), m_ColorBuffer(0), m_Width(width), m_Height(height)
+{
+    //prefer the surfaceless platform so no X/wayland server is needed
+    EGLDisplay display{ EGL_NO_DISPLAY };
+    auto getPlatformDisplay{ (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT") };
+    if (getPlatformDisplay)
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    if (display == EGL_NO_DISPLAY)
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint major, minor;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+    {
+        std::cout << "Failed to initialize EGL (0x" << std::hex << eglGetError() << std::dec << ")" << std::endl;
+        return;
+    }
+    m_Display = display;
+    eglBindAPI(EGL_OPENGL_API);
+
+    EGLint configAttribs[] {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config{ nullptr };
+    EGLint configCount{ 0 };
+    eglChooseConfig(display, configAttribs, &config, 1, &configCount);
+
+    //same context version the window path asks glfw for
+    EGLint contextAttribs[] {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    EGLContext context{ eglCreateContext(display, configCount ? config : EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, contextAttribs) };
+    if (context == EGL_NO_CONTEXT)
+    {
+        std::cout << "Failed to create EGL context (0x" << std::hex << eglGetError() << std::dec << ")" << std::endl;
+        return;
+    }
+
+    EGLSurface surface{ EGL_NO_SURFACE };
+    if (configCount)
+    {
+        EGLint pbufferAttribs[] { EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE };
+        surface = eglCreatePbufferSurface(display, config, pbufferAttribs);
+    }
+    if (!eglMakeCurrent(display, surface, surface, context))
+    {
+        std::cout << "Failed to make EGL context current (0x" << std::hex << eglGetError() << std::dec << ")" << std::endl;
+        eglDestroyContext(display, context);
+        return;
+    }
+    m_Context = context;
+    m_Surface = surface;
+
+    //render into our own framebuffer so surfaceless and pbuffer behave the same
+    GLCall(glGenRenderbuffers(1, &m_ColorBuffer));
+    GLCall(glBindRenderbuffer(GL_RENDERBUFFER, m_ColorBuffer));
+    GLCall(glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height));
+    GpuMemory::Get().Track(GpuMemoryCategory::Renderbuffer, m_ColorBuffer, 4ull * width * height);
+    GLCall(glGenFramebuffers(1, &m_Framebuffer));
+    GLCall(glBindFramebuffer(GL_FRAMEBUFFER, m_Framebuffer));
+    GLCall(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_ColorBuffer));
+    GLCall(glViewport(0, 0, width, height));
+}
+
+HeadlessContext::~HeadlessContext()
+{
+    if (m_Context)
+    {
+        GLCall(glDeleteFramebuffers(1, &m_Framebuffer));
+        GpuMemory::Get().Untrack(GpuMemoryCategory::Renderbuffer, m_ColorBuffer);
+        GLCall(glDeleteRenderbuffers(1, &m_ColorBuffer));
+        eglMakeCurrent(m_Display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (m_Surface != EGL_NO_SURFACE)
+            eglDestroySurface(m_Display, m_Surface);
+        eglDestroyContext(m_Display, m_Context);
+    }
+    if (m_Display)
+        eglTerminate(m_Display);
+}
+
+std::string HeadlessContext::GetVersion() const
+{
+    return IsValid() ? (const char*)glGetString(GL_VERSION) : "";
+}
+
+std::string HeadlessContext::GetRendererName() const
+{
+    return IsValid() ? (const char*)glGetString(GL_RENDERER) : "";
+}
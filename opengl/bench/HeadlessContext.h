@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+
+//offscreen GL 3.3 core context through EGL (surfaceless mesa platform when available)
+//so the renderer can run on machines without a display, e.g. mesa llvmpipe
+class HeadlessContext
+{
+private:
+	void* m_Display;
+	void* m_Context;
+	void* m_Surface;
+	unsigned int m_Framebuffer;
+	unsigned int m_ColorBuffer;
+	int m_Width;
+	int m_Height;
+public:
+	HeadlessContext(int width, int height);
+	~HeadlessContext();
+
+	HeadlessContext(const HeadlessContext&) = delete;
+	HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+	inline bool IsValid() const { return m_Context != nullptr; }
+	inline int GetWidth() const { return m_Width; }
+	inline int GetHeight() const { return m_Height; }
+
+	//GL_VERSION / GL_RENDERER of the created context
+	std::string GetVersion() const;
+	std::string GetRendererName() const;
+};
@@ -0,0 +1,95 @@
+#include "Statistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+double Mean(const std::vector<double>& samples)
+{
+    if (samples.empty())
+        return 0.0;
+    double sum{ 0.0 };
+    for (double s : samples)
+        sum += s;
+    return sum / samples.size();
+}
+
+double StandardDeviation(const std::vector<double>& samples)
+{
+    if (samples.size() < 2)
+        return 0.0;
+    double mean{ Mean(samples) };
+    double sum{ 0.0 };
+    for (double s : samples)
+        sum += (s - mean) * (s - mean);
+    return std::sqrt(sum / (samples.size() - 1));
+}
+
+//two sided 97.5% quantile of student's t for 1..30 degrees of freedom
+static double StudentT975(size_t degrees)
+{
+    static const double table[] {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+    };
+    if (degrees == 0)
+        return 0.0;
+    return degrees <= 30 ? table[degrees - 1] : 1.960;
+}
+
+ConfidenceInterval MeanConfidenceInterval95(const std::vector<double>& samples)
+{
+    double mean{ Mean(samples) };
+    if (samples.size() < 2)
+        return { mean, mean };
+    double half{ StudentT975(samples.size() - 1) * StandardDeviation(samples) / std::sqrt((double)samples.size()) };
+    return { mean - half, mean + half };
+}
+
+double MannWhitneyU(const std::vector<double>& a, const std::vector<double>& b)
+{
+    if (a.empty() || b.empty())
+        return 1.0;
+
+    //rank the pooled samples, ties get their average rank
+    std::vector<std::pair<double, int>> pooled;
+    pooled.reserve(a.size() + b.size());
+    for (double v : a)
+        pooled.push_back({ v, 0 });
+    for (double v : b)
+        pooled.push_back({ v, 1 });
+    std::sort(pooled.begin(), pooled.end());
+
+    double rankSumA{ 0.0 };
+    double tieTerm{ 0.0 };
+    for (size_t i = 0; i < pooled.size();)
+    {
+        size_t j{ i };
+        while (j < pooled.size() && pooled[j].first == pooled[i].first)
+            j++;
+        double rank{ 0.5 * (i + 1 + j) };
+        double ties{ (double)(j - i) };
+        tieTerm += ties * ties * ties - ties;
+        for (size_t k = i; k < j; k++)
+        {
+            if (pooled[k].second == 0)
+                rankSumA += rank;
+        }
+        i = j;
+    }
+
+    double n1{ (double)a.size() };
+    double n2{ (double)b.size() };
+    double n{ n1 + n2 };
+    double u{ rankSumA - n1 * (n1 + 1.0) / 2.0 };
+    double meanU{ n1 * n2 / 2.0 };
+    double varU{ n1 * n2 / 12.0 * ((n + 1.0) - tieTerm / (n * (n - 1.0))) };
+    if (varU <= 0.0)
+        return 1.0;
+
+    double z{ (std::fabs(u - meanU) - 0.5) / std::sqrt(varU) };
+    if (z < 0.0)
+        z = 0.0;
+    return std::erfc(z / std::sqrt(2.0));
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <vector>
+
+struct ConfidenceInterval
+{
+	double Low;
+	double High;
+};
+
+double Mean(const std::vector<double>& samples);
+double StandardDeviation(const std::vector<double>& samples);
+
+//two sided 95% interval of the mean (student t)
+ConfidenceInterval MeanConfidenceInterval95(const std::vector<double>& samples);
+
+//two sided Mann-Whitney U test, normal approximation with tie and continuity correction.
+//returns the p-value for "a and b come from the same distribution"
+double MannWhitneyU(const std::vector<double>& a, const std::vector<double>& b);
@@ -0,0 +1,31 @@
+#shader vertex
+#version 330 core
+
+layout(location = 0) in vec4 position;
+layout(location = 1) in vec2 texCoord;
+//per instance: xy offset, z scale
+layout(location = 2) in vec4 instance;
+
+out vec2 v_TexCoord;
+
+void main()
+{
+   gl_Position = vec4(position.xy * instance.z + instance.xy, position.zw);
+   v_TexCoord = texCoord;
+};
+
+#shader fragment
+#version 330 core
+
+layout(location = 0) out vec4 color;
+
+in vec2 v_TexCoord;
+
+uniform vec4 u_Color;
+uniform sampler2D u_Texture;
+
+void main()
+{
+	//texture tinted by u_Color
+	color = texture(u_Texture, v_TexCoord) * u_Color;
+};
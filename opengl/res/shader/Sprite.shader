@@ -0,0 +1,27 @@
+#shader vertex
+#version 330 core
+
+layout(location = 0) in vec4 position;
+layout(location = 1) in vec3 texCoord;  //u, v, atlas layer
+
+out vec3 v_TexCoord;
+
+void main()
+{
+   gl_Position = position;
+   v_TexCoord = texCoord;
+};
+
+#shader fragment
+#version 330 core
+
+layout(location = 0) out vec4 color;
+
+in vec3 v_TexCoord;
+
+uniform sampler2DArray u_Atlas;
+
+void main()
+{
+	color = texture(u_Atlas, v_TexCoord);
+};
@@ -0,0 +1,56 @@
+#shader vertex
+#version 330 core
+
+layout(location = 0) in vec4 position;
+layout(location = 1) in vec2 texCoord;
+
+uniform vec4 u_TexCoordTransform;   //scale in xy, offset in zw
+
+out vec2 v_TexCoord;
+
+void main()
+{
+   gl_Position = position;
+   v_TexCoord = texCoord * u_TexCoordTransform.xy + u_TexCoordTransform.zw;
+};
+
+#shader fragment
+#version 330 core
+
+layout(location = 0) out vec4 color;
+
+in vec2 v_TexCoord;
+
+uniform sampler2D u_PageTable;      //rg: cache slot, b: level of the page in that slot
+uniform sampler2D u_PageCache;
+uniform float u_VirtualSize;        //texels per side of level 0
+uniform float u_PageSize;           //without the border
+uniform float u_PageBorder;
+uniform float u_CacheSize;
+uniform float u_MaxLevel;
+uniform float u_LodBias;
+uniform bool u_Feedback;            //write the page this pixel wants instead of its color
+
+void main()
+{
+	//the level the hardware would pick for a texture of the full virtual size
+	vec2 texels = v_TexCoord * u_VirtualSize;
+	vec2 dx = dFdx(texels);
+	vec2 dy = dFdy(texels);
+	float lod = 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8)) + u_LodBias;
+	float level = clamp(floor(lod), 0.0, u_MaxLevel);
+
+	vec2 uv = clamp(v_TexCoord, 0.0, 0.99999);
+	vec2 page = floor(uv * (u_VirtualSize / u_PageSize) / exp2(level));
+	if (u_Feedback)
+	{
+		color = vec4(page, level, 255.0) / 255.0;
+		return;
+	}
+
+	//the entry is the page itself or the closest resident ancestor
+	vec3 entry = floor(texelFetch(u_PageTable, ivec2(page), int(level)).rgb * 255.0 + 0.5);
+	vec2 inPage = fract(uv * (u_VirtualSize / u_PageSize) / exp2(entry.b));
+	vec2 texel = entry.rg * (u_PageSize + 2.0 * u_PageBorder) + u_PageBorder + inPage * u_PageSize;
+	color = textureLod(u_PageCache, texel / u_CacheSize, 0.0);
+};
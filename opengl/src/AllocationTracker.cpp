@@ -0,0 +1,419 @@
+#include "AllocationTracker.h"
+#include "CallStack.h"
+#include "Renderer.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <new>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+//everything below is plain arrays and atomics: the hooks run inside malloc and must never
+//allocate themselves
+
+struct TagStats
+{
+	const char* Name;
+	std::atomic<unsigned long long> Count;
+	std::atomic<unsigned long long> Bytes;
+	unsigned long long LastCount;
+	unsigned long long LastBytes;
+	unsigned long long TotalCount;
+	unsigned long long TotalBytes;
+	unsigned long long PeakCount;
+	unsigned long long PeakBytes;
+};
+
+struct StackRecord
+{
+	unsigned long long Hash;            //0 == empty slot
+	CallStack Stack;
+	unsigned int Tag;
+	unsigned long long Count;
+	unsigned long long Bytes;
+	bool SteadyState;
+};
+
+static TagStats s_Tags[AllocationTracker::s_MaxTags];
+static std::atomic<unsigned int> s_TagCount{ 1 };
+static std::mutex s_TagMutex;
+
+static StackRecord s_Stacks[AllocationTracker::s_MaxStacks];
+static std::atomic_flag s_StackLock = ATOMIC_FLAG_INIT;
+static std::atomic<unsigned long long> s_DroppedStacks{ 0 };
+
+static std::atomic<bool> s_Strict{ false };
+static std::atomic<bool> s_CaptureStacks{ false };
+static unsigned int s_WarmupFrames{ 60 };
+static std::atomic<unsigned long long> s_FrameIndex{ 0 };
+static std::atomic<unsigned long long> s_FrameCount{ 0 };
+static std::atomic<unsigned long long> s_FrameBytes{ 0 };
+static std::atomic<unsigned long long> s_Total{ 0 };
+static std::atomic<unsigned long long> s_Frees{ 0 };
+static std::atomic<unsigned long long> s_SteadyState{ 0 };
+static unsigned long long s_LastFrameCount{ 0 };
+static unsigned long long s_LastFrameBytes{ 0 };
+static unsigned long long s_PeakFrameCount{ 0 };
+
+static thread_local unsigned int t_Tag{ 0 };
+static thread_local bool t_InHook{ false };
+
+#ifdef OPENGL_TRACK_ALLOCATIONS
+
+static void RecordStack(size_t size, unsigned int tag, bool steadyState)
+{
+    CallStack stack{ CallStack::Capture() };
+    unsigned long long hash{ stack.Hash() };
+
+    while (s_StackLock.test_and_set(std::memory_order_acquire))
+        ;
+    unsigned int slot{ (unsigned int)(hash % AllocationTracker::s_MaxStacks) };
+    for (unsigned int probe = 0; probe < AllocationTracker::s_MaxStacks; probe++)
+    {
+        StackRecord& record{ s_Stacks[(slot + probe) % AllocationTracker::s_MaxStacks] };
+        if (record.Hash == 0)
+        {
+            record.Hash = hash;
+            record.Stack = stack;
+            record.Tag = tag;
+        }
+        if (record.Hash == hash)
+        {
+            record.Count++;
+            record.Bytes += size;
+            record.SteadyState |= steadyState;
+            s_StackLock.clear(std::memory_order_release);
+            return;
+        }
+    }
+    s_StackLock.clear(std::memory_order_release);
+    s_DroppedStacks.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void RecordAllocation(size_t size)
+{
+    if (t_InHook)
+        return;
+    t_InHook = true;
+
+    unsigned int tag{ t_Tag };
+    s_Tags[tag].Count.fetch_add(1, std::memory_order_relaxed);
+    s_Tags[tag].Bytes.fetch_add(size, std::memory_order_relaxed);
+    s_FrameCount.fetch_add(1, std::memory_order_relaxed);
+    s_FrameBytes.fetch_add(size, std::memory_order_relaxed);
+    s_Total.fetch_add(1, std::memory_order_relaxed);
+
+    bool steadyState{ s_Strict.load(std::memory_order_relaxed) && s_FrameIndex.load(std::memory_order_relaxed) >= s_WarmupFrames };
+    if (steadyState)
+        s_SteadyState.fetch_add(1, std::memory_order_relaxed);
+    if (steadyState || s_CaptureStacks.load(std::memory_order_relaxed))
+        RecordStack(size, tag, steadyState);
+
+    t_InHook = false;
+}
+
+static void RecordFree()
+{
+    s_Frees.fetch_add(1, std::memory_order_relaxed);
+}
+
+#if defined(__GLIBC__)
+
+//glibc: wrap the malloc family, operator new ends up here as well
+extern "C" {
+
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* ptr);
+
+void* malloc(size_t size)
+{
+    void* ptr{ __libc_malloc(size) };
+    if (ptr)
+        RecordAllocation(size);
+    return ptr;
+}
+
+void* calloc(size_t count, size_t size)
+{
+    void* ptr{ __libc_calloc(count, size) };
+    if (ptr)
+        RecordAllocation(count * size);
+    return ptr;
+}
+
+void* realloc(void* ptr, size_t size)
+{
+    void* result{ __libc_realloc(ptr, size) };
+    if (result && size)
+        RecordAllocation(size);
+    if (ptr && (result || !size))
+        RecordFree();
+    return result;
+}
+
+void* memalign(size_t alignment, size_t size)
+{
+    void* ptr{ __libc_memalign(alignment, size) };
+    if (ptr)
+        RecordAllocation(size);
+    return ptr;
+}
+
+void* aligned_alloc(size_t alignment, size_t size)
+{
+    return memalign(alignment, size);
+}
+
+int posix_memalign(void** result, size_t alignment, size_t size)
+{
+    void* ptr{ memalign(alignment, size) };
+    if (!ptr)
+        return ENOMEM;
+    *result = ptr;
+    return 0;
+}
+
+void free(void* ptr)
+{
+    if (ptr)
+        RecordFree();
+    __libc_free(ptr);
+}
+
+}
+
+#else
+
+//elsewhere: replace the global operator new/delete (plain malloc/free stay untracked)
+static void* TrackedNew(size_t size)
+{
+    void* ptr{ std::malloc(size ? size : 1) };
+    if (!ptr)
+        throw std::bad_alloc();
+    RecordAllocation(size);
+    return ptr;
+}
+
+static void* TrackedAlignedNew(size_t size, std::align_val_t alignment)
+{
+    size = size ? size : 1;
+#if defined(_MSC_VER)
+    void* ptr{ _aligned_malloc(size, (size_t)alignment) };
+#else
+    void* ptr{ std::aligned_alloc((size_t)alignment, (size + (size_t)alignment - 1) & ~((size_t)alignment - 1)) };
+#endif
+    if (!ptr)
+        throw std::bad_alloc();
+    RecordAllocation(size);
+    return ptr;
+}
+
+static void TrackedDelete(void* ptr)
+{
+    if (!ptr)
+        return;
+    RecordFree();
+    std::free(ptr);
+}
+
+static void TrackedAlignedDelete(void* ptr)
+{
+    if (!ptr)
+        return;
+    RecordFree();
+#if defined(_MSC_VER)
+    _aligned_free(ptr);
+#else
+    std::free(ptr);
+#endif
+}
+
+void* operator new(size_t size) { return TrackedNew(size); }
+void* operator new[](size_t size) { return TrackedNew(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { try { return TrackedNew(size); } catch (...) { return nullptr; } }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { try { return TrackedNew(size); } catch (...) { return nullptr; } }
+void* operator new(size_t size, std::align_val_t alignment) { return TrackedAlignedNew(size, alignment); }
+void* operator new[](size_t size, std::align_val_t alignment) { return TrackedAlignedNew(size, alignment); }
+void operator delete(void* ptr) noexcept { TrackedDelete(ptr); }
+void operator delete[](void* ptr) noexcept { TrackedDelete(ptr); }
+void operator delete(void* ptr, size_t) noexcept { TrackedDelete(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { TrackedDelete(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { TrackedDelete(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { TrackedDelete(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { TrackedAlignedDelete(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { TrackedAlignedDelete(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept { TrackedAlignedDelete(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { TrackedAlignedDelete(ptr); }
+
+#endif
+#endif
+
+unsigned int AllocationTracker::RegisterTag(const char* name)
+{
+    std::lock_guard<std::mutex> lock(s_TagMutex);
+    unsigned int count{ s_TagCount.load(std::memory_order_relaxed) };
+    for (unsigned int i = 1; i < count; i++)
+    {
+        if (!std::strcmp(s_Tags[i].Name, name))
+            return i;
+    }
+    if (count == s_MaxTags)
+        return 0;
+    s_Tags[count].Name = name;
+    s_TagCount.store(count + 1, std::memory_order_release);
+    return count;
+}
+
+bool AllocationTracker::IsEnabled()
+{
+#ifdef OPENGL_TRACK_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+void AllocationTracker::SetStrictMode(bool strict, unsigned int warmupFrames)
+{
+    //the first capture may load libgcc and allocate, get that out of the way now
+    CallStack::Capture();
+
+    s_WarmupFrames = warmupFrames;
+    s_Strict.store(strict);
+}
+
+void AllocationTracker::SetCaptureStacks(bool capture)
+{
+    CallStack::Capture();
+    s_CaptureStacks.store(capture);
+}
+
+static void ReportStacks(std::ostream& out, bool steadyStateOnly)
+{
+    for (const StackRecord& record : s_Stacks)
+    {
+        if (!record.Hash || (steadyStateOnly && !record.SteadyState))
+            continue;
+        const char* tag{ record.Tag ? s_Tags[record.Tag].Name : "untagged" };
+        out << "  " << record.Count << " allocations, " << record.Bytes << " bytes [" << tag << "]"
+            << (record.SteadyState ? " (steady state)" : "") << std::endl;
+        //skip the hook frames themselves
+        record.Stack.Print(out, 4);
+    }
+}
+
+void AllocationTracker::EndFrame()
+{
+    unsigned long long frameCount{ s_FrameCount.exchange(0, std::memory_order_relaxed) };
+    unsigned long long frameBytes{ s_FrameBytes.exchange(0, std::memory_order_relaxed) };
+    s_LastFrameCount = frameCount;
+    s_LastFrameBytes = frameBytes;
+    if (frameCount > s_PeakFrameCount)
+        s_PeakFrameCount = frameCount;
+
+    unsigned int tags{ s_TagCount.load(std::memory_order_acquire) };
+    for (unsigned int i = 0; i < tags; i++)
+    {
+        TagStats& stats{ s_Tags[i] };
+        stats.LastCount = stats.Count.exchange(0, std::memory_order_relaxed);
+        stats.LastBytes = stats.Bytes.exchange(0, std::memory_order_relaxed);
+        stats.TotalCount += stats.LastCount;
+        stats.TotalBytes += stats.LastBytes;
+        if (stats.LastCount > stats.PeakCount)
+            stats.PeakCount = stats.LastCount;
+        if (stats.LastBytes > stats.PeakBytes)
+            stats.PeakBytes = stats.LastBytes;
+    }
+
+    bool steadyState{ s_Strict.load() && s_FrameIndex.load() >= s_WarmupFrames };
+    s_FrameIndex.fetch_add(1, std::memory_order_relaxed);
+    if (steadyState && frameCount)
+    {
+        t_InHook = true;
+        std::cerr << "Steady state frame " << s_FrameIndex.load() - 1 << " allocated " << frameCount
+            << " times (" << frameBytes << " bytes):" << std::endl;
+        ReportStacks(std::cerr, true);
+        t_InHook = false;
+        ASSERT(false);
+    }
+}
+
+unsigned long long AllocationTracker::GetFrameIndex()
+{
+    return s_FrameIndex.load(std::memory_order_relaxed);
+}
+
+unsigned long long AllocationTracker::GetLastFrameAllocations()
+{
+    return s_LastFrameCount;
+}
+
+unsigned long long AllocationTracker::GetLastFrameBytes()
+{
+    return s_LastFrameBytes;
+}
+
+unsigned long long AllocationTracker::GetTotalAllocations()
+{
+    return s_Total.load(std::memory_order_relaxed);
+}
+
+unsigned long long AllocationTracker::GetSteadyStateAllocations()
+{
+    return s_SteadyState.load(std::memory_order_relaxed);
+}
+
+void AllocationTracker::Report(std::ostream& out)
+{
+    //the report itself allocates (iostream, backtrace_symbols), keep that out of the numbers
+    bool wasInHook{ t_InHook };
+    t_InHook = true;
+
+    unsigned long long frames{ s_FrameIndex.load() };
+    out << "Allocations (" << (IsEnabled() ? "" : "tracking disabled, ") << frames << " frames, "
+        << s_Frees.load() << " frees, peak " << s_PeakFrameCount << " per frame, "
+        << s_SteadyState.load() << " in steady state)" << std::endl;
+
+    unsigned int tags{ s_TagCount.load(std::memory_order_acquire) };
+    for (unsigned int i = 0; i < tags; i++)
+    {
+        const TagStats& stats{ s_Tags[i] };
+        //allocations since the last EndFrame() have not been folded into the totals yet
+        unsigned long long count{ stats.TotalCount + stats.Count.load() };
+        unsigned long long bytes{ stats.TotalBytes + stats.Bytes.load() };
+        if (!count)
+            continue;
+        out << "  " << std::left << std::setw(24) << (i ? stats.Name : "untagged") << std::right
+            << std::setw(12) << count << " allocs " << std::setw(14) << bytes << " bytes"
+            << "  per frame avg " << (frames ? count / frames : count)
+            << " peak " << stats.PeakCount << " (" << stats.PeakBytes << " bytes)" << std::endl;
+    }
+
+    if (s_DroppedStacks.load())
+        out << "  (" << s_DroppedStacks.load() << " allocations from call stacks beyond the table)" << std::endl;
+    ReportStacks(out, false);
+
+    t_InHook = wasInHook;
+}
+
+AllocationScope::AllocationScope(unsigned int tag)
+    : m_Previous(t_Tag)
+{
+    t_Tag = tag;
+}
+
+AllocationScope::~AllocationScope()
+{
+    t_Tag = m_Previous;
+}
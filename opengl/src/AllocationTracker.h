@@ -0,0 +1,61 @@
+#pragma once
+
+#include <iosfwd>
+
+//counts heap allocations per frame and per subsystem tag. the hooks (malloc family on glibc,
+//global operator new/delete elsewhere) are only compiled in with OPENGL_TRACK_ALLOCATIONS;
+//without it everything here still links but reports zeros
+class AllocationTracker
+{
+public:
+	static constexpr unsigned int s_MaxTags{ 64 };
+	static constexpr unsigned int s_MaxStacks{ 128 };
+
+	//tag 0 is "untagged"
+	static unsigned int RegisterTag(const char* name);
+
+	//true when the hooks are compiled in
+	static bool IsEnabled();
+
+	//strict mode asserts at EndFrame() when a frame after the first warmupFrames allocated,
+	//after printing where the allocations came from
+	static void SetStrictMode(bool strict, unsigned int warmupFrames = 60);
+	//record call stacks for every allocation, not only for strict mode violations
+	static void SetCaptureStacks(bool capture);
+
+	static void EndFrame();
+
+	static unsigned long long GetFrameIndex();
+	static unsigned long long GetLastFrameAllocations();
+	static unsigned long long GetLastFrameBytes();
+	//every allocation since startup, for measuring a stretch of code
+	static unsigned long long GetTotalAllocations();
+	//allocations in frames past the strict mode warmup
+	static unsigned long long GetSteadyStateAllocations();
+
+	//per tag totals, per frame peaks and the recorded call stacks
+	static void Report(std::ostream& out);
+};
+
+//attributes the allocations of this thread to a tag while in scope
+class AllocationScope
+{
+private:
+	unsigned int m_Previous;
+public:
+	explicit AllocationScope(unsigned int tag);
+	~AllocationScope();
+
+	AllocationScope(const AllocationScope&) = delete;
+	AllocationScope& operator=(const AllocationScope&) = delete;
+};
+
+#define ALLOCATION_CONCAT_IMPL(a, b) a##b
+#define ALLOCATION_CONCAT(a, b) ALLOCATION_CONCAT_IMPL(a, b)
+#ifdef OPENGL_TRACK_ALLOCATIONS
+#define ALLOCATION_SCOPE(name) \
+    static const unsigned int ALLOCATION_CONCAT(s_AllocationTag, __LINE__){ AllocationTracker::RegisterTag(name) }; \
+    AllocationScope ALLOCATION_CONCAT(allocationScope, __LINE__)(ALLOCATION_CONCAT(s_AllocationTag, __LINE__))
+#else
+#define ALLOCATION_SCOPE(name)
+#endif
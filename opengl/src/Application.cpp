@@ -5,124 +5,42 @@
 
 #include <iostream>
 #include <string>
-#include <fstream>
-#include <sstream>
 #include <chrono>
+#include <cmath>
+#include <memory>
+#include <filesystem>
 
 #include "Renderer.h"
 #include "VertexBuffer.h"
 #include "IndexBuffer.h"
-
-struct ShaderProgramSource
+#include "InstanceBuffer.h"
+#include "AssetPipeline.h"
+#include "EntityManager.h"
+#include "FileSystem.h"
+#include "MeshCache.h"
+#include "ResourceManager.h"
+#include "Profiler.h"
+#include "FrameArena.h"
+#include "Shader.h"
+#include "AllocationTracker.h"
+#include "GpuMemory.h"
+#include "Texture.h"
+#include "WorkerPool.h"
+
+//where a quad is drawn, the vec4 the instanced shader reads per instance
+struct QuadInstance
 {
-    std::string VertexSource;
-    std::string FragmentSouce;
+    float X, Y;
+    float Scale;
+    float Unused;
 };
 
-static ShaderProgramSource ParseShader(const std::string& filepath) 
-{
-    enum class ShaderType
-    {
-        NONE = -1, VERTEX = 0, FRAGMENT = 1
-    };
-    //CHANGE CLASS TO STATIC TO BE ABLE TO CALL FUNCTIONS OUTSIDE OF SCOPE(?)
-
-    //opens the file using fstream
-    //sstream needed for getline as well
-    std::ifstream stream(filepath);
-    std::string line;
-    std::stringstream ss[2];
-    ShaderType type {ShaderType::NONE};
-
-    while (getline(stream, line))
-    {
-        if (line.find("#shader") != std::string::npos)
-        {
-            if (line.find("vertex") != std::string::npos)
-            {
-                //set mode to vertex
-                type = ShaderType::VERTEX;
-            }
-            else if (line.find("fragment") != std::string::npos)
-            {
-                //set mode to fragment
-                type = ShaderType::FRAGMENT;
-            }
-        }
-        else
-        {
-            ss[(int)type] << line << '\n';
-        }
-    }
-
-    return { ss[0].str(), ss[1].str() };
-}
-
-static unsigned int CompileShader(unsigned int type, const std::string& source)
+//quads breathe around their base size
+struct Pulse
 {
-    unsigned int id { glCreateShader(type) };
-    const char* src { source.c_str() };
-    GLCall(glShaderSource(id, 1, &src, nullptr));
-    GLCall(glCompileShader(id));
-   
-    //glGetShaderiv(id, GL_COMPILE_STATUS, &result);
-    //if(result)
-
-    //TODO:ERROR HANDLING
-    //query to check if ID is good
-    int result;
-    GLCall(glGetShaderiv(id, GL_COMPILE_STATUS, &result));
-    //std::cout << (type == GL_VERTEX_SHADER ? "vertex" : "fragment") << "shader compile status" << result << std::endl;
-    if (result == GL_FALSE)
-    {
-        //print the error message
-        int length;
-        GLCall(glGetShaderiv(id, GL_INFO_LOG_LENGTH, &length));
-        //char message[length];
-
-        char* message{ (char*)_malloca(length * sizeof(char)) };
-        //allocate on the stack dynamically
-        GLCall(glGetShaderInfoLog(id, length, &length, message));
-        std::cout << "FAILED TO COMPILE SHADER:" << 
-            (type == GL_VERTEX_SHADER ? "vertex" : "fragment") << " shader" << std::endl;
-        std::cout << message << std::endl;
-        GLCall(glDeleteShader(id));
-        return 0;
-    }
-
-    return id;
-}
-
-static int CreateShader(const std::string& vertexShader, const std::string& fragmentShader)
-{
-    unsigned int program{ glCreateProgram() };
-    unsigned int vs{ CompileShader(GL_VERTEX_SHADER, vertexShader) };
-    unsigned int fs{ CompileShader(GL_FRAGMENT_SHADER, fragmentShader) };
-
-    GLCall(glAttachShader(program, vs));
-    GLCall(glAttachShader(program, fs));
-    GLCall(glLinkProgram(program));
-
-    GLint program_linked;
-
-    GLCall(glGetProgramiv(program, GL_LINK_STATUS, &program_linked));
-    std::cout << "Program link status: " << program_linked << std::endl;
-    if (program_linked != GL_TRUE)
-    {
-        GLsizei log_length{ 0 };
-        GLchar message[1024];
-        glGetProgramInfoLog(program, 1024, &log_length, message);
-        std::cout << "Failed to link program" << std::endl;
-        std::cout << message << std::endl;
-    }
-
-    GLCall(glValidateProgram(program));
-
-    GLCall(glDeleteShader(vs));
-    GLCall(glDeleteShader(fs));
-
-    return program;
-}
+    float Phase;
+    float Speed;
+};
 
 int main(void)
 {
@@ -167,21 +85,10 @@ int main(void)
     //Ensure we can capture the escape key being pressed below
     glfwSetInputMode(window, GLFW_STICKY_KEYS, GL_TRUE);
     
-    //data that will be passed to our buffer
-    float positions[] {
-        -0.5f, -0.5f,   //1
-         0.5f, -0.5f,   //2
-         0.5f,  0.5f,   //3
-        -0.5f,  0.5f    //4
-    };
-
-    //our index buffer telling which points in space to connect
-    unsigned int indices[] {
-        0, 1, 2,
-        2, 3, 0
-    };
-
-
+    //a packed build reads every res/ path out of res.pack (see opengl_pack), a development
+    //checkout without one keeps reading the loose files
+    if (std::filesystem::exists("res.pack"))
+        FileSystem::Get().Mount("res.pack", "res");
 
     //VAO (vertex array object) must be set up before binding attributes                                                                     
     //needed when going into core profile mode; is created for you in compat mode
@@ -189,28 +96,49 @@ int main(void)
     GLCall(glGenVertexArrays(1, &VertexArrayID));                           
     GLCall(glBindVertexArray(VertexArrayID));
 
-    //create buffer and copy data
-    VertexBuffer vertexBuff(positions, 4 * 2 * sizeof(float)); 
-    
-    //define vertex layout here
-    GLCall(glEnableVertexAttribArray(0));
-    GLCall(glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 2, 0));  
-                                                                            //^^^^ == (start of indice, how big each vec is, data type, ?, amount to get to next vec in bytes, ?)
-                                                                            //links vertices to our buffer
-    IndexBuffer indexBuff(indices, 6);
-    
-    //upload shader
-    ShaderProgramSource source = ParseShader("res/shader/Basic.shader");
-    std::cout << "VERTEX\n" << source.VertexSource << std::endl;
-    std::cout << "FRAGMENT\n" << source.FragmentSouce << std::endl;
-    
-    unsigned int shader = CreateShader(source.VertexSource, source.FragmentSouce);
-    GLCall(glUseProgram(shader));
+    //whole app budget, the ledger warns when buffers/textures go over it
+    GpuMemory::Get().SetTotalBudget(256ull * 1024 * 1024);
+#ifdef OPENGL_TRACK_ALLOCATIONS
+    //diagnostic builds also record where every GPU object was created for the leak report
+    GpuMemory::Get().SetCaptureSites(true);
+#endif
+
+    //buffers are owned by the resource manager, we only keep handles
+    ResourceManager resources;
+
+    //the quad, its shader and texture load in the background while the window is already up.
+    //the first run converts the quad into the mesh cache, later ones map the converted file.
+    //until the texture streams in the quad samples a plain white one
+    WorkerPool workers;
+    MeshCache meshCache("cache/meshes");
+    std::unique_ptr<AssetPipeline> assets{ std::make_unique<AssetPipeline>(workers, resources, 8ull * 1024 * 1024, &meshCache) };
+    MeshHandle quad{ assets->LoadMesh("res/models/quad.obj") };
+    ShaderHandle shaderAsset{ assets->LoadShader("res/shader/Instanced.shader") };
+    TextureHandle checker{ assets->LoadTexture("res/textures/checker.tga") };
 
     //uniforms are essential for altering shader at run time (cpu computes rgba then sends to gpu) another form of sending data to the shader
-    GLCall(int location = glGetUniformLocation(shader, "u_Color"));
-    ASSERT(location != -1);
-    GLCall(glUniform4f(location, 0.8f, 0.3f, 0.8f, 1.0f));
+    //looked up again whenever the program changes (once the shader has loaded)
+    unsigned int shader = 0;
+    int location = -1;
+
+    //a grid of quads, each one an entity. every frame the pulse system writes the instances of
+    //the pulsing half and the instance buffer re-uploads only their chunks
+    EntityManager entities;
+    for (int y = 0; y < 8; y++)
+    {
+        for (int x = 0; x < 8; x++)
+        {
+            QuadInstance instance{ -0.875f + x * 0.25f, -0.875f + y * 0.25f, 0.2f, 0.0f };
+            if ((x + y) % 2)
+                entities.Create(instance, Pulse{ (x + y) * 0.4f, 2.0f + x * 0.25f });
+            else
+                entities.Create(instance);
+        }
+    }
+    VertexBufferLayout instanceLayout;
+    instanceLayout.Push<float>(4);
+    InstanceBuffer instances(ComponentTypes::Of<QuadInstance>(), instanceLayout, 2);
+    auto start{ std::chrono::steady_clock::now() };
 
     float r = 0.0f;
     float increment = 0.05f;
@@ -219,34 +147,75 @@ int main(void)
     //auto t_Now = std::chrono::high_resolution_clock::now();
     //float time = std::chrono::duration_cast<std::chrono::duration<float>>(t_Now - t_Start).count();
 
+#ifdef OPENGL_STRICT_ALLOCATIONS
+    //once the loop has warmed up a frame that touches the heap asserts
+    AllocationTracker::SetStrictMode(true);
+#endif
+
     /* Loop until the user closes the window */
     while (!glfwWindowShouldClose(window) && glfwGetKey(window, GLFW_KEY_ESCAPE) != GLFW_PRESS)
     {
         /* Render here */
         glClear(GL_COLOR_BUFFER_BIT);
-        GLCall(glUniform4f(location, r, 0.3f, 0.8f, 1.0f));
-
-                                                //instead of binding vertex buffer, atrrib pointer etc. just bind vao
-        GLCall(glBindVertexArray(VertexArrayID));
-        indexBuff.Bind();                       //bind vertex buffer repeatedly
+        workers.RunMainThreadJobs();           //GL work the jobs handed back
+        assets->Update();
+        if (assets->GetShader(shaderAsset) != shader)
+        {
+            shader = assets->GetShader(shaderAsset);
+            GLCall(glUseProgram(shader));
+            GLCall(location = glGetUniformLocation(shader, "u_Color"));
+            ASSERT(location != -1);
+            GLCall(int textureLocation = glGetUniformLocation(shader, "u_Texture"));
+            ASSERT(textureLocation != -1);
+            GLCall(glUniform1i(textureLocation, 0));    //texture slot 0
+        }
+        assets->GetTexture(checker).Bind(0);
 
         if (r > 1.0f) increment = -0.5f;
         else if (r < 0.0f) increment = 0.5f;
 
         r += increment;
 
+        float time{ std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count() };
+        entities.ForEach<QuadInstance, const Pulse>([time](Entity, QuadInstance& instance, const Pulse& pulse) {
+            instance.Scale = 0.2f + 0.05f * std::sin(time * pulse.Speed + pulse.Phase);
+        });
+        instances.Sync(entities);
+
         //ISSUE A DRAW CALL'
-        //Using 6 vertices using our 4 positions
-        GLCall(glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr));   //drawing a triangle starting at indice 0 with 3 rows of data
-        
+        //Using every index of the mesh, nothing to draw while it or the shader is still loading
+        const MeshAsset* mesh = assets->GetMesh(quad);
+        if (mesh && shader)
+        {
+            GLCall(glUniform4f(location, r, 0.3f, 0.8f, 1.0f));
+                                                    //instead of binding vertex buffer, atrrib pointer etc. just bind vao
+            GLCall(glBindVertexArray(VertexArrayID));
+            resources.Get(mesh->Vertices)->Bind();
+            mesh->Layout.Apply();
+            resources.Get(mesh->Indices)->Bind();
+            instances.Draw(mesh->IndexCount);       //every quad, one draw per chunk
+        }
 
         /* Swap front and back buffers */
         glfwSwapBuffers(window);
 
         /* Poll for and process events */
         glfwPollEvents();
+
+        resources.EndFrame();
+        Profiler::Get().EndFrame();
+        FrameArena::EndFrame();
+        AllocationTracker::EndFrame();
     }
-    GLCall(glDeleteProgram(shader));
+    assets->Release(quad);
+    assets->Release(shaderAsset);
+    assets->Release(checker);
+    assets.reset();
+    resources.FlushRetired();
+    Profiler::Get().Report(std::cout);
+    AllocationTracker::Report(std::cout);
+    GpuMemory::Get().Report(std::cout);
+    GpuMemory::Get().ReportLeaks(std::cout);
     glfwTerminate();
     return 0;
 }
\ No newline at end of file
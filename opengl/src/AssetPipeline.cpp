@@ -0,0 +1,438 @@
+#include "AssetPipeline.h"
+#include "FileSystem.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+static const ProfilerCounter s_ReadBytes("Asset read bytes");
+static const ProfilerCounter s_UploadBytes("Asset upload bytes");
+
+//how long a blocking wait gives a fence before checking again
+static const unsigned long long s_FenceTimeout{ 1000000000ull };
+
+//reads a byte of every page, so the decode stage never waits on the disk
+static void FaultIn(const unsigned char* data, size_t size)
+{
+    unsigned char sum{ 0 };
+    for (size_t i = 0; i < size; i += 4096)
+        sum ^= data[i];
+    volatile unsigned char sink{ sum };
+    (void)sink;
+}
+
+//moves the assets whose fence has passed into the pool, drop() gets the ones released meanwhile
+template<typename FencedAsset, typename T, typename DropFn>
+static void Publish(std::vector<FencedAsset>& fenced, ResourcePool<T>& pool, bool wait, DropFn drop)
+{
+    size_t kept{ 0 };
+    for (size_t i = 0; i < fenced.size(); i++)
+    {
+        FencedAsset& entry{ fenced[i] };
+        GLenum status{ glClientWaitSync(entry.Fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? s_FenceTimeout : 0) };
+        if (status == GL_TIMEOUT_EXPIRED)
+        {
+            if (kept != i)
+                fenced[kept] = std::move(entry);
+            kept++;
+            continue;
+        }
+        GLCall(glDeleteSync(entry.Fence));
+        if (!pool.Emplace(entry.Target, std::move(entry.Asset)))
+            drop(entry.Asset);
+    }
+    fenced.erase(fenced.begin() + kept, fenced.end());
+}
+
+AssetPipeline::AssetPipeline(WorkerPool& workers, ResourceManager& resources, unsigned long long frameBudget, MeshCache* meshCache)
+    : m_Workers(workers), m_Io(1, "Asset IO"), m_Resources(resources), m_MeshCache(meshCache), m_Textures(workers),
+      m_InFlight(0), m_White(1, 1), m_FrameBudget(frameBudget), m_LastFrameUploadBytes(0)
+{
+    const unsigned char white[] { 255, 255, 255, 255 };
+    m_White.SetData(0, 0, 0, 1, 1, white);
+}
+
+AssetPipeline::~AssetPipeline()
+{
+    //the stage jobs hold this pointer
+    while (m_InFlight.load() != 0)
+    {
+        m_Io.Wait();
+        m_Workers.Wait();
+    }
+
+    for (Fenced<MeshAsset>& fenced : m_FencedMeshes)
+    {
+        GLCall(glDeleteSync(fenced.Fence));
+        m_Resources.Release(fenced.Asset.Vertices);
+        m_Resources.Release(fenced.Asset.Indices);
+    }
+    for (Fenced<ShaderAsset>& fenced : m_FencedShaders)
+    {
+        GLCall(glDeleteSync(fenced.Fence));
+        GLCall(glDeleteProgram(fenced.Asset.Program));
+    }
+    for (MeshAsset& mesh : m_Meshes)
+    {
+        m_Resources.Release(mesh.Vertices);
+        m_Resources.Release(mesh.Indices);
+    }
+    for (ShaderAsset& shader : m_Shaders)
+    {
+        GLCall(glDeleteProgram(shader.Program));
+    }
+}
+
+MeshHandle AssetPipeline::LoadMesh(const std::string& filepath)
+{
+    MeshHandle handle{ m_Meshes.Allocate() };
+    Start(AssetKind::Mesh, handle.Index, handle.Generation, filepath, false);
+    return handle;
+}
+
+ShaderHandle AssetPipeline::LoadShader(const std::string& filepath)
+{
+    ShaderHandle handle{ m_Shaders.Allocate() };
+    Start(AssetKind::Shader, handle.Index, handle.Generation, filepath, false);
+    return handle;
+}
+
+TextureHandle AssetPipeline::LoadTexture(const std::string& filepath, bool mipmaps)
+{
+    TextureHandle handle{ m_Textures.Reserve() };
+    Start(AssetKind::Texture, handle.Index, handle.Generation, filepath, mipmaps);
+    return handle;
+}
+
+void AssetPipeline::Start(AssetKind kind, unsigned int index, unsigned int generation, const std::string& path, bool mipmaps)
+{
+    //jobs are std::functions and must be copyable, the load is not
+    std::shared_ptr<Load> load{ std::make_shared<Load>() };
+    load->Kind = kind;
+    load->Index = index;
+    load->Generation = generation;
+    load->Path = path;
+    load->Mipmaps = mipmaps;
+    load->Valid = false;
+    load->Bytes = 0;
+    m_InFlight.fetch_add(1);
+    m_Io.Submit([this, load]() { Read(load); });
+}
+
+void AssetPipeline::Read(std::shared_ptr<Load> load)
+{
+    if (load->Kind == AssetKind::Mesh && m_MeshCache)
+    {
+        //the cache maps the converted file (converting it first on a miss), nothing is left to decode
+        load->CachedMesh = std::make_unique<MeshFile>();
+        MeshFile& file{ *load->CachedMesh };
+        load->Valid = m_MeshCache->Load(load->Path, file);
+        if (load->Valid)
+        {
+            FaultIn((const unsigned char*)file.GetVertexData(), file.GetVertexBytes());
+            FaultIn((const unsigned char*)file.GetIndexData(), file.GetIndexCount() * sizeof(unsigned int));
+            load->Bytes = file.GetVertexBytes() + file.GetIndexCount() * sizeof(unsigned int);
+            s_ReadBytes.Add(load->Bytes);
+        }
+        Finish(*load);
+        return;
+    }
+
+    std::shared_ptr<VirtualFile> file{ std::make_shared<VirtualFile>() };
+    if (!FileSystem::Get().Open(load->Path, *file))
+    {
+        std::cout << "Failed to open asset " << load->Path << std::endl;
+        Finish(*load);
+        return;
+    }
+    FaultIn(file->GetData(), file->GetSize());
+    s_ReadBytes.Add(file->GetSize());
+    m_Workers.Submit([this, load, file]() { Decode(*load, file->GetData(), file->GetSize()); });
+}
+
+void AssetPipeline::Decode(Load& load, const unsigned char* data, size_t size)
+{
+    switch (load.Kind)
+    {
+    case AssetKind::Mesh:
+        load.Valid = ::LoadMesh(load.Path, data, size, load.Mesh, &m_Workers);
+        load.Bytes = load.Mesh.GetVertexBytes() + load.Mesh.Indices.size() * sizeof(unsigned int);
+        break;
+    case AssetKind::Shader:
+        load.Shader = ParseShader((const char*)data, size);
+        load.Valid = !load.Shader.VertexSource.empty() && !load.Shader.FragmentSouce.empty();
+        if (!load.Valid)
+            std::cout << "No vertex and fragment stage in " << load.Path << std::endl;
+        load.Bytes = load.Shader.VertexSource.size() + load.Shader.FragmentSouce.size();
+        break;
+    case AssetKind::Texture:
+        load.Valid = DecodeImage(data, size, load.Pixels);
+        if (!load.Valid)
+            std::cout << "Failed to decode image " << load.Path << std::endl;
+        break;
+    }
+    Finish(load);
+}
+
+void AssetPipeline::Finish(Load& load)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_DecodedMutex);
+        m_Decoded.push_back(std::move(load));
+    }
+    m_DecodedReady.notify_all();
+    m_InFlight.fetch_sub(1);
+}
+
+void AssetPipeline::TakeDecoded()
+{
+    std::vector<Load> decoded;
+    {
+        std::lock_guard<std::mutex> lock(m_DecodedMutex);
+        decoded.swap(m_Decoded);
+    }
+    for (Load& load : decoded)
+    {
+        if (load.Kind != AssetKind::Texture)
+        {
+            m_Uploads.push_back(std::move(load));
+            continue;
+        }
+        //textures leave for the streamer right away, it keeps a budget of its own
+        TextureHandle handle{ load.Index, load.Generation };
+        if (!m_Textures.IsAlive(handle))
+            continue;
+        if (load.Valid)
+            m_Textures.Load(handle, std::move(load.Pixels), load.Mipmaps);
+        else
+            m_Textures.Release(handle);
+    }
+}
+
+unsigned long long AssetPipeline::UploadMesh(Load& load)
+{
+    MeshHandle handle{ load.Index, load.Generation };
+    if (!m_Meshes.IsAlive(handle))
+        return 0;   //released while loading
+    if (!load.Valid)
+    {
+        m_Meshes.Remove(handle);
+        return 0;
+    }
+
+    MeshAsset asset{};
+    const void* vertices;
+    unsigned int vertexBytes;
+    const unsigned int* indices;
+    if (load.CachedMesh)
+    {
+        const MeshFile& file{ *load.CachedMesh };
+        vertices = file.GetVertexData();
+        vertexBytes = file.GetVertexBytes();
+        indices = file.GetIndexData();
+        asset.IndexCount = file.GetIndexCount();
+        asset.Layout = file.GetLayout();
+        asset.Parts = file.GetParts();
+        std::copy_n(file.GetBoundsMin(), 3, asset.BoundsMin);
+        std::copy_n(file.GetBoundsMax(), 3, asset.BoundsMax);
+    }
+    else
+    {
+        const MeshData& mesh{ load.Mesh };
+        vertices = mesh.Vertices.data();
+        vertexBytes = mesh.GetVertexBytes();
+        indices = mesh.Indices.data();
+        asset.IndexCount = mesh.GetIndexCount();
+        asset.Layout = MeshData::GetLayout();
+        asset.Parts = mesh.Parts;
+        std::copy_n(mesh.BoundsMin, 3, asset.BoundsMin);
+        std::copy_n(mesh.BoundsMax, 3, asset.BoundsMax);
+    }
+
+    //creating the index buffer binds it to whichever VAO is bound, that binding is put back
+    GLint elements{ 0 };
+    GLCall(glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &elements));
+    asset.Vertices = m_Resources.CreateVertexBuffer(vertices, vertexBytes);
+    asset.Indices = m_Resources.CreateIndexBuffer(indices, asset.IndexCount);
+    GLCall(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, (GLuint)elements));
+    GLsync fence;
+    GLCall(fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+    m_FencedMeshes.push_back({ handle, std::move(asset), fence });
+    return load.Bytes;
+}
+
+unsigned long long AssetPipeline::UploadShader(Load& load)
+{
+    ShaderHandle handle{ load.Index, load.Generation };
+    if (!m_Shaders.IsAlive(handle))
+        return 0;
+    if (!load.Valid)
+    {
+        m_Shaders.Remove(handle);
+        return 0;
+    }
+
+    unsigned int program{ CreateShader(load.Shader.VertexSource, load.Shader.FragmentSouce) };
+    GLint linked{ GL_FALSE };
+    GLCall(glGetProgramiv(program, GL_LINK_STATUS, &linked));
+    if (linked != GL_TRUE)
+    {
+        //CreateShader() printed the log
+        GLCall(glDeleteProgram(program));
+        m_Shaders.Remove(handle);
+        return 0;
+    }
+    GLsync fence;
+    GLCall(fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+    m_FencedShaders.push_back({ handle, { program }, fence });
+    return load.Bytes;
+}
+
+void AssetPipeline::PollFences(bool wait)
+{
+    Publish(m_FencedMeshes, m_Meshes, wait, [this](MeshAsset& mesh) {
+        m_Resources.Release(mesh.Vertices);
+        m_Resources.Release(mesh.Indices);
+    });
+    Publish(m_FencedShaders, m_Shaders, wait, [](ShaderAsset& shader) {
+        GLCall(glDeleteProgram(shader.Program));
+    });
+}
+
+unsigned long long AssetPipeline::Pump(unsigned long long budget, bool wait)
+{
+    TakeDecoded();
+
+    //a load bigger than the whole budget still goes, alone in its frame
+    unsigned long long uploaded{ 0 };
+    while (!m_Uploads.empty() && (budget == 0 || uploaded < budget))
+    {
+        Load& load{ m_Uploads.front() };
+        uploaded += load.Kind == AssetKind::Mesh ? UploadMesh(load) : UploadShader(load);
+        m_Uploads.pop_front();
+    }
+    PollFences(wait);
+    s_UploadBytes.Add(uploaded);
+    return uploaded;
+}
+
+void AssetPipeline::Update()
+{
+    m_LastFrameUploadBytes = Pump(m_FrameBudget, false);
+    m_Textures.Update();
+}
+
+void AssetPipeline::WaitWhile(const std::function<bool()>& loading, bool textures)
+{
+    while (loading())
+    {
+        Pump(0, true);
+        if (textures)
+            m_Textures.Flush();
+        if (!loading())
+            break;
+        //still in the IO or decode stage
+        std::unique_lock<std::mutex> lock(m_DecodedMutex);
+        m_DecodedReady.wait_for(lock, std::chrono::milliseconds(1), [this]() { return !m_Decoded.empty(); });
+    }
+}
+
+void AssetPipeline::Flush()
+{
+    WaitWhile([this]() { return GetPendingCount() != 0; }, true);
+}
+
+AssetState AssetPipeline::Wait(MeshHandle handle)
+{
+    WaitWhile([this, handle]() { return GetState(handle) == AssetState::Loading; }, false);
+    return GetState(handle);
+}
+
+AssetState AssetPipeline::Wait(ShaderHandle handle)
+{
+    WaitWhile([this, handle]() { return GetState(handle) == AssetState::Loading; }, false);
+    return GetState(handle);
+}
+
+AssetState AssetPipeline::Wait(TextureHandle handle)
+{
+    WaitWhile([this, handle]() { return GetState(handle) == AssetState::Loading; }, true);
+    return GetState(handle);
+}
+
+AssetState AssetPipeline::GetState(MeshHandle handle)
+{
+    if (!m_Meshes.IsAlive(handle))
+        return AssetState::Failed;
+    return m_Meshes.Get(handle) ? AssetState::Ready : AssetState::Loading;
+}
+
+AssetState AssetPipeline::GetState(ShaderHandle handle)
+{
+    if (!m_Shaders.IsAlive(handle))
+        return AssetState::Failed;
+    return m_Shaders.Get(handle) ? AssetState::Ready : AssetState::Loading;
+}
+
+AssetState AssetPipeline::GetState(TextureHandle handle)
+{
+    if (!m_Textures.IsAlive(handle))
+        return AssetState::Failed;
+    return m_Textures.IsReady(handle) ? AssetState::Ready : AssetState::Loading;
+}
+
+const MeshAsset* AssetPipeline::GetMesh(MeshHandle handle)
+{
+    if (const MeshAsset* mesh = m_Meshes.Get(handle))
+        return mesh;
+    return m_Meshes.Get(m_MeshPlaceholder);
+}
+
+unsigned int AssetPipeline::GetShader(ShaderHandle handle)
+{
+    if (const ShaderAsset* shader = m_Shaders.Get(handle))
+        return shader->Program;
+    const ShaderAsset* placeholder{ m_Shaders.Get(m_ShaderPlaceholder) };
+    return placeholder ? placeholder->Program : 0;
+}
+
+const Texture& AssetPipeline::GetTexture(TextureHandle handle)
+{
+    if (Texture* texture = m_Textures.Get(handle))
+        return *texture;
+    if (Texture* placeholder = m_Textures.Get(m_TexturePlaceholder))
+        return *placeholder;
+    return m_White;
+}
+
+void AssetPipeline::Release(MeshHandle handle)
+{
+    m_Meshes.Remove(handle, [this](MeshAsset&& mesh) {
+        m_Resources.Release(mesh.Vertices);
+        m_Resources.Release(mesh.Indices);
+    });
+}
+
+void AssetPipeline::Release(ShaderHandle handle)
+{
+    m_Shaders.Remove(handle, [](ShaderAsset&& shader) {
+        GLCall(glDeleteProgram(shader.Program));
+    });
+}
+
+void AssetPipeline::Release(TextureHandle handle)
+{
+    m_Textures.Release(handle);
+}
+
+size_t AssetPipeline::GetPendingCount()
+{
+    size_t decoded;
+    {
+        std::lock_guard<std::mutex> lock(m_DecodedMutex);
+        decoded = m_Decoded.size();
+    }
+    return decoded + m_InFlight.load() + m_Uploads.size() + m_FencedMeshes.size() + m_FencedShaders.size()
+        + m_Textures.GetPendingCount();
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include "Image.h"
+#include "MeshCache.h"
+#include "MeshLoader.h"
+#include "Renderer.h"
+#include "ResourceManager.h"
+#include "Shader.h"
+#include "TextureStreamer.h"
+#include "VertexBufferLayout.h"
+#include "WorkerPool.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+//a mesh whose buffers live in the ResourceManager. bind the vertex buffer, Layout.Apply(), bind
+//the index buffer and draw IndexCount indices (or the parts' ranges)
+struct MeshAsset
+{
+	VertexBufferHandle Vertices;
+	IndexBufferHandle Indices;
+	VertexBufferLayout Layout;
+	std::vector<MeshPart> Parts;
+	unsigned int IndexCount;
+	float BoundsMin[3];
+	float BoundsMax[3];
+};
+
+struct ShaderAsset
+{
+	unsigned int Program;
+};
+
+using MeshHandle = Handle<MeshAsset>;
+using ShaderHandle = Handle<ShaderAsset>;
+
+enum class AssetState
+{
+	Loading, Ready, Failed      //Failed also covers released handles
+};
+
+//loads meshes, shaders and textures while the app keeps rendering. a load passes three stages:
+//IO on a thread of its own (FileSystem, the file faulted in), decode on the WorkerPool (parsing,
+//image decoding) and upload on the GL thread in Update(), which stops once the frame's budget
+//is spent. meshes and shaders are ready when the fence behind their upload has signalled,
+//textures go through the TextureStreamer's PBO ring. until an asset is ready Get*() hands out
+//the placeholder, so the first frame renders right away. every call is GL thread
+class AssetPipeline
+{
+private:
+	enum class AssetKind
+	{
+		Mesh, Shader, Texture
+	};
+
+	//a load travelling through the stages
+	struct Load
+	{
+		AssetKind Kind;
+		unsigned int Index;                     //of the handle
+		unsigned int Generation;
+		std::string Path;
+		bool Mipmaps;
+		bool Valid;                             //decoded fine
+		MeshData Mesh;
+		std::unique_ptr<MeshFile> CachedMesh;   //instead of Mesh with a MeshCache
+		ShaderProgramSource Shader;
+		Image Pixels;
+		unsigned long long Bytes;               //what the upload costs of the budget
+	};
+	template<typename T>
+	struct Fenced
+	{
+		Handle<T> Target;
+		T Asset;
+		GLsync Fence;                           //signalled once the GPU has the data
+	};
+
+	WorkerPool& m_Workers;
+	WorkerPool m_Io;
+	ResourceManager& m_Resources;
+	MeshCache* m_MeshCache;
+	TextureStreamer m_Textures;
+	ResourcePool<MeshAsset> m_Meshes;
+	ResourcePool<ShaderAsset> m_Shaders;
+	std::vector<Fenced<MeshAsset>> m_FencedMeshes;
+	std::vector<Fenced<ShaderAsset>> m_FencedShaders;
+	std::deque<Load> m_Uploads;                 //decoded, waiting for budget
+
+	std::mutex m_DecodedMutex;
+	std::condition_variable m_DecodedReady;
+	std::vector<Load> m_Decoded;                //filled by the stage jobs
+	std::atomic<unsigned int> m_InFlight;       //loads in the IO or decode stage
+
+	MeshHandle m_MeshPlaceholder;
+	ShaderHandle m_ShaderPlaceholder;
+	TextureHandle m_TexturePlaceholder;
+	Texture m_White;
+
+	unsigned long long m_FrameBudget;
+	unsigned long long m_LastFrameUploadBytes;
+
+	void Start(AssetKind kind, unsigned int index, unsigned int generation, const std::string& path, bool mipmaps);
+	//IO thread: opens and faults in the file, then queues the decode
+	void Read(std::shared_ptr<Load> load);
+	//worker side
+	void Decode(Load& load, const unsigned char* data, size_t size);
+	void Finish(Load& load);
+
+	void TakeDecoded();
+	//returns the bytes uploaded, 0 for loads that failed or were released meanwhile
+	unsigned long long UploadMesh(Load& load);
+	unsigned long long UploadShader(Load& load);
+	void PollFences(bool wait);
+	unsigned long long Pump(unsigned long long budget, bool wait);
+	//Pump()s (and with textures flushes the streamer) for as long as loading() says so
+	void WaitWhile(const std::function<bool()>& loading, bool textures);
+public:
+	//frameBudget 0 == unlimited, it covers mesh and shader uploads (textures stream under the
+	//TextureStreamer's own budget). with a mesh cache meshes load through it on the IO thread
+	AssetPipeline(WorkerPool& workers, ResourceManager& resources, unsigned long long frameBudget = 8 * 1024 * 1024,
+		MeshCache* meshCache = nullptr);
+	//waits for the stage jobs, the context must still be current
+	~AssetPipeline();
+
+	AssetPipeline(const AssetPipeline&) = delete;
+	AssetPipeline& operator=(const AssetPipeline&) = delete;
+
+	//all return immediately
+	MeshHandle LoadMesh(const std::string& filepath);
+	ShaderHandle LoadShader(const std::string& filepath);
+	TextureHandle LoadTexture(const std::string& filepath, bool mipmaps = true);
+
+	//once per frame: uploads what finished decoding until the budget is spent, publishes the
+	//assets whose fence has passed and streams texture rows
+	void Update();
+	//blocks until every queued load is ready or failed (loading screens, shutdown)
+	void Flush();
+	//blocks until this one is ready or failed
+	AssetState Wait(MeshHandle handle);
+	AssetState Wait(ShaderHandle handle);
+	AssetState Wait(TextureHandle handle);
+
+	AssetState GetState(MeshHandle handle);
+	AssetState GetState(ShaderHandle handle);
+	AssetState GetState(TextureHandle handle);
+
+	//the asset once ready, the placeholder's before that (nullptr / 0 without one). the mesh
+	//pointer is only good until the next Update()
+	const MeshAsset* GetMesh(MeshHandle handle);
+	unsigned int GetShader(ShaderHandle handle);
+	//without a placeholder texture: a 1x1 white one
+	const Texture& GetTexture(TextureHandle handle);
+
+	//a ready asset of this pipeline to stand in for the ones still loading
+	inline void SetPlaceholder(MeshHandle handle) { m_MeshPlaceholder = handle; }
+	inline void SetPlaceholder(ShaderHandle handle) { m_ShaderPlaceholder = handle; }
+	inline void SetPlaceholder(TextureHandle handle) { m_TexturePlaceholder = handle; }
+
+	//loading ones are dropped when they reach the GL thread
+	void Release(MeshHandle handle);
+	void Release(ShaderHandle handle);
+	void Release(TextureHandle handle);
+
+	inline TextureStreamer& GetTextureStreamer() { return m_Textures; }
+	inline void SetFrameBudget(unsigned long long bytes) { m_FrameBudget = bytes; }
+	inline unsigned long long GetLastFrameUploadBytes() const { return m_LastFrameUploadBytes; }
+	//loads not ready yet, in any stage
+	size_t GetPendingCount();
+};
@@ -0,0 +1,541 @@
+#include "BlockEncoder.h"
+#include "Texture.h"
+#include "WorkerPool.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BLOCK_ENCODER_SSE2
+#include <emmintrin.h>
+#endif
+
+static const ProfilerCounter s_EncodedPixels("Texture encoded pixels");
+
+namespace {
+
+    //one row of a block, a float per pixel
+    struct Lanes
+    {
+#ifdef BLOCK_ENCODER_SSE2
+        __m128 V;
+#else
+        float V[4];
+#endif
+    };
+
+#ifdef BLOCK_ENCODER_SSE2
+    inline Lanes Splat(float value) { return { _mm_set1_ps(value) }; }
+    inline Lanes operator+(Lanes a, Lanes b) { return { _mm_add_ps(a.V, b.V) }; }
+    inline Lanes operator-(Lanes a, Lanes b) { return { _mm_sub_ps(a.V, b.V) }; }
+    inline Lanes operator*(Lanes a, Lanes b) { return { _mm_mul_ps(a.V, b.V) }; }
+    inline Lanes Min(Lanes a, Lanes b) { return { _mm_min_ps(a.V, b.V) }; }
+    inline Lanes Max(Lanes a, Lanes b) { return { _mm_max_ps(a.V, b.V) }; }
+    //to nearest, ties to even like the scalar path
+    inline Lanes Round(Lanes a) { return { _mm_cvtepi32_ps(_mm_cvtps_epi32(a.V)) }; }
+    inline void Store(Lanes a, float* out) { _mm_storeu_ps(out, a.V); }
+
+    inline float HorizontalSum(Lanes a)
+    {
+        __m128 pairs{ _mm_add_ps(a.V, _mm_movehl_ps(a.V, a.V)) };
+        return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+    }
+    inline float HorizontalMin(Lanes a)
+    {
+        __m128 pairs{ _mm_min_ps(a.V, _mm_movehl_ps(a.V, a.V)) };
+        return _mm_cvtss_f32(_mm_min_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+    }
+    inline float HorizontalMax(Lanes a)
+    {
+        __m128 pairs{ _mm_max_ps(a.V, _mm_movehl_ps(a.V, a.V)) };
+        return _mm_cvtss_f32(_mm_max_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+    }
+
+    //16 RGBA8 pixels into one register per row and channel
+    inline void LoadChannels(const unsigned char* pixels, Lanes (&channels)[4][4])
+    {
+        const __m128i mask{ _mm_set1_epi32(0xff) };
+        for (unsigned int row = 0; row < 4; row++)
+        {
+            __m128i packed{ _mm_loadu_si128((const __m128i*)(pixels + row * 16)) };
+            channels[0][row].V = _mm_cvtepi32_ps(_mm_and_si128(packed, mask));
+            channels[1][row].V = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(packed, 8), mask));
+            channels[2][row].V = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(packed, 16), mask));
+            channels[3][row].V = _mm_cvtepi32_ps(_mm_srli_epi32(packed, 24));
+        }
+    }
+#else
+    template<typename Op>
+    inline Lanes Apply(Lanes a, Lanes b, Op op)
+    {
+        Lanes result;
+        for (unsigned int i = 0; i < 4; i++)
+            result.V[i] = op(a.V[i], b.V[i]);
+        return result;
+    }
+
+    inline Lanes Splat(float value) { return { { value, value, value, value } }; }
+    inline Lanes operator+(Lanes a, Lanes b) { return Apply(a, b, [](float x, float y) { return x + y; }); }
+    inline Lanes operator-(Lanes a, Lanes b) { return Apply(a, b, [](float x, float y) { return x - y; }); }
+    inline Lanes operator*(Lanes a, Lanes b) { return Apply(a, b, [](float x, float y) { return x * y; }); }
+    inline Lanes Min(Lanes a, Lanes b) { return Apply(a, b, [](float x, float y) { return std::min(x, y); }); }
+    inline Lanes Max(Lanes a, Lanes b) { return Apply(a, b, [](float x, float y) { return std::max(x, y); }); }
+    inline Lanes Round(Lanes a) { return Apply(a, a, [](float x, float) { return std::nearbyint(x); }); }
+    inline void Store(Lanes a, float* out) { std::memcpy(out, a.V, sizeof(a.V)); }
+
+    inline float HorizontalSum(Lanes a) { return (a.V[0] + a.V[2]) + (a.V[1] + a.V[3]); }
+    inline float HorizontalMin(Lanes a) { return std::min(std::min(a.V[0], a.V[1]), std::min(a.V[2], a.V[3])); }
+    inline float HorizontalMax(Lanes a) { return std::max(std::max(a.V[0], a.V[1]), std::max(a.V[2], a.V[3])); }
+
+    inline void LoadChannels(const unsigned char* pixels, Lanes (&channels)[4][4])
+    {
+        for (unsigned int row = 0; row < 4; row++)
+            for (unsigned int x = 0; x < 4; x++)
+                for (unsigned int c = 0; c < 4; c++)
+                    channels[c][row].V[x] = pixels[row * 16 + x * 4 + c];
+    }
+#endif
+
+    inline Lanes Clamp(Lanes a, float low, float high) { return Min(Max(a, Splat(low)), Splat(high)); }
+
+    struct Color
+    {
+        float R, G, B;
+    };
+
+    unsigned short To565(Color color)
+    {
+        int r{ (int)std::lround(std::min(std::max(color.R, 0.0f), 255.0f) * 31.0f / 255.0f) };
+        int g{ (int)std::lround(std::min(std::max(color.G, 0.0f), 255.0f) * 63.0f / 255.0f) };
+        int b{ (int)std::lround(std::min(std::max(color.B, 0.0f), 255.0f) * 31.0f / 255.0f) };
+        return (unsigned short)((r << 11) | (g << 5) | b);
+    }
+
+    //the 8 bit color the hardware expands a 565 endpoint to
+    Color From565(unsigned short packed)
+    {
+        unsigned int r{ (packed >> 11) & 31u }, g{ (packed >> 5) & 63u }, b{ packed & 31u };
+        return { (float)((r << 3) | (r >> 2)), (float)((g << 2) | (g >> 4)), (float)((b << 3) | (b >> 2)) };
+    }
+
+    //position of every pixel between the endpoints in thirds, 0 == c0 and 3 == c1
+    void FitColorIndices(const Lanes (&channels)[4][4], unsigned short c0, unsigned short c1, Lanes (&steps)[4])
+    {
+        Color e0{ From565(c0) }, e1{ From565(c1) };
+        Color axis{ e1.R - e0.R, e1.G - e0.G, e1.B - e0.B };
+        float length{ axis.R * axis.R + axis.G * axis.G + axis.B * axis.B };
+        float scale{ length > 0.0f ? 3.0f / length : 0.0f };
+        for (unsigned int row = 0; row < 4; row++)
+        {
+            Lanes projection{ (channels[0][row] - Splat(e0.R)) * Splat(axis.R)
+                + (channels[1][row] - Splat(e0.G)) * Splat(axis.G)
+                + (channels[2][row] - Splat(e0.B)) * Splat(axis.B) };
+            steps[row] = Clamp(Round(projection * Splat(scale)), 0.0f, 3.0f);
+        }
+    }
+
+    //least squares endpoints for the chosen indices, false when they do not constrain both
+    bool RefineColorEndpoints(const Lanes (&channels)[4][4], const Lanes (&steps)[4], Color& e0, Color& e1)
+    {
+        Lanes aa{ Splat(0.0f) }, bb{ Splat(0.0f) }, ab{ Splat(0.0f) };
+        Lanes ap[3]{ Splat(0.0f), Splat(0.0f), Splat(0.0f) }, bp[3]{ Splat(0.0f), Splat(0.0f), Splat(0.0f) };
+        for (unsigned int row = 0; row < 4; row++)
+        {
+            Lanes beta{ steps[row] * Splat(1.0f / 3.0f) };
+            Lanes alpha{ Splat(1.0f) - beta };
+            aa = aa + alpha * alpha;
+            bb = bb + beta * beta;
+            ab = ab + alpha * beta;
+            for (unsigned int c = 0; c < 3; c++)
+            {
+                ap[c] = ap[c] + alpha * channels[c][row];
+                bp[c] = bp[c] + beta * channels[c][row];
+            }
+        }
+        float sumAA{ HorizontalSum(aa) }, sumBB{ HorizontalSum(bb) }, sumAB{ HorizontalSum(ab) };
+        float determinant{ sumAA * sumBB - sumAB * sumAB };
+        if (std::fabs(determinant) < 1e-3f)
+            return false;
+        float solved[2][3];
+        for (unsigned int c = 0; c < 3; c++)
+        {
+            float sumAP{ HorizontalSum(ap[c]) }, sumBP{ HorizontalSum(bp[c]) };
+            solved[0][c] = (sumAP * sumBB - sumBP * sumAB) / determinant;
+            solved[1][c] = (sumBP * sumAA - sumAP * sumAB) / determinant;
+        }
+        e0 = { solved[0][0], solved[0][1], solved[0][2] };
+        e1 = { solved[1][0], solved[1][1], solved[1][2] };
+        return true;
+    }
+
+    //four color mode needs c0 > c1, equal endpoints encode a solid block with every index 0
+    void OrderEndpoints(unsigned short& c0, unsigned short& c1)
+    {
+        if (c0 < c1)
+            std::swap(c0, c1);
+    }
+
+    void WriteColorBlock(unsigned short c0, unsigned short c1, const Lanes (&steps)[4], unsigned char* out)
+    {
+        //steps run c0, 1/3, 2/3, c1; the block stores c0, c1, 1/3, 2/3
+        static const unsigned int s_StepToIndex[4]{ 0, 2, 3, 1 };
+        unsigned int indices{ 0 };
+        for (unsigned int row = 0; row < 4; row++)
+        {
+            float values[4];
+            Store(steps[row], values);
+            for (unsigned int x = 0; x < 4; x++)
+                indices |= s_StepToIndex[(unsigned int)values[x]] << (2 * (row * 4 + x));
+        }
+        out[0] = (unsigned char)c0;
+        out[1] = (unsigned char)(c0 >> 8);
+        out[2] = (unsigned char)c1;
+        out[3] = (unsigned char)(c1 >> 8);
+        for (unsigned int i = 0; i < 4; i++)
+            out[4 + i] = (unsigned char)(indices >> (8 * i));
+    }
+
+    //endpoints along the principal axis of the colors, one least squares refinement on top
+    void EncodeColorBlock(const Lanes (&channels)[4][4], unsigned char* out)
+    {
+        Lanes sum[3]{ channels[0][0], channels[1][0], channels[2][0] };
+        for (unsigned int row = 1; row < 4; row++)
+            for (unsigned int c = 0; c < 3; c++)
+                sum[c] = sum[c] + channels[c][row];
+        Color mean{ HorizontalSum(sum[0]) / 16.0f, HorizontalSum(sum[1]) / 16.0f, HorizontalSum(sum[2]) / 16.0f };
+
+        Lanes rr{ Splat(0.0f) }, rg{ Splat(0.0f) }, rb{ Splat(0.0f) }, gg{ Splat(0.0f) }, gb{ Splat(0.0f) }, bb{ Splat(0.0f) };
+        Lanes centered[3][4];
+        for (unsigned int row = 0; row < 4; row++)
+        {
+            Lanes r{ channels[0][row] - Splat(mean.R) }, g{ channels[1][row] - Splat(mean.G) }, b{ channels[2][row] - Splat(mean.B) };
+            centered[0][row] = r;
+            centered[1][row] = g;
+            centered[2][row] = b;
+            rr = rr + r * r; rg = rg + r * g; rb = rb + r * b;
+            gg = gg + g * g; gb = gb + g * b; bb = bb + b * b;
+        }
+        float covariance[3][3];
+        covariance[0][0] = HorizontalSum(rr);
+        covariance[0][1] = covariance[1][0] = HorizontalSum(rg);
+        covariance[0][2] = covariance[2][0] = HorizontalSum(rb);
+        covariance[1][1] = HorizontalSum(gg);
+        covariance[1][2] = covariance[2][1] = HorizontalSum(gb);
+        covariance[2][2] = HorizontalSum(bb);
+
+        //power iteration from the row of the largest variance, which is never orthogonal to the axis
+        unsigned int start{ 0 };
+        for (unsigned int c = 1; c < 3; c++)
+            if (covariance[c][c] > covariance[start][start])
+                start = c;
+        float axis[3]{ covariance[start][0], covariance[start][1], covariance[start][2] };
+        for (unsigned int iteration = 0; iteration < 4; iteration++)
+        {
+            float next[3];
+            for (unsigned int c = 0; c < 3; c++)
+                next[c] = covariance[c][0] * axis[0] + covariance[c][1] * axis[1] + covariance[c][2] * axis[2];
+            float length{ std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]) };
+            if (length < 1e-6f)
+                break;
+            for (unsigned int c = 0; c < 3; c++)
+                axis[c] = next[c] / length;
+        }
+        float axisLength{ std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]) };
+
+        unsigned short c0, c1;
+        if (axisLength < 1e-6f)
+        {
+            c0 = c1 = To565(mean);  //solid block
+        }
+        else
+        {
+            for (float& value : axis)
+                value /= axisLength;
+            Lanes low{ Splat(std::numeric_limits<float>::max()) }, high{ Splat(-std::numeric_limits<float>::max()) };
+            for (unsigned int row = 0; row < 4; row++)
+            {
+                Lanes projection{ centered[0][row] * Splat(axis[0]) + centered[1][row] * Splat(axis[1]) + centered[2][row] * Splat(axis[2]) };
+                low = Min(low, projection);
+                high = Max(high, projection);
+            }
+            float lowest{ HorizontalMin(low) }, highest{ HorizontalMax(high) };
+            c0 = To565({ mean.R + axis[0] * highest, mean.G + axis[1] * highest, mean.B + axis[2] * highest });
+            c1 = To565({ mean.R + axis[0] * lowest, mean.G + axis[1] * lowest, mean.B + axis[2] * lowest });
+        }
+        OrderEndpoints(c0, c1);
+
+        Lanes steps[4];
+        FitColorIndices(channels, c0, c1, steps);
+        Color e0, e1;
+        if (c0 != c1 && RefineColorEndpoints(channels, steps, e0, e1))
+        {
+            c0 = To565(e0);
+            c1 = To565(e1);
+            OrderEndpoints(c0, c1);
+            FitColorIndices(channels, c0, c1, steps);
+        }
+        WriteColorBlock(c0, c1, steps, out);
+    }
+
+    //BC4 block of one channel in eight value mode between its min and max
+    void EncodeChannelBlock(const Lanes (&values)[4], unsigned char* out)
+    {
+        Lanes low{ values[0] }, high{ values[0] };
+        for (unsigned int row = 1; row < 4; row++)
+        {
+            low = Min(low, values[row]);
+            high = Max(high, values[row]);
+        }
+        float a0{ HorizontalMax(high) }, a1{ HorizontalMin(low) };
+        out[0] = (unsigned char)a0;
+        out[1] = (unsigned char)a1;
+
+        //steps run from a0 (0) to a1 (7); the block stores a0, a1 and then the six in between
+        static const unsigned int s_StepToIndex[8]{ 0, 2, 3, 4, 5, 6, 7, 1 };
+        unsigned long long indices{ 0 };
+        if (a0 > a1)
+        {
+            Lanes scale{ Splat(7.0f / (a0 - a1)) };
+            for (unsigned int row = 0; row < 4; row++)
+            {
+                float steps[4];
+                Store(Clamp(Round((Splat(a0) - values[row]) * scale), 0.0f, 7.0f), steps);
+                for (unsigned int x = 0; x < 4; x++)
+                    indices |= (unsigned long long)s_StepToIndex[(unsigned int)steps[x]] << (3 * (row * 4 + x));
+            }
+        }
+        for (unsigned int i = 0; i < 6; i++)
+            out[2 + i] = (unsigned char)(indices >> (8 * i));
+    }
+
+    void EncodeBC1(const unsigned char* pixels, unsigned char* out)
+    {
+        Lanes channels[4][4];
+        LoadChannels(pixels, channels);
+        EncodeColorBlock(channels, out);
+    }
+
+    void EncodeBC3(const unsigned char* pixels, unsigned char* out)
+    {
+        Lanes channels[4][4];
+        LoadChannels(pixels, channels);
+        EncodeChannelBlock(channels[3], out);
+        EncodeColorBlock(channels, out + 8);
+    }
+
+    void EncodeBC4(const unsigned char* pixels, unsigned char* out)
+    {
+        Lanes channels[4][4];
+        LoadChannels(pixels, channels);
+        EncodeChannelBlock(channels[0], out);
+    }
+
+    void EncodeBC5(const unsigned char* pixels, unsigned char* out)
+    {
+        Lanes channels[4][4];
+        LoadChannels(pixels, channels);
+        EncodeChannelBlock(channels[0], out);
+        EncodeChannelBlock(channels[1], out + 8);
+    }
+
+    using BlockFunction = void (*)(const unsigned char* pixels, unsigned char* out);
+
+    BlockFunction GetBlockEncoder(unsigned int internalFormat)
+    {
+        switch (internalFormat)
+        {
+            case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+            case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:          return EncodeBC1;
+            case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+            case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:    return EncodeBC3;
+            case GL_COMPRESSED_RED_RGTC1:                   return EncodeBC4;
+            case GL_COMPRESSED_RG_RGTC2:                    return EncodeBC5;
+            default:                                        return nullptr;
+        }
+    }
+
+    void DecodeColorBlock(const unsigned char* block, unsigned char* pixels)
+    {
+        unsigned short c0{ (unsigned short)(block[0] | (block[1] << 8)) };
+        unsigned short c1{ (unsigned short)(block[2] | (block[3] << 8)) };
+        Color e0{ From565(c0) }, e1{ From565(c1) };
+        unsigned char palette[4][4]{
+            { (unsigned char)e0.R, (unsigned char)e0.G, (unsigned char)e0.B, 255 },
+            { (unsigned char)e1.R, (unsigned char)e1.G, (unsigned char)e1.B, 255 } };
+        for (unsigned int c = 0; c < 3; c++)
+        {
+            unsigned int a{ palette[0][c] }, b{ palette[1][c] };
+            palette[2][c] = (unsigned char)(c0 > c1 ? (2 * a + b) / 3 : (a + b) / 2);
+            palette[3][c] = (unsigned char)(c0 > c1 ? (a + 2 * b) / 3 : 0);
+        }
+        palette[2][3] = 255;
+        palette[3][3] = c0 > c1 ? 255 : 0;
+
+        unsigned int indices{ (unsigned int)(block[4] | (block[5] << 8) | (block[6] << 16) | ((unsigned int)block[7] << 24)) };
+        for (unsigned int i = 0; i < 16; i++)
+            std::memcpy(pixels + i * 4, palette[(indices >> (2 * i)) & 3], 4);
+    }
+
+    void DecodeChannelBlock(const unsigned char* block, unsigned char* pixels, unsigned int channel)
+    {
+        unsigned int a0{ block[0] }, a1{ block[1] };
+        unsigned int palette[8]{ a0, a1 };
+        if (a0 > a1)
+        {
+            for (unsigned int i = 1; i < 7; i++)
+                palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+        }
+        else
+        {
+            for (unsigned int i = 1; i < 5; i++)
+                palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+
+        unsigned long long indices{ 0 };
+        for (unsigned int i = 0; i < 6; i++)
+            indices |= (unsigned long long)block[2 + i] << (8 * i);
+        for (unsigned int i = 0; i < 16; i++)
+            pixels[i * 4 + channel] = (unsigned char)palette[(indices >> (3 * i)) & 7];
+    }
+
+    //the channels the format stores, for PSNR
+    unsigned int GetStoredChannels(unsigned int internalFormat)
+    {
+        switch (internalFormat)
+        {
+            case GL_COMPRESSED_RED_RGTC1:       return 1;
+            case GL_COMPRESSED_RG_RGTC2:        return 2;
+            case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+            case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:  return 3;
+            default:                            return 4;
+        }
+    }
+
+}
+
+bool CanEncode(unsigned int internalFormat)
+{
+    return GetBlockEncoder(internalFormat) != nullptr;
+}
+
+bool EncodeImage(const Image& image, unsigned int internalFormat, CompressedImage& out, WorkerPool* workers)
+{
+    out = CompressedImage();
+    BlockFunction encode{ GetBlockEncoder(internalFormat) };
+    if (!image.IsValid() || !encode)
+    {
+        std::cout << "Cannot encode image as format 0x" << std::hex << internalFormat << std::dec << std::endl;
+        return false;
+    }
+
+    out.InternalFormat = internalFormat;
+    out.Width = image.Width;
+    out.Height = image.Height;
+    size_t size{ (size_t)GetImageSize(internalFormat, image.Width, image.Height) };
+    out.Levels.push_back({ image.Width, image.Height, 0, size });
+    out.Data.resize(size);
+
+    unsigned int blockBytes{ GetBlockBytes(internalFormat) };
+    unsigned int blocksX{ (image.Width + 3) / 4 }, blocksY{ (image.Height + 3) / 4 };
+    auto encodeRows = [&](unsigned int begin, unsigned int end) {
+        unsigned char pixels[64];
+        for (unsigned int blockY = begin; blockY < end; blockY++)
+        {
+            unsigned char* dst{ out.Data.data() + (size_t)blockY * blocksX * blockBytes };
+            for (unsigned int blockX = 0; blockX < blocksX; blockX++, dst += blockBytes)
+            {
+                //blocks hanging over the edge repeat the last row/column
+                for (unsigned int row = 0; row < 4; row++)
+                {
+                    unsigned int y{ std::min(blockY * 4 + row, image.Height - 1) };
+                    const unsigned char* src{ image.Pixels.data() + y * image.GetRowSize() };
+                    for (unsigned int x = 0; x < 4; x++)
+                        std::memcpy(pixels + row * 16 + x * 4, src + std::min(blockX * 4 + x, image.Width - 1) * 4, 4);
+                }
+                encode(pixels, dst);
+            }
+        }
+    };
+
+    if (workers)
+        workers->ParallelFor(blocksY, std::max(1024 / blocksX, 1u), encodeRows);
+    else
+        encodeRows(0, blocksY);
+    s_EncodedPixels.Add((unsigned long long)image.Width * image.Height);
+    return true;
+}
+
+bool DecodeCompressedImage(const CompressedImage& image, Image& out)
+{
+    out = Image();
+    if (!image.IsValid() || !GetBlockEncoder(image.InternalFormat))
+        return false;
+
+    const CompressedLevel& level{ image.Levels[0] };
+    out.Width = level.Width;
+    out.Height = level.Height;
+    out.Pixels.resize(out.GetRowSize() * out.Height);
+
+    unsigned int blockBytes{ GetBlockBytes(image.InternalFormat) };
+    unsigned int blocksX{ (level.Width + 3) / 4 }, blocksY{ (level.Height + 3) / 4 };
+    const unsigned char* block{ image.GetLevelData(0) };
+    for (unsigned int blockY = 0; blockY < blocksY; blockY++)
+    {
+        for (unsigned int blockX = 0; blockX < blocksX; blockX++, block += blockBytes)
+        {
+            unsigned char pixels[64];
+            switch (GetStoredChannels(image.InternalFormat))
+            {
+                case 1:
+                case 2:
+                    for (unsigned int i = 0; i < 16; i++)
+                        std::memcpy(pixels + i * 4, "\0\0\0\xff", 4);
+                    DecodeChannelBlock(block, pixels, 0);
+                    if (image.InternalFormat == GL_COMPRESSED_RG_RGTC2)
+                        DecodeChannelBlock(block + 8, pixels, 1);
+                    break;
+                case 3:
+                    DecodeColorBlock(block, pixels);
+                    break;
+                default:
+                    DecodeColorBlock(block + 8, pixels);
+                    DecodeChannelBlock(block, pixels, 3);
+                    break;
+            }
+            for (unsigned int row = 0; row < 4 && blockY * 4 + row < out.Height; row++)
+            {
+                unsigned int width{ std::min(4u, out.Width - blockX * 4) };
+                std::memcpy(out.Pixels.data() + (blockY * 4 + row) * out.GetRowSize() + blockX * 16, pixels + row * 16, width * 4);
+            }
+        }
+    }
+    return true;
+}
+
+double ComputePsnr(const Image& reference, const CompressedImage& image)
+{
+    Image decoded;
+    if (!DecodeCompressedImage(image, decoded) || decoded.Width != reference.Width || decoded.Height != reference.Height)
+        return 0.0;
+
+    unsigned int channels{ GetStoredChannels(image.InternalFormat) };
+    double squaredError{ 0.0 };
+    for (size_t i = 0; i < reference.Pixels.size(); i += 4)
+    {
+        for (unsigned int c = 0; c < channels; c++)
+        {
+            double difference{ (double)reference.Pixels[i + c] - decoded.Pixels[i + c] };
+            squaredError += difference * difference;
+        }
+    }
+    double meanError{ squaredError / ((double)reference.Width * reference.Height * channels) };
+    if (meanError == 0.0)
+        return std::numeric_limits<double>::infinity();
+    return 10.0 * std::log10(255.0 * 255.0 / meanError);
+}
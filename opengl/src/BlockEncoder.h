@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Image.h"
+#include "CompressedImage.h"
+
+class WorkerPool;
+
+//CPU block compression for assets that arrive uncompressed: BC1 (opaque DXT1), BC3 (DXT5),
+//BC4 (RGTC1) and BC5 (RGTC2) plus their sRGB variants. each 4x4 block is fitted with SSE2
+//where the compiler targets it and plain floats otherwise. BC7 can be loaded, not produced
+bool CanEncode(unsigned int internalFormat);
+
+//encodes image into the single level of out. with workers the rows of blocks are spread over
+//the pool, the calling thread helps
+bool EncodeImage(const Image& image, unsigned int internalFormat, CompressedImage& out, WorkerPool* workers = nullptr);
+
+//level 0 back to RGBA8 the way the GPU samples it: channels the format does not store read
+//as 0, alpha as 255
+bool DecodeCompressedImage(const CompressedImage& image, Image& out);
+
+//peak signal to noise ratio in dB over the channels the format stores, infinite when exact
+double ComputePsnr(const Image& reference, const CompressedImage& image);
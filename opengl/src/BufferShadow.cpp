@@ -0,0 +1,94 @@
+#include "BufferShadow.h"
+#include "AllocationTracker.h"
+#include "Profiler.h"
+#include "Renderer.h"
+
+#include <algorithm>
+#include <cstring>
+
+static const ProfilerCounter s_UploadBytes("Buffer upload bytes");
+static const ProfilerCounter s_UploadCalls("Buffer upload calls");
+
+BufferShadow::BufferShadow(const void* data, unsigned int size)
+    : m_Data(size)
+{
+    if (data && size)
+        std::memcpy(m_Data.data(), data, size);
+}
+
+void BufferShadow::Write(unsigned int offset, const void* data, unsigned int size)
+{
+    ALLOCATION_SCOPE("BufferShadow");
+    ASSERT((unsigned long long)offset + size <= m_Data.size());
+    if (!size)
+        return;
+    std::memcpy(m_Data.data() + offset, data, size);
+
+    //find the first range that could merge with [offset, offset + size)
+    Range added{ offset, offset + size };
+    auto first{ std::lower_bound(m_Dirty.begin(), m_Dirty.end(), added, [](const Range& r, const Range& a) {
+        return r.End + s_MergeGap < a.Begin;
+    }) };
+    auto last{ first };
+    while (last != m_Dirty.end() && last->Begin <= added.End + s_MergeGap)
+    {
+        added.Begin = std::min(added.Begin, last->Begin);
+        added.End = std::max(added.End, last->End);
+        ++last;
+    }
+
+    if (first == last)
+        m_Dirty.insert(first, added);
+    else
+    {
+        *first = added;
+        m_Dirty.erase(first + 1, last);
+    }
+}
+
+unsigned int BufferShadow::Flush(unsigned int target, unsigned int buffer)
+{
+    if (m_Dirty.empty())
+        return 0;
+
+    unsigned int bytes{ 0 };
+    GLCall(glBindBuffer(target, buffer));
+    if (m_Dirty.size() <= s_MapRangeThreshold)
+    {
+        for (const Range& range : m_Dirty)
+        {
+            GLCall(glBufferSubData(target, range.Begin, range.End - range.Begin, m_Data.data() + range.Begin));
+            bytes += range.End - range.Begin;
+        }
+        s_UploadCalls.Add(m_Dirty.size());
+    }
+    else
+    {
+        //one map over the whole span, only the dirty pieces are written and flushed
+        unsigned int begin{ m_Dirty.front().Begin };
+        unsigned int end{ m_Dirty.back().End };
+        GLCall(unsigned char* mapped = (unsigned char*)glMapBufferRange(target, begin, end - begin,
+            GL_MAP_WRITE_BIT | GL_MAP_FLUSH_EXPLICIT_BIT));
+        ASSERT(mapped);
+        for (const Range& range : m_Dirty)
+        {
+            std::memcpy(mapped + (range.Begin - begin), m_Data.data() + range.Begin, range.End - range.Begin);
+            GLCall(glFlushMappedBufferRange(target, range.Begin - begin, range.End - range.Begin));
+            bytes += range.End - range.Begin;
+        }
+        GLCall(glUnmapBuffer(target));
+        s_UploadCalls.Increment();
+    }
+
+    m_Dirty.clear();
+    s_UploadBytes.Add(bytes);
+    return bytes;
+}
+
+void BufferShadow::Upload(unsigned int buffer, unsigned int offset, const void* data, unsigned int size)
+{
+    GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, buffer));
+    GLCall(glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, data));
+    s_UploadCalls.Increment();
+    s_UploadBytes.Add(size);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+
+//CPU copy of a GL buffer plus the byte ranges written since the last flush. ranges that
+//overlap, touch or are closer than s_MergeGap are merged, so a flush is the smallest
+//number of uploads that covers everything that changed
+class BufferShadow
+{
+public:
+	static constexpr unsigned int s_MergeGap{ 64 };         //re-uploading a small clean gap beats another call
+	static constexpr unsigned int s_MapRangeThreshold{ 8 }; //more ranges than this go through one mapped write
+private:
+	struct Range
+	{
+		unsigned int Begin;
+		unsigned int End;
+	};
+
+	std::vector<unsigned char> m_Data;
+	std::vector<Range> m_Dirty;                             //sorted and disjoint
+public:
+	BufferShadow(const void* data, unsigned int size);
+
+	void Write(unsigned int offset, const void* data, unsigned int size);
+
+	//uploads the dirty ranges into buffer (bound to target while flushing) and returns the byte count
+	unsigned int Flush(unsigned int target, unsigned int buffer);
+
+	//immediate glBufferSubData for buffers without a shadow, counted like a flush
+	static void Upload(unsigned int buffer, unsigned int offset, const void* data, unsigned int size);
+
+	inline bool IsDirty() const { return !m_Dirty.empty(); }
+	inline unsigned int GetDirtyRangeCount() const { return (unsigned int)m_Dirty.size(); }
+	inline const unsigned char* GetData() const { return m_Data.data(); }
+	inline unsigned int GetSize() const { return (unsigned int)m_Data.size(); }
+};
@@ -0,0 +1,55 @@
+#include "CallStack.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <ostream>
+
+#if defined(__GLIBC__)
+#include <execinfo.h>
+#elif defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+CallStack CallStack::Capture()
+{
+    CallStack stack;
+#if defined(__GLIBC__)
+    stack.Depth = (unsigned int)backtrace(stack.Frames, s_MaxDepth);
+#elif defined(_WIN32)
+    stack.Depth = (unsigned int)CaptureStackBackTrace(0, s_MaxDepth, stack.Frames, nullptr);
+#else
+    stack.Depth = 0;
+#endif
+    return stack;
+}
+
+unsigned long long CallStack::Hash() const
+{
+    unsigned long long hash{ 14695981039346656037ull };
+    for (unsigned int i = 0; i < Depth; i++)
+        hash = (hash ^ (unsigned long long)(uintptr_t)Frames[i]) * 1099511628211ull;
+    return hash | 1;
+}
+
+void CallStack::Print(std::ostream& out, unsigned int skip, const char* indent) const
+{
+    if (skip >= Depth)
+        return;
+#if defined(__GLIBC__)
+    //link with -rdynamic to get function names instead of bare offsets
+    char** symbols{ backtrace_symbols((void* const*)Frames, (int)Depth) };
+    for (unsigned int i = skip; i < Depth; i++)
+    {
+        if (symbols)
+            out << indent << symbols[i] << std::endl;
+        else
+            out << indent << Frames[i] << std::endl;
+    }
+    std::free(symbols);
+#else
+    for (unsigned int i = skip; i < Depth; i++)
+        out << indent << Frames[i] << std::endl;
+#endif
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <iosfwd>
+
+//raw return addresses of the calling thread, cheap to capture and only symbolized when printed
+struct CallStack
+{
+	static constexpr unsigned int s_MaxDepth{ 16 };
+
+	void* Frames[s_MaxDepth];
+	unsigned int Depth;
+
+	//does not allocate, except on the very first call which may load the unwinder
+	static CallStack Capture();
+
+	//fnv-1a over the return addresses, never 0
+	unsigned long long Hash() const;
+
+	//one frame per line, skip drops the innermost frames (the capturing functions themselves)
+	void Print(std::ostream& out, unsigned int skip = 0, const char* indent = "      ") const;
+};
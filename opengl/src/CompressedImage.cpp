@@ -0,0 +1,360 @@
+#include "CompressedImage.h"
+#include "FileSystem.h"
+#include "Texture.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+static unsigned int ReadU32(const unsigned char* data, bool swap = false)
+{
+    unsigned int value{ (unsigned int)(data[0] | (data[1] << 8) | (data[2] << 16) | ((unsigned int)data[3] << 24)) };
+    if (swap)
+        value = (value >> 24) | ((value >> 8) & 0xff00) | ((value << 8) & 0xff0000) | (value << 24);
+    return value;
+}
+
+static constexpr unsigned int FourCC(char a, char b, char c, char d)
+{
+    return (unsigned int)a | ((unsigned int)b << 8) | ((unsigned int)c << 16) | ((unsigned int)d << 24);
+}
+
+//lays out the levels of a width x height chain back to back, false if data is too short
+static bool AddLevels(CompressedImage& image, unsigned int levels, size_t available)
+{
+    unsigned int width{ image.Width }, height{ image.Height };
+    size_t offset{ 0 };
+    levels = std::min(std::max(levels, 1u), Texture::GetFullMipCount(width, height));
+    for (unsigned int level = 0; level < levels; level++)
+    {
+        size_t size{ (size_t)GetImageSize(image.InternalFormat, width, height) };
+        if (offset + size > available)
+            return false;
+        image.Levels.push_back({ width, height, offset, size });
+        offset += size;
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+    return true;
+}
+
+//the color half of BC1/2/3: one byte of 2 bit indices per row
+static void FlipColorBlock(unsigned char* block, unsigned int rows)
+{
+    std::reverse(block + 4, block + 4 + rows);
+}
+
+//BC2 alpha: two bytes of 4 bit alphas per row
+static void FlipExplicitAlphaBlock(unsigned char* block, unsigned int rows)
+{
+    for (unsigned int row = 0; row < rows / 2; row++)
+        std::swap_ranges(block + row * 2, block + row * 2 + 2, block + (rows - 1 - row) * 2);
+}
+
+//BC3 alpha/BC4/BC5 channel: 48 bits of 3 bit indices after the endpoints, 12 bits per row
+static void FlipInterpolatedBlock(unsigned char* block, unsigned int rows)
+{
+    unsigned long long bits{ 0 };
+    for (unsigned int i = 0; i < 6; i++)
+        bits |= (unsigned long long)block[2 + i] << (8 * i);
+    unsigned long long flipped{ bits };
+    for (unsigned int row = 0; row < rows; row++)
+    {
+        unsigned long long mask{ 0xfffull << (12 * (rows - 1 - row)) };
+        flipped = (flipped & ~mask) | (((bits >> (12 * row)) & 0xfff) << (12 * (rows - 1 - row)));
+    }
+    for (unsigned int i = 0; i < 6; i++)
+        block[2 + i] = (unsigned char)(flipped >> (8 * i));
+}
+
+//containers store the top row first, turn every level upside down to match Image
+static void FlipVertically(CompressedImage& image)
+{
+    void (*first)(unsigned char*, unsigned int){ nullptr };
+    void (*second)(unsigned char*, unsigned int){ nullptr };
+    switch (image.InternalFormat)
+    {
+        case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+            first = FlipColorBlock; break;
+        case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+        case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT:
+            first = FlipExplicitAlphaBlock; second = FlipColorBlock; break;
+        case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+        case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+            first = FlipInterpolatedBlock; second = FlipColorBlock; break;
+        case GL_COMPRESSED_RED_RGTC1:
+        case GL_COMPRESSED_SIGNED_RED_RGTC1:
+            first = FlipInterpolatedBlock; break;
+        case GL_COMPRESSED_RG_RGTC2:
+        case GL_COMPRESSED_SIGNED_RG_RGTC2:
+            first = second = FlipInterpolatedBlock; break;
+        default:
+            return;     //BC6H/BC7 partitions and modes can not be mirrored in place
+    }
+
+    unsigned int blockBytes{ GetBlockBytes(image.InternalFormat) };
+    for (const CompressedLevel& level : image.Levels)
+    {
+        unsigned int blocksX{ (level.Width + 3) / 4 }, blocksY{ (level.Height + 3) / 4 };
+        unsigned int rows{ std::min(level.Height, 4u) };
+        size_t rowSize{ (size_t)blocksX * blockBytes };
+        unsigned char* data{ image.Data.data() + level.Offset };
+        for (unsigned int y = 0; y < blocksY / 2; y++)
+            std::swap_ranges(data + y * rowSize, data + (y + 1) * rowSize, data + (blocksY - 1 - y) * rowSize);
+        for (size_t offset = 0; offset < level.Size; offset += blockBytes)
+        {
+            first(data + offset, rows);
+            if (second)
+                second(data + offset + 8, rows);
+        }
+    }
+}
+
+static unsigned int GetDxgiFormat(unsigned int dxgiFormat)
+{
+    switch (dxgiFormat)
+    {
+        case 71: return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+        case 72: return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT;
+        case 74: return GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+        case 75: return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT;
+        case 77: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case 78: return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+        case 80: return GL_COMPRESSED_RED_RGTC1;
+        case 81: return GL_COMPRESSED_SIGNED_RED_RGTC1;
+        case 83: return GL_COMPRESSED_RG_RGTC2;
+        case 84: return GL_COMPRESSED_SIGNED_RG_RGTC2;
+        case 95: return GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT;
+        case 96: return GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT;
+        case 98: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+        case 99: return GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM;
+        default: return 0;
+    }
+}
+
+static bool DecodeDds(const unsigned char* data, size_t size, CompressedImage& image)
+{
+    //"DDS " + 124 byte header, the pixel format sits at 76
+    if (size < 128 || ReadU32(data + 4) != 124)
+        return false;
+    unsigned int flags{ ReadU32(data + 8) };
+    image.Height = ReadU32(data + 12);
+    image.Width = ReadU32(data + 16);
+    unsigned int levels{ (flags & 0x20000) ? ReadU32(data + 28) : 1 };
+    unsigned int pixelFlags{ ReadU32(data + 80) };
+    unsigned int fourCC{ ReadU32(data + 84) };
+    size_t offset{ 128 };
+
+    if (!(pixelFlags & 0x4))
+    {
+        std::cout << "Unsupported DDS: uncompressed pixel format" << std::endl;
+        return false;
+    }
+    switch (fourCC)
+    {
+        case FourCC('D', 'X', 'T', '1'): image.InternalFormat = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT; break;
+        case FourCC('D', 'X', 'T', '3'): image.InternalFormat = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT; break;
+        case FourCC('D', 'X', 'T', '5'): image.InternalFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; break;
+        case FourCC('A', 'T', 'I', '1'):
+        case FourCC('B', 'C', '4', 'U'): image.InternalFormat = GL_COMPRESSED_RED_RGTC1; break;
+        case FourCC('B', 'C', '4', 'S'): image.InternalFormat = GL_COMPRESSED_SIGNED_RED_RGTC1; break;
+        case FourCC('A', 'T', 'I', '2'):
+        case FourCC('B', 'C', '5', 'U'): image.InternalFormat = GL_COMPRESSED_RG_RGTC2; break;
+        case FourCC('B', 'C', '5', 'S'): image.InternalFormat = GL_COMPRESSED_SIGNED_RG_RGTC2; break;
+        case FourCC('D', 'X', '1', '0'):
+        {
+            if (size < 148)
+                return false;
+            unsigned int dxgiFormat{ ReadU32(data + 128) };
+            image.InternalFormat = GetDxgiFormat(dxgiFormat);
+            if (!image.InternalFormat)
+            {
+                std::cout << "Unsupported DDS DXGI format " << dxgiFormat << std::endl;
+                return false;
+            }
+            offset = 148;
+            break;
+        }
+        default:
+        {
+            char name[5]{ (char)fourCC, (char)(fourCC >> 8), (char)(fourCC >> 16), (char)(fourCC >> 24), 0 };
+            std::cout << "Unsupported DDS format " << name << std::endl;
+            return false;
+        }
+    }
+    if (!image.Width || !image.Height)
+        return false;
+
+    //array layers and cube faces follow the first chain, only that one is read
+    if (!AddLevels(image, levels, size - offset))
+        return false;
+    const CompressedLevel& last{ image.Levels.back() };
+    image.Data.assign(data + offset, data + offset + last.Offset + last.Size);
+    FlipVertically(image);
+    return true;
+}
+
+static const unsigned char s_KtxIdentifier[12]{ 0xab, 'K', 'T', 'X', ' ', '1', '1', 0xbb, '\r', '\n', 0x1a, '\n' };
+
+static bool DecodeKtx(const unsigned char* data, size_t size, CompressedImage& image)
+{
+    if (size < 64)
+        return false;
+    unsigned int endianness{ ReadU32(data + 12) };
+    if (endianness != 0x04030201 && endianness != 0x01020304)
+        return false;
+    bool swap{ endianness == 0x01020304 };
+    unsigned int type{ ReadU32(data + 16, swap) };
+    image.InternalFormat = ReadU32(data + 28, swap);
+    image.Width = ReadU32(data + 36, swap);
+    image.Height = ReadU32(data + 40, swap);
+    unsigned int depth{ ReadU32(data + 44, swap) };
+    unsigned int arrayElements{ ReadU32(data + 48, swap) };
+    unsigned int faces{ ReadU32(data + 52, swap) };
+    unsigned int levels{ std::max(ReadU32(data + 56, swap), 1u) };
+    unsigned int keyValueBytes{ ReadU32(data + 60, swap) };
+
+    if (type != 0 || !IsBlockCompressed(image.InternalFormat))
+    {
+        std::cout << "Unsupported KTX format 0x" << std::hex << image.InternalFormat << std::dec << std::endl;
+        return false;
+    }
+    if (depth > 1 || arrayElements > 0 || faces != 1 || !image.Width || !image.Height)
+    {
+        std::cout << "Unsupported KTX: only plain 2D textures" << std::endl;
+        return false;
+    }
+
+    //KTX defaults to the top row first, KTXorientation can say otherwise
+    bool topDown{ true };
+    size_t cursor{ 64 };
+    size_t keyValueEnd{ cursor + keyValueBytes };
+    if (keyValueEnd > size)
+        return false;
+    while (cursor + 4 <= keyValueEnd)
+    {
+        unsigned int pairSize{ ReadU32(data + cursor, swap) };
+        const char* pair{ (const char*)data + cursor + 4 };
+        if (cursor + 4 + pairSize > keyValueEnd)
+            return false;
+        static const char s_Orientation[]{ "KTXorientation" };
+        if (pairSize > sizeof(s_Orientation) && std::memcmp(pair, s_Orientation, sizeof(s_Orientation)) == 0)
+        {
+            std::string value(pair + sizeof(s_Orientation), pairSize - sizeof(s_Orientation));
+            topDown = value.find("T=u") == std::string::npos;
+        }
+        cursor += 4 + ((pairSize + 3) & ~3u);
+    }
+    cursor = keyValueEnd;
+
+    //every level is prefixed with its size, compressed sizes are already 4 byte aligned
+    unsigned int width{ image.Width }, height{ image.Height };
+    levels = std::min(levels, Texture::GetFullMipCount(width, height));
+    for (unsigned int level = 0; level < levels; level++)
+    {
+        if (cursor + 4 > size)
+            return false;
+        size_t levelSize{ ReadU32(data + cursor, swap) };
+        cursor += 4;
+        if (levelSize != GetImageSize(image.InternalFormat, width, height) || cursor + levelSize > size)
+            return false;
+        image.Levels.push_back({ width, height, image.Data.size(), levelSize });
+        image.Data.insert(image.Data.end(), data + cursor, data + cursor + levelSize);
+        cursor += (levelSize + 3) & ~(size_t)3;
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+    if (topDown)
+        FlipVertically(image);
+    return true;
+}
+
+bool LoadCompressedImage(const unsigned char* data, size_t size, CompressedImage& image)
+{
+    image = CompressedImage();
+    bool decoded{ false };
+    if (size >= 4 && ReadU32(data) == FourCC('D', 'D', 'S', ' '))
+        decoded = DecodeDds(data, size, image);
+    else if (size >= sizeof(s_KtxIdentifier) && std::memcmp(data, s_KtxIdentifier, sizeof(s_KtxIdentifier)) == 0)
+        decoded = DecodeKtx(data, size, image);
+    else
+        std::cout << "Not a DDS or KTX file" << std::endl;
+    if (!decoded)
+        image = CompressedImage();
+    return decoded;
+}
+
+bool LoadCompressedImage(const std::string& filepath, CompressedImage& image)
+{
+    VirtualFile file;
+    if (!FileSystem::Get().Open(filepath, file))
+    {
+        std::cout << "Failed to open image " << filepath << std::endl;
+        image = CompressedImage();
+        return false;
+    }
+
+    if (!LoadCompressedImage(file.GetData(), file.GetSize(), image))
+    {
+        std::cout << "Failed to load compressed image " << filepath << std::endl;
+        return false;
+    }
+    return true;
+}
+
+static unsigned int GetBaseFormat(unsigned int internalFormat)
+{
+    switch (internalFormat)
+    {
+        case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT:
+        case GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT:
+            return GL_RGB;
+        case GL_COMPRESSED_RED_RGTC1:
+        case GL_COMPRESSED_SIGNED_RED_RGTC1:
+            return GL_RED;
+        case GL_COMPRESSED_RG_RGTC2:
+        case GL_COMPRESSED_SIGNED_RG_RGTC2:
+            return GL_RG;
+        default:
+            return GL_RGBA;
+    }
+}
+
+static void WriteU32(std::ostream& stream, unsigned int value)
+{
+    unsigned char bytes[4]{ (unsigned char)value, (unsigned char)(value >> 8), (unsigned char)(value >> 16), (unsigned char)(value >> 24) };
+    stream.write((const char*)bytes, 4);
+}
+
+bool WriteKtx(const std::string& filepath, const CompressedImage& image)
+{
+    std::ofstream stream(filepath, std::ios::binary);
+    if (!stream || !image.IsValid())
+        return false;
+
+    static const char s_Orientation[]{ "KTXorientation\0S=r,T=u" };
+    unsigned int pairSize{ (unsigned int)sizeof(s_Orientation) };
+    unsigned int paddedPairSize{ (pairSize + 3) & ~3u };
+
+    stream.write((const char*)s_KtxIdentifier, sizeof(s_KtxIdentifier));
+    unsigned int header[13]{ 0x04030201, 0, 1, 0, image.InternalFormat, GetBaseFormat(image.InternalFormat), image.Width, image.Height, 0, 0, 1,
+        (unsigned int)image.Levels.size(), 4 + paddedPairSize };
+    for (unsigned int value : header)
+        WriteU32(stream, value);
+    WriteU32(stream, pairSize);
+    stream.write(s_Orientation, pairSize);
+    stream.write("\0\0\0", paddedPairSize - pairSize);
+
+    for (unsigned int level = 0; level < image.Levels.size(); level++)
+    {
+        WriteU32(stream, (unsigned int)image.Levels[level].Size);
+        stream.write((const char*)image.GetLevelData(level), image.Levels[level].Size);
+    }
+    return (bool)stream;
+}
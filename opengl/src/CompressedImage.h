@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+//one mip level inside CompressedImage::Data
+struct CompressedLevel
+{
+	unsigned int Width { 0 };
+	unsigned int Height { 0 };
+	size_t Offset { 0 };
+	size_t Size { 0 };
+};
+
+//block compressed (BC1..BC7) image with its mip chain, ready for glCompressedTexSubImage2D.
+//rows of blocks go bottom to top like Image, except BC6H/BC7 from top-down containers which
+//cannot be flipped without re-encoding and stay as stored
+struct CompressedImage
+{
+	unsigned int InternalFormat { 0 };  //GL_COMPRESSED_*
+	unsigned int Width { 0 };
+	unsigned int Height { 0 };
+	std::vector<CompressedLevel> Levels;
+	std::vector<unsigned char> Data;
+
+	inline bool IsValid() const { return InternalFormat && !Levels.empty(); }
+	inline const unsigned char* GetLevelData(unsigned int level) const { return Data.data() + Levels[level].Offset; }
+	inline size_t GetSize() const { return Data.size(); }
+};
+
+//.dds (DXT1/3/5, ATI1/2, BC4/5 and DX10 headers up to BC7) and KTX 1.1. array layers, cube
+//faces and uncompressed payloads are not supported. safe to call from any thread, failures
+//print why on std::cout and leave the image empty
+bool LoadCompressedImage(const std::string& filepath, CompressedImage& image);
+bool LoadCompressedImage(const unsigned char* data, size_t size, CompressedImage& image);
+
+//KTX 1.1 with a KTXorientation of "S=r,T=u" so it loads back without flipping
+bool WriteKtx(const std::string& filepath, const CompressedImage& image);
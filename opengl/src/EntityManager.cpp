@@ -0,0 +1,264 @@
+#include "EntityManager.h"
+
+#include "Renderer.h"
+
+#include <cstring>
+#include <iostream>
+#include <mutex>
+
+static const ProfilerCounter s_ChunksAllocated("ECS chunks allocated");
+
+static std::mutex s_TypesMutex;
+static ComponentTypes::Info s_Types[ComponentTypes::s_MaxTypes];
+static unsigned int s_TypeCount{ 0 };
+
+unsigned int ComponentTypes::Register(unsigned int size, unsigned int alignment)
+{
+    std::lock_guard<std::mutex> lock(s_TypesMutex);
+    if (s_TypeCount == s_MaxTypes)
+    {
+        std::cout << "ComponentTypes: more than " << s_MaxTypes << " component types" << std::endl;
+        ASSERT(false);
+    }
+    s_Types[s_TypeCount] = { size, alignment };
+    return s_TypeCount++;
+}
+
+const ComponentTypes::Info& ComponentTypes::Get(unsigned int type)
+{
+    //entries never change once Of<T>() handed out their index
+    return s_Types[type];
+}
+
+Archetype::Archetype(ComponentMask mask)
+    : m_Mask(mask), m_Capacity(0)
+{
+    std::memset(m_Columns, -1, sizeof(m_Columns));
+    unsigned int rowBytes{ (unsigned int)sizeof(Entity) };
+    for (unsigned int type = 0; type < ComponentTypes::s_MaxTypes; type++)
+    {
+        if (!(mask & (ComponentMask{ 1 } << type)))
+            continue;
+        m_Columns[type] = (signed char)m_Types.size();
+        m_Types.push_back(type);
+        rowBytes += ComponentTypes::Get(type).Size;
+    }
+
+    //entity handles first, every column aligned for its type. the padding may cost a row or two
+    for (m_Capacity = Chunk::s_Bytes / rowBytes; m_Capacity > 0; m_Capacity--)
+    {
+        unsigned int offset{ m_Capacity * (unsigned int)sizeof(Entity) };
+        m_Offsets.clear();
+        for (unsigned int type : m_Types)
+        {
+            const ComponentTypes::Info& info{ ComponentTypes::Get(type) };
+            ASSERT(info.Alignment <= 64);
+            offset = (offset + info.Alignment - 1) / info.Alignment * info.Alignment;
+            m_Offsets.push_back(offset);
+            offset += info.Size * m_Capacity;
+        }
+        if (offset <= Chunk::s_Bytes)
+            break;
+    }
+    //a single component larger than a chunk
+    ASSERT(m_Capacity > 0);
+}
+
+Chunk::Chunk(Archetype* archetype, unsigned int id, unsigned int version)
+    : m_Archetype(archetype), m_Data(new Line[s_Bytes / sizeof(Line)]), m_Count(0), m_Id(id),
+      m_Versions(archetype->m_Types.size(), version), m_StructureVersion(version)
+{
+    s_ChunksAllocated.Increment();
+}
+
+void* Chunk::GetColumn(unsigned int type) const
+{
+    int column{ m_Archetype->GetColumn(type) };
+    if (column < 0)
+        return nullptr;
+    return (unsigned char*)m_Data.get() + m_Archetype->m_Offsets[column];
+}
+
+unsigned int Chunk::GetVersion(unsigned int type) const
+{
+    int column{ m_Archetype->GetColumn(type) };
+    return column < 0 ? 0 : m_Versions[column];
+}
+
+const Entity* Chunk::GetEntities() const
+{
+    return (const Entity*)m_Data.get();
+}
+
+unsigned int Chunk::GetCapacity() const
+{
+    return m_Archetype->GetCapacity();
+}
+
+EntityManager::EntityManager()
+    : m_ChunkIdCount(0), m_EntityCount(0), m_Version(1)
+{
+}
+
+EntityManager::~EntityManager()
+{
+}
+
+Archetype* EntityManager::GetArchetype(ComponentMask mask)
+{
+    auto found{ m_ArchetypesByMask.find(mask) };
+    if (found != m_ArchetypesByMask.end())
+        return found->second;
+    m_Archetypes.push_back(std::make_unique<Archetype>(mask));
+    m_ArchetypesByMask[mask] = m_Archetypes.back().get();
+    return m_Archetypes.back().get();
+}
+
+bool EntityManager::IsAlive(Entity entity) const
+{
+    return entity.Index < m_Entities.size() && m_Entities[entity.Index].Generation == entity.Generation;
+}
+
+Entity EntityManager::Create()
+{
+    return Create(ComponentMask{ 0 });
+}
+
+Entity EntityManager::Create(ComponentMask mask)
+{
+    unsigned int index;
+    if (!m_FreeEntities.empty())
+    {
+        index = m_FreeEntities.back();
+        m_FreeEntities.pop_back();
+    }
+    else
+    {
+        index = (unsigned int)m_Entities.size();
+        m_Entities.push_back({ 1, nullptr, 0, 0 });
+    }
+    Insert(index, GetArchetype(mask));
+    m_EntityCount++;
+    return { index, m_Entities[index].Generation };
+}
+
+bool EntityManager::Destroy(Entity entity)
+{
+    if (!IsAlive(entity))
+        return false;
+    Location& location{ m_Entities[entity.Index] };
+    Erase(location);
+    location.Storage = nullptr;
+    if (++location.Generation == 0)
+        location.Generation = 1;
+    m_FreeEntities.push_back(entity.Index);
+    m_EntityCount--;
+    return true;
+}
+
+void EntityManager::Insert(unsigned int index, Archetype* archetype)
+{
+    std::vector<std::unique_ptr<Chunk>>& chunks{ archetype->m_Chunks };
+    if (chunks.empty() || chunks.back()->m_Count == archetype->m_Capacity)
+    {
+        unsigned int id;
+        if (!m_FreeChunkIds.empty())
+        {
+            id = m_FreeChunkIds.back();
+            m_FreeChunkIds.pop_back();
+        }
+        else
+            id = m_ChunkIdCount++;
+        chunks.push_back(std::make_unique<Chunk>(archetype, id, m_Version));
+    }
+
+    Chunk& chunk{ *chunks.back() };
+    unsigned int row{ chunk.m_Count++ };
+    Location& location{ m_Entities[index] };
+    ((Entity*)chunk.m_Data.get())[row] = { index, location.Generation };
+    chunk.m_StructureVersion = m_Version;
+    location.Storage = archetype;
+    location.ChunkIndex = (unsigned int)chunks.size() - 1;
+    location.Row = row;
+}
+
+void EntityManager::Erase(const Location& location)
+{
+    Archetype& archetype{ *location.Storage };
+    Chunk& chunk{ *archetype.m_Chunks[location.ChunkIndex] };
+    Chunk& last{ *archetype.m_Chunks.back() };
+    unsigned int lastRow{ last.m_Count - 1 };
+
+    //the archetype's last entity takes over the row, which keeps every chunk but the last full
+    if (&chunk != &last || location.Row != lastRow)
+    {
+        Entity moved{ last.GetEntities()[lastRow] };
+        ((Entity*)chunk.m_Data.get())[location.Row] = moved;
+        for (unsigned int column = 0; column < archetype.m_Types.size(); column++)
+        {
+            unsigned int size{ ComponentTypes::Get(archetype.m_Types[column]).Size };
+            unsigned char* base{ (unsigned char*)chunk.m_Data.get() + archetype.m_Offsets[column] };
+            unsigned char* lastBase{ (unsigned char*)last.m_Data.get() + archetype.m_Offsets[column] };
+            std::memcpy(base + location.Row * size, lastBase + lastRow * size, size);
+        }
+        Location& movedLocation{ m_Entities[moved.Index] };
+        movedLocation.ChunkIndex = location.ChunkIndex;
+        movedLocation.Row = location.Row;
+    }
+    chunk.m_StructureVersion = m_Version;
+    last.m_StructureVersion = m_Version;
+
+    if (--last.m_Count == 0)
+    {
+        m_FreeChunkIds.push_back(last.m_Id);
+        archetype.m_Chunks.pop_back();
+    }
+}
+
+void EntityManager::Move(unsigned int index, ComponentMask mask)
+{
+    Location from{ m_Entities[index] };
+    Archetype* archetype{ GetArchetype(mask) };
+    Insert(index, archetype);
+
+    const Location& to{ m_Entities[index] };
+    const Archetype& source{ *from.Storage };
+    const Chunk& sourceChunk{ *source.m_Chunks[from.ChunkIndex] };
+    const Chunk& chunk{ *archetype->m_Chunks[to.ChunkIndex] };
+    for (unsigned int column = 0; column < archetype->m_Types.size(); column++)
+    {
+        int sourceColumn{ source.GetColumn(archetype->m_Types[column]) };
+        if (sourceColumn < 0)
+            continue;
+        unsigned int size{ ComponentTypes::Get(archetype->m_Types[column]).Size };
+        std::memcpy((unsigned char*)chunk.m_Data.get() + archetype->m_Offsets[column] + to.Row * size,
+            (const unsigned char*)sourceChunk.m_Data.get() + source.m_Offsets[sourceColumn] + from.Row * size, size);
+    }
+    Erase(from);
+}
+
+void* EntityManager::GetComponent(Entity entity, unsigned int type, bool write)
+{
+    if (!IsAlive(entity))
+        return nullptr;
+    const Location& location{ m_Entities[entity.Index] };
+    int column{ location.Storage->GetColumn(type) };
+    if (column < 0)
+        return nullptr;
+    Chunk& chunk{ *location.Storage->m_Chunks[location.ChunkIndex] };
+    if (write)
+        chunk.m_Versions[column] = m_Version;
+    return (unsigned char*)chunk.m_Data.get() + location.Storage->m_Offsets[column] + location.Row * ComponentTypes::Get(type).Size;
+}
+
+void EntityManager::Stamp(Chunk& chunk, ComponentMask written)
+{
+    if (!written)
+        return;
+    const Archetype& archetype{ *chunk.m_Archetype };
+    for (unsigned int column = 0; column < archetype.m_Types.size(); column++)
+    {
+        if (written & (ComponentMask{ 1 } << archetype.m_Types[column]))
+            chunk.m_Versions[column] = m_Version;
+    }
+}
@@ -0,0 +1,294 @@
+#pragma once
+
+#include "ResourcePool.h"
+#include "WorkerPool.h"
+
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+struct EntityTag;
+using Entity = Handle<EntityTag>;
+
+//one bit per component type
+using ComponentMask = unsigned long long;
+
+//component types get an index the first time they are used. components are plain data that
+//chunks move around with memcpy
+class ComponentTypes
+{
+public:
+	static constexpr unsigned int s_MaxTypes{ 64 };
+
+	struct Info
+	{
+		unsigned int Size;
+		unsigned int Alignment;
+	};
+
+	static unsigned int Register(unsigned int size, unsigned int alignment);
+	static const Info& Get(unsigned int type);
+
+	template<typename T>
+	static unsigned int Of()
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "components must be plain data");
+		static const unsigned int s_Type{ Register((unsigned int)sizeof(T), (unsigned int)alignof(T)) };
+		return s_Type;
+	}
+
+	template<typename... T>
+	static ComponentMask MaskOf()
+	{
+		return (ComponentMask{ 0 } | ... | (ComponentMask{ 1 } << Of<std::remove_const_t<T>>()));
+	}
+};
+
+class Archetype;
+
+//s_Bytes of entities that share one set of components: the entity handles, then one array per
+//component. an archetype's chunks are kept full except for the last one, so iteration is over
+//packed arrays. versions say when each array was last written and when entities came or
+//went, to compare against EntityManager::AdvanceVersion()
+class Chunk
+{
+	friend class EntityManager;
+public:
+	static constexpr unsigned int s_Bytes{ 16 * 1024 };
+private:
+	struct alignas(64) Line
+	{
+		unsigned char Bytes[64];
+	};
+
+	Archetype* m_Archetype;
+	std::unique_ptr<Line[]> m_Data;
+	unsigned int m_Count;
+	unsigned int m_Id;
+	std::vector<unsigned int> m_Versions;       //per column of the archetype
+	unsigned int m_StructureVersion;
+public:
+	Chunk(Archetype* archetype, unsigned int id, unsigned int version);
+
+	Chunk(const Chunk&) = delete;
+	Chunk& operator=(const Chunk&) = delete;
+
+	//the array of T, nullptr when the archetype has no T. writing through it does not update
+	//the version, queries and EntityManager::Write() do that
+	template<typename T>
+	inline T* GetArray() const { return (T*)GetColumn(ComponentTypes::Of<T>()); }
+	void* GetColumn(unsigned int type) const;
+	//version of the last write to the array of type, 0 without one
+	unsigned int GetVersion(unsigned int type) const;
+	template<typename T>
+	inline unsigned int GetVersion() const { return GetVersion(ComponentTypes::Of<T>()); }
+	//type written or entities added/removed after version since
+	inline bool DidChange(unsigned int type, unsigned int since) const
+	{
+		return (int)(GetVersion(type) - since) > 0 || (int)(m_StructureVersion - since) > 0;
+	}
+	template<typename T>
+	inline bool DidChange(unsigned int since) const { return DidChange(ComponentTypes::Of<T>(), since); }
+
+	const Entity* GetEntities() const;
+	inline unsigned int GetCount() const { return m_Count; }
+	unsigned int GetCapacity() const;
+	//unique among the live chunks of the manager, reused once a chunk is freed (with new versions)
+	inline unsigned int GetId() const { return m_Id; }
+	inline unsigned int GetStructureVersion() const { return m_StructureVersion; }
+	inline const Archetype& GetArchetype() const { return *m_Archetype; }
+};
+
+//the chunks of one combination of components
+class Archetype
+{
+	friend class EntityManager;
+	friend class Chunk;
+private:
+	ComponentMask m_Mask;
+	std::vector<unsigned int> m_Types;          //sorted
+	std::vector<unsigned int> m_Offsets;        //of each column within a chunk
+	signed char m_Columns[ComponentTypes::s_MaxTypes];   //type -> column, -1 when absent
+	unsigned int m_Capacity;
+	std::vector<std::unique_ptr<Chunk>> m_Chunks;
+public:
+	explicit Archetype(ComponentMask mask);
+
+	inline int GetColumn(unsigned int type) const { return m_Columns[type]; }
+	inline ComponentMask GetMask() const { return m_Mask; }
+	inline unsigned int GetCapacity() const { return m_Capacity; }
+	inline const std::vector<std::unique_ptr<Chunk>>& GetChunks() const { return m_Chunks; }
+};
+
+//entities and their components in archetype chunks. systems are queries over the chunks that
+//hold a set of components: ForEach<Position, const Velocity>(fn) calls fn(entity, position,
+//velocity) for every such entity, a const component is read-only and everything else counts
+//as written, which bumps that array's version in every visited chunk. ParallelForEach() hands
+//the chunks to a WorkerPool.
+//
+//structural changes (Create, Destroy, Add, Remove) move entities between chunks, so they must
+//not happen during a query. one thread at a time outside of the parallel queries
+class EntityManager
+{
+private:
+	struct Location
+	{
+		unsigned int Generation;
+		Archetype* Storage;
+		unsigned int ChunkIndex;    //into the archetype's chunks
+		unsigned int Row;
+	};
+
+	std::vector<Location> m_Entities;
+	std::vector<unsigned int> m_FreeEntities;
+	std::vector<std::unique_ptr<Archetype>> m_Archetypes;
+	std::unordered_map<ComponentMask, Archetype*> m_ArchetypesByMask;
+	std::vector<unsigned int> m_FreeChunkIds;
+	unsigned int m_ChunkIdCount;
+	unsigned int m_EntityCount;
+	unsigned int m_Version;
+
+	Archetype* GetArchetype(ComponentMask mask);
+	//components left uninitialized
+	Entity Create(ComponentMask mask);
+	//a new row at the end of the archetype, components left uninitialized
+	void Insert(unsigned int index, Archetype* archetype);
+	//takes the row out, the archetype's last entity fills the hole
+	void Erase(const Location& location);
+	//to the archetype for mask, keeping the components both have
+	void Move(unsigned int index, ComponentMask mask);
+	void* GetComponent(Entity entity, unsigned int type, bool write);
+	void Stamp(Chunk& chunk, ComponentMask written);
+
+	template<typename... T, typename Fn>
+	static void RunChunk(Chunk& chunk, Fn& fn)
+	{
+		std::tuple<std::remove_const_t<T>*...> arrays{ chunk.GetArray<std::remove_const_t<T>>()... };
+		const Entity* entities{ chunk.GetEntities() };
+		for (unsigned int i = 0; i < chunk.GetCount(); i++)
+			fn(entities[i], std::get<std::remove_const_t<T>*>(arrays)[i]...);
+	}
+
+	template<typename... T>
+	static ComponentMask WrittenMask()
+	{
+		return (ComponentMask{ 0 } | ... | (std::is_const<T>::value ? 0 : ComponentTypes::MaskOf<T>()));
+	}
+public:
+	EntityManager();
+	~EntityManager();
+
+	EntityManager(const EntityManager&) = delete;
+	EntityManager& operator=(const EntityManager&) = delete;
+
+	Entity Create();
+	template<typename... T>
+	Entity Create(const T&... components)
+	{
+		Entity entity{ Create(ComponentTypes::MaskOf<T...>()) };
+		((*(T*)GetComponent(entity, ComponentTypes::Of<T>(), true) = components), ...);
+		return entity;
+	}
+	bool Destroy(Entity entity);
+	bool IsAlive(Entity entity) const;
+
+	//sets the component when the entity has it already
+	template<typename T>
+	bool Add(Entity entity, const T& component = {})
+	{
+		if (!IsAlive(entity))
+			return false;
+		unsigned int type{ ComponentTypes::Of<T>() };
+		const Location& location{ m_Entities[entity.Index] };
+		if (!(location.Storage->GetMask() & (ComponentMask{ 1 } << type)))
+			Move(entity.Index, location.Storage->GetMask() | (ComponentMask{ 1 } << type));
+		*(T*)GetComponent(entity, type, true) = component;
+		return true;
+	}
+	template<typename T>
+	bool Remove(Entity entity)
+	{
+		if (!Has<T>(entity))
+			return false;
+		Move(entity.Index, m_Entities[entity.Index].Storage->GetMask() & ~ComponentTypes::MaskOf<T>());
+		return true;
+	}
+	template<typename T>
+	bool Has(Entity entity) const
+	{
+		return IsAlive(entity) && (m_Entities[entity.Index].Storage->GetMask() & ComponentTypes::MaskOf<T>());
+	}
+	//nullptr when the entity is dead or has no T
+	template<typename T>
+	const T* Read(Entity entity) { return (const T*)GetComponent(entity, ComponentTypes::Of<T>(), false); }
+	//the same, marking T of the entity's chunk as written
+	template<typename T>
+	T* Write(Entity entity) { return (T*)GetComponent(entity, ComponentTypes::Of<T>(), true); }
+
+	//fn(const Chunk&) for every chunk whose archetype has all of required, read-only
+	template<typename Fn>
+	void VisitChunks(ComponentMask required, Fn&& fn) const
+	{
+		for (const std::unique_ptr<Archetype>& archetype : m_Archetypes)
+		{
+			if ((archetype->GetMask() & required) != required)
+				continue;
+			for (const std::unique_ptr<Chunk>& chunk : archetype->m_Chunks)
+				fn((const Chunk&)*chunk);
+		}
+	}
+
+	//fn(Chunk&) for every chunk with all of T
+	template<typename... T, typename Fn>
+	void ForEachChunk(Fn&& fn)
+	{
+		ComponentMask required{ ComponentTypes::MaskOf<T...>() };
+		ComponentMask written{ WrittenMask<T...>() };
+		for (const std::unique_ptr<Archetype>& archetype : m_Archetypes)
+		{
+			if ((archetype->GetMask() & required) != required)
+				continue;
+			for (const std::unique_ptr<Chunk>& chunk : archetype->m_Chunks)
+			{
+				Stamp(*chunk, written);
+				fn(*chunk);
+			}
+		}
+	}
+
+	//fn(Entity, T&...) for every entity with all of T
+	template<typename... T, typename Fn>
+	void ForEach(Fn&& fn)
+	{
+		ForEachChunk<T...>([&fn](Chunk& chunk) { RunChunk<T...>(chunk, fn); });
+	}
+
+	//ForEachChunk() with the chunks spread over the workers and the calling thread. fn must be
+	//safe to call from several threads at once
+	template<typename... T, typename Fn>
+	void ParallelForEachChunk(WorkerPool& workers, Fn&& fn)
+	{
+		std::vector<Chunk*> chunks;
+		ForEachChunk<T...>([&chunks](Chunk& chunk) { chunks.push_back(&chunk); });
+		workers.ParallelFor((unsigned int)chunks.size(), 1, [&chunks, &fn](unsigned int begin, unsigned int end) {
+			for (unsigned int i = begin; i < end; i++)
+				fn(*chunks[i]);
+		});
+	}
+
+	template<typename... T, typename Fn>
+	void ParallelForEach(WorkerPool& workers, Fn&& fn)
+	{
+		ParallelForEachChunk<T...>(workers, [&fn](Chunk& chunk) { RunChunk<T...>(chunk, fn); });
+	}
+
+	//returns the current version and starts a new one, so whatever is written from now on
+	//passes Chunk::DidChange(returned version)
+	inline unsigned int AdvanceVersion() { return m_Version++; }
+
+	inline unsigned int GetEntityCount() const { return m_EntityCount; }
+	//chunk ids stay below this
+	inline unsigned int GetChunkIdCount() const { return m_ChunkIdCount; }
+};
@@ -0,0 +1,191 @@
+#include "FileSystem.h"
+#include "Profiler.h"
+
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+
+static const ProfilerCounter s_LooseOpens("Loose files opened");
+static const ProfilerCounter s_PackOpens("Pack entries opened");
+static const ProfilerCounter s_Decompressed("Pack bytes decompressed");
+
+VirtualFile::VirtualFile()
+    : m_Data(nullptr), m_Size(0), m_Open(false)
+{
+}
+
+void VirtualFile::Close()
+{
+    m_Loose.Close();
+    m_Pack.reset();
+    m_Decompressed = std::vector<unsigned char>();
+    m_Data = nullptr;
+    m_Size = 0;
+    m_Open = false;
+}
+
+FileSystem::FileSystem()
+{
+}
+
+FileSystem& FileSystem::Get()
+{
+    static FileSystem s_Instance;
+    return s_Instance;
+}
+
+bool FileSystem::Mount(const std::string& source, const std::string& prefix)
+{
+    MountPoint mount{ source, NormalizePath(prefix), "", nullptr };
+    if (!mount.Prefix.empty())
+        mount.Prefix.push_back('/');
+
+    std::error_code error;
+    if (std::filesystem::is_directory(source, error))
+        mount.Directory = source;
+    else
+    {
+        std::shared_ptr<PackFile> pack{ std::make_shared<PackFile>() };
+        if (!std::filesystem::is_regular_file(source, error) || !pack->Open(source))
+        {
+            std::cout << "Failed to mount " << source << std::endl;
+            return false;
+        }
+        mount.Pack = std::move(pack);
+    }
+
+    std::unique_lock<std::shared_mutex> lock(m_Mutex);
+    m_Mounts.push_back(std::move(mount));
+    return true;
+}
+
+void FileSystem::Unmount(const std::string& source)
+{
+    std::unique_lock<std::shared_mutex> lock(m_Mutex);
+    for (size_t i = m_Mounts.size(); i-- > 0;)
+    {
+        if (m_Mounts[i].Source == source)
+            m_Mounts.erase(m_Mounts.begin() + i);
+    }
+}
+
+void FileSystem::UnmountAll()
+{
+    std::unique_lock<std::shared_mutex> lock(m_Mutex);
+    m_Mounts.clear();
+}
+
+bool FileSystem::Open(const std::string& path, VirtualFile& file) const
+{
+    file.Close();
+    std::string normalized{ NormalizePath(path) };
+    {
+        std::shared_lock<std::shared_mutex> lock(m_Mutex);
+        for (size_t i = m_Mounts.size(); i-- > 0;)
+        {
+            const MountPoint& mount{ m_Mounts[i] };
+            if (normalized.compare(0, mount.Prefix.size(), mount.Prefix) != 0)
+                continue;
+            std::string name{ normalized.substr(mount.Prefix.size()) };
+            if (!mount.Pack)
+            {
+                if (file.m_Loose.Open(mount.Directory + "/" + name))
+                {
+                    s_LooseOpens.Increment();
+                    file.m_Data = file.m_Loose.GetData();
+                    file.m_Size = file.m_Loose.GetSize();
+                    file.m_Open = true;
+                    return true;
+                }
+                continue;
+            }
+
+            int index{ mount.Pack->Find(name) };
+            if (index < 0)
+                continue;
+            s_PackOpens.Increment();
+            file.m_Pack = mount.Pack;
+            file.m_Size = mount.Pack->GetSize(index);
+            file.m_Data = mount.Pack->GetData(index);
+            if (!file.m_Data)
+            {
+                file.m_Decompressed.resize(file.m_Size);
+                if (!mount.Pack->Read(index, file.m_Decompressed.data()))
+                {
+                    std::cout << "Corrupt entry " << name << " in " << mount.Source << std::endl;
+                    file.Close();
+                    return false;
+                }
+                s_Decompressed.Add(file.m_Size);
+                file.m_Data = file.m_Decompressed.data();
+            }
+            file.m_Open = true;
+            return true;
+        }
+    }
+
+    if (!file.m_Loose.Open(path))
+        return false;
+    s_LooseOpens.Increment();
+    file.m_Data = file.m_Loose.GetData();
+    file.m_Size = file.m_Loose.GetSize();
+    file.m_Open = true;
+    return true;
+}
+
+bool FileSystem::ReadFile(const std::string& path, std::vector<unsigned char>& data) const
+{
+    VirtualFile file;
+    if (!Open(path, file))
+    {
+        data.clear();
+        return false;
+    }
+    data.assign(file.GetData(), file.GetData() + file.GetSize());
+    return true;
+}
+
+bool FileSystem::Exists(const std::string& path) const
+{
+    std::string normalized{ NormalizePath(path) };
+    std::error_code error;
+    {
+        std::shared_lock<std::shared_mutex> lock(m_Mutex);
+        for (const MountPoint& mount : m_Mounts)
+        {
+            if (normalized.compare(0, mount.Prefix.size(), mount.Prefix) != 0)
+                continue;
+            std::string name{ normalized.substr(mount.Prefix.size()) };
+            if (mount.Pack ? mount.Pack->Find(name) >= 0 : std::filesystem::is_regular_file(mount.Directory + "/" + name, error))
+                return true;
+        }
+    }
+    return std::filesystem::is_regular_file(path, error);
+}
+
+std::string FileSystem::NormalizePath(const std::string& path)
+{
+    std::vector<std::string> segments;
+    size_t begin{ 0 };
+    while (begin <= path.size())
+    {
+        size_t end{ path.find_first_of("/\\", begin) };
+        if (end == std::string::npos)
+            end = path.size();
+        std::string segment{ path.substr(begin, end - begin) };
+        if (segment == ".." && !segments.empty() && segments.back() != "..")
+            segments.pop_back();
+        else if (!segment.empty() && segment != ".")
+            segments.push_back(std::move(segment));
+        begin = end + 1;
+    }
+
+    std::string normalized{ !path.empty() && (path[0] == '/' || path[0] == '\\') ? "/" : "" };
+    for (size_t i = 0; i < segments.size(); i++)
+    {
+        if (i)
+            normalized.push_back('/');
+        normalized += segments[i];
+    }
+    return normalized;
+}
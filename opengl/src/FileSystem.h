@@ -0,0 +1,72 @@
+#pragma once
+
+#include "MappedFile.h"
+#include "PackFile.h"
+
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+//the bytes of a file opened through FileSystem: a mapped loose file, a view into a mapped pack
+//or a decompressed copy of a pack entry. keeps its pack mapped until closed, even when the
+//pack is unmounted meanwhile
+class VirtualFile
+{
+private:
+	MappedFile m_Loose;
+	std::shared_ptr<const PackFile> m_Pack;
+	std::vector<unsigned char> m_Decompressed;
+	const unsigned char* m_Data;
+	size_t m_Size;
+	bool m_Open;
+
+	friend class FileSystem;
+public:
+	VirtualFile();
+
+	VirtualFile(const VirtualFile&) = delete;
+	VirtualFile& operator=(const VirtualFile&) = delete;
+
+	void Close();
+	inline bool IsOpen() const { return m_Open; }
+	inline const unsigned char* GetData() const { return m_Data; }
+	inline size_t GetSize() const { return m_Size; }
+};
+
+//where asset paths ("res/shader/Basic.shader") are looked up: mounted directories and packs,
+//newest mount first, then the path itself relative to the working directory. with nothing
+//mounted every path reads the loose file as before. opening is safe from any thread
+class FileSystem
+{
+private:
+	struct MountPoint
+	{
+		std::string Source;                     //as passed to Mount()
+		std::string Prefix;                     //normalized, "" or ending in '/'
+		std::string Directory;                  //for a directory mount
+		std::shared_ptr<const PackFile> Pack;   //for a pack mount
+	};
+
+	mutable std::shared_mutex m_Mutex;
+	std::vector<MountPoint> m_Mounts;
+
+	FileSystem();
+public:
+	static FileSystem& Get();
+
+	//mounts a directory or pack so that prefix/name finds name inside it: Mount("res.pack", "res")
+	//serves "res/shader/Basic.shader" from the pack's "shader/Basic.shader". false (and prints
+	//why) when source is neither
+	bool Mount(const std::string& source, const std::string& prefix = "");
+	void Unmount(const std::string& source);
+	void UnmountAll();
+
+	//false when no mount has the file and there is no loose file at path either
+	bool Open(const std::string& path, VirtualFile& file) const;
+	bool ReadFile(const std::string& path, std::vector<unsigned char>& data) const;
+	bool Exists(const std::string& path) const;
+
+	//'/' separators, no "." segments, ".." folded into the parent where there is one
+	static std::string NormalizePath(const std::string& path);
+};
@@ -0,0 +1,132 @@
+#include "FrameArena.h"
+#include "AllocationTracker.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+
+LinearArena::LinearArena(size_t blockSize)
+    : m_BlockSize(blockSize), m_Current(0), m_Offset(0), m_Used(0), m_HighWater(0), m_Generation(0)
+{
+}
+
+void* LinearArena::Allocate(size_t size, size_t alignment)
+{
+    if (size == 0)
+        size = 1;
+
+    //try the current block and then any block kept from an earlier, larger frame
+    while (m_Current < m_Blocks.size())
+    {
+        Block& block{ m_Blocks[m_Current] };
+        uintptr_t base{ (uintptr_t)block.Data.get() };
+        uintptr_t aligned{ (base + m_Offset + alignment - 1) & ~(uintptr_t)(alignment - 1) };
+        size_t offset{ aligned - base };
+        if (offset + size <= block.Size)
+        {
+            m_Used += offset + size - m_Offset;
+            m_Offset = offset + size;
+            m_HighWater = std::max(m_HighWater, m_Used);
+            return (void*)aligned;
+        }
+        m_Current++;
+        m_Offset = 0;
+    }
+
+    //grow, this only happens until the arena has seen its largest frame
+    ALLOCATION_SCOPE("FrameArena");
+    size_t blockSize{ std::max(m_BlockSize, size + alignment) };
+    m_Blocks.push_back({ std::unique_ptr<unsigned char[]>(new unsigned char[blockSize]), blockSize });
+    m_Current = m_Blocks.size() - 1;
+    m_Offset = 0;
+    return Allocate(size, alignment);
+}
+
+void LinearArena::Reset()
+{
+#ifndef NDEBUG
+    //anything still reading last frame's data now sees garbage instead of plausible values
+    for (size_t i = 0; i <= m_Current && i < m_Blocks.size(); i++)
+        std::memset(m_Blocks[i].Data.get(), 0xdd, i == m_Current ? m_Offset : m_Blocks[i].Size);
+#endif
+    m_Current = 0;
+    m_Offset = 0;
+    m_Used = 0;
+    m_Generation++;
+}
+
+size_t LinearArena::GetCapacity() const
+{
+    size_t capacity{ 0 };
+    for (const Block& block : m_Blocks)
+        capacity += block.Size;
+    return capacity;
+}
+
+namespace {
+
+    struct ThreadArenas;
+
+    std::mutex s_RegistryMutex;
+    std::vector<ThreadArenas*> s_Registry;
+    std::atomic<unsigned long long> s_FrameIndex{ 0 };
+
+    struct ThreadArenas
+    {
+        LinearArena Arenas[2];
+
+        ThreadArenas()
+        {
+            std::lock_guard<std::mutex> lock(s_RegistryMutex);
+            s_Registry.push_back(this);
+        }
+
+        ~ThreadArenas()
+        {
+            std::lock_guard<std::mutex> lock(s_RegistryMutex);
+            s_Registry.erase(std::find(s_Registry.begin(), s_Registry.end(), this));
+        }
+    };
+
+    ThreadArenas& GetThreadArenas()
+    {
+        thread_local ThreadArenas s_Arenas;
+        return s_Arenas;
+    }
+
+}
+
+LinearArena& FrameArena::Get()
+{
+    return GetThreadArenas().Arenas[s_FrameIndex.load(std::memory_order_relaxed) & 1];
+}
+
+LinearArena& FrameArena::GetPrevious()
+{
+    return GetThreadArenas().Arenas[(s_FrameIndex.load(std::memory_order_relaxed) + 1) & 1];
+}
+
+void FrameArena::EndFrame()
+{
+    std::lock_guard<std::mutex> lock(s_RegistryMutex);
+    unsigned long long next{ s_FrameIndex.load(std::memory_order_relaxed) + 1 };
+    for (ThreadArenas* arenas : s_Registry)
+        arenas->Arenas[next & 1].Reset();
+    s_FrameIndex.store(next, std::memory_order_release);
+}
+
+unsigned long long FrameArena::GetFrameIndex()
+{
+    return s_FrameIndex.load(std::memory_order_relaxed);
+}
+
+size_t FrameArena::GetHighWater()
+{
+    std::lock_guard<std::mutex> lock(s_RegistryMutex);
+    size_t total{ 0 };
+    for (ThreadArenas* arenas : s_Registry)
+        total += std::max(arenas->Arenas[0].GetHighWater(), arenas->Arenas[1].GetHighWater());
+    return total;
+}
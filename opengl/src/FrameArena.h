@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "Renderer.h"
+
+//bump allocator for transient data. Reset() rewinds to the start in O(1) and keeps every block
+//it grew, so once it has seen the largest frame it never touches the heap again.
+//debug builds poison reset memory and ArenaAllocator checks the arena was not reset under it
+class LinearArena
+{
+private:
+	struct Block
+	{
+		std::unique_ptr<unsigned char[]> Data;
+		size_t Size;
+	};
+
+	std::vector<Block> m_Blocks;
+	size_t m_BlockSize;
+	size_t m_Current;                   //block being bumped
+	size_t m_Offset;                    //into the current block
+	size_t m_Used;
+	size_t m_HighWater;
+	unsigned long long m_Generation;    //incremented by every Reset()
+public:
+	explicit LinearArena(size_t blockSize = 1024 * 1024);
+
+	LinearArena(const LinearArena&) = delete;
+	LinearArena& operator=(const LinearArena&) = delete;
+
+	void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+	template<typename T>
+	T* AllocateArray(size_t count)
+	{
+		return static_cast<T*>(Allocate(count * sizeof(T), alignof(T)));
+	}
+
+	void Reset();
+
+	inline unsigned long long GetGeneration() const { return m_Generation; }
+	inline size_t GetUsed() const { return m_Used; }
+	inline size_t GetHighWater() const { return m_HighWater; }
+	size_t GetCapacity() const;
+};
+
+//STL allocator over a LinearArena, deallocate is a no-op. containers using it must not
+//outlive the arena's next Reset()
+template<typename T>
+class ArenaAllocator
+{
+public:
+	using value_type = T;
+
+	LinearArena* m_Arena;
+#ifndef NDEBUG
+	unsigned long long m_Generation;
+#endif
+
+	explicit ArenaAllocator(LinearArena& arena) noexcept
+		: m_Arena(&arena)
+#ifndef NDEBUG
+		, m_Generation(arena.GetGeneration())
+#endif
+	{}
+
+	template<typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) noexcept
+		: m_Arena(other.m_Arena)
+#ifndef NDEBUG
+		, m_Generation(other.m_Generation)
+#endif
+	{}
+
+	T* allocate(size_t count)
+	{
+		CheckGeneration();
+		return m_Arena->AllocateArray<T>(count);
+	}
+
+	void deallocate(T*, size_t)
+	{
+		CheckGeneration();
+	}
+
+	//use-after-reset: the container kept memory from a frame that is already gone
+	inline void CheckGeneration() const
+	{
+#ifndef NDEBUG
+		ASSERT(m_Generation == m_Arena->GetGeneration());
+#endif
+	}
+
+	template<typename U>
+	bool operator==(const ArenaAllocator<U>& other) const { return m_Arena == other.m_Arena; }
+	template<typename U>
+	bool operator!=(const ArenaAllocator<U>& other) const { return m_Arena != other.m_Arena; }
+};
+
+template<typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+//two arenas per thread, flipped every frame: Get() is this frame's scratch memory,
+//GetPrevious() still holds what was written last frame so the render thread can consume
+//data produced a frame ahead. EndFrame() must run while no other thread allocates
+class FrameArena
+{
+public:
+	//this thread's arena for the current frame
+	static LinearArena& Get();
+	//this thread's arena of the previous frame, reset at the next EndFrame()
+	static LinearArena& GetPrevious();
+
+	//flips every thread to its other arena and resets that one
+	static void EndFrame();
+
+	static unsigned long long GetFrameIndex();
+	//sum over all threads of the largest frame seen so far
+	static size_t GetHighWater();
+};
@@ -0,0 +1,373 @@
+#include "FrustumCuller.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+static const ProfilerCounter s_ObjectsVisible("Cull objects visible");
+static const ProfilerCounter s_ObjectsCulled("Cull objects culled");
+static const ProfilerCounter s_CullTime("Cull us");
+
+//below this many objects the split and compaction cost more than the workers save
+static const unsigned int s_ParallelObjects{ 16 * 1024 };
+//slots per parallel task
+static const unsigned int s_TaskSlots{ 2048 };
+
+struct FrustumCuller::PlaneSet
+{
+    float X[6], Y[6], Z[6], W[6];
+    float AbsX[6], AbsY[6], AbsZ[6];
+};
+
+Frustum Frustum::FromMatrix(const Mat4& viewProjection)
+{
+    //clip = M * p, a plane is the last row plus or minus one of the others
+    auto row = [&viewProjection](unsigned int i) {
+        const Vec4* columns{ viewProjection.Columns };
+        return Vec4{ (&columns[0].X)[i], (&columns[1].X)[i], (&columns[2].X)[i], (&columns[3].X)[i] };
+    };
+    Vec4 x{ row(0) }, y{ row(1) }, z{ row(2) }, w{ row(3) };
+    Frustum frustum{ { w + x, w - x, w + y, w - y, w + z, w - z } };
+    for (Vec4& plane : frustum.Planes)
+    {
+        float length{ std::sqrt(plane.X * plane.X + plane.Y * plane.Y + plane.Z * plane.Z) };
+        if (length > 0.0f)
+            plane = plane * (1.0f / length);
+    }
+    return frustum;
+}
+
+//false when the box is outside a plane, otherwise clears the planes it is entirely inside of
+static bool TestBox(const float* min, const float* max, const float* x, const float* y, const float* z, const float* w,
+    const float* absX, const float* absY, const float* absZ, unsigned int& planes)
+{
+    float cx{ (min[0] + max[0]) * 0.5f }, cy{ (min[1] + max[1]) * 0.5f }, cz{ (min[2] + max[2]) * 0.5f };
+    float ex{ (max[0] - min[0]) * 0.5f }, ey{ (max[1] - min[1]) * 0.5f }, ez{ (max[2] - min[2]) * 0.5f };
+    for (unsigned int p = 0; p < 6; p++)
+    {
+        if (!(planes & (1u << p)))
+            continue;
+        float distance{ x[p] * cx + y[p] * cy + z[p] * cz + w[p] };
+        float radius{ absX[p] * ex + absY[p] * ey + absZ[p] * ez };
+        if (distance + radius < 0.0f)
+            return false;
+        if (distance - radius >= 0.0f)
+            planes &= ~(1u << p);
+    }
+    return true;
+}
+
+FrustumCuller::FrustumCuller()
+    : m_ObjectCount(0), m_NeedsRefit(false), m_Stats{}
+{
+}
+
+void FrustumCuller::Build(const Vec3* centers, const Vec3* extents, unsigned int count)
+{
+    m_ObjectCount = count;
+    m_NeedsRefit = false;
+    m_Nodes.clear();
+    m_Slots.assign(count, s_InvalidIndex);
+    m_Indices.clear();
+    for (std::vector<float>* array : { &m_CenterX, &m_CenterY, &m_CenterZ, &m_ExtentX, &m_ExtentY, &m_ExtentZ })
+        array->clear();
+    if (count == 0)
+    {
+        m_Visible.clear();
+        return;
+    }
+
+    std::vector<unsigned int> objects(count);
+    for (unsigned int i = 0; i < count; i++)
+        objects[i] = i;
+    m_Nodes.reserve(2 * (count / s_LeafSize + 1));
+    BuildNode(objects.data(), count, centers, extents);
+    Refit();
+    m_Visible.resize(m_Indices.size());
+}
+
+unsigned int FrustumCuller::BuildNode(unsigned int* objects, unsigned int count, const Vec3* centers, const Vec3* extents)
+{
+    unsigned int index{ (unsigned int)m_Nodes.size() };
+    m_Nodes.push_back({});
+    if (count <= s_LeafSize)
+    {
+        //padding is a box of negative size, outside of any plane it is tested against
+        Node leaf{ {}, {}, (unsigned int)m_Indices.size(), 0, 0 };
+        for (unsigned int i = 0; i < s_LeafSize; i++)
+        {
+            unsigned int object{ i < count ? objects[i] : s_InvalidIndex };
+            Vec3 center{ object != s_InvalidIndex ? centers[object] : Vec3{ 0.0f, 0.0f, 0.0f } };
+            Vec3 extent{ object != s_InvalidIndex ? extents[object] : Vec3{ -1e30f, -1e30f, -1e30f } };
+            if (object != s_InvalidIndex)
+                m_Slots[object] = (unsigned int)m_Indices.size();
+            m_Indices.push_back(object);
+            m_CenterX.push_back(center.X);
+            m_CenterY.push_back(center.Y);
+            m_CenterZ.push_back(center.Z);
+            m_ExtentX.push_back(extent.X);
+            m_ExtentY.push_back(extent.Y);
+            m_ExtentZ.push_back(extent.Z);
+        }
+        leaf.End = (unsigned int)m_Indices.size();
+        m_Nodes[index] = leaf;
+        return index;
+    }
+
+    //median split along the widest spread of the centers
+    Vec3 low{ centers[objects[0]] }, high{ low };
+    for (unsigned int i = 1; i < count; i++)
+    {
+        const Vec3& c{ centers[objects[i]] };
+        low = { std::min(low.X, c.X), std::min(low.Y, c.Y), std::min(low.Z, c.Z) };
+        high = { std::max(high.X, c.X), std::max(high.Y, c.Y), std::max(high.Z, c.Z) };
+    }
+    Vec3 spread{ high - low };
+    unsigned int axis{ spread.X >= spread.Y && spread.X >= spread.Z ? 0u : (spread.Y >= spread.Z ? 1u : 2u) };
+    //a multiple of the leaf size on the left keeps the leaves full
+    unsigned int half{ (count / 2 + s_LeafSize - 1) / s_LeafSize * s_LeafSize };
+    std::nth_element(objects, objects + half, objects + count, [centers, axis](unsigned int a, unsigned int b) {
+        return (&centers[a].X)[axis] < (&centers[b].X)[axis];
+    });
+
+    //bounds come from Refit() once the whole tree is laid out
+    BuildNode(objects, half, centers, extents);
+    unsigned int right{ BuildNode(objects + half, count - half, centers, extents) };
+    m_Nodes[index] = { {}, {}, m_Nodes[index + 1].First, m_Nodes[right].End, right };
+    return index;
+}
+
+void FrustumCuller::SetBounds(unsigned int index, const Vec3& center, const Vec3& extents)
+{
+    if (index >= m_ObjectCount)
+        return;
+    unsigned int slot{ m_Slots[index] };
+    m_CenterX[slot] = center.X;
+    m_CenterY[slot] = center.Y;
+    m_CenterZ[slot] = center.Z;
+    m_ExtentX[slot] = extents.X;
+    m_ExtentY[slot] = extents.Y;
+    m_ExtentZ[slot] = extents.Z;
+    m_NeedsRefit = true;
+}
+
+void FrustumCuller::Refit()
+{
+    //children always come after their parent
+    for (size_t i = m_Nodes.size(); i-- > 0;)
+    {
+        Node& node{ m_Nodes[i] };
+        if (node.Right)
+        {
+            const Node& first{ m_Nodes[i + 1] };
+            const Node& second{ m_Nodes[node.Right] };
+            for (unsigned int axis = 0; axis < 3; axis++)
+            {
+                node.Min[axis] = std::min(first.Min[axis], second.Min[axis]);
+                node.Max[axis] = std::max(first.Max[axis], second.Max[axis]);
+            }
+            continue;
+        }
+        for (unsigned int axis = 0; axis < 3; axis++)
+        {
+            node.Min[axis] = 1e30f;
+            node.Max[axis] = -1e30f;
+        }
+        for (unsigned int slot = node.First; slot < node.End; slot++)
+        {
+            if (m_Indices[slot] == s_InvalidIndex)
+                continue;
+            const float center[3]{ m_CenterX[slot], m_CenterY[slot], m_CenterZ[slot] };
+            const float extent[3]{ m_ExtentX[slot], m_ExtentY[slot], m_ExtentZ[slot] };
+            for (unsigned int axis = 0; axis < 3; axis++)
+            {
+                node.Min[axis] = std::min(node.Min[axis], center[axis] - extent[axis]);
+                node.Max[axis] = std::max(node.Max[axis], center[axis] + extent[axis]);
+            }
+        }
+    }
+    m_NeedsRefit = false;
+}
+
+unsigned int FrustumCuller::Cull(const Frustum& frustum, WorkerPool* workers)
+{
+    auto start{ std::chrono::steady_clock::now() };
+    if (m_NeedsRefit)
+        Refit();
+
+    PlaneSet set;
+    for (unsigned int p = 0; p < 6; p++)
+    {
+        const Vec4& plane{ frustum.Planes[p] };
+        set.X[p] = plane.X;
+        set.Y[p] = plane.Y;
+        set.Z[p] = plane.Z;
+        set.W[p] = plane.W;
+        set.AbsX[p] = std::fabs(plane.X);
+        set.AbsY[p] = std::fabs(plane.Y);
+        set.AbsZ[p] = std::fabs(plane.Z);
+    }
+
+    m_Stats = {};
+    m_Tasks.clear();
+    if (!m_Nodes.empty())
+    {
+        bool parallel{ workers && workers->GetThreadCount() > 0 && m_ObjectCount >= s_ParallelObjects };
+        Gather(0, 0x3f, set, parallel ? s_TaskSlots : ~0u);
+    }
+
+    if (m_Tasks.size() > 1)
+    {
+        workers->ParallelFor((unsigned int)m_Tasks.size(), 1, [this, &set](unsigned int begin, unsigned int end) {
+            for (unsigned int i = begin; i < end; i++)
+            {
+                Task& task{ m_Tasks[i] };
+                Visit(task.Node, task.Planes, set, task, m_Visible.data() + m_Nodes[task.Node].First);
+            }
+        });
+    }
+    else if (!m_Tasks.empty())
+        Visit(m_Tasks[0].Node, m_Tasks[0].Planes, set, m_Tasks[0], m_Visible.data() + m_Nodes[m_Tasks[0].Node].First);
+
+    //every task wrote from the first slot of its subtree, pull them together in order
+    for (const Task& task : m_Tasks)
+    {
+        const unsigned int* source{ m_Visible.data() + m_Nodes[task.Node].First };
+        if (source != m_Visible.data() + m_Stats.Visible)
+            std::memmove(m_Visible.data() + m_Stats.Visible, source, task.Visible * sizeof(unsigned int));
+        m_Stats.Visible += task.Visible;
+        m_Stats.NodesTested += task.NodesTested;
+        m_Stats.LeavesTested += task.LeavesTested;
+    }
+    m_Stats.Culled = m_ObjectCount - m_Stats.Visible;
+    m_Stats.Microseconds = (unsigned long long)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+    s_ObjectsVisible.Add(m_Stats.Visible);
+    s_ObjectsCulled.Add(m_Stats.Culled);
+    s_CullTime.Add(m_Stats.Microseconds);
+    return m_Stats.Visible;
+}
+
+void FrustumCuller::Gather(unsigned int node, unsigned int planes, const PlaneSet& set, unsigned int taskSlots)
+{
+    const Node& current{ m_Nodes[node] };
+    m_Stats.NodesTested++;
+    if (!TestBox(current.Min, current.Max, set.X, set.Y, set.Z, set.W, set.AbsX, set.AbsY, set.AbsZ, planes))
+        return;
+    if (planes == 0 || !current.Right || current.End - current.First <= taskSlots)
+    {
+        m_Tasks.push_back({ node, planes, 0, 0, 0 });
+        return;
+    }
+    Gather(node + 1, planes, set, taskSlots);
+    Gather(current.Right, planes, set, taskSlots);
+}
+
+void FrustumCuller::Visit(unsigned int node, unsigned int planes, const PlaneSet& set, Task& task, unsigned int* out) const
+{
+    //node already passed its own test with planes left over
+    const Node& current{ m_Nodes[node] };
+    if (planes == 0)
+    {
+        for (unsigned int slot = current.First; slot < current.End; slot++)
+        {
+            if (m_Indices[slot] != s_InvalidIndex)
+                out[task.Visible++] = m_Indices[slot];
+        }
+        return;
+    }
+    if (!current.Right)
+    {
+        task.LeavesTested++;
+        task.Visible += TestLeaf(current, planes, set, out + task.Visible);
+        return;
+    }
+    for (unsigned int child : { node + 1, current.Right })
+    {
+        unsigned int childPlanes{ planes };
+        const Node& next{ m_Nodes[child] };
+        task.NodesTested++;
+        if (TestBox(next.Min, next.Max, set.X, set.Y, set.Z, set.W, set.AbsX, set.AbsY, set.AbsZ, childPlanes))
+            Visit(child, childPlanes, set, task, out);
+    }
+}
+
+unsigned int FrustumCuller::TestLeaf(const Node& leaf, unsigned int planes, const PlaneSet& set, unsigned int* out) const
+{
+    //bit per slot of the leaf that is outside some plane
+    unsigned int outside{ 0 };
+    unsigned int first{ leaf.First };
+#if defined(__AVX2__)
+    {
+        __m256 cx{ _mm256_loadu_ps(&m_CenterX[first]) }, cy{ _mm256_loadu_ps(&m_CenterY[first]) }, cz{ _mm256_loadu_ps(&m_CenterZ[first]) };
+        __m256 ex{ _mm256_loadu_ps(&m_ExtentX[first]) }, ey{ _mm256_loadu_ps(&m_ExtentY[first]) }, ez{ _mm256_loadu_ps(&m_ExtentZ[first]) };
+        __m256 result{ _mm256_setzero_ps() };
+        for (unsigned int p = 0; p < 6; p++)
+        {
+            if (!(planes & (1u << p)))
+                continue;
+#ifdef __FMA__
+            __m256 distance{ _mm256_fmadd_ps(_mm256_set1_ps(set.X[p]), cx, _mm256_fmadd_ps(_mm256_set1_ps(set.Y[p]), cy,
+                _mm256_fmadd_ps(_mm256_set1_ps(set.Z[p]), cz, _mm256_set1_ps(set.W[p])))) };
+            __m256 radius{ _mm256_fmadd_ps(_mm256_set1_ps(set.AbsX[p]), ex, _mm256_fmadd_ps(_mm256_set1_ps(set.AbsY[p]), ey,
+                _mm256_mul_ps(_mm256_set1_ps(set.AbsZ[p]), ez))) };
+#else
+            __m256 distance{ _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(set.X[p]), cx), _mm256_mul_ps(_mm256_set1_ps(set.Y[p]), cy)),
+                _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(set.Z[p]), cz), _mm256_set1_ps(set.W[p]))) };
+            __m256 radius{ _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(set.AbsX[p]), ex), _mm256_mul_ps(_mm256_set1_ps(set.AbsY[p]), ey)),
+                _mm256_mul_ps(_mm256_set1_ps(set.AbsZ[p]), ez)) };
+#endif
+            result = _mm256_or_ps(result, _mm256_cmp_ps(_mm256_add_ps(distance, radius), _mm256_setzero_ps(), _CMP_LT_OQ));
+        }
+        outside = (unsigned int)_mm256_movemask_ps(result);
+    }
+#elif defined(VECTOR_MATH_SSE2)
+    for (unsigned int half = 0; half < s_LeafSize; half += 4)
+    {
+        unsigned int slot{ first + half };
+        __m128 cx{ _mm_loadu_ps(&m_CenterX[slot]) }, cy{ _mm_loadu_ps(&m_CenterY[slot]) }, cz{ _mm_loadu_ps(&m_CenterZ[slot]) };
+        __m128 ex{ _mm_loadu_ps(&m_ExtentX[slot]) }, ey{ _mm_loadu_ps(&m_ExtentY[slot]) }, ez{ _mm_loadu_ps(&m_ExtentZ[slot]) };
+        __m128 result{ _mm_setzero_ps() };
+        for (unsigned int p = 0; p < 6; p++)
+        {
+            if (!(planes & (1u << p)))
+                continue;
+            __m128 distance{ _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(set.X[p]), cx), _mm_mul_ps(_mm_set1_ps(set.Y[p]), cy)),
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(set.Z[p]), cz), _mm_set1_ps(set.W[p]))) };
+            __m128 radius{ _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(set.AbsX[p]), ex), _mm_mul_ps(_mm_set1_ps(set.AbsY[p]), ey)),
+                _mm_mul_ps(_mm_set1_ps(set.AbsZ[p]), ez)) };
+            result = _mm_or_ps(result, _mm_cmplt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+        }
+        outside |= (unsigned int)_mm_movemask_ps(result) << half;
+    }
+#else
+    for (unsigned int lane = 0; lane < s_LeafSize; lane++)
+    {
+        unsigned int slot{ first + lane };
+        for (unsigned int p = 0; p < 6; p++)
+        {
+            if (!(planes & (1u << p)))
+                continue;
+            float distance{ set.X[p] * m_CenterX[slot] + set.Y[p] * m_CenterY[slot] + set.Z[p] * m_CenterZ[slot] + set.W[p] };
+            float radius{ set.AbsX[p] * m_ExtentX[slot] + set.AbsY[p] * m_ExtentY[slot] + set.AbsZ[p] * m_ExtentZ[slot] };
+            if (distance + radius < 0.0f)
+            {
+                outside |= 1u << lane;
+                break;
+            }
+        }
+    }
+#endif
+
+    unsigned int count{ 0 };
+    for (unsigned int lane = 0; lane < s_LeafSize; lane++)
+    {
+        if (!(outside & (1u << lane)) && m_Indices[first + lane] != s_InvalidIndex)
+            out[count++] = m_Indices[first + lane];
+    }
+    return count;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "VectorMath.h"
+#include "WorkerPool.h"
+
+#include <vector>
+
+//the six planes of a view-projection, normals pointing inside: a point is inside a plane when
+//Dot(normal, p) + W >= 0
+struct Frustum
+{
+	Vec4 Planes[6];     //left, right, bottom, top, near, far
+
+	//GL clip space (-w..w on every axis), the planes come out normalized
+	static Frustum FromMatrix(const Mat4& viewProjection);
+};
+
+struct CullStats
+{
+	unsigned int Visible;
+	unsigned int Culled;
+	unsigned int NodesTested;
+	unsigned int LeavesTested;          //SIMD tests of a leaf's objects
+	unsigned long long Microseconds;
+};
+
+//visibility of many objects against a frustum. the bounds (center and half extents boxes, a
+//sphere is the box around it) are kept in SoA arrays ordered by a BVH whose leaves are
+//s_LeafSize objects, so one leaf is a single 8 wide test per plane (two 4 wide ones without
+//AVX2). subtrees outside a plane are rejected whole, a plane a node is fully inside of is not
+//tested again below it, and a subtree inside every plane is emitted without any test.
+//
+//with a WorkerPool large sets are split into subtrees that are culled in parallel, each into
+//its own part of the visible list, which is compacted afterwards in BVH order. not thread-safe
+//itself, one Cull() at a time
+class FrustumCuller
+{
+public:
+	static constexpr unsigned int s_LeafSize{ 8 };
+	static constexpr unsigned int s_InvalidIndex{ ~0u };
+private:
+	struct Node
+	{
+		float Min[3];
+		float Max[3];
+		unsigned int First;     //slots of the subtree, First a multiple of s_LeafSize
+		unsigned int End;
+		unsigned int Right;     //index of the second child, the first one follows the node. 0 in a leaf
+	};
+
+	struct Task
+	{
+		unsigned int Node;
+		unsigned int Planes;    //bit per frustum plane still to test
+		unsigned int Visible;
+		unsigned int NodesTested;
+		unsigned int LeavesTested;
+	};
+
+	struct PlaneSet;
+
+	//one slot per object plus padding to fill the last slot of every leaf
+	std::vector<float> m_CenterX, m_CenterY, m_CenterZ;
+	std::vector<float> m_ExtentX, m_ExtentY, m_ExtentZ;
+	std::vector<unsigned int> m_Indices;        //slot -> object, s_InvalidIndex for padding
+	std::vector<unsigned int> m_Slots;          //object -> slot
+	std::vector<Node> m_Nodes;
+	unsigned int m_ObjectCount;
+	bool m_NeedsRefit;
+
+	std::vector<unsigned int> m_Visible;        //one entry per slot, the front m_Stats.Visible are the result
+	std::vector<Task> m_Tasks;
+	CullStats m_Stats;
+
+	unsigned int BuildNode(unsigned int* objects, unsigned int count, const Vec3* centers, const Vec3* extents);
+	void Refit();
+	void Gather(unsigned int node, unsigned int planes, const PlaneSet& set, unsigned int taskSlots);
+	void Visit(unsigned int node, unsigned int planes, const PlaneSet& set, Task& task, unsigned int* out) const;
+	unsigned int TestLeaf(const Node& leaf, unsigned int planes, const PlaneSet& set, unsigned int* out) const;
+public:
+	FrustumCuller();
+
+	//replaces every object with count new ones and builds the BVH around them. objects are
+	//referred to by their index into these arrays
+	void Build(const Vec3* centers, const Vec3* extents, unsigned int count);
+	//moves one object, the BVH keeps its shape and is refit on the next Cull(). when objects
+	//travel far the tree gets loose and Build() should run again
+	void SetBounds(unsigned int index, const Vec3& center, const Vec3& extents);
+
+	//fills the visible list and returns its size. with workers the subtrees are spread over them
+	//once there are enough objects to pay for it
+	unsigned int Cull(const Frustum& frustum, WorkerPool* workers = nullptr);
+
+	//the indices of the visible objects, valid until the next Cull() or Build()
+	inline const unsigned int* GetVisible() const { return m_Visible.data(); }
+	inline unsigned int GetVisibleCount() const { return m_Stats.Visible; }
+	inline const CullStats& GetStats() const { return m_Stats; }
+	inline unsigned int GetObjectCount() const { return m_ObjectCount; }
+	inline unsigned int GetNodeCount() const { return (unsigned int)m_Nodes.size(); }
+};
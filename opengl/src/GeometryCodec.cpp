@@ -0,0 +1,440 @@
+#include "GeometryCodec.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GEOMETRY_CODEC_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+    constexpr unsigned char s_VertexHeader{ 0xa0 };
+    constexpr unsigned char s_IndexHeader{ 0xe0 };
+    constexpr unsigned int s_GroupSize{ 16 };
+    constexpr unsigned int s_BlockBytes{ 8192 };
+    constexpr unsigned int s_MaxBlockVertices{ 256 };
+    constexpr unsigned int s_MaxStride{ 256 };
+
+    //vertices per block, a multiple of the group size so groups never straddle blocks
+    unsigned int GetBlockVertices(unsigned int stride)
+    {
+        return std::min((s_BlockBytes / stride) & ~(s_GroupSize - 1), s_MaxBlockVertices);
+    }
+
+    inline unsigned char Zigzag(unsigned char delta)
+    {
+        return (unsigned char)((delta << 1) ^ (delta & 0x80 ? 0xff : 0x00));
+    }
+
+    inline unsigned char Unzigzag(unsigned char value)
+    {
+        return (unsigned char)((value >> 1) ^ (0u - (value & 1)));
+    }
+
+    //payload bytes of a group for each of the 2 bit modes: all zero, 2, 4 and 8 bits per value
+    constexpr unsigned int s_GroupBytes[4] { 0, 4, 8, 16 };
+
+    //16 deltas of one byte of the vertex into out, unpacked and unzigzagged
+    inline void DecodeGroup(const unsigned char* data, unsigned int mode, unsigned char* out)
+    {
+#ifdef GEOMETRY_CODEC_SSE2
+        __m128i values;
+        switch (mode)
+        {
+            case 0:
+                values = _mm_setzero_si128();
+                break;
+            case 1:
+            {
+                //spread the 4 bytes to 8 nibbles and those to 16 pairs of bits, highest bits first
+                int packed;
+                std::memcpy(&packed, data, 4);
+                __m128i bytes{ _mm_cvtsi32_si128(packed) };
+                __m128i nibbles{ _mm_unpacklo_epi8(_mm_srli_epi16(bytes, 4), bytes) };
+                __m128i pairs{ _mm_unpacklo_epi8(_mm_srli_epi16(nibbles, 2), nibbles) };
+                values = _mm_and_si128(pairs, _mm_set1_epi8(3));
+                break;
+            }
+            case 2:
+            {
+                __m128i bytes{ _mm_loadl_epi64((const __m128i*)data) };
+                __m128i nibbles{ _mm_unpacklo_epi8(_mm_srli_epi16(bytes, 4), bytes) };
+                values = _mm_and_si128(nibbles, _mm_set1_epi8(15));
+                break;
+            }
+            default:
+                values = _mm_loadu_si128((const __m128i*)data);
+                break;
+        }
+        __m128i half{ _mm_and_si128(_mm_srli_epi16(values, 1), _mm_set1_epi8(0x7f)) };
+        __m128i sign{ _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(values, _mm_set1_epi8(1))) };
+        _mm_storeu_si128((__m128i*)out, _mm_xor_si128(half, sign));
+#else
+        for (unsigned int i = 0; i < s_GroupSize; i++)
+        {
+            unsigned char value;
+            switch (mode)
+            {
+                case 0:     value = 0; break;
+                case 1:     value = (data[i / 4] >> (6 - 2 * (i % 4))) & 3; break;
+                case 2:     value = (data[i / 2] >> (i % 2 ? 0 : 4)) & 15; break;
+                default:    value = data[i]; break;
+            }
+            out[i] = Unzigzag(value);
+        }
+#endif
+    }
+
+    //turns the deltas of a block (byte of the vertex major) into vertices, continuing from last
+    void DecodeDeltas(const unsigned char* deltas, unsigned int vertices, unsigned int stride, unsigned char* last,
+        unsigned char* block)
+    {
+#ifdef GEOMETRY_CODEC_SSE2
+        //4 bytes of the vertex at a time: a 4x16 transpose gives 4 vertices per register and
+        //a prefix sum over the register continues from the previous vertex
+        for (unsigned int k = 0; k < stride; k += 4)
+        {
+            int previous;
+            std::memcpy(&previous, last + k, 4);
+            __m128i carry{ _mm_set1_epi32(previous) };
+            for (unsigned int i = 0; i < vertices; i += s_GroupSize)
+            {
+                __m128i r0{ _mm_loadu_si128((const __m128i*)(deltas + (k + 0) * vertices + i)) };
+                __m128i r1{ _mm_loadu_si128((const __m128i*)(deltas + (k + 1) * vertices + i)) };
+                __m128i r2{ _mm_loadu_si128((const __m128i*)(deltas + (k + 2) * vertices + i)) };
+                __m128i r3{ _mm_loadu_si128((const __m128i*)(deltas + (k + 3) * vertices + i)) };
+                __m128i t0{ _mm_unpacklo_epi8(r0, r1) }, t1{ _mm_unpackhi_epi8(r0, r1) };
+                __m128i t2{ _mm_unpacklo_epi8(r2, r3) }, t3{ _mm_unpackhi_epi8(r2, r3) };
+                __m128i quads[4] { _mm_unpacklo_epi16(t0, t2), _mm_unpackhi_epi16(t0, t2), _mm_unpacklo_epi16(t1, t3), _mm_unpackhi_epi16(t1, t3) };
+                for (unsigned int q = 0; q < 4; q++)
+                {
+                    __m128i sum{ quads[q] };
+                    sum = _mm_add_epi8(sum, _mm_slli_si128(sum, 4));
+                    sum = _mm_add_epi8(sum, _mm_slli_si128(sum, 8));
+                    sum = _mm_add_epi8(sum, carry);
+                    carry = _mm_shuffle_epi32(sum, 0xff);
+                    unsigned char* out{ block + (size_t)(i + q * 4) * stride + k };
+                    for (unsigned int v = 0; v < 4; v++)
+                    {
+                        int value{ _mm_cvtsi128_si32(sum) };
+                        std::memcpy(out + v * stride, &value, 4);
+                        sum = _mm_srli_si128(sum, 4);
+                    }
+                }
+            }
+            int value{ _mm_cvtsi128_si32(carry) };
+            std::memcpy(last + k, &value, 4);
+        }
+#else
+        for (unsigned int k = 0; k < stride; k++)
+        {
+            unsigned char previous{ last[k] };
+            const unsigned char* lane{ deltas + (size_t)k * vertices };
+            for (unsigned int i = 0; i < vertices; i++)
+            {
+                previous += lane[i];
+                block[(size_t)i * stride + k] = previous;
+            }
+            last[k] = previous;
+        }
+#endif
+    }
+
+    //index coding state, the encoder and the decoder step it the same way
+    struct IndexFifos
+    {
+        unsigned int Edges[16][2];
+        unsigned int Vertices[16];
+        unsigned int EdgeOffset;
+        unsigned int VertexOffset;
+        unsigned int Next;              //the vertex a code of 0 stands for
+        unsigned int Last;              //explicit vertices are deltas from the previous one
+
+        void PushEdge(unsigned int a, unsigned int b)
+        {
+            Edges[EdgeOffset & 15][0] = a;
+            Edges[EdgeOffset & 15][1] = b;
+            EdgeOffset++;
+        }
+
+        //0: Next, 1-14: the n-th most recent vertex, 15: explicit
+        unsigned int GetCode(unsigned int vertex) const
+        {
+            if (vertex == Next)
+                return 0;
+            for (unsigned int f = 1; f < 15; f++)
+            {
+                if (Vertices[(VertexOffset - f) & 15] == vertex)
+                    return f;
+            }
+            return 15;
+        }
+
+        //what a vertex coded as code does to the state
+        void Use(unsigned int vertex, unsigned int code)
+        {
+            if (code != 0 && code != 15)
+                return;
+            if (code == 0)
+                Next++;
+            else
+                Last = vertex;
+            Vertices[VertexOffset & 15] = vertex;
+            VertexOffset++;
+        }
+    };
+
+    void WriteVarint(unsigned int value, std::vector<unsigned char>& out)
+    {
+        while (value >= 0x80)
+        {
+            out.push_back((unsigned char)(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back((unsigned char)value);
+    }
+
+    bool ReadVarint(const unsigned char*& data, const unsigned char* end, unsigned int& value)
+    {
+        value = 0;
+        for (unsigned int shift = 0; shift < 35; shift += 7)
+        {
+            if (data == end)
+                return false;
+            unsigned char byte{ *data++ };
+            value |= (unsigned int)(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                return true;
+        }
+        return false;
+    }
+
+    void EncodeVertex(IndexFifos& fifos, unsigned int vertex, unsigned int code, std::vector<unsigned char>& explicits)
+    {
+        if (code == 15)
+        {
+            int delta{ (int)(vertex - fifos.Last) };
+            WriteVarint(((unsigned int)delta << 1) ^ (unsigned int)(delta >> 31), explicits);
+        }
+        fifos.Use(vertex, code);
+    }
+
+    bool DecodeVertex(IndexFifos& fifos, unsigned int code, const unsigned char*& data, const unsigned char* end, unsigned int& vertex)
+    {
+        if (code == 0)
+            vertex = fifos.Next;
+        else if (code == 15)
+        {
+            unsigned int zigzag;
+            if (!ReadVarint(data, end, zigzag))
+                return false;
+            vertex = fifos.Last + ((zigzag >> 1) ^ (0u - (zigzag & 1)));
+        }
+        else
+            vertex = fifos.Vertices[(fifos.VertexOffset - code) & 15];
+        fifos.Use(vertex, code);
+        return true;
+    }
+
+}
+
+void EncodeVertexBuffer(const void* vertices, unsigned int count, unsigned int stride, std::vector<unsigned char>& out)
+{
+    out.clear();
+    out.push_back(s_VertexHeader);
+    const unsigned char* bytes{ (const unsigned char*)vertices };
+    unsigned char last[s_MaxStride] {};
+    unsigned char deltas[s_MaxBlockVertices];
+    unsigned int blockVertices{ GetBlockVertices(stride) };
+    for (unsigned int first = 0; first < count; first += blockVertices)
+    {
+        unsigned int vertexCount{ std::min(blockVertices, count - first) };
+        unsigned int groups{ (vertexCount + s_GroupSize - 1) / s_GroupSize };
+        unsigned int padded{ std::min(groups * s_GroupSize, s_MaxBlockVertices) };      //== groups * s_GroupSize
+        for (unsigned int k = 0; k < stride; k++)
+        {
+            //the padding past the last vertex repeats it, zero deltas
+            unsigned char previous{ last[k] };
+            for (unsigned int i = 0; i < padded; i++)
+            {
+                unsigned char value{ i < vertexCount ? bytes[(size_t)(first + i) * stride + k] : previous };
+                deltas[i] = Zigzag((unsigned char)(value - previous));
+                previous = value;
+            }
+            last[k] = previous;
+
+            size_t header{ out.size() };
+            out.resize(header + (groups + 3) / 4, 0);
+            for (unsigned int g = 0; g < groups; g++)
+            {
+                const unsigned char* group{ deltas + g * s_GroupSize };
+                unsigned char largest{ *std::max_element(group, group + s_GroupSize) };
+                unsigned int mode{ largest == 0 ? 0u : largest < 4 ? 1u : largest < 16 ? 2u : 3u };
+                out[header + g / 4] |= (unsigned char)(mode << (6 - 2 * (g % 4)));
+                size_t payload{ out.size() };
+                out.resize(payload + s_GroupBytes[mode], 0);
+                unsigned char* p{ out.data() + payload };
+                for (unsigned int i = 0; i < s_GroupSize; i++)
+                {
+                    if (mode == 1)
+                        p[i / 4] |= (unsigned char)(group[i] << (6 - 2 * (i % 4)));
+                    else if (mode == 2)
+                        p[i / 2] |= (unsigned char)(group[i] << (i % 2 ? 0 : 4));
+                    else if (mode == 3)
+                        p[i] = group[i];
+                }
+            }
+        }
+    }
+}
+
+bool DecodeVertexBuffer(void* vertices, unsigned int count, unsigned int stride, const unsigned char* data, size_t size)
+{
+    if (stride == 0 || stride % 4 || stride > s_MaxStride || size == 0 || data[0] != s_VertexHeader)
+        return false;
+    const unsigned char* end{ data + size };
+    data++;
+
+    unsigned char* out{ (unsigned char*)vertices };
+    unsigned char last[s_MaxStride] {};
+    unsigned char deltas[s_BlockBytes];
+    unsigned char block[s_BlockBytes];
+    unsigned int blockVertices{ GetBlockVertices(stride) };
+    for (unsigned int first = 0; first < count; first += blockVertices)
+    {
+        unsigned int vertexCount{ std::min(blockVertices, count - first) };
+        unsigned int groups{ (vertexCount + s_GroupSize - 1) / s_GroupSize };
+        unsigned int padded{ groups * s_GroupSize };
+        for (unsigned int k = 0; k < stride; k++)
+        {
+            const unsigned char* header{ data };
+            size_t headerSize{ (groups + 3) / 4 };
+            if ((size_t)(end - data) < headerSize)
+                return false;
+            data += headerSize;
+            unsigned char* lane{ deltas + (size_t)k * padded };
+            for (unsigned int g = 0; g < groups; g++)
+            {
+                unsigned int mode{ (header[g / 4] >> (6 - 2 * (g % 4))) & 3u };
+                if ((size_t)(end - data) < s_GroupBytes[mode])
+                    return false;
+                DecodeGroup(data, mode, lane + g * s_GroupSize);
+                data += s_GroupBytes[mode];
+            }
+        }
+        DecodeDeltas(deltas, padded, stride, last, block);
+        std::memcpy(out + (size_t)first * stride, block, (size_t)vertexCount * stride);
+    }
+    return data == end;
+}
+
+size_t GetMinEncodedVertexSize(unsigned int count, unsigned int stride)
+{
+    if (stride == 0 || stride % 4 || stride > s_MaxStride)
+        return SIZE_MAX;
+    //every lane of a block has its group modes, the groups themselves may all be zero bits
+    auto laneHeader = [](unsigned int vertices) { return (size_t)((vertices + s_GroupSize - 1) / s_GroupSize + 3) / 4; };
+    unsigned int blockVertices{ GetBlockVertices(stride) };
+    unsigned int rest{ count % blockVertices };
+    return 1 + (size_t)stride * ((size_t)(count / blockVertices) * laneHeader(blockVertices) + (rest ? laneHeader(rest) : 0));
+}
+
+void EncodeIndexBuffer(const unsigned int* indices, unsigned int count, std::vector<unsigned char>& out)
+{
+    out.clear();
+    out.reserve(count / 3 + 16);
+    out.push_back(s_IndexHeader);
+    IndexFifos fifos{};
+    std::vector<unsigned char> explicits;
+    for (unsigned int t = 0; t + 2 < count; t += 3)
+    {
+        const unsigned int* triangle{ indices + t };
+        explicits.clear();
+
+        //a recent edge (p, q) is shared by the triangle (q, p, z) on its other side
+        bool shared{ false };
+        for (unsigned int e = 0; e < 15 && !shared; e++)
+        {
+            const unsigned int* edge{ fifos.Edges[(fifos.EdgeOffset - 1 - e) & 15] };
+            for (unsigned int r = 0; r < 3; r++)
+            {
+                unsigned int x{ triangle[r] }, y{ triangle[(r + 1) % 3] }, z{ triangle[(r + 2) % 3] };
+                if (edge[0] != y || edge[1] != x)
+                    continue;
+                unsigned int code{ fifos.GetCode(z) };
+                EncodeVertex(fifos, z, code, explicits);
+                out.push_back((unsigned char)(e << 4 | code));
+                fifos.PushEdge(y, z);
+                fifos.PushEdge(z, x);
+                shared = true;
+                break;
+            }
+        }
+        if (!shared)
+        {
+            unsigned int codes[3];
+            for (unsigned int v = 0; v < 3; v++)
+            {
+                codes[v] = fifos.GetCode(triangle[v]);
+                EncodeVertex(fifos, triangle[v], codes[v], explicits);
+            }
+            out.push_back((unsigned char)(0xf0 | codes[0]));
+            out.push_back((unsigned char)(codes[1] << 4 | codes[2]));
+            fifos.PushEdge(triangle[0], triangle[1]);
+            fifos.PushEdge(triangle[1], triangle[2]);
+            fifos.PushEdge(triangle[2], triangle[0]);
+        }
+        out.insert(out.end(), explicits.begin(), explicits.end());
+    }
+}
+
+size_t GetMinEncodedIndexSize(unsigned int count)
+{
+    return 1 + (size_t)count / 3;
+}
+
+bool DecodeIndexBuffer(unsigned int* indices, unsigned int count, const unsigned char* data, size_t size)
+{
+    if (count % 3 || size == 0 || data[0] != s_IndexHeader)
+        return false;
+    const unsigned char* end{ data + size };
+    data++;
+
+    IndexFifos fifos{};
+    for (unsigned int t = 0; t < count; t += 3)
+    {
+        if (data == end)
+            return false;
+        unsigned char code{ *data++ };
+        unsigned int* triangle{ indices + t };
+        if (code < 0xf0)
+        {
+            const unsigned int* edge{ fifos.Edges[(fifos.EdgeOffset - 1 - (code >> 4)) & 15] };
+            unsigned int x{ edge[1] }, y{ edge[0] }, z;
+            if (!DecodeVertex(fifos, code & 15, data, end, z))
+                return false;
+            triangle[0] = x;
+            triangle[1] = y;
+            triangle[2] = z;
+            fifos.PushEdge(y, z);
+            fifos.PushEdge(z, x);
+        }
+        else
+        {
+            if (data == end)
+                return false;
+            unsigned char rest{ *data++ };
+            if (!DecodeVertex(fifos, code & 15, data, end, triangle[0]) ||
+                !DecodeVertex(fifos, rest >> 4, data, end, triangle[1]) ||
+                !DecodeVertex(fifos, rest & 15, data, end, triangle[2]))
+                return false;
+            fifos.PushEdge(triangle[0], triangle[1]);
+            fifos.PushEdge(triangle[1], triangle[2]);
+            fifos.PushEdge(triangle[2], triangle[0]);
+        }
+    }
+    return data == end;
+}
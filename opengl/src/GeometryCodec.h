@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+//lossless compression for vertex and index buffers, built so decoding is cheaper than reading
+//the raw bytes from disk. run a general purpose compressor over the result for more.
+//
+//vertex streams are cut into blocks of up to 256 vertices; every byte of the vertex is delta
+//coded against the same byte of the previous vertex, zigzagged, and stored in groups of 16
+//vertices at 0, 2, 4 or 8 bits per value. smooth, spatially ordered data (welded meshes,
+//first use order) mostly lands in the 2 and 4 bit groups
+//
+//index buffers are coded per triangle against a FIFO of recent edges and one of recent
+//vertices: a triangle sharing an edge with a recent one and adding a new or recent vertex
+//takes a single byte. triangles may come back rotated, with the same winding
+
+//stride must be a multiple of 4 and at most 256
+void EncodeVertexBuffer(const void* vertices, unsigned int count, unsigned int stride, std::vector<unsigned char>& out);
+//false when data is malformed or does not hold count vertices of stride bytes
+bool DecodeVertexBuffer(void* vertices, unsigned int count, unsigned int stride, const unsigned char* data, size_t size);
+//the smallest encoding of count vertices, so a reader can reject a count its data cannot hold
+//before allocating for it. SIZE_MAX for a stride DecodeVertexBuffer() rejects
+size_t GetMinEncodedVertexSize(unsigned int count, unsigned int stride);
+
+//count must be a multiple of 3
+void EncodeIndexBuffer(const unsigned int* indices, unsigned int count, std::vector<unsigned char>& out);
+bool DecodeIndexBuffer(unsigned int* indices, unsigned int count, const unsigned char* data, size_t size);
+//one byte per triangle at best
+size_t GetMinEncodedIndexSize(unsigned int count);
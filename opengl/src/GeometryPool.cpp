@@ -0,0 +1,148 @@
+#include "GeometryPool.h"
+#include "AllocationTracker.h"
+
+#include <algorithm>
+#include <cstdint>
+
+//the IndexBuffer/VertexBuffer constructors bind what they create, make sure the pool's
+//VAO is the one that picks up the element buffer
+static unsigned int CreateVertexArray()
+{
+    unsigned int id;
+    GLCall(glGenVertexArrays(1, &id));
+    GLCall(glBindVertexArray(id));
+    return id;
+}
+
+GeometryPool::GeometryPool(const VertexBufferLayout& layout, unsigned int vertexCapacity, unsigned int indexCapacity)
+    : m_Layout(layout),
+      m_VertexArrayID(CreateVertexArray()),
+      m_Vertices(nullptr, vertexCapacity * layout.GetStride()),
+      m_Indices(nullptr, indexCapacity),
+      m_VertexRanges(vertexCapacity),
+      m_IndexRanges(indexCapacity),
+      m_Rebuilds(0)
+{
+    m_Layout.Apply();
+    GLCall(glBindVertexArray(0));
+}
+
+GeometryPool::~GeometryPool()
+{
+    GLCall(glDeleteVertexArrays(1, &m_VertexArrayID));
+}
+
+GeometryHandle GeometryPool::Add(const void* vertices, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount)
+{
+    ALLOCATION_SCOPE("GeometryPool");
+    RangeAllocation vertexRange{ m_VertexRanges.Allocate(vertexCount) };
+    RangeAllocation indexRange{ m_IndexRanges.Allocate(indexCount) };
+    if (!vertexRange.IsValid() || !indexRange.IsValid())
+    {
+        m_VertexRanges.Free(vertexRange);
+        m_IndexRanges.Free(indexRange);
+
+        //double whatever ran out (at least enough for this mesh), the rebuild also compacts
+        RangeAllocatorStats v{ m_VertexRanges.GetStats() };
+        RangeAllocatorStats i{ m_IndexRanges.GetStats() };
+        unsigned int vertexCapacity{ v.Capacity };
+        unsigned int indexCapacity{ i.Capacity };
+        if (v.UsedSize + vertexCount > v.Capacity || !vertexRange.IsValid())
+            vertexCapacity = std::max(v.Capacity * 2, v.UsedSize + vertexCount);
+        if (i.UsedSize + indexCount > i.Capacity || !indexRange.IsValid())
+            indexCapacity = std::max(i.Capacity * 2, i.UsedSize + indexCount);
+        Rebuild(vertexCapacity, indexCapacity);
+
+        vertexRange = m_VertexRanges.Allocate(vertexCount);
+        indexRange = m_IndexRanges.Allocate(indexCount);
+        ASSERT(vertexRange.IsValid() && indexRange.IsValid());
+    }
+
+    //static buffers upload right away, through the copy target so no VAO binding gets disturbed
+    m_Vertices.Update(vertexRange.Offset * m_Layout.GetStride(), vertices, vertexCount * m_Layout.GetStride());
+    m_Indices.Update(indexRange.Offset, indices, indexCount);
+
+    GeometryHandle handle{ m_Meshes.Allocate() };
+    m_Meshes.Emplace(handle, { vertexRange, indexRange });
+    return handle;
+}
+
+void GeometryPool::Remove(GeometryHandle handle)
+{
+    m_Meshes.Remove(handle, [this](GeometryMesh&& mesh) {
+        m_VertexRanges.Free(mesh.Vertices);
+        m_IndexRanges.Free(mesh.Indices);
+    });
+}
+
+const GeometryMesh* GeometryPool::Get(GeometryHandle handle)
+{
+    return m_Meshes.Get(handle);
+}
+
+void GeometryPool::Bind() const
+{
+    GLCall(glBindVertexArray(m_VertexArrayID));
+}
+
+void GeometryPool::Draw(GeometryHandle handle)
+{
+    const GeometryMesh* mesh{ m_Meshes.Get(handle) };
+    if (!mesh)
+        return;
+    GLCall(glDrawElementsBaseVertex(GL_TRIANGLES, mesh->Indices.Size, GL_UNSIGNED_INT,
+        (const void*)((uintptr_t)mesh->Indices.Offset * sizeof(unsigned int)), (GLint)mesh->Vertices.Offset));
+}
+
+void GeometryPool::Compact()
+{
+    Rebuild(m_VertexRanges.GetCapacity(), m_IndexRanges.GetCapacity());
+}
+
+void GeometryPool::Rebuild(unsigned int vertexCapacity, unsigned int indexCapacity)
+{
+    ALLOCATION_SCOPE("GeometryPool");
+    unsigned int stride{ m_Layout.GetStride() };
+
+    GLCall(glBindVertexArray(m_VertexArrayID));
+    VertexBuffer vertices(nullptr, vertexCapacity * stride);
+    IndexBuffer indices(nullptr, indexCapacity);
+    m_VertexRanges.Reset(vertexCapacity);
+    m_IndexRanges.Reset(indexCapacity);
+
+    //allocating into empty allocators in order packs the meshes back to back
+    for (GeometryMesh& mesh : m_Meshes)
+    {
+        RangeAllocation vertexRange{ m_VertexRanges.Allocate(mesh.Vertices.Size) };
+        RangeAllocation indexRange{ m_IndexRanges.Allocate(mesh.Indices.Size) };
+        ASSERT(vertexRange.IsValid() && indexRange.IsValid());
+
+        GLCall(glBindBuffer(GL_COPY_READ_BUFFER, m_Vertices.GetRendererID()));
+        GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, vertices.GetRendererID()));
+        GLCall(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+            (GLintptr)mesh.Vertices.Offset * stride, (GLintptr)vertexRange.Offset * stride, (GLsizeiptr)mesh.Vertices.Size * stride));
+        GLCall(glBindBuffer(GL_COPY_READ_BUFFER, m_Indices.GetRendererID()));
+        GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, indices.GetRendererID()));
+        GLCall(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+            (GLintptr)mesh.Indices.Offset * sizeof(unsigned int), (GLintptr)indexRange.Offset * sizeof(unsigned int),
+            (GLsizeiptr)mesh.Indices.Size * sizeof(unsigned int)));
+
+        mesh.Vertices = vertexRange;
+        mesh.Indices = indexRange;
+    }
+    GLCall(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+    GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+
+    m_Vertices = std::move(vertices);
+    m_Indices = std::move(indices);
+    m_Vertices.Bind();
+    m_Layout.Apply();
+    m_Indices.Bind();
+    GLCall(glBindVertexArray(0));
+    m_Rebuilds++;
+}
+
+GeometryPoolStats GeometryPool::GetStats() const
+{
+    return { m_VertexRanges.GetStats(), m_IndexRanges.GetStats(), (unsigned int)m_Meshes.Size(), m_Rebuilds };
+}
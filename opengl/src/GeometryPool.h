@@ -0,0 +1,67 @@
+#pragma once
+
+#include "IndexBuffer.h"
+#include "RangeAllocator.h"
+#include "ResourcePool.h"
+#include "VertexBuffer.h"
+#include "VertexBufferLayout.h"
+
+//where one mesh lives inside the pool's buffers, in vertices and indices (not bytes)
+struct GeometryMesh
+{
+	RangeAllocation Vertices;
+	RangeAllocation Indices;
+};
+
+using GeometryHandle = Handle<GeometryMesh>;
+
+struct GeometryPoolStats
+{
+	RangeAllocatorStats Vertices;
+	RangeAllocatorStats Indices;
+	unsigned int Meshes;
+	unsigned int Rebuilds;              //compactions and grows, each one copies every mesh
+};
+
+//many meshes of one vertex format suballocated out of a single vertex buffer and a single
+//index buffer, drawn through one VAO with glDrawElementsBaseVertex so switching meshes is
+//just a different offset. indices are relative to the mesh's first vertex
+class GeometryPool
+{
+private:
+	VertexBufferLayout m_Layout;
+	unsigned int m_VertexArrayID;
+	VertexBuffer m_Vertices;
+	IndexBuffer m_Indices;
+	RangeAllocator m_VertexRanges;
+	RangeAllocator m_IndexRanges;
+	ResourcePool<GeometryMesh> m_Meshes;
+	unsigned int m_Rebuilds;
+
+	//moves every mesh to the front of freshly allocated buffers of the given capacities
+	void Rebuild(unsigned int vertexCapacity, unsigned int indexCapacity);
+public:
+	GeometryPool(const VertexBufferLayout& layout, unsigned int vertexCapacity, unsigned int indexCapacity);
+	~GeometryPool();
+
+	GeometryPool(const GeometryPool&) = delete;
+	GeometryPool& operator=(const GeometryPool&) = delete;
+
+	//copies the mesh in, growing (and compacting) the buffers when it does not fit.
+	//vertices must match the pool's layout
+	GeometryHandle Add(const void* vertices, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount);
+	void Remove(GeometryHandle handle);
+	const GeometryMesh* Get(GeometryHandle handle);
+
+	//binds the shared VAO, needed once before any number of Draw() calls
+	void Bind() const;
+	void Draw(GeometryHandle handle);
+
+	//closes the holes left by Remove(), offsets change but handles stay valid
+	void Compact();
+
+	GeometryPoolStats GetStats() const;
+	inline const VertexBufferLayout& GetLayout() const { return m_Layout; }
+	inline unsigned int GetVertexBufferID() const { return m_Vertices.GetRendererID(); }
+	inline unsigned int GetIndexBufferID() const { return m_Indices.GetRendererID(); }
+};
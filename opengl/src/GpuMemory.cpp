@@ -0,0 +1,170 @@
+#include "GpuMemory.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+static const char* s_CategoryNames[]{ "Vertex buffers", "Index buffers", "Textures", "Renderbuffers", "Other" };
+
+const char* GetCategoryName(GpuMemoryCategory category)
+{
+    return s_CategoryNames[(int)category];
+}
+
+static unsigned long long MakeKey(GpuMemoryCategory category, unsigned int id)
+{
+    return ((unsigned long long)category << 32) | id;
+}
+
+static double ToMiB(unsigned long long bytes)
+{
+    return bytes / (1024.0 * 1024.0);
+}
+
+GpuMemory::GpuMemory()
+    : m_Categories{}, m_Total{}, m_Serial(0), m_BudgetWarnings(0), m_CaptureSites(false)
+{
+}
+
+GpuMemory& GpuMemory::Get()
+{
+    static GpuMemory s_Instance;
+    return s_Instance;
+}
+
+void GpuMemory::CheckBudget(const CategoryStats& stats, unsigned long long previous, const char* name)
+{
+    //warn once when crossing the budget, again only after dropping back under it
+    if (!stats.Budget || stats.Used <= stats.Budget || previous > stats.Budget)
+        return;
+    m_BudgetWarnings++;
+    std::cout << "GPU MEMORY BUDGET EXCEEDED: " << name << " " << std::fixed << std::setprecision(2)
+        << ToMiB(stats.Used) << " MiB of " << ToMiB(stats.Budget) << " MiB" << std::defaultfloat << std::endl;
+}
+
+void GpuMemory::Track(GpuMemoryCategory category, unsigned int id, unsigned long long size)
+{
+    CallStack site{};
+    if (m_CaptureSites.load(std::memory_order_relaxed))
+        site = CallStack::Capture();
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    CategoryStats& stats{ m_Categories[(int)category] };
+    unsigned long long previous{ stats.Used };
+    unsigned long long previousTotal{ m_Total.Used };
+
+    auto result{ m_Allocations.insert({ MakeKey(category, id), { category, size, m_Serial++, site } }) };
+    if (result.second)
+    {
+        stats.Objects++;
+        m_Total.Objects++;
+    }
+    else
+    {
+        stats.Used -= result.first->second.Size;
+        m_Total.Used -= result.first->second.Size;
+        result.first->second.Size = size;
+    }
+    stats.Used += size;
+    m_Total.Used += size;
+    stats.HighWater = std::max(stats.HighWater, stats.Used);
+    m_Total.HighWater = std::max(m_Total.HighWater, m_Total.Used);
+
+    CheckBudget(stats, previous, GetCategoryName(category));
+    CheckBudget(m_Total, previousTotal, "Total");
+}
+
+void GpuMemory::Untrack(GpuMemoryCategory category, unsigned int id)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto it{ m_Allocations.find(MakeKey(category, id)) };
+    if (it == m_Allocations.end())
+        return;
+    CategoryStats& stats{ m_Categories[(int)category] };
+    stats.Used -= it->second.Size;
+    stats.Objects--;
+    m_Total.Used -= it->second.Size;
+    m_Total.Objects--;
+    m_Allocations.erase(it);
+}
+
+void GpuMemory::SetBudget(GpuMemoryCategory category, unsigned long long bytes)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Categories[(int)category].Budget = bytes;
+    CheckBudget(m_Categories[(int)category], 0, GetCategoryName(category));
+}
+
+void GpuMemory::SetTotalBudget(unsigned long long bytes)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Total.Budget = bytes;
+    CheckBudget(m_Total, 0, "Total");
+}
+
+void GpuMemory::SetCaptureSites(bool capture)
+{
+    m_CaptureSites.store(capture, std::memory_order_relaxed);
+}
+
+GpuMemory::CategoryStats GpuMemory::GetStats(GpuMemoryCategory category) const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Categories[(int)category];
+}
+
+GpuMemory::CategoryStats GpuMemory::GetTotalStats() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Total;
+}
+
+unsigned int GpuMemory::GetBudgetWarnings() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_BudgetWarnings;
+}
+
+static void ReportLine(std::ostream& out, const char* name, const GpuMemory::CategoryStats& stats)
+{
+    out << "  " << std::left << std::setw(16) << name << std::right << std::fixed << std::setprecision(2)
+        << std::setw(10) << ToMiB(stats.Used) << " MiB in " << std::setw(6) << stats.Objects << " objects"
+        << "  high-water " << std::setw(10) << ToMiB(stats.HighWater) << " MiB";
+    if (stats.Budget)
+        out << "  budget " << std::setw(10) << ToMiB(stats.Budget) << " MiB" << (stats.HighWater > stats.Budget ? "  EXCEEDED" : "");
+    out << std::defaultfloat << std::endl;
+}
+
+void GpuMemory::Report(std::ostream& out) const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    out << "GPU memory (" << m_BudgetWarnings << " budget warnings)" << std::endl;
+    for (int i = 0; i < (int)GpuMemoryCategory::Count; i++)
+        ReportLine(out, s_CategoryNames[i], m_Categories[i]);
+    ReportLine(out, "Total", m_Total);
+}
+
+size_t GpuMemory::ReportLeaks(std::ostream& out) const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (m_Allocations.empty())
+        return 0;
+
+    std::vector<std::pair<unsigned long long, const Allocation*>> leaks;
+    leaks.reserve(m_Allocations.size());
+    for (const auto& entry : m_Allocations)
+        leaks.push_back({ entry.first, &entry.second });
+    std::sort(leaks.begin(), leaks.end(), [](const auto& a, const auto& b) { return a.second->Serial < b.second->Serial; });
+
+    out << "GPU MEMORY LEAKS: " << leaks.size() << " objects, " << ToMiB(m_Total.Used) << " MiB still alive" << std::endl;
+    for (const auto& leak : leaks)
+    {
+        const Allocation& allocation{ *leak.second };
+        out << "  " << GetCategoryName(allocation.Category) << " " << (unsigned int)(leak.first & 0xffffffffu)
+            << ", " << allocation.Size << " bytes, created at:" << std::endl;
+        //skip Capture() and Track()
+        allocation.Site.Print(out, 2);
+    }
+    return leaks.size();
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "CallStack.h"
+
+#include <atomic>
+#include <iosfwd>
+#include <mutex>
+#include <unordered_map>
+
+enum class GpuMemoryCategory
+{
+	VertexBuffer = 0, IndexBuffer, Texture, Renderbuffer, Other, Count
+};
+
+const char* GetCategoryName(GpuMemoryCategory category);
+
+//ledger of every GL object that owns video memory. whoever calls glBufferData/glTexStorage/
+//glRenderbufferStorage tracks the object here and untracks it right before deleting it.
+//budgets only warn, they never refuse an allocation
+class GpuMemory
+{
+public:
+	struct CategoryStats
+	{
+		unsigned long long Used;
+		unsigned long long HighWater;
+		unsigned long long Budget;      //0 == no budget
+		unsigned long long Objects;
+	};
+private:
+	struct Allocation
+	{
+		GpuMemoryCategory Category;
+		unsigned long long Size;
+		unsigned long long Serial;      //creation order, for the leak report
+		CallStack Site;
+	};
+
+	mutable std::mutex m_Mutex;
+	std::unordered_map<unsigned long long, Allocation> m_Allocations;    //key: category << 32 | GL name
+	CategoryStats m_Categories[(int)GpuMemoryCategory::Count];
+	CategoryStats m_Total;
+	unsigned long long m_Serial;
+	unsigned int m_BudgetWarnings;
+	std::atomic<bool> m_CaptureSites;       //read by Track() outside the lock
+
+	GpuMemory();
+
+	void CheckBudget(const CategoryStats& stats, unsigned long long previous, const char* name);
+public:
+	static GpuMemory& Get();
+
+	//tracking the same object again replaces its size (glBufferData on an existing buffer)
+	void Track(GpuMemoryCategory category, unsigned int id, unsigned long long size);
+	void Untrack(GpuMemoryCategory category, unsigned int id);
+
+	void SetBudget(GpuMemoryCategory category, unsigned long long bytes);
+	void SetTotalBudget(unsigned long long bytes);
+	//call stacks of the creation sites for the leak report. off by default, a backtrace on every
+	//Track() costs too much for buffers created at runtime; without it leaks are listed without sites
+	void SetCaptureSites(bool capture);
+
+	CategoryStats GetStats(GpuMemoryCategory category) const;
+	CategoryStats GetTotalStats() const;
+	unsigned int GetBudgetWarnings() const;
+
+	//usage, high-water mark and budget per category
+	void Report(std::ostream& out) const;
+	//lists every object still tracked with its creation site, returns how many there are
+	size_t ReportLeaks(std::ostream& out) const;
+};
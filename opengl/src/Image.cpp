@@ -0,0 +1,223 @@
+#include "Image.h"
+#include "FileSystem.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iostream>
+
+static void FlipRows(Image& image)
+{
+    size_t rowSize{ image.GetRowSize() };
+    for (unsigned int y = 0; y < image.Height / 2; y++)
+    {
+        unsigned char* top{ image.Pixels.data() + y * rowSize };
+        unsigned char* bottom{ image.Pixels.data() + (image.Height - 1 - y) * rowSize };
+        std::swap_ranges(top, top + rowSize, bottom);
+    }
+}
+
+//gray, BGR or BGRA source pixel to RGBA
+static void StorePixel(const unsigned char* src, unsigned int bytesPerPixel, unsigned char* dst)
+{
+    if (bytesPerPixel == 1)
+    {
+        dst[0] = dst[1] = dst[2] = src[0];
+        dst[3] = 255;
+        return;
+    }
+    dst[0] = src[2];
+    dst[1] = src[1];
+    dst[2] = src[0];
+    dst[3] = bytesPerPixel == 4 ? src[3] : 255;
+}
+
+static bool DecodeTga(const unsigned char* data, size_t size, Image& image)
+{
+    if (size < 18)
+        return false;
+    unsigned int idLength{ data[0] };
+    if (size < 18 + (size_t)idLength)
+        return false;       //truncated inside the image id
+    unsigned int colorMapType{ data[1] };
+    unsigned int imageType{ data[2] };
+    unsigned int width{ (unsigned int)(data[12] | (data[13] << 8)) };
+    unsigned int height{ (unsigned int)(data[14] | (data[15] << 8)) };
+    unsigned int bytesPerPixel{ data[16] / 8u };
+    bool topDown{ (data[17] & 0x20) != 0 };
+    bool rle{ imageType == 10 || imageType == 11 };
+    bool gray{ imageType == 3 || imageType == 11 };
+
+    if (colorMapType != 0 || (imageType != 2 && imageType != 3 && !rle) || !width || !height)
+    {
+        std::cout << "Unsupported TGA (type " << imageType << ", color map " << colorMapType << ")" << std::endl;
+        return false;
+    }
+    if (gray ? bytesPerPixel != 1 : (bytesPerPixel != 3 && bytesPerPixel != 4))
+    {
+        std::cout << "Unsupported TGA pixel depth " << (unsigned int)data[16] << std::endl;
+        return false;
+    }
+
+    //the header alone may claim 65535x65535, check the data can hold that many pixels before
+    //allocating them. an rle packet covers at most 128 pixels for every byte
+    const unsigned char* src{ data + 18 + idLength };
+    const unsigned char* end{ data + size };
+    size_t pixels{ (size_t)width * height };
+    if (rle ? pixels > (size_t)(end - src) * 128 : (size_t)(end - src) < pixels * bytesPerPixel)
+        return false;
+
+    image.Width = width;
+    image.Height = height;
+    image.Pixels.resize(pixels * 4);
+    unsigned char* dst{ image.Pixels.data() };
+    if (!rle)
+    {
+        for (size_t i = 0; i < pixels; i++, src += bytesPerPixel, dst += 4)
+            StorePixel(src, bytesPerPixel, dst);
+    }
+    else
+    {
+        //packets: header bit 7 set == one pixel repeated, else that many raw pixels
+        size_t written{ 0 };
+        while (written < pixels)
+        {
+            if (src >= end)
+                return false;
+            unsigned int header{ *src++ };
+            size_t count{ std::min<size_t>((header & 0x7f) + 1, pixels - written) };
+            if (header & 0x80)
+            {
+                if ((size_t)(end - src) < bytesPerPixel)
+                    return false;
+                for (size_t i = 0; i < count; i++, dst += 4)
+                    StorePixel(src, bytesPerPixel, dst);
+                src += bytesPerPixel;
+            }
+            else
+            {
+                if ((size_t)(end - src) < count * bytesPerPixel)
+                    return false;
+                for (size_t i = 0; i < count; i++, src += bytesPerPixel, dst += 4)
+                    StorePixel(src, bytesPerPixel, dst);
+            }
+            written += count;
+        }
+    }
+
+    if (topDown)
+        FlipRows(image);
+    return true;
+}
+
+//whitespace and # comments between the header fields
+static bool ReadPnmValue(const unsigned char*& cursor, const unsigned char* end, unsigned int& value)
+{
+    while (cursor < end && (std::isspace(*cursor) || *cursor == '#'))
+    {
+        if (*cursor == '#')
+        {
+            while (cursor < end && *cursor != '\n')
+                cursor++;
+        }
+        else
+            cursor++;
+    }
+    if (cursor >= end || !std::isdigit(*cursor))
+        return false;
+    value = 0;
+    while (cursor < end && std::isdigit(*cursor))
+        value = value * 10 + (*cursor++ - '0');
+    return true;
+}
+
+static bool DecodePnm(const unsigned char* data, size_t size, Image& image)
+{
+    unsigned int channels{ data[1] == '6' ? 3u : 1u };
+    const unsigned char* cursor{ data + 2 };
+    const unsigned char* end{ data + size };
+    unsigned int width, height, maxValue;
+    if (!ReadPnmValue(cursor, end, width) || !ReadPnmValue(cursor, end, height) || !ReadPnmValue(cursor, end, maxValue))
+        return false;
+    if (maxValue == 0 || maxValue > 255 || !width || !height)
+    {
+        std::cout << "Unsupported PNM (max value " << maxValue << ")" << std::endl;
+        return false;
+    }
+    //single whitespace before the raster
+    if (cursor >= end)
+        return false;
+    cursor++;
+
+    size_t pixels{ (size_t)width * height };
+    size_t remaining{ (size_t)(end - cursor) };
+    if (remaining / channels < pixels)
+        return false;
+
+    image.Width = width;
+    image.Height = height;
+    image.Pixels.resize(pixels * 4);
+    unsigned char* dst{ image.Pixels.data() };
+    for (size_t i = 0; i < pixels; i++, cursor += channels, dst += 4)
+    {
+        for (unsigned int c = 0; c < 3; c++)
+            dst[c] = (unsigned char)(cursor[channels == 3 ? c : 0] * 255u / maxValue);
+        dst[3] = 255;
+    }
+    //pnm rows go top to bottom
+    FlipRows(image);
+    return true;
+}
+
+bool DecodeImage(const unsigned char* data, size_t size, Image& image)
+{
+    image = Image();
+    //tga has no magic number, pnm starts with P5/P6
+    bool decoded{ size >= 2 && data[0] == 'P' && (data[1] == '5' || data[1] == '6')
+        ? DecodePnm(data, size, image)
+        : DecodeTga(data, size, image) };
+    if (!decoded)
+        image = Image();
+    return decoded;
+}
+
+bool DecodeImage(const std::string& filepath, Image& image)
+{
+    VirtualFile file;
+    if (!FileSystem::Get().Open(filepath, file))
+    {
+        std::cout << "Failed to open image " << filepath << std::endl;
+        image = Image();
+        return false;
+    }
+
+    if (!DecodeImage(file.GetData(), file.GetSize(), image))
+    {
+        std::cout << "Failed to decode image " << filepath << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool WriteTga(const std::string& filepath, const Image& image)
+{
+    std::ofstream stream(filepath, std::ios::binary);
+    if (!stream || !image.IsValid())
+        return false;
+
+    unsigned char header[18]{};
+    header[2] = 2;
+    header[12] = (unsigned char)(image.Width & 0xff);
+    header[13] = (unsigned char)(image.Width >> 8);
+    header[14] = (unsigned char)(image.Height & 0xff);
+    header[15] = (unsigned char)(image.Height >> 8);
+    header[16] = 32;
+    header[17] = 8;     //8 alpha bits, bottom-up like our pixels
+    stream.write((const char*)header, sizeof(header));
+
+    std::vector<unsigned char> bgra(image.Pixels);
+    for (size_t i = 0; i < bgra.size(); i += 4)
+        std::swap(bgra[i], bgra[i + 2]);
+    stream.write((const char*)bgra.data(), bgra.size());
+    return (bool)stream;
+}
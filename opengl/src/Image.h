@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+//8 bit RGBA pixels, rows stored bottom to top the way glTexSubImage2D expects them
+struct Image
+{
+	unsigned int Width { 0 };
+	unsigned int Height { 0 };
+	std::vector<unsigned char> Pixels;  //Width * Height * 4
+
+	inline bool IsValid() const { return Width && Height; }
+	inline size_t GetRowSize() const { return (size_t)Width * 4; }
+	inline size_t GetSize() const { return Pixels.size(); }
+};
+
+//.tga (true color/grayscale, raw or RLE) and binary .ppm/.pgm. safe to call from any thread,
+//failures print why on std::cout and leave the image empty
+bool DecodeImage(const std::string& filepath, Image& image);
+bool DecodeImage(const unsigned char* data, size_t size, Image& image);
+
+//uncompressed 32 bit .tga, mostly for generating test assets
+bool WriteTga(const std::string& filepath, const Image& image);
@@ -1,8 +1,9 @@
 #include "IndexBuffer.h"
 #include "Renderer.h"
+#include "GpuMemory.h"
 
 
-IndexBuffer::IndexBuffer(const unsigned int* data, unsigned int count)
+IndexBuffer::IndexBuffer(const unsigned int* data, unsigned int count, bool dynamic)
     : m_Count(count)
 {
     ASSERT(sizeof(unsigned int) == sizeof(GLuint));
@@ -10,12 +11,44 @@ IndexBuffer::IndexBuffer(const unsigned int* data, unsigned int count)
 
     GLCall(glGenBuffers(1, &m_RendererID));                                       //sending the address of buffer to fill with and ID of 1
     GLCall(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_RendererID));                          //<--- create buffer of memory and then put data in buffer
-    GLCall(glBufferData(GL_ELEMENT_ARRAY_BUFFER, count * sizeof(unsigned int), data, GL_STATIC_DRAW));
+    GLCall(glBufferData(GL_ELEMENT_ARRAY_BUFFER, count * sizeof(unsigned int), data, dynamic ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW));
+    GpuMemory::Get().Track(GpuMemoryCategory::IndexBuffer, m_RendererID, count * sizeof(unsigned int));
     //^^^^ == (target, size, data, usage) 6 vertices to make triangle, 12 to make square
+    if (dynamic)
+        m_Shadow = std::make_unique<BufferShadow>(data, count * sizeof(unsigned int));
 }
 IndexBuffer::~IndexBuffer()
 {
-    GLCall(glDeleteBuffers(1, &m_RendererID));
+    if (m_RendererID)
+    {
+        GpuMemory::Get().Untrack(GpuMemoryCategory::IndexBuffer, m_RendererID);
+        GLCall(glDeleteBuffers(1, &m_RendererID));
+    }
+}
+
+IndexBuffer::IndexBuffer(IndexBuffer&& other) noexcept
+    : m_RendererID(other.m_RendererID), m_Count(other.m_Count), m_Shadow(std::move(other.m_Shadow))
+{
+    other.m_RendererID = 0;
+    other.m_Count = 0;
+}
+
+IndexBuffer& IndexBuffer::operator=(IndexBuffer&& other) noexcept
+{
+    if (this != &other)
+    {
+        if (m_RendererID)
+        {
+            GpuMemory::Get().Untrack(GpuMemoryCategory::IndexBuffer, m_RendererID);
+            GLCall(glDeleteBuffers(1, &m_RendererID));
+        }
+        m_RendererID = other.m_RendererID;
+        m_Count = other.m_Count;
+        m_Shadow = std::move(other.m_Shadow);
+        other.m_RendererID = 0;
+        other.m_Count = 0;
+    }
+    return *this;
 }
 
 void IndexBuffer::Bind() const
@@ -25,4 +58,19 @@ void IndexBuffer::Bind() const
 void IndexBuffer::Unbind() const
 {
     GLCall(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
-}
\ No newline at end of file
+}
+
+void IndexBuffer::Update(unsigned int first, const unsigned int* data, unsigned int count)
+{
+    ASSERT((unsigned long long)first + count <= m_Count);
+    if (m_Shadow)
+        m_Shadow->Write(first * sizeof(unsigned int), data, count * sizeof(unsigned int));
+    else
+        BufferShadow::Upload(m_RendererID, first * sizeof(unsigned int), data, count * sizeof(unsigned int));
+}
+
+unsigned int IndexBuffer::Flush()
+{
+    //binding GL_ELEMENT_ARRAY_BUFFER would change whatever VAO is bound, use the copy target
+    return m_Shadow ? m_Shadow->Flush(GL_COPY_WRITE_BUFFER, m_RendererID) : 0;
+}
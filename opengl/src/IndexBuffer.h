@@ -1,17 +1,38 @@
 #pragma once
 
+#include <memory>
+
+#include "BufferShadow.h"
+
 class IndexBuffer
 {
 private:
 	unsigned int m_RendererID;
 	unsigned int m_Count;
 	//size == bytes, count == element count
+	std::unique_ptr<BufferShadow> m_Shadow;     //only for dynamic buffers
 public:
-	IndexBuffer(const unsigned int* data, unsigned int count);
+	//dynamic buffers keep a CPU copy; Update() only marks indices dirty and Flush() uploads them
+	IndexBuffer(const unsigned int* data, unsigned int count, bool dynamic = false);
 	~IndexBuffer();
 
+	//owns a GL buffer name, so it can be moved but never copied
+	IndexBuffer(const IndexBuffer&) = delete;
+	IndexBuffer& operator=(const IndexBuffer&) = delete;
+	IndexBuffer(IndexBuffer&& other) noexcept;
+	IndexBuffer& operator=(IndexBuffer&& other) noexcept;
+
 	void Bind() const;
 	void Unbind() const;
 
+	//in indices, not bytes. static buffers upload right away, dynamic ones on the next Flush()
+	void Update(unsigned int first, const unsigned int* data, unsigned int count);
+	//returns the number of bytes uploaded
+	unsigned int Flush();
+
+	inline bool IsDynamic() const { return m_Shadow != nullptr; }
+	inline bool IsDirty() const { return m_Shadow && m_Shadow->IsDirty(); }
+
 	inline unsigned int GetCount() const { return m_Count; }
+	inline unsigned int GetRendererID() const { return m_RendererID; }
 };
\ No newline at end of file
@@ -0,0 +1,66 @@
+#include "InstanceBuffer.h"
+
+#include "Renderer.h"
+
+#include <algorithm>
+
+static const ProfilerCounter s_InstanceChunksUploaded("Instance chunks uploaded");
+
+InstanceBuffer::InstanceBuffer(unsigned int componentType, const VertexBufferLayout& layout, unsigned int firstAttribute)
+    : m_Type(componentType), m_Layout(layout), m_FirstAttribute(firstAttribute), m_Version(0), m_Synced(false)
+{
+    unsigned int stride{ ComponentTypes::Get(componentType).Size };
+    ASSERT(layout.GetStride() == stride);
+    //no archetype with the component fits more rows than one with only it
+    m_RegionBytes = Chunk::s_Bytes / (unsigned int)(sizeof(Entity) + stride) * stride;
+}
+
+unsigned int InstanceBuffer::Sync(EntityManager& entities)
+{
+    //one region per chunk id, ids only grow past the count the manager ever needed
+    unsigned int regions{ entities.GetChunkIdCount() };
+    bool full{ !m_Synced };
+    if (!m_Buffer || m_Buffer->GetSize() < regions * m_RegionBytes)
+    {
+        unsigned int capacity{ std::max(regions, m_Buffer ? m_Buffer->GetSize() / m_RegionBytes * 2 : 4u) };
+        m_Buffer = std::make_unique<VertexBuffer>(nullptr, capacity * m_RegionBytes, true);
+        full = true;
+    }
+
+    std::fill(m_Counts.begin(), m_Counts.end(), 0);
+    m_Counts.resize(regions, 0);
+    unsigned int stride{ m_Layout.GetStride() };
+    entities.VisitChunks(ComponentMask{ 1 } << m_Type, [&](const Chunk& chunk) {
+        m_Counts[chunk.GetId()] = chunk.GetCount();
+        if (!full && !chunk.DidChange(m_Type, m_Version))
+            return;
+        m_Buffer->Update(chunk.GetId() * m_RegionBytes, chunk.GetColumn(m_Type), chunk.GetCount() * stride);
+        s_InstanceChunksUploaded.Increment();
+    });
+
+    m_Version = entities.AdvanceVersion();
+    m_Synced = true;
+    return m_Buffer->Flush();
+}
+
+void InstanceBuffer::Draw(unsigned int indexCount)
+{
+    if (!m_Buffer)
+        return;
+    m_Buffer->Bind();
+    for (unsigned int id = 0; id < m_Counts.size(); id++)
+    {
+        if (m_Counts[id] == 0)
+            continue;
+        m_Layout.Apply(m_FirstAttribute, (unsigned long long)id * m_RegionBytes, 1);
+        GLCall(glDrawElementsInstanced(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, nullptr, m_Counts[id]));
+    }
+}
+
+unsigned int InstanceBuffer::GetInstanceCount() const
+{
+    unsigned int count{ 0 };
+    for (unsigned int chunkCount : m_Counts)
+        count += chunkCount;
+    return count;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "EntityManager.h"
+#include "VertexBuffer.h"
+#include "VertexBufferLayout.h"
+
+#include <memory>
+#include <vector>
+
+//per-instance vertex data straight from an ECS component (a world matrix, a tint, ...) for every
+//entity that has it. each chunk owns a fixed region of one dynamic vertex buffer, found by its
+//chunk id, so Sync() rewrites only the chunks whose component array or entities changed since
+//the previous Sync() and the buffer's dirty ranges upload just those. Draw() issues one
+//instanced draw per chunk. GL thread only
+class InstanceBuffer
+{
+private:
+	unsigned int m_Type;
+	VertexBufferLayout m_Layout;
+	unsigned int m_FirstAttribute;
+	unsigned int m_RegionBytes;                 //the largest chunk of the component, in bytes
+	std::unique_ptr<VertexBuffer> m_Buffer;
+	std::vector<unsigned int> m_Counts;         //instances per chunk id as of the last Sync()
+	unsigned int m_Version;                     //AdvanceVersion() of the last Sync()
+	bool m_Synced;
+public:
+	//layout describes one component, attributes firstAttribute.. of the shader read it
+	InstanceBuffer(unsigned int componentType, const VertexBufferLayout& layout, unsigned int firstAttribute);
+
+	InstanceBuffer(const InstanceBuffer&) = delete;
+	InstanceBuffer& operator=(const InstanceBuffer&) = delete;
+
+	//copies what changed and flushes, returns the bytes uploaded. advances the manager's
+	//version, so one InstanceBuffer per manager and component
+	unsigned int Sync(EntityManager& entities);
+
+	//instanced draws of the currently bound vertex array and index buffer (with the mesh's
+	//layout applied), indexCount indices per instance
+	void Draw(unsigned int indexCount);
+
+	unsigned int GetInstanceCount() const;
+};
@@ -0,0 +1,298 @@
+#include "Json.h"
+
+#include <charconv>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+    //recursive descent over the text, nesting is capped so hostile files cannot blow the stack
+    class JsonParser
+    {
+    private:
+        static constexpr unsigned int s_MaxDepth{ 256 };
+
+        const char* m_Begin;
+        const char* m_Current;
+        const char* m_End;
+        const char* m_Error;
+
+        bool Fail(const char* message)
+        {
+            if (!m_Error)
+                m_Error = message;
+            return false;
+        }
+
+        void SkipSpace()
+        {
+            while (m_Current < m_End && (*m_Current == ' ' || *m_Current == '\t' || *m_Current == '\n' || *m_Current == '\r'))
+                m_Current++;
+        }
+
+        bool Literal(const char* word)
+        {
+            size_t length{ std::strlen(word) };
+            if ((size_t)(m_End - m_Current) < length || std::memcmp(m_Current, word, length) != 0)
+                return Fail("unknown literal");
+            m_Current += length;
+            return true;
+        }
+
+        bool Hex4(unsigned int& code)
+        {
+            if (m_End - m_Current < 4)
+                return Fail("truncated \\u escape");
+            code = 0;
+            for (unsigned int i = 0; i < 4; i++)
+            {
+                char c{ *m_Current++ };
+                code <<= 4;
+                if (c >= '0' && c <= '9') code |= c - '0';
+                else if (c >= 'a' && c <= 'f') code |= c - 'a' + 10;
+                else if (c >= 'A' && c <= 'F') code |= c - 'A' + 10;
+                else return Fail("bad \\u escape");
+            }
+            return true;
+        }
+
+        static void AppendUtf8(std::string& out, unsigned int code)
+        {
+            if (code < 0x80)
+                out += (char)code;
+            else if (code < 0x800)
+            {
+                out += (char)(0xc0 | (code >> 6));
+                out += (char)(0x80 | (code & 0x3f));
+            }
+            else if (code < 0x10000)
+            {
+                out += (char)(0xe0 | (code >> 12));
+                out += (char)(0x80 | ((code >> 6) & 0x3f));
+                out += (char)(0x80 | (code & 0x3f));
+            }
+            else
+            {
+                out += (char)(0xf0 | (code >> 18));
+                out += (char)(0x80 | ((code >> 12) & 0x3f));
+                out += (char)(0x80 | ((code >> 6) & 0x3f));
+                out += (char)(0x80 | (code & 0x3f));
+            }
+        }
+
+        bool ParseString(std::string& out)
+        {
+            m_Current++;    //opening quote
+            out.clear();
+            while (true)
+            {
+                //copy runs without escapes in one go
+                const char* run{ m_Current };
+                while (m_Current < m_End && *m_Current != '"' && *m_Current != '\\' && (unsigned char)*m_Current >= 0x20)
+                    m_Current++;
+                out.append(run, m_Current);
+                if (m_Current == m_End)
+                    return Fail("unterminated string");
+                char c{ *m_Current++ };
+                if (c == '"')
+                    return true;
+                if (c != '\\')
+                    return Fail("control character in string");
+                if (m_Current == m_End)
+                    return Fail("unterminated string");
+                switch (*m_Current++)
+                {
+                    case '"':   out += '"'; break;
+                    case '\\':  out += '\\'; break;
+                    case '/':   out += '/'; break;
+                    case 'b':   out += '\b'; break;
+                    case 'f':   out += '\f'; break;
+                    case 'n':   out += '\n'; break;
+                    case 'r':   out += '\r'; break;
+                    case 't':   out += '\t'; break;
+                    case 'u':
+                    {
+                        unsigned int code;
+                        if (!Hex4(code))
+                            return false;
+                        //a surrogate pair encodes one code point above the BMP
+                        if (code >= 0xd800 && code < 0xdc00 && m_End - m_Current >= 6 && m_Current[0] == '\\' && m_Current[1] == 'u')
+                        {
+                            m_Current += 2;
+                            unsigned int low;
+                            if (!Hex4(low))
+                                return false;
+                            if (low >= 0xdc00 && low < 0xe000)
+                                code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                        }
+                        AppendUtf8(out, code);
+                        break;
+                    }
+                    default:
+                        return Fail("unknown escape");
+                }
+            }
+        }
+
+        bool ParseNumber(double& out)
+        {
+            const char* start{ m_Current };
+            //from_chars takes no leading '+' and neither does JSON, but it does take "inf"/"nan"
+            if (m_Current < m_End && *m_Current == '-')
+                m_Current++;
+            if (m_Current == m_End || *m_Current < '0' || *m_Current > '9')
+                return Fail("bad number");
+            std::from_chars_result result{ std::from_chars(start, m_End, out) };
+            if (result.ec != std::errc())
+                return Fail("bad number");
+            m_Current = result.ptr;
+            return true;
+        }
+
+        bool ParseValue(JsonValue& value, unsigned int depth)
+        {
+            if (depth > s_MaxDepth)
+                return Fail("nested too deep");
+            SkipSpace();
+            if (m_Current == m_End)
+                return Fail("unexpected end");
+            switch (*m_Current)
+            {
+                case '{':
+                {
+                    value.Kind = JsonValue::Type::Object;
+                    m_Current++;
+                    SkipSpace();
+                    if (m_Current < m_End && *m_Current == '}')
+                    {
+                        m_Current++;
+                        return true;
+                    }
+                    while (true)
+                    {
+                        SkipSpace();
+                        if (m_Current == m_End || *m_Current != '"')
+                            return Fail("expected a member name");
+                        value.Object.emplace_back();
+                        if (!ParseString(value.Object.back().first))
+                            return false;
+                        SkipSpace();
+                        if (m_Current == m_End || *m_Current++ != ':')
+                            return Fail("expected ':'");
+                        if (!ParseValue(value.Object.back().second, depth + 1))
+                            return false;
+                        SkipSpace();
+                        if (m_Current < m_End && *m_Current == ',')
+                        {
+                            m_Current++;
+                            continue;
+                        }
+                        if (m_Current < m_End && *m_Current == '}')
+                        {
+                            m_Current++;
+                            return true;
+                        }
+                        return Fail("expected ',' or '}'");
+                    }
+                }
+                case '[':
+                {
+                    value.Kind = JsonValue::Type::Array;
+                    m_Current++;
+                    SkipSpace();
+                    if (m_Current < m_End && *m_Current == ']')
+                    {
+                        m_Current++;
+                        return true;
+                    }
+                    while (true)
+                    {
+                        value.Array.emplace_back();
+                        if (!ParseValue(value.Array.back(), depth + 1))
+                            return false;
+                        SkipSpace();
+                        if (m_Current < m_End && *m_Current == ',')
+                        {
+                            m_Current++;
+                            continue;
+                        }
+                        if (m_Current < m_End && *m_Current == ']')
+                        {
+                            m_Current++;
+                            return true;
+                        }
+                        return Fail("expected ',' or ']'");
+                    }
+                }
+                case '"':
+                    value.Kind = JsonValue::Type::String;
+                    return ParseString(value.String);
+                case 't':
+                    value.Kind = JsonValue::Type::Bool;
+                    value.Bool = true;
+                    return Literal("true");
+                case 'f':
+                    value.Kind = JsonValue::Type::Bool;
+                    value.Bool = false;
+                    return Literal("false");
+                case 'n':
+                    value.Kind = JsonValue::Type::Null;
+                    return Literal("null");
+                default:
+                    value.Kind = JsonValue::Type::Number;
+                    return ParseNumber(value.Number);
+            }
+        }
+    public:
+        JsonParser(const char* text, size_t size)
+            : m_Begin(text), m_Current(text), m_End(text + size), m_Error(nullptr)
+        {
+        }
+
+        bool Parse(JsonValue& value)
+        {
+            if (!ParseValue(value, 0))
+                return false;
+            SkipSpace();
+            return m_Current == m_End || Fail("trailing characters");
+        }
+
+        inline const char* GetError() const { return m_Error; }
+        inline size_t GetOffset() const { return (size_t)(m_Current - m_Begin); }
+    };
+
+}
+
+const JsonValue* JsonValue::Find(const char* key) const
+{
+    for (const std::pair<std::string, JsonValue>& member : Object)
+    {
+        if (member.first == key)
+            return &member.second;
+    }
+    return nullptr;
+}
+
+double JsonValue::GetNumber(const char* key, double fallback) const
+{
+    const JsonValue* member{ Find(key) };
+    return member && member->IsNumber() ? member->Number : fallback;
+}
+
+const std::string& JsonValue::GetString(const char* key) const
+{
+    static const std::string s_Empty;
+    const JsonValue* member{ Find(key) };
+    return member && member->IsString() ? member->String : s_Empty;
+}
+
+bool ParseJson(const char* text, size_t size, JsonValue& value)
+{
+    value = JsonValue();
+    JsonParser parser(text, size);
+    if (parser.Parse(value))
+        return true;
+    std::cout << "JSON error at byte " << parser.GetOffset() << ": " << parser.GetError() << std::endl;
+    value = JsonValue();
+    return false;
+}
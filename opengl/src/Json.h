@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+//a parsed JSON document. objects keep their members in file order and lookups are linear,
+//which is fine for the small objects of asset headers like glTF
+struct JsonValue
+{
+	enum class Type
+	{
+		Null, Bool, Number, String, Array, Object
+	};
+
+	Type Kind { Type::Null };
+	bool Bool { false };
+	double Number { 0.0 };
+	std::string String;
+	std::vector<JsonValue> Array;
+	std::vector<std::pair<std::string, JsonValue>> Object;
+
+	//nullptr when this is not an object or has no such member
+	const JsonValue* Find(const char* key) const;
+	//the member's value, or fallback when it is missing or of another type
+	double GetNumber(const char* key, double fallback = 0.0) const;
+	const std::string& GetString(const char* key) const;
+
+	inline bool IsNull() const { return Kind == Type::Null; }
+	inline bool IsNumber() const { return Kind == Type::Number; }
+	inline bool IsString() const { return Kind == Type::String; }
+	inline bool IsArray() const { return Kind == Type::Array; }
+	inline bool IsObject() const { return Kind == Type::Object; }
+};
+
+//RFC 8259 JSON, strings come back as UTF-8. false (and prints where) on malformed input
+bool ParseJson(const char* text, size_t size, JsonValue& value);
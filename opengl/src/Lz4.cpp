@@ -0,0 +1,185 @@
+#include "Lz4.h"
+
+#include <cstring>
+
+namespace {
+
+    constexpr unsigned int s_MinMatch{ 4 };
+    constexpr unsigned int s_HashBits{ 14 };
+    constexpr size_t s_MaxOffset{ 65535 };
+    //the format wants the last 5 bytes as literals and no match starting in the last 12
+    constexpr size_t s_LastLiterals{ 5 };
+    constexpr size_t s_MatchLimit{ 12 };
+
+    inline unsigned int Read32(const unsigned char* p)
+    {
+        unsigned int value;
+        std::memcpy(&value, p, 4);
+        return value;
+    }
+
+    inline unsigned int Hash(unsigned int sequence)
+    {
+        return (sequence * 2654435761u) >> (32 - s_HashBits);
+    }
+
+    //a length past the 4 bits of the token: runs of 255 and the rest
+    void WriteLength(std::vector<unsigned char>& out, size_t length)
+    {
+        for (; length >= 255; length -= 255)
+            out.push_back(255);
+        out.push_back((unsigned char)length);
+    }
+
+    void WriteSequence(std::vector<unsigned char>& out, const unsigned char* literals, size_t literalCount,
+        size_t offset, size_t matchLength)
+    {
+        size_t token{ out.size() };
+        out.push_back(0);
+        unsigned char code{ (unsigned char)((literalCount < 15 ? literalCount : 15) << 4) };
+        if (literalCount >= 15)
+            WriteLength(out, literalCount - 15);
+        out.insert(out.end(), literals, literals + literalCount);
+        if (matchLength)
+        {
+            out.push_back((unsigned char)(offset & 0xff));
+            out.push_back((unsigned char)(offset >> 8));
+            size_t length{ matchLength - s_MinMatch };
+            code |= (unsigned char)(length < 15 ? length : 15);
+            if (length >= 15)
+                WriteLength(out, length - 15);
+        }
+        out[token] = code;
+    }
+
+    //false when the length runs past end
+    inline bool ReadLength(const unsigned char*& p, const unsigned char* end, size_t& length)
+    {
+        unsigned char byte;
+        do
+        {
+            if (p == end)
+                return false;
+            byte = *p++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    }
+
+}
+
+void Lz4Compress(const unsigned char* data, size_t size, std::vector<unsigned char>& out)
+{
+    out.clear();
+    out.reserve(size + size / 255 + 16);
+    size_t anchor{ 0 };
+    if (size > s_MatchLimit)
+    {
+        //positions + 1, 0 is an empty slot
+        std::vector<unsigned int> table((size_t)1 << s_HashBits, 0);
+        size_t limit{ size - s_MatchLimit };
+        size_t i{ 0 };
+        while (i <= limit)
+        {
+            unsigned int sequence{ Read32(data + i) };
+            unsigned int& slot{ table[Hash(sequence)] };
+            size_t candidate{ (size_t)slot - 1 };
+            slot = (unsigned int)(i + 1);
+            if (candidate == (size_t)-1 || i - candidate > s_MaxOffset || Read32(data + candidate) != sequence)
+            {
+                //skip faster through data that does not compress
+                i += 1 + ((i - anchor) >> 6);
+                continue;
+            }
+
+            //extend backwards over literals and forwards up to the last literals
+            while (i > anchor && candidate > 0 && data[i - 1] == data[candidate - 1])
+            {
+                i--;
+                candidate--;
+            }
+            size_t end{ i + s_MinMatch };
+            while (end < size - s_LastLiterals && data[end] == data[candidate + end - i])
+                end++;
+
+            WriteSequence(out, data + anchor, i - anchor, i - candidate, end - i);
+            anchor = end;
+            i = end;
+            if (i - 2 <= limit)
+                table[Hash(Read32(data + i - 2))] = (unsigned int)(i - 2 + 1);
+        }
+    }
+    WriteSequence(out, data + anchor, size - anchor, 0, 0);
+}
+
+bool Lz4Decompress(unsigned char* out, size_t outSize, const unsigned char* data, size_t size)
+{
+    const unsigned char* p{ data };
+    const unsigned char* end{ data + size };
+    unsigned char* o{ out };
+    unsigned char* oend{ out + outSize };
+    while (p < end)
+    {
+        unsigned char token{ *p++ };
+        size_t literals{ (size_t)(token >> 4) };
+        size_t offset;
+        size_t length{ (size_t)(token & 15) };
+        //most sequences are short: with room on both sides both halves are fixed size copies,
+        //at most 14 literals and an 18 byte match
+        if (literals != 15 && length != 15 && end - p >= 18 && oend - o >= 32)
+        {
+            std::memcpy(o, p, 16);
+            o += literals;
+            p += literals;
+            offset = (size_t)p[0] | (size_t)p[1] << 8;
+            p += 2;
+            if (offset >= 8 && offset <= (size_t)(o - out))
+            {
+                //8 byte steps never read bytes this copy has yet to write
+                const unsigned char* match{ o - offset };
+                std::memcpy(o, match, 8);
+                std::memcpy(o + 8, match + 8, 8);
+                std::memcpy(o + 16, match + 16, 2);
+                o += length + s_MinMatch;
+                continue;
+            }
+        }
+        else
+        {
+            if (literals == 15 && !ReadLength(p, end, literals))
+                return false;
+            if (literals > (size_t)(end - p) || literals > (size_t)(oend - o))
+                return false;
+            std::memcpy(o, p, literals);
+            o += literals;
+            p += literals;
+
+            //the last sequence has no match
+            if (p == end)
+                break;
+            if (end - p < 2)
+                return false;
+            offset = (size_t)p[0] | (size_t)p[1] << 8;
+            p += 2;
+            if (length == 15 && !ReadLength(p, end, length))
+                return false;
+        }
+
+        length += s_MinMatch;
+        if (offset == 0 || offset > (size_t)(o - out) || length > (size_t)(oend - o))
+            return false;
+        const unsigned char* match{ o - offset };
+        if (offset >= 8 && (size_t)(oend - o) >= length + 8)
+        {
+            for (size_t i = 0; i < length; i += 8)
+                std::memcpy(o + i, match + i, 8);
+        }
+        else
+        {
+            for (size_t i = 0; i < length; i++)
+                o[i] = match[i];
+        }
+        o += length;
+    }
+    return o == oend && p == end;
+}
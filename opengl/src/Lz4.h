@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+//LZ4 block format (no frame, no checksum): sequences of a token, literals and a match of at
+//least 4 bytes up to 64 KiB back. interoperable with LZ4_compress_default/LZ4_decompress_safe,
+//decoding runs at a large fraction of memcpy speed
+
+//replaces out with the compressed block, greedy single-probe matching
+void Lz4Compress(const unsigned char* data, size_t size, std::vector<unsigned char>& out);
+//out receives exactly outSize bytes. false when data is malformed, would write past out or
+//does not decode to exactly outSize bytes
+bool Lz4Decompress(unsigned char* out, size_t outSize, const unsigned char* data, size_t size);
@@ -0,0 +1,116 @@
+#include "MappedFile.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#endif
+
+MappedFile::MappedFile()
+    : m_Data(nullptr), m_Size(0), m_Open(false), m_Mapped(false)
+{
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+bool MappedFile::Open(const std::string& filepath)
+{
+    Close();
+#if defined(_WIN32)
+    HANDLE file{ CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr) };
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size))
+    {
+        CloseHandle(file);
+        return false;
+    }
+    m_Size = (size_t)size.QuadPart;
+    if (m_Size)
+    {
+        //the view keeps the mapping and the file alive, both handles can go right away
+        HANDLE mapping{ CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) };
+        if (mapping)
+        {
+            m_Data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+        }
+        if (!m_Data)
+        {
+            CloseHandle(file);
+            m_Size = 0;
+            return false;
+        }
+        m_Mapped = true;
+    }
+    CloseHandle(file);
+#elif defined(__unix__) || defined(__APPLE__)
+    int descriptor{ open(filepath.c_str(), O_RDONLY) };
+    if (descriptor < 0)
+        return false;
+    struct stat status;
+    if (fstat(descriptor, &status) != 0)
+    {
+        close(descriptor);
+        return false;
+    }
+    m_Size = (size_t)status.st_size;
+    if (m_Size)
+    {
+        void* view{ mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, descriptor, 0) };
+        if (view == MAP_FAILED)
+        {
+            close(descriptor);
+            m_Size = 0;
+            return false;
+        }
+        m_Data = (const unsigned char*)view;
+        m_Mapped = true;
+    }
+    close(descriptor);
+#else
+    std::ifstream stream(filepath, std::ios::binary | std::ios::ate);
+    if (!stream)
+        return false;
+    m_Fallback.resize((size_t)stream.tellg());
+    stream.seekg(0);
+    stream.read((char*)m_Fallback.data(), m_Fallback.size());
+    if (!stream)
+    {
+        m_Fallback = std::vector<unsigned char>();
+        return false;
+    }
+    m_Data = m_Fallback.empty() ? nullptr : m_Fallback.data();
+    m_Size = m_Fallback.size();
+#endif
+    m_Open = true;
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (m_Mapped)
+    {
+#if defined(_WIN32)
+        UnmapViewOfFile(m_Data);
+#elif defined(__unix__) || defined(__APPLE__)
+        munmap((void*)m_Data, m_Size);
+#endif
+    }
+    m_Fallback = std::vector<unsigned char>();
+    m_Data = nullptr;
+    m_Size = 0;
+    m_Open = false;
+    m_Mapped = false;
+}
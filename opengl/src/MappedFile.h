@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+//a whole file mapped read-only into the address space, so readers (parsers, buffer uploads)
+//work straight on the page cache instead of a copy. platforms without mmap or
+//MapViewOfFile read the file into memory instead
+class MappedFile
+{
+private:
+	const unsigned char* m_Data;
+	size_t m_Size;
+	bool m_Open;
+	bool m_Mapped;                          //m_Data is a view to unmap on Close()
+	std::vector<unsigned char> m_Fallback;
+public:
+	MappedFile();
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	//false when the file is missing or cannot be mapped, empty files open with no data
+	bool Open(const std::string& filepath);
+	void Close();
+
+	inline bool IsOpen() const { return m_Open; }
+	inline const unsigned char* GetData() const { return m_Data; }
+	inline size_t GetSize() const { return m_Size; }
+};
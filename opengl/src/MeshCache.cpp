@@ -0,0 +1,323 @@
+#include "MeshCache.h"
+#include "FileSystem.h"
+#include "GeometryCodec.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+static const char s_Magic[4]{ 'M', 'E', 'S', 'H' };
+static const unsigned int s_Version{ 2 };
+static const unsigned int s_EncodedVertices{ 1 };
+static const unsigned int s_EncodedIndices{ 2 };
+//vertex and index sections start on a page, so a mapping hands the driver whole pages
+static const unsigned long long s_SectionAlignment{ 4096 };
+static const size_t s_HashBlockSize{ 1 << 20 };
+
+static const ProfilerCounter s_Conversions("Mesh cache conversions");
+
+static unsigned long long AlignUp(unsigned long long value, unsigned long long alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+MeshFile::MeshFile()
+    : m_Header(), m_VertexData(nullptr), m_IndexData(nullptr)
+{
+}
+
+bool MeshFile::Write(const std::string& filepath, const MeshData& mesh, unsigned long long sourceHash, bool encode)
+{
+    VertexBufferLayout layout{ MeshData::GetLayout() };
+    std::vector<Attribute> attributes;
+    unsigned int offset{ 0 };
+    for (const VertexBufferElement& element : layout.GetElements())
+    {
+        attributes.push_back({ element.type, element.count, element.normalized, offset });
+        offset += element.count * VertexBufferElement::GetSizeOfType(element.type);
+    }
+    std::string names;
+    std::vector<Part> parts;
+    for (const MeshPart& part : mesh.Parts)
+    {
+        parts.push_back({ part.FirstIndex, part.IndexCount, (unsigned int)names.size(), (unsigned int)part.Material.size() });
+        names += part.Material;
+    }
+
+    //sections as they go into the file
+    const unsigned char* vertices{ (const unsigned char*)mesh.Vertices.data() };
+    const unsigned char* indices{ (const unsigned char*)mesh.Indices.data() };
+    unsigned long long verticesSize{ mesh.GetVertexBytes() };
+    unsigned long long indicesSize{ mesh.Indices.size() * sizeof(unsigned int) };
+    unsigned int flags{ 0 };
+    std::vector<unsigned char> encodedVertices, encodedIndices;
+    if (encode)
+    {
+        EncodeVertexBuffer(mesh.Vertices.data(), mesh.GetVertexCount(), layout.GetStride(), encodedVertices);
+        if (encodedVertices.size() < verticesSize)
+        {
+            vertices = encodedVertices.data();
+            verticesSize = encodedVertices.size();
+            flags |= s_EncodedVertices;
+        }
+        EncodeIndexBuffer(mesh.Indices.data(), mesh.GetIndexCount(), encodedIndices);
+        if (encodedIndices.size() < indicesSize)
+        {
+            indices = encodedIndices.data();
+            indicesSize = encodedIndices.size();
+            flags |= s_EncodedIndices;
+        }
+    }
+
+    Header header{};
+    std::memcpy(header.Magic, s_Magic, sizeof(s_Magic));
+    header.Version = s_Version;
+    header.SourceHash = sourceHash;
+    header.VertexCount = mesh.GetVertexCount();
+    header.IndexCount = mesh.GetIndexCount();
+    header.VertexStride = layout.GetStride();
+    header.AttributeCount = (unsigned int)attributes.size();
+    header.PartCount = (unsigned int)parts.size();
+    header.NamesSize = (unsigned int)names.size();
+    header.Flags = flags;
+    std::copy_n(mesh.BoundsMin, 3, header.BoundsMin);
+    std::copy_n(mesh.BoundsMax, 3, header.BoundsMax);
+    header.AttributesOffset = sizeof(Header);
+    header.PartsOffset = header.AttributesOffset + attributes.size() * sizeof(Attribute);
+    header.NamesOffset = header.PartsOffset + parts.size() * sizeof(Part);
+    header.VerticesOffset = AlignUp(header.NamesOffset + names.size(), s_SectionAlignment);
+    header.IndicesOffset = AlignUp(header.VerticesOffset + verticesSize, s_SectionAlignment);
+    header.VerticesSize = verticesSize;
+    header.IndicesSize = indicesSize;
+
+    std::ofstream stream(filepath, std::ios::binary);
+    if (!stream)
+        return false;
+    auto pad = [&stream](unsigned long long to) {
+        static const char s_Zeros[s_SectionAlignment]{};
+        stream.write(s_Zeros, (std::streamsize)(to - (unsigned long long)stream.tellp()));
+    };
+    stream.write((const char*)&header, sizeof(header));
+    stream.write((const char*)attributes.data(), attributes.size() * sizeof(Attribute));
+    stream.write((const char*)parts.data(), parts.size() * sizeof(Part));
+    stream.write(names.data(), names.size());
+    pad(header.VerticesOffset);
+    stream.write((const char*)vertices, (std::streamsize)verticesSize);
+    pad(header.IndicesOffset);
+    stream.write((const char*)indices, (std::streamsize)indicesSize);
+    return (bool)stream;
+}
+
+bool MeshFile::Open(const std::string& filepath)
+{
+    Close();
+    if (!m_File.Open(filepath))
+    {
+        std::cout << "Failed to open mesh file " << filepath << std::endl;
+        return false;
+    }
+
+    const unsigned char* data{ m_File.GetData() };
+    unsigned long long size{ m_File.GetSize() };
+    auto fail = [this, &filepath](const char* reason) {
+        std::cout << "Bad mesh file " << filepath << ": " << reason << std::endl;
+        Close();
+        return false;
+    };
+    if (size < sizeof(Header))
+        return fail("truncated header");
+    std::memcpy(&m_Header, data, sizeof(Header));
+    if (std::memcmp(m_Header.Magic, s_Magic, sizeof(s_Magic)) != 0)
+        return fail("not a mesh file");
+    if (m_Header.Version != s_Version)
+        return fail("unsupported version");
+
+    //offsets are checked one at a time so a huge one cannot wrap the sum around
+    const Header& h{ m_Header };
+    unsigned long long vertexBytes{ (unsigned long long)h.VertexCount * h.VertexStride };
+    unsigned long long indexBytes{ (unsigned long long)h.IndexCount * sizeof(unsigned int) };
+    if (h.AttributesOffset > size || h.AttributeCount > (size - h.AttributesOffset) / sizeof(Attribute) ||
+        h.PartsOffset > size || h.PartCount > (size - h.PartsOffset) / sizeof(Part) ||
+        h.NamesOffset > size || h.NamesSize > size - h.NamesOffset ||
+        h.VerticesOffset > size || h.VerticesSize > size - h.VerticesOffset || h.VerticesOffset % 4 ||
+        h.IndicesOffset > size || h.IndicesSize > size - h.IndicesOffset || h.IndicesOffset % 4)
+        return fail("section outside of the file");
+    if ((!(h.Flags & s_EncodedVertices) && h.VerticesSize != vertexBytes) ||
+        (!(h.Flags & s_EncodedIndices) && h.IndicesSize != indexBytes) || h.Flags & ~(s_EncodedVertices | s_EncodedIndices))
+        return fail("bad section size");
+    //encoded sections are decoded into buffers sized from the counts, which must fit the data
+    if ((h.Flags & s_EncodedVertices && h.VerticesSize < GetMinEncodedVertexSize(h.VertexCount, h.VertexStride)) ||
+        (h.Flags & s_EncodedIndices && h.IndicesSize < GetMinEncodedIndexSize(h.IndexCount)))
+        return fail("bad section size");
+
+    //rebuild the layout, attributes have to be packed in order the way VertexBufferLayout lays them out
+    unsigned int offset{ 0 };
+    for (unsigned int i = 0; i < h.AttributeCount; i++)
+    {
+        Attribute attribute;
+        std::memcpy(&attribute, data + h.AttributesOffset + i * sizeof(Attribute), sizeof(Attribute));
+        if (attribute.Offset != offset || attribute.Count < 1 || attribute.Count > 4)
+            return fail("bad vertex layout");
+        if (attribute.Type == GL_FLOAT && !attribute.Normalized)
+            m_Layout.Push<float>(attribute.Count);
+        else if (attribute.Type == GL_UNSIGNED_INT && !attribute.Normalized)
+            m_Layout.Push<unsigned int>(attribute.Count);
+        else if (attribute.Type == GL_UNSIGNED_BYTE && attribute.Normalized)
+            m_Layout.Push<unsigned char>(attribute.Count);
+        else
+            return fail("bad vertex layout");
+        offset = m_Layout.GetStride();
+    }
+    if (m_Layout.GetStride() != h.VertexStride)
+        return fail("bad vertex layout");
+
+    for (unsigned int i = 0; i < h.PartCount; i++)
+    {
+        Part part;
+        std::memcpy(&part, data + h.PartsOffset + i * sizeof(Part), sizeof(Part));
+        if (part.FirstIndex > h.IndexCount || part.IndexCount > h.IndexCount - part.FirstIndex ||
+            part.NameOffset > h.NamesSize || part.NameLength > h.NamesSize - part.NameOffset)
+            return fail("bad part table");
+        m_Parts.push_back({ std::string((const char*)data + h.NamesOffset + part.NameOffset, part.NameLength), part.FirstIndex, part.IndexCount });
+    }
+
+    m_VertexData = data + h.VerticesOffset;
+    m_IndexData = (const unsigned int*)(data + h.IndicesOffset);
+    if (h.Flags & s_EncodedVertices)
+    {
+        m_DecodedVertices.resize(vertexBytes);
+        if (!DecodeVertexBuffer(m_DecodedVertices.data(), h.VertexCount, h.VertexStride, m_VertexData, h.VerticesSize))
+            return fail("bad vertex encoding");
+        m_VertexData = m_DecodedVertices.data();
+    }
+    if (h.Flags & s_EncodedIndices)
+    {
+        m_DecodedIndices.resize(h.IndexCount);
+        if (!DecodeIndexBuffer(m_DecodedIndices.data(), h.IndexCount, (const unsigned char*)m_IndexData, h.IndicesSize))
+            return fail("bad index encoding");
+        m_IndexData = m_DecodedIndices.data();
+    }
+
+    //the buffers go to the GPU as they are, an index past the vertices would read out of bounds there
+    unsigned int maxIndex{ 0 };
+    for (unsigned int i = 0; i < h.IndexCount; i++)
+        maxIndex = std::max(maxIndex, m_IndexData[i]);
+    if (h.IndexCount && maxIndex >= h.VertexCount)
+        return fail("index out of range");
+    return true;
+}
+
+void MeshFile::Close()
+{
+    m_File.Close();
+    m_Header = Header();
+    m_Layout = VertexBufferLayout();
+    m_Parts.clear();
+    m_VertexData = nullptr;
+    m_IndexData = nullptr;
+    m_DecodedVertices = std::vector<unsigned char>();
+    m_DecodedIndices = std::vector<unsigned int>();
+}
+
+MeshCache::MeshCache(const std::string& directory, WorkerPool* workers, bool encode)
+    : m_Directory(directory), m_Workers(workers), m_Encode(encode)
+{
+}
+
+bool MeshCache::Load(const std::string& sourcePath, MeshFile& file)
+{
+    file.Close();
+    VirtualFile source;
+    if (!FileSystem::Get().Open(sourcePath, source))
+    {
+        std::cout << "Failed to open mesh " << sourcePath << std::endl;
+        return false;
+    }
+    unsigned long long hash{ HashContent(source.GetData(), source.GetSize(), m_Workers) };
+    std::string cachePath{ GetCachePath(hash) };
+
+    std::error_code error;
+    if (std::filesystem::exists(cachePath, error) && file.Open(cachePath))
+    {
+        if (file.GetSourceHash() == hash)
+            return true;
+        file.Close();
+    }
+
+    s_Conversions.Increment();
+    MeshData mesh;
+    if (!LoadMesh(sourcePath, source.GetData(), source.GetSize(), mesh, m_Workers))
+        return false;
+
+    //written under a temporary name and renamed, a reader never maps half a file
+    std::filesystem::create_directories(m_Directory, error);
+    std::string temporary{ cachePath + ".tmp" };
+    if (!MeshFile::Write(temporary, mesh, hash, m_Encode))
+    {
+        std::cout << "Failed to write mesh cache " << temporary << std::endl;
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    std::filesystem::rename(temporary, cachePath, error);
+    if (error)
+    {
+        std::cout << "Failed to write mesh cache " << cachePath << ": " << error.message() << std::endl;
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    return file.Open(cachePath);
+}
+
+std::string MeshCache::GetCachePath(unsigned long long sourceHash) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.mesh", sourceHash);
+    return (std::filesystem::path(m_Directory) / name).string();
+}
+
+//multiply-rotate over 8 byte words with a final avalanche, a few GB/s per thread
+static unsigned long long HashBlock(const unsigned char* data, size_t size, unsigned long long seed)
+{
+    static const unsigned long long s_Prime1{ 0x9e3779b97f4a7c15ull }, s_Prime2{ 0xc2b2ae3d27d4eb4full };
+    unsigned long long hash{ seed ^ (size * s_Prime1) };
+    size_t i{ 0 };
+    for (; i + 8 <= size; i += 8)
+    {
+        unsigned long long word;
+        std::memcpy(&word, data + i, 8);
+        hash ^= word * s_Prime2;
+        hash = ((hash << 31) | (hash >> 33)) * s_Prime1;
+    }
+    unsigned long long tail{ 0 };
+    if (i < size)
+        std::memcpy(&tail, data + i, size - i);
+    hash ^= tail * s_Prime2;
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+unsigned long long MeshCache::HashContent(const unsigned char* data, size_t size, WorkerPool* workers)
+{
+    unsigned int blocks{ (unsigned int)((size + s_HashBlockSize - 1) / s_HashBlockSize) };
+    std::vector<unsigned long long> hashes(blocks);
+    auto hashBlocks = [&](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; i++)
+        {
+            size_t offset{ (size_t)i * s_HashBlockSize };
+            hashes[i] = HashBlock(data + offset, std::min(s_HashBlockSize, size - offset), i);
+        }
+    };
+    if (workers)
+        workers->ParallelFor(blocks, 1, hashBlocks);
+    else
+        hashBlocks(0, blocks);
+    return HashBlock((const unsigned char*)hashes.data(), hashes.size() * sizeof(unsigned long long), size);
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "MappedFile.h"
+#include "MeshLoader.h"
+#include "VertexBufferLayout.h"
+#include "WorkerPool.h"
+
+#include <string>
+#include <vector>
+
+//a converted mesh on disk, read through a mapping. the vertex and index sections are page
+//aligned and in their GPU format, so GetVertexData()/GetIndexData() go to VertexBuffer,
+//IndexBuffer or GeometryPool::Add() as they are and the driver copies from the mapped pages.
+//encoded files trade that for a fraction of the size: Open() decodes them into memory.
+//sections follow the header in the order attributes, parts, names, vertices, indices
+class MeshFile
+{
+private:
+	struct Header
+	{
+		char Magic[4];
+		unsigned int Version;
+		unsigned long long SourceHash;          //content hash of the file it was converted from
+		unsigned int VertexCount;
+		unsigned int IndexCount;                //32 bit indices
+		unsigned int VertexStride;
+		unsigned int AttributeCount;
+		unsigned int PartCount;
+		unsigned int NamesSize;
+		unsigned int Flags;                     //which sections went through GeometryCodec
+		unsigned int Reserved;
+		float BoundsMin[3];
+		float BoundsMax[3];
+		unsigned long long AttributesOffset;
+		unsigned long long PartsOffset;
+		unsigned long long NamesOffset;
+		unsigned long long VerticesOffset;
+		unsigned long long IndicesOffset;
+		unsigned long long VerticesSize;        //in the file, smaller than the buffer when encoded
+		unsigned long long IndicesSize;
+	};
+
+	struct Attribute
+	{
+		unsigned int Type;                      //GL_FLOAT, GL_UNSIGNED_INT or GL_UNSIGNED_BYTE
+		unsigned int Count;
+		unsigned int Normalized;
+		unsigned int Offset;                    //in the vertex
+	};
+
+	struct Part
+	{
+		unsigned int FirstIndex;
+		unsigned int IndexCount;
+		unsigned int NameOffset;                //into the names section
+		unsigned int NameLength;
+	};
+
+	MappedFile m_File;
+	Header m_Header;
+	const unsigned char* m_VertexData;          //into the mapping, or the decoded copies
+	const unsigned int* m_IndexData;
+	std::vector<unsigned char> m_DecodedVertices;
+	std::vector<unsigned int> m_DecodedIndices;
+	VertexBufferLayout m_Layout;
+	std::vector<MeshPart> m_Parts;
+public:
+	MeshFile();
+
+	MeshFile(const MeshFile&) = delete;
+	MeshFile& operator=(const MeshFile&) = delete;
+
+	//vertices are written in MeshData::GetLayout(). encode runs the sections through
+	//GeometryCodec, each one is kept raw when that does not make it smaller
+	static bool Write(const std::string& filepath, const MeshData& mesh, unsigned long long sourceHash = 0,
+		bool encode = false);
+
+	//maps the file and checks every section lies inside it and every index names a vertex.
+	//false (and prints why) otherwise
+	bool Open(const std::string& filepath);
+	void Close();
+	inline bool IsOpen() const { return m_File.IsOpen(); }
+
+	inline const void* GetVertexData() const { return m_VertexData; }
+	inline const unsigned int* GetIndexData() const { return m_IndexData; }
+	inline unsigned int GetVertexCount() const { return m_Header.VertexCount; }
+	inline unsigned int GetIndexCount() const { return m_Header.IndexCount; }
+	inline unsigned int GetVertexBytes() const { return m_Header.VertexCount * m_Header.VertexStride; }
+	inline const VertexBufferLayout& GetLayout() const { return m_Layout; }
+	inline const std::vector<MeshPart>& GetParts() const { return m_Parts; }
+	inline const float* GetBoundsMin() const { return m_Header.BoundsMin; }
+	inline const float* GetBoundsMax() const { return m_Header.BoundsMax; }
+	inline unsigned long long GetSourceHash() const { return m_Header.SourceHash; }
+	inline bool IsEncoded() const { return m_Header.Flags != 0; }
+};
+
+//source models (anything LoadMesh() reads) converted once into MeshFiles under a cache
+//directory, named by a hash of the source's content: an edited model converts again, an
+//untouched one is only hashed and mapped. for .gltf only the JSON is hashed, edits to the
+//external buffers alone do not invalidate the cache
+class MeshCache
+{
+private:
+	std::string m_Directory;
+	WorkerPool* m_Workers;
+	bool m_Encode;
+public:
+	//the directory is created on the first conversion. with workers hashing and parsing use the
+	//pool, encode writes conversions through GeometryCodec (see MeshFile::Write())
+	explicit MeshCache(const std::string& directory, WorkerPool* workers = nullptr, bool encode = false);
+
+	//opens the cached conversion of the source, converting and writing it first when it is
+	//missing or stale. false (and prints why) when the source cannot be loaded
+	bool Load(const std::string& sourcePath, MeshFile& file);
+
+	std::string GetCachePath(unsigned long long sourceHash) const;
+
+	//64 bit hash of a file's content. blocks are hashed independently and combined, so the
+	//result does not depend on workers
+	static unsigned long long HashContent(const unsigned char* data, size_t size, WorkerPool* workers = nullptr);
+};
@@ -0,0 +1,1229 @@
+#include "MeshLoader.h"
+
+#include "FileSystem.h"
+#include "Json.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <iostream>
+
+static const ProfilerCounter s_ParsedBytes("Mesh parsed bytes");
+
+namespace {
+
+    //OBJ text is split into chunks of about this many bytes, cut after a newline
+    constexpr size_t s_ObjChunkSize{ 1 << 20 };
+    //a corner attribute that was not written. ParseIndex() never produces it
+    constexpr int s_NoIndex{ INT_MIN };
+
+    //runs body(i) for every i in [0, count), on the pool when there is one
+    void ForEach(WorkerPool* workers, unsigned int count, const std::function<void(unsigned int)>& body)
+    {
+        if (workers && count > 1)
+        {
+            workers->ParallelFor(count, 1, [&body](unsigned int begin, unsigned int end) {
+                for (unsigned int i = begin; i < end; i++)
+                    body(i);
+            });
+        }
+        else
+        {
+            for (unsigned int i = 0; i < count; i++)
+                body(i);
+        }
+    }
+
+    //appends a run of indices, growing the previous part when the material did not change
+    void AddPart(MeshData& mesh, const std::string& material, unsigned int first, unsigned int count)
+    {
+        if (count == 0)
+            return;
+        if (!mesh.Parts.empty())
+        {
+            MeshPart& last{ mesh.Parts.back() };
+            if (last.Material == material && last.FirstIndex + last.IndexCount == first)
+            {
+                last.IndexCount += count;
+                return;
+            }
+        }
+        mesh.Parts.push_back({ material, first, count });
+    }
+
+    void ComputeBounds(MeshData& mesh)
+    {
+        if (mesh.Vertices.empty())
+            return;
+        for (unsigned int axis = 0; axis < 3; axis++)
+        {
+            mesh.BoundsMin[axis] = mesh.Vertices[0].Position[axis];
+            mesh.BoundsMax[axis] = mesh.Vertices[0].Position[axis];
+        }
+        for (const MeshVertex& vertex : mesh.Vertices)
+        {
+            for (unsigned int axis = 0; axis < 3; axis++)
+            {
+                mesh.BoundsMin[axis] = std::min(mesh.BoundsMin[axis], vertex.Position[axis]);
+                mesh.BoundsMax[axis] = std::max(mesh.BoundsMax[axis], vertex.Position[axis]);
+            }
+        }
+    }
+
+    //area weighted face normal of a triangle, added to out
+    void AddFaceNormal(const float* a, const float* b, const float* c, float* out)
+    {
+        float ab[3] { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+        float ac[3] { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+        out[0] += ab[1] * ac[2] - ab[2] * ac[1];
+        out[1] += ab[2] * ac[0] - ab[0] * ac[2];
+        out[2] += ab[0] * ac[1] - ab[1] * ac[0];
+    }
+
+    void Normalize(const float* in, float* out)
+    {
+        float length{ std::sqrt(in[0] * in[0] + in[1] * in[1] + in[2] * in[2]) };
+        if (length > 0.0f)
+        {
+            out[0] = in[0] / length;
+            out[1] = in[1] / length;
+            out[2] = in[2] / length;
+        }
+        else
+        {
+            out[0] = 0.0f;
+            out[1] = 0.0f;
+            out[2] = 1.0f;
+        }
+    }
+
+    //OBJ
+
+    //one face corner. as written the indices are 1 based, or relative to the attributes read so
+    //far when negative; relative ones are kept chunk local (count in this chunk + index) until the
+    //counts of the earlier chunks are known. after resolving they are 0 based, -1 when missing
+    struct ObjCorner
+    {
+        int Attributes[3];              //position, texture coordinate, normal
+        unsigned int Relative;          //bit per attribute
+    };
+
+    //open addressing map from a resolved corner to a vertex index, linear probing in a power of
+    //two table that is kept at most half full
+    class CornerMap
+    {
+    private:
+        struct Slot
+        {
+            int Key[3];
+            unsigned int Value;
+        };
+
+        static constexpr unsigned int s_Empty{ UINT_MAX };
+
+        std::vector<Slot> m_Slots;
+        size_t m_Count;
+
+        static size_t Hash(const int* key)
+        {
+            unsigned long long hash{ (unsigned int)key[0] * 0x9e3779b97f4a7c15ull };
+            hash ^= (unsigned int)key[1] * 0xc2b2ae3d27d4eb4full;
+            hash ^= (unsigned int)key[2] * 0x165667b19e3779f9ull;
+            return (size_t)(hash ^ (hash >> 29));
+        }
+
+        void Resize(size_t capacity)
+        {
+            std::vector<Slot> slots(capacity, Slot{ { 0, 0, 0 }, s_Empty });
+            std::swap(m_Slots, slots);
+            size_t mask{ capacity - 1 };
+            for (const Slot& slot : slots)
+            {
+                if (slot.Value == s_Empty)
+                    continue;
+                size_t i{ Hash(slot.Key) & mask };
+                while (m_Slots[i].Value != s_Empty)
+                    i = (i + 1) & mask;
+                m_Slots[i] = slot;
+            }
+        }
+    public:
+        explicit CornerMap(size_t expected)
+            : m_Count(0)
+        {
+            size_t capacity{ 16 };
+            while (capacity < expected * 2)
+                capacity *= 2;
+            Resize(capacity);
+        }
+
+        //the value stored for key, or value after inserting it
+        unsigned int Insert(const int* key, unsigned int value)
+        {
+            if ((m_Count + 1) * 2 > m_Slots.size())
+                Resize(m_Slots.size() * 2);
+            size_t mask{ m_Slots.size() - 1 };
+            size_t i{ Hash(key) & mask };
+            while (m_Slots[i].Value != s_Empty)
+            {
+                const Slot& slot{ m_Slots[i] };
+                if (slot.Key[0] == key[0] && slot.Key[1] == key[1] && slot.Key[2] == key[2])
+                    return slot.Value;
+                i = (i + 1) & mask;
+            }
+            m_Slots[i] = { { key[0], key[1], key[2] }, value };
+            m_Count++;
+            return value;
+        }
+    };
+
+    struct ObjMaterialSwitch
+    {
+        std::string Name;
+        size_t FirstCorner;
+    };
+
+    struct ObjChunk
+    {
+        const char* Begin { nullptr };
+        const char* End { nullptr };
+        std::vector<float> Attributes[3];       //xyz, uv, xyz
+        std::vector<ObjCorner> Corners;         //three per triangle
+        std::vector<ObjMaterialSwitch> Materials;
+        unsigned int Lines { 0 };
+        const char* Error { nullptr };
+
+        size_t Bases[3] { 0, 0, 0 };            //attributes in earlier chunks
+        size_t FirstCorner { 0 };
+        std::vector<ObjCorner> Unique;          //welded inside the chunk, in order of first use
+        std::vector<unsigned int> Local;        //per corner, into Unique
+        std::vector<unsigned int> Remap;        //Unique to mesh vertices
+    };
+
+    inline const char* SkipBlanks(const char* p, const char* end)
+    {
+        while (p < end && (*p == ' ' || *p == '\t'))
+            p++;
+        return p;
+    }
+
+    bool ParseFloat(const char*& p, const char* end, float& value)
+    {
+        p = SkipBlanks(p, end);
+        if (p < end && *p == '+')
+            p++;
+        std::from_chars_result result{ std::from_chars(p, end, value) };
+        if (result.ec == std::errc::result_out_of_range)
+            value = 0.0f;   //denormals some exporters write
+        else if (result.ec != std::errc())
+            return false;
+        p = result.ptr;
+        return true;
+    }
+
+    bool ParseIndex(const char*& p, const char* end, size_t count, ObjCorner& corner, unsigned int attribute)
+    {
+        int value;
+        std::from_chars_result result{ std::from_chars(p, end, value) };
+        if (result.ec != std::errc() || value == 0)
+            return false;
+        p = result.ptr;
+        if (value > 0)
+            corner.Attributes[attribute] = value - 1;
+        else
+        {
+            //chunk local, may go below 0 into earlier chunks but never down to s_NoIndex: that
+            //would need more than INT_MAX attributes before it, which LoadObj() rejects anyway
+            long long index{ (long long)count + value };
+            if (index <= s_NoIndex || index > INT_MAX)
+                return false;
+            corner.Attributes[attribute] = (int)index;
+            corner.Relative |= 1u << attribute;
+        }
+        return true;
+    }
+
+    bool ParseFace(ObjChunk& chunk, const char* p, const char* end)
+    {
+        size_t counts[3] { chunk.Attributes[0].size() / 3, chunk.Attributes[1].size() / 2, chunk.Attributes[2].size() / 3 };
+        ObjCorner first{}, previous{};
+        unsigned int corners{ 0 };
+        while ((p = SkipBlanks(p, end)) < end)
+        {
+            ObjCorner corner{ { s_NoIndex, s_NoIndex, s_NoIndex }, 0 };
+            if (!ParseIndex(p, end, counts[0], corner, 0))
+                return false;
+            if (p < end && *p == '/')
+            {
+                p++;
+                if (p < end && *p != '/' && !ParseIndex(p, end, counts[1], corner, 1))
+                    return false;
+                if (p < end && *p == '/')
+                {
+                    p++;
+                    if (!ParseIndex(p, end, counts[2], corner, 2))
+                        return false;
+                }
+            }
+            if (p < end && *p != ' ' && *p != '\t')
+                return false;
+
+            //fan out from the first corner
+            if (corners == 0)
+                first = corner;
+            else if (corners >= 2)
+            {
+                chunk.Corners.push_back(first);
+                chunk.Corners.push_back(previous);
+                chunk.Corners.push_back(corner);
+            }
+            previous = corner;
+            corners++;
+        }
+        return corners >= 3;
+    }
+
+    bool ParseObjLine(ObjChunk& chunk, const char* p, const char* end)
+    {
+        p = SkipBlanks(p, end);
+        if (p == end || *p == '#')
+            return true;
+        const char* keyword{ p };
+        while (p < end && *p != ' ' && *p != '\t')
+            p++;
+        size_t length{ (size_t)(p - keyword) };
+
+        if (keyword[0] == 'v' && length <= 2)
+        {
+            unsigned int attribute{ length == 1 ? 0u : keyword[1] == 't' ? 1u : keyword[1] == 'n' ? 2u : 3u };
+            if (attribute == 3)
+                return true;    //vp
+            float values[3] { 0.0f, 0.0f, 0.0f };
+            unsigned int components{ attribute == 1 ? 2u : 3u };
+            for (unsigned int i = 0; i < components; i++)
+            {
+                //a texture coordinate may leave out v, anything past the components we keep
+                //(w, vertex colors) is ignored
+                if (!ParseFloat(p, end, values[i]) && !(attribute == 1 && i == 1))
+                {
+                    chunk.Error = "bad number";
+                    return false;
+                }
+            }
+            chunk.Attributes[attribute].insert(chunk.Attributes[attribute].end(), values, values + components);
+            return true;
+        }
+        if (length == 1 && keyword[0] == 'f')
+        {
+            if (!ParseFace(chunk, p, end))
+            {
+                chunk.Error = "bad face";
+                return false;
+            }
+            return true;
+        }
+        if (length == 6 && std::memcmp(keyword, "usemtl", 6) == 0)
+        {
+            p = SkipBlanks(p, end);
+            const char* nameEnd{ end };
+            while (nameEnd > p && (nameEnd[-1] == ' ' || nameEnd[-1] == '\t'))
+                nameEnd--;
+            chunk.Materials.push_back({ std::string(p, nameEnd), chunk.Corners.size() });
+            return true;
+        }
+        //groups, smoothing groups, mtllib, lines and points do not change the triangles
+        return true;
+    }
+
+    void ParseObjChunk(ObjChunk& chunk)
+    {
+        const char* p{ chunk.Begin };
+        while (p < chunk.End)
+        {
+            const char* lineEnd{ (const char*)std::memchr(p, '\n', chunk.End - p) };
+            if (!lineEnd)
+                lineEnd = chunk.End;
+            const char* end{ lineEnd };
+            if (end > p && end[-1] == '\r')
+                end--;
+            chunk.Lines++;
+            if (!ParseObjLine(chunk, p, end))
+                return;
+            p = lineEnd < chunk.End ? lineEnd + 1 : chunk.End;
+        }
+    }
+
+    //turns the chunk's indices into absolute 0 based ones and welds its corners
+    bool ResolveObjChunk(ObjChunk& chunk, const size_t* totals)
+    {
+        CornerMap map(chunk.Corners.size() / 2);
+        chunk.Local.resize(chunk.Corners.size());
+        for (size_t i = 0; i < chunk.Corners.size(); i++)
+        {
+            ObjCorner& corner{ chunk.Corners[i] };
+            for (unsigned int attribute = 0; attribute < 3; attribute++)
+            {
+                long long index{ corner.Attributes[attribute] };
+                if (index == s_NoIndex)
+                {
+                    if (attribute == 0)
+                        return false;   //every corner needs a position
+                    corner.Attributes[attribute] = -1;
+                    continue;
+                }
+                if (corner.Relative & (1u << attribute))
+                    index += (long long)chunk.Bases[attribute];
+                if (index < 0 || (unsigned long long)index >= totals[attribute])
+                    return false;
+                corner.Attributes[attribute] = (int)index;
+            }
+            corner.Relative = 0;
+            unsigned int local{ map.Insert(corner.Attributes, (unsigned int)chunk.Unique.size()) };
+            if (local == chunk.Unique.size())
+                chunk.Unique.push_back(corner);
+            chunk.Local[i] = local;
+        }
+        return true;
+    }
+
+    //glTF
+
+    struct GltfFile
+    {
+        JsonValue Document;
+        std::vector<std::vector<unsigned char>> Storage;
+        std::vector<const unsigned char*> Buffers;
+        std::vector<size_t> BufferSizes;
+    };
+
+    //a typed view of buffer memory. accessors without a bufferView read as zeros
+    struct GltfAccessor
+    {
+        const unsigned char* Data;
+        size_t Count;
+        size_t Stride;
+        unsigned int ComponentType;
+        unsigned int Components;
+        bool Normalized;
+    };
+
+    unsigned int GetComponentSize(unsigned int type)
+    {
+        switch (type)
+        {
+            case 5120: case 5121:   return 1;   //(unsigned) byte
+            case 5122: case 5123:   return 2;   //(unsigned) short
+            case 5125: case 5126:   return 4;   //unsigned int, float
+        }
+        return 0;
+    }
+
+    bool DecodeBase64(const char* p, const char* end, std::vector<unsigned char>& out)
+    {
+        unsigned int bits{ 0 }, count{ 0 };
+        for (; p < end && *p != '='; p++)
+        {
+            char c{ *p };
+            unsigned int value;
+            if (c >= 'A' && c <= 'Z') value = c - 'A';
+            else if (c >= 'a' && c <= 'z') value = c - 'a' + 26;
+            else if (c >= '0' && c <= '9') value = c - '0' + 52;
+            else if (c == '+') value = 62;
+            else if (c == '/') value = 63;
+            else return false;
+            bits = (bits << 6) | value;
+            count += 6;
+            if (count >= 8)
+            {
+                count -= 8;
+                out.push_back((unsigned char)(bits >> count));
+            }
+        }
+        return true;
+    }
+
+    //a byte count or offset of the document, 0 when missing. false unless it is a whole number
+    //that fits in memory, so nothing casts a negative or huge double
+    bool GetSize(const JsonValue& value, const char* key, size_t& out)
+    {
+        out = 0;
+        const JsonValue* number{ value.Find(key) };
+        if (!number)
+            return true;
+        if (!number->IsNumber() || number->Number < 0 || number->Number >= 9007199254740992.0 || number->Number != std::floor(number->Number))
+            return false;
+        out = (size_t)number->Number;
+        return true;
+    }
+
+    //bin is the BIN chunk of a GLB, the buffer without a uri
+    bool LoadGltfBuffers(GltfFile& file, const unsigned char* bin, size_t binSize, const std::string& directory)
+    {
+        const JsonValue* buffers{ file.Document.Find("buffers") };
+        if (!buffers)
+            return true;
+        for (const JsonValue& buffer : buffers->Array)
+        {
+            size_t length;
+            if (!GetSize(buffer, "byteLength", length))
+            {
+                std::cout << "glTF buffer has an invalid byteLength" << std::endl;
+                return false;
+            }
+            const std::string& uri{ buffer.GetString("uri") };
+            const unsigned char* data;
+            size_t size;
+            if (uri.empty())
+            {
+                if (!bin)
+                {
+                    std::cout << "glTF buffer without uri outside of a GLB" << std::endl;
+                    return false;
+                }
+                data = bin;
+                size = binSize;
+            }
+            else
+            {
+                file.Storage.emplace_back();
+                std::vector<unsigned char>& storage{ file.Storage.back() };
+                if (uri.compare(0, 5, "data:") == 0)
+                {
+                    size_t start{ uri.find(";base64,") };
+                    if (start == std::string::npos || !DecodeBase64(uri.data() + start + 8, uri.data() + uri.size(), storage))
+                    {
+                        std::cout << "glTF buffer has an unsupported data uri" << std::endl;
+                        return false;
+                    }
+                }
+                else if (!FileSystem::Get().ReadFile(directory + uri, storage))
+                {
+                    std::cout << "Failed to open glTF buffer " << directory + uri << std::endl;
+                    return false;
+                }
+                data = storage.data();
+                size = storage.size();
+            }
+            if (size < length)
+            {
+                std::cout << "glTF buffer is shorter than its byteLength" << std::endl;
+                return false;
+            }
+            file.Buffers.push_back(data);
+            file.BufferSizes.push_back(length);
+        }
+        return true;
+    }
+
+    const char* GetAccessor(const GltfFile& file, double index, GltfAccessor& accessor)
+    {
+        const JsonValue* accessors{ file.Document.Find("accessors") };
+        if (!accessors || index < 0 || index >= accessors->Array.size())
+            return "accessor out of range";
+        const JsonValue& source{ accessors->Array[(size_t)index] };
+        if (source.Find("sparse"))
+            return "sparse accessors are not supported";
+
+        accessor.ComponentType = (unsigned int)source.GetNumber("componentType");
+        unsigned int componentSize{ GetComponentSize(accessor.ComponentType) };
+        if (!componentSize)
+            return "unknown component type";
+        const std::string& type{ source.GetString("type") };
+        if (type == "SCALAR") accessor.Components = 1;
+        else if (type == "VEC2") accessor.Components = 2;
+        else if (type == "VEC3") accessor.Components = 3;
+        else if (type == "VEC4") accessor.Components = 4;
+        else return "unsupported accessor type";
+        if (!GetSize(source, "count", accessor.Count) || accessor.Count > UINT_MAX)
+            return "invalid accessor count";
+        const JsonValue* normalized{ source.Find("normalized") };
+        accessor.Normalized = normalized && normalized->Bool;
+
+        size_t elementSize{ (size_t)componentSize * accessor.Components };
+        accessor.Stride = elementSize;
+        accessor.Data = nullptr;
+        const JsonValue* viewIndex{ source.Find("bufferView") };
+        if (!viewIndex)
+            return nullptr;
+
+        const JsonValue* views{ file.Document.Find("bufferViews") };
+        if (!views || !viewIndex->IsNumber() || viewIndex->Number < 0 || viewIndex->Number >= views->Array.size())
+            return "bufferView out of range";
+        const JsonValue& view{ views->Array[(size_t)viewIndex->Number] };
+        double buffer{ view.GetNumber("buffer", -1.0) };
+        if (buffer < 0 || buffer >= file.Buffers.size())
+            return "buffer out of range";
+        size_t viewOffset, viewLength, stride, offset;
+        if (!GetSize(view, "byteOffset", viewOffset) || !GetSize(view, "byteLength", viewLength) || !GetSize(view, "byteStride", stride))
+            return "invalid bufferView";
+        size_t bufferSize{ file.BufferSizes[(size_t)buffer] };
+        if (viewOffset > bufferSize || viewLength > bufferSize - viewOffset)
+            return "bufferView outside of its buffer";
+        if (stride)
+            accessor.Stride = stride;
+
+        //written so that nothing can wrap around
+        if (!GetSize(source, "byteOffset", offset))
+            return "invalid accessor byteOffset";
+        if (accessor.Count && (offset > viewLength || viewLength - offset < elementSize ||
+            accessor.Count - 1 > (viewLength - offset - elementSize) / accessor.Stride))
+            return "accessor outside of its bufferView";
+        accessor.Data = file.Buffers[(size_t)buffer] + viewOffset + offset;
+        return nullptr;
+    }
+
+    float ReadComponent(const unsigned char* p, unsigned int type, bool normalized)
+    {
+        switch (type)
+        {
+            case 5120:
+            {
+                float value{ (float)(signed char)*p };
+                return normalized ? std::max(value / 127.0f, -1.0f) : value;
+            }
+            case 5121:
+                return normalized ? *p / 255.0f : (float)*p;
+            case 5122:
+            {
+                short value;
+                std::memcpy(&value, p, 2);
+                return normalized ? std::max(value / 32767.0f, -1.0f) : (float)value;
+            }
+            case 5123:
+            {
+                unsigned short value;
+                std::memcpy(&value, p, 2);
+                return normalized ? value / 65535.0f : (float)value;
+            }
+            case 5125:
+            {
+                unsigned int value;
+                std::memcpy(&value, p, 4);
+                return (float)value;
+            }
+        }
+        float value;
+        std::memcpy(&value, p, 4);
+        return value;
+    }
+
+    //components of element i, zeros for accessors without data
+    void ReadElement(const GltfAccessor& accessor, size_t i, float* out, unsigned int components)
+    {
+        unsigned int componentSize{ GetComponentSize(accessor.ComponentType) };
+        for (unsigned int c = 0; c < components; c++)
+        {
+            out[c] = accessor.Data && c < accessor.Components
+                ? ReadComponent(accessor.Data + i * accessor.Stride + c * componentSize, accessor.ComponentType, accessor.Normalized)
+                : 0.0f;
+        }
+    }
+
+    unsigned int ReadIndex(const GltfAccessor& accessor, size_t i)
+    {
+        if (!accessor.Data)
+            return 0;
+        const unsigned char* p{ accessor.Data + i * accessor.Stride };
+        switch (accessor.ComponentType)
+        {
+            case 5121:
+                return *p;
+            case 5123:
+            {
+                unsigned short value;
+                std::memcpy(&value, p, 2);
+                return value;
+            }
+        }
+        unsigned int value;
+        std::memcpy(&value, p, 4);
+        return value;
+    }
+
+    //4x4 matrices are column major like glTF's
+    void Multiply(const float* a, const float* b, float* out)
+    {
+        for (unsigned int column = 0; column < 4; column++)
+        {
+            for (unsigned int row = 0; row < 4; row++)
+            {
+                float sum{ 0.0f };
+                for (unsigned int k = 0; k < 4; k++)
+                    sum += a[k * 4 + row] * b[column * 4 + k];
+                out[column * 4 + row] = sum;
+            }
+        }
+    }
+
+    void GetNodeMatrix(const JsonValue& node, float* out)
+    {
+        const JsonValue* matrix{ node.Find("matrix") };
+        if (matrix && matrix->Array.size() == 16)
+        {
+            for (unsigned int i = 0; i < 16; i++)
+                out[i] = (float)matrix->Array[i].Number;
+            return;
+        }
+
+        float t[3] { 0.0f, 0.0f, 0.0f }, r[4] { 0.0f, 0.0f, 0.0f, 1.0f }, s[3] { 1.0f, 1.0f, 1.0f };
+        if (const JsonValue* value = node.Find("translation"))
+            for (unsigned int i = 0; i < 3 && i < value->Array.size(); i++) t[i] = (float)value->Array[i].Number;
+        if (const JsonValue* value = node.Find("rotation"))
+            for (unsigned int i = 0; i < 4 && i < value->Array.size(); i++) r[i] = (float)value->Array[i].Number;
+        if (const JsonValue* value = node.Find("scale"))
+            for (unsigned int i = 0; i < 3 && i < value->Array.size(); i++) s[i] = (float)value->Array[i].Number;
+
+        //T * R * S with R from the unit quaternion (x, y, z, w)
+        float x{ r[0] }, y{ r[1] }, z{ r[2] }, w{ r[3] };
+        float rotation[9] {
+            1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + z * w), 2.0f * (x * z - y * w),
+            2.0f * (x * y - z * w), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + x * w),
+            2.0f * (x * z + y * w), 2.0f * (y * z - x * w), 1.0f - 2.0f * (x * x + y * y)
+        };
+        for (unsigned int column = 0; column < 3; column++)
+        {
+            for (unsigned int row = 0; row < 3; row++)
+                out[column * 4 + row] = rotation[column * 3 + row] * s[column];
+            out[column * 4 + 3] = 0.0f;
+        }
+        out[12] = t[0];
+        out[13] = t[1];
+        out[14] = t[2];
+        out[15] = 1.0f;
+    }
+
+    struct GltfPrimitive
+    {
+        const JsonValue* Source;
+        float Transform[16];
+        std::string Material;
+
+        std::vector<MeshVertex> Vertices;
+        std::vector<unsigned int> Indices;
+        const char* Error { nullptr };
+    };
+
+    //an index into an array of count entries, false unless it is a whole number inside it
+    bool GetIndex(const JsonValue& value, size_t count, size_t& out)
+    {
+        if (!value.IsNumber() || value.Number < 0 || value.Number >= count || value.Number != std::floor(value.Number))
+            return false;
+        out = (size_t)value.Number;
+        return true;
+    }
+
+    //visited has an entry per node. glTF nodes have at most one parent, so a node reached twice
+    //is an error, which also keeps cycles from recursing forever
+    const char* CollectNodes(const GltfFile& file, size_t node, const float* parent, std::vector<GltfPrimitive>& primitives,
+        std::vector<unsigned char>& visited, unsigned int depth)
+    {
+        const JsonValue& nodes{ *file.Document.Find("nodes") };
+        if (visited[node])
+            return "node with more than one parent";
+        visited[node] = 1;
+        if (depth > 64)
+            return nullptr;
+        const JsonValue& source{ nodes.Array[node] };
+        float local[16], transform[16];
+        GetNodeMatrix(source, local);
+        Multiply(parent, local, transform);
+
+        const JsonValue* meshes{ file.Document.Find("meshes") };
+        const JsonValue* mesh{ source.Find("mesh") };
+        if (meshes && mesh && mesh->IsNumber() && mesh->Number >= 0 && mesh->Number < meshes->Array.size())
+        {
+            const JsonValue* materials{ file.Document.Find("materials") };
+            if (const JsonValue* list = meshes->Array[(size_t)mesh->Number].Find("primitives"))
+            {
+                for (const JsonValue& primitive : list->Array)
+                {
+                    primitives.emplace_back();
+                    GltfPrimitive& target{ primitives.back() };
+                    target.Source = &primitive;
+                    std::memcpy(target.Transform, transform, sizeof(transform));
+                    double material{ primitive.GetNumber("material", -1.0) };
+                    if (materials && material >= 0 && material < materials->Array.size())
+                    {
+                        target.Material = materials->Array[(size_t)material].GetString("name");
+                        if (target.Material.empty())
+                            target.Material = "material" + std::to_string((size_t)material);
+                    }
+                }
+            }
+        }
+        if (const JsonValue* children = source.Find("children"))
+        {
+            for (const JsonValue& value : children->Array)
+            {
+                size_t child;
+                if (!GetIndex(value, nodes.Array.size(), child))
+                    return "node out of range";
+                if (const char* error = CollectNodes(file, child, transform, primitives, visited, depth + 1))
+                    return error;
+            }
+        }
+        return nullptr;
+    }
+
+    void DecodePrimitive(const GltfFile& file, GltfPrimitive& primitive)
+    {
+        unsigned int mode{ (unsigned int)primitive.Source->GetNumber("mode", 4.0) };
+        if (mode < 4 || mode > 6)
+            return;     //points and lines
+        const JsonValue* attributes{ primitive.Source->Find("attributes") };
+        const JsonValue* positionIndex{ attributes ? attributes->Find("POSITION") : nullptr };
+        if (!positionIndex)
+        {
+            primitive.Error = "primitive without POSITION";
+            return;
+        }
+
+        GltfAccessor positions, texCoords{}, normals{}, indices{};
+        if ((primitive.Error = GetAccessor(file, positionIndex->Number, positions)))
+            return;
+        const JsonValue* texCoordIndex{ attributes->Find("TEXCOORD_0") };
+        if (texCoordIndex && (primitive.Error = GetAccessor(file, texCoordIndex->Number, texCoords)))
+            return;
+        const JsonValue* normalIndex{ attributes->Find("NORMAL") };
+        if (normalIndex && (primitive.Error = GetAccessor(file, normalIndex->Number, normals)))
+            return;
+        const JsonValue* indicesIndex{ primitive.Source->Find("indices") };
+        if (indicesIndex && (primitive.Error = GetAccessor(file, indicesIndex->Number, indices)))
+            return;
+        if ((texCoordIndex && texCoords.Count != positions.Count) || (normalIndex && normals.Count != positions.Count))
+        {
+            primitive.Error = "attributes of different counts";
+            return;
+        }
+
+        //normals go through the inverse transpose, which is the cofactor matrix up to a scale
+        const float* m{ primitive.Transform };
+        float normalMatrix[9];
+        for (unsigned int row = 0; row < 3; row++)
+        {
+            for (unsigned int column = 0; column < 3; column++)
+            {
+                unsigned int r1{ (row + 1) % 3 }, r2{ (row + 2) % 3 }, c1{ (column + 1) % 3 }, c2{ (column + 2) % 3 };
+                normalMatrix[row * 3 + column] = m[c1 * 4 + r1] * m[c2 * 4 + r2] - m[c2 * 4 + r1] * m[c1 * 4 + r2];
+            }
+        }
+        float determinant{ m[0] * normalMatrix[0] + m[4] * normalMatrix[1] + m[8] * normalMatrix[2] };
+
+        primitive.Vertices.resize(positions.Count);
+        for (size_t i = 0; i < positions.Count; i++)
+        {
+            MeshVertex& vertex{ primitive.Vertices[i] };
+            float p[3], n[3];
+            ReadElement(positions, i, p, 3);
+            for (unsigned int row = 0; row < 3; row++)
+                vertex.Position[row] = m[row] * p[0] + m[4 + row] * p[1] + m[8 + row] * p[2] + m[12 + row];
+            ReadElement(texCoords, i, vertex.TexCoord, 2);
+            vertex.TexCoord[1] = 1.0f - vertex.TexCoord[1];
+            ReadElement(normals, i, n, 3);
+            float transformed[3];
+            for (unsigned int row = 0; row < 3; row++)
+                transformed[row] = normalMatrix[row * 3] * n[0] + normalMatrix[row * 3 + 1] * n[1] + normalMatrix[row * 3 + 2] * n[2];
+            Normalize(transformed, vertex.Normal);
+        }
+
+        size_t count{ indicesIndex ? indices.Count : positions.Count };
+        auto index = [&](size_t i) { return indicesIndex ? ReadIndex(indices, i) : (unsigned int)i; };
+        std::vector<unsigned int>& out{ primitive.Indices };
+        if (mode == 4)
+        {
+            out.resize(count - count % 3);
+            for (size_t i = 0; i < out.size(); i++)
+                out[i] = index(i);
+        }
+        else if (count >= 3)
+        {
+            out.reserve((count - 2) * 3);
+            for (size_t i = 0; i + 2 < count; i++)
+            {
+                if (mode == 5)
+                {
+                    //every other strip triangle is wound the other way
+                    out.push_back(index(i));
+                    out.push_back(index(i + 1 + i % 2));
+                    out.push_back(index(i + 2 - i % 2));
+                }
+                else
+                {
+                    out.push_back(index(i + 1));
+                    out.push_back(index(i + 2));
+                    out.push_back(index(0));
+                }
+            }
+        }
+        for (size_t i = 0; i < out.size(); i++)
+        {
+            if (out[i] >= positions.Count)
+            {
+                primitive.Error = "index out of range";
+                return;
+            }
+        }
+        //a mirroring transform turns the triangles inside out
+        if (determinant < 0.0f)
+        {
+            for (size_t i = 0; i + 2 < out.size(); i += 3)
+                std::swap(out[i + 1], out[i + 2]);
+        }
+
+        if (!normalIndex)
+        {
+            std::vector<float> sums(primitive.Vertices.size() * 3, 0.0f);
+            for (size_t i = 0; i + 2 < out.size(); i += 3)
+            {
+                const MeshVertex* v{ primitive.Vertices.data() };
+                float face[3] { 0.0f, 0.0f, 0.0f };
+                AddFaceNormal(v[out[i]].Position, v[out[i + 1]].Position, v[out[i + 2]].Position, face);
+                for (unsigned int corner = 0; corner < 3; corner++)
+                    for (unsigned int axis = 0; axis < 3; axis++)
+                        sums[out[i + corner] * 3 + axis] += face[axis];
+            }
+            for (size_t i = 0; i < primitive.Vertices.size(); i++)
+                Normalize(&sums[i * 3], primitive.Vertices[i].Normal);
+        }
+    }
+
+}
+
+bool LoadObj(const char* text, size_t size, MeshData& mesh, WorkerPool* workers)
+{
+    mesh = MeshData();
+    s_ParsedBytes.Add(size);
+
+    std::vector<ObjChunk> chunks;
+    const char* end{ text + size };
+    for (const char* p = text; p < end;)
+    {
+        const char* chunkEnd{ end };
+        if ((size_t)(end - p) > s_ObjChunkSize)
+        {
+            const char* newline{ (const char*)std::memchr(p + s_ObjChunkSize, '\n', end - p - s_ObjChunkSize) };
+            chunkEnd = newline ? newline + 1 : end;
+        }
+        chunks.emplace_back();
+        chunks.back().Begin = p;
+        chunks.back().End = chunkEnd;
+        p = chunkEnd;
+    }
+    unsigned int chunkCount{ (unsigned int)chunks.size() };
+    ForEach(workers, chunkCount, [&](unsigned int i) { ParseObjChunk(chunks[i]); });
+
+    //counts of earlier chunks resolve relative indices, and line numbers for errors
+    static constexpr unsigned int s_Components[3] { 3, 2, 3 };
+    size_t totals[3] { 0, 0, 0 };
+    size_t corners{ 0 };
+    unsigned int lines{ 0 };
+    for (ObjChunk& chunk : chunks)
+    {
+        if (chunk.Error)
+        {
+            std::cout << "OBJ error on line " << lines + chunk.Lines << ": " << chunk.Error << std::endl;
+            return false;
+        }
+        lines += chunk.Lines;
+        for (unsigned int attribute = 0; attribute < 3; attribute++)
+        {
+            chunk.Bases[attribute] = totals[attribute];
+            totals[attribute] += chunk.Attributes[attribute].size() / s_Components[attribute];
+        }
+        chunk.FirstCorner = corners;
+        corners += chunk.Corners.size();
+    }
+    if (corners == 0)
+    {
+        std::cout << "OBJ has no faces" << std::endl;
+        return false;
+    }
+    if (corners > UINT_MAX || totals[0] > INT_MAX || totals[1] > INT_MAX || totals[2] > INT_MAX)
+    {
+        std::cout << "OBJ is too large for 32 bit indices" << std::endl;
+        return false;
+    }
+
+    std::vector<float> attributes[3];
+    for (unsigned int attribute = 0; attribute < 3; attribute++)
+        attributes[attribute].resize(totals[attribute] * s_Components[attribute]);
+    std::vector<unsigned char> resolved(chunkCount);
+    ForEach(workers, chunkCount, [&](unsigned int i) {
+        ObjChunk& chunk{ chunks[i] };
+        for (unsigned int attribute = 0; attribute < 3; attribute++)
+        {
+            std::vector<float>& source{ chunk.Attributes[attribute] };
+            std::copy(source.begin(), source.end(), attributes[attribute].begin() + chunk.Bases[attribute] * s_Components[attribute]);
+            std::vector<float>().swap(source);
+        }
+        resolved[i] = ResolveObjChunk(chunk, totals);
+    });
+    if (std::find(resolved.begin(), resolved.end(), 0) != resolved.end())
+    {
+        std::cout << "OBJ face index out of range" << std::endl;
+        return false;
+    }
+
+    //chunks were welded on their own, merging them in order keeps vertices in order of first
+    //use, so the result does not depend on the chunking
+    size_t unique{ 0 };
+    for (const ObjChunk& chunk : chunks)
+        unique += chunk.Unique.size();
+    CornerMap map(unique);
+    std::vector<const ObjCorner*> keys;
+    keys.reserve(unique);
+    for (ObjChunk& chunk : chunks)
+    {
+        chunk.Remap.resize(chunk.Unique.size());
+        for (size_t i = 0; i < chunk.Unique.size(); i++)
+        {
+            unsigned int vertex{ map.Insert(chunk.Unique[i].Attributes, (unsigned int)keys.size()) };
+            if (vertex == keys.size())
+                keys.push_back(&chunk.Unique[i]);
+            chunk.Remap[i] = vertex;
+        }
+    }
+
+    mesh.Indices.resize(corners);
+    ForEach(workers, chunkCount, [&](unsigned int i) {
+        ObjChunk& chunk{ chunks[i] };
+        for (size_t corner = 0; corner < chunk.Local.size(); corner++)
+            mesh.Indices[chunk.FirstCorner + corner] = chunk.Remap[chunk.Local[corner]];
+    });
+
+    bool missingNormals{ false };
+    mesh.Vertices.resize(keys.size());
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        const int* key{ keys[i]->Attributes };
+        MeshVertex& vertex{ mesh.Vertices[i] };
+        std::copy_n(&attributes[0][(size_t)key[0] * 3], 3, vertex.Position);
+        if (key[1] >= 0)
+            std::copy_n(&attributes[1][(size_t)key[1] * 2], 2, vertex.TexCoord);
+        else
+            vertex.TexCoord[0] = vertex.TexCoord[1] = 0.0f;
+        if (key[2] >= 0)
+            std::copy_n(&attributes[2][(size_t)key[2] * 3], 3, vertex.Normal);
+        else
+            missingNormals = true;
+    }
+
+    //smooth normals are shared by every vertex at a position, whatever its uv
+    if (missingNormals)
+    {
+        std::vector<float> sums(totals[0] * 3, 0.0f);
+        for (size_t i = 0; i < corners; i += 3)
+        {
+            const int* a{ keys[mesh.Indices[i]]->Attributes };
+            const int* b{ keys[mesh.Indices[i + 1]]->Attributes };
+            const int* c{ keys[mesh.Indices[i + 2]]->Attributes };
+            float face[3] { 0.0f, 0.0f, 0.0f };
+            AddFaceNormal(&attributes[0][(size_t)a[0] * 3], &attributes[0][(size_t)b[0] * 3], &attributes[0][(size_t)c[0] * 3], face);
+            for (const int* key : { a, b, c })
+                for (unsigned int axis = 0; axis < 3; axis++)
+                    sums[(size_t)key[0] * 3 + axis] += face[axis];
+        }
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            const int* key{ keys[i]->Attributes };
+            if (key[2] < 0)
+                Normalize(&sums[(size_t)key[0] * 3], mesh.Vertices[i].Normal);
+        }
+    }
+
+    std::string material;
+    size_t start{ 0 };
+    for (const ObjChunk& chunk : chunks)
+    {
+        for (const ObjMaterialSwitch& change : chunk.Materials)
+        {
+            size_t first{ chunk.FirstCorner + change.FirstCorner };
+            AddPart(mesh, material, (unsigned int)start, (unsigned int)(first - start));
+            material = change.Name;
+            start = first;
+        }
+    }
+    AddPart(mesh, material, (unsigned int)start, (unsigned int)(corners - start));
+
+    ComputeBounds(mesh);
+    return true;
+}
+
+bool LoadGltf(const unsigned char* data, size_t size, const std::string& directory, MeshData& mesh, WorkerPool* workers)
+{
+    mesh = MeshData();
+    s_ParsedBytes.Add(size);
+
+    //a GLB is a 12 byte header and chunks of { length, type, data }: JSON first, then BIN
+    const char* json{ (const char*)data };
+    size_t jsonSize{ size };
+    const unsigned char* bin{ nullptr };
+    size_t binSize{ 0 };
+    if (size >= 12 && std::memcmp(data, "glTF", 4) == 0)
+    {
+        unsigned int header[3];
+        std::memcpy(header, data, sizeof(header));
+        if (header[1] != 2 || header[2] > size)
+        {
+            std::cout << "Unsupported GLB version or truncated file" << std::endl;
+            return false;
+        }
+        jsonSize = 0;
+        for (size_t offset = 12; offset + 8 <= header[2];)
+        {
+            unsigned int chunk[2];
+            std::memcpy(chunk, data + offset, sizeof(chunk));
+            offset += 8;
+            if (chunk[0] > header[2] - offset)
+            {
+                std::cout << "GLB chunk is truncated" << std::endl;
+                return false;
+            }
+            if (chunk[1] == 0x4e4f534a && !jsonSize)
+            {
+                json = (const char*)data + offset;
+                jsonSize = chunk[0];
+            }
+            else if (chunk[1] == 0x004e4942 && !bin)
+            {
+                bin = data + offset;
+                binSize = chunk[0];
+            }
+            offset += chunk[0];
+        }
+        if (!jsonSize)
+        {
+            std::cout << "GLB has no JSON chunk" << std::endl;
+            return false;
+        }
+    }
+
+    GltfFile file;
+    if (!ParseJson(json, jsonSize, file.Document) || !LoadGltfBuffers(file, bin, binSize, directory))
+        return false;
+
+    std::vector<GltfPrimitive> primitives;
+    const JsonValue* nodes{ file.Document.Find("nodes") };
+    std::vector<unsigned char> visited(nodes ? nodes->Array.size() : 0, 0);
+    const char* error{ nullptr };
+    const float identity[16] { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+    const JsonValue* scenes{ file.Document.Find("scenes") };
+    double scene{ file.Document.GetNumber("scene", 0.0) };
+    if (scenes && scene >= 0 && scene < scenes->Array.size())
+    {
+        if (const JsonValue* roots = scenes->Array[(size_t)scene].Find("nodes"))
+        {
+            size_t root;
+            for (size_t i = 0; i < roots->Array.size() && !error; i++)
+            {
+                if (!GetIndex(roots->Array[i], visited.size(), root))
+                    error = "node out of range";
+                else
+                    error = CollectNodes(file, root, identity, primitives, visited, 0);
+            }
+        }
+    }
+    else if (nodes)
+    {
+        //no scene, take every node nobody lists as a child. bad child indices fail once their
+        //parent is collected
+        std::vector<unsigned char> child(nodes->Array.size(), 0);
+        size_t index;
+        for (const JsonValue& node : nodes->Array)
+            if (const JsonValue* children = node.Find("children"))
+                for (const JsonValue& value : children->Array)
+                    if (GetIndex(value, child.size(), index))
+                        child[index] = 1;
+        for (size_t i = 0; i < child.size() && !error; i++)
+            if (!child[i])
+                error = CollectNodes(file, i, identity, primitives, visited, 0);
+    }
+    if (error)
+    {
+        std::cout << "glTF error: " << error << std::endl;
+        return false;
+    }
+
+    ForEach(workers, (unsigned int)primitives.size(), [&](unsigned int i) { DecodePrimitive(file, primitives[i]); });
+
+    size_t vertices{ 0 }, indices{ 0 };
+    for (const GltfPrimitive& primitive : primitives)
+    {
+        if (primitive.Error)
+        {
+            std::cout << "glTF error: " << primitive.Error << std::endl;
+            return false;
+        }
+        vertices += primitive.Vertices.size();
+        indices += primitive.Indices.size();
+    }
+    if (indices == 0)
+    {
+        std::cout << "glTF has no triangles" << std::endl;
+        return false;
+    }
+    if (vertices > UINT_MAX || indices > UINT_MAX)
+    {
+        std::cout << "glTF is too large for 32 bit indices" << std::endl;
+        return false;
+    }
+
+    mesh.Vertices.reserve(vertices);
+    mesh.Indices.reserve(indices);
+    for (const GltfPrimitive& primitive : primitives)
+    {
+        unsigned int baseVertex{ (unsigned int)mesh.Vertices.size() };
+        unsigned int firstIndex{ (unsigned int)mesh.Indices.size() };
+        mesh.Vertices.insert(mesh.Vertices.end(), primitive.Vertices.begin(), primitive.Vertices.end());
+        for (unsigned int index : primitive.Indices)
+            mesh.Indices.push_back(baseVertex + index);
+        AddPart(mesh, primitive.Material, firstIndex, (unsigned int)primitive.Indices.size());
+    }
+    ComputeBounds(mesh);
+    return true;
+}
+
+bool LoadMesh(const std::string& filepath, const unsigned char* data, size_t size, MeshData& mesh, WorkerPool* workers)
+{
+    size_t dot{ filepath.find_last_of('.') };
+    std::string extension{ dot == std::string::npos ? "" : filepath.substr(dot + 1) };
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    size_t slash{ filepath.find_last_of("/\\") };
+    std::string directory{ slash == std::string::npos ? "" : filepath.substr(0, slash + 1) };
+
+    bool loaded;
+    if (extension == "obj")
+        loaded = LoadObj((const char*)data, size, mesh, workers);
+    else if (extension == "gltf" || extension == "glb")
+        loaded = LoadGltf(data, size, directory, mesh, workers);
+    else
+    {
+        std::cout << "Unknown mesh format " << filepath << std::endl;
+        mesh = MeshData();
+        return false;
+    }
+    if (!loaded)
+    {
+        std::cout << "Failed to load mesh " << filepath << std::endl;
+        mesh = MeshData();
+    }
+    return loaded;
+}
+
+bool LoadMesh(const std::string& filepath, MeshData& mesh, WorkerPool* workers)
+{
+    //parsed straight out of the page cache or the pack
+    VirtualFile file;
+    if (!FileSystem::Get().Open(filepath, file))
+    {
+        std::cout << "Failed to open mesh " << filepath << std::endl;
+        mesh = MeshData();
+        return false;
+    }
+    return LoadMesh(filepath, file.GetData(), file.GetSize(), mesh, workers);
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "VertexBufferLayout.h"
+#include "WorkerPool.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+//one interleaved vertex of an imported mesh. position comes first and the texture coordinate
+//second, so shaders written for the pos/uv quad (locations 0 and 1) draw meshes unchanged
+struct MeshVertex
+{
+	float Position[3];
+	float TexCoord[2];
+	float Normal[3];
+};
+
+//a run of indices drawn with one material (an OBJ usemtl block, a glTF primitive)
+struct MeshPart
+{
+	std::string Material;
+	unsigned int FirstIndex;
+	unsigned int IndexCount;
+};
+
+//welded, indexed triangles ready for VertexBuffer/IndexBuffer
+struct MeshData
+{
+	std::vector<MeshVertex> Vertices;
+	std::vector<unsigned int> Indices;
+	std::vector<MeshPart> Parts;
+	float BoundsMin[3] { 0.0f, 0.0f, 0.0f };
+	float BoundsMax[3] { 0.0f, 0.0f, 0.0f };
+
+	inline unsigned int GetVertexCount() const { return (unsigned int)Vertices.size(); }
+	inline unsigned int GetIndexCount() const { return (unsigned int)Indices.size(); }
+	inline unsigned int GetVertexBytes() const { return (unsigned int)(Vertices.size() * sizeof(MeshVertex)); }
+
+	static VertexBufferLayout GetLayout()
+	{
+		VertexBufferLayout layout;
+		layout.Push<float>(3);
+		layout.Push<float>(2);
+		layout.Push<float>(3);
+		return layout;
+	}
+};
+
+//picks the importer by extension: .obj, .gltf (external or data: URI buffers) or .glb.
+//with workers the parsing is spread over the pool, the result is the same either way.
+//safe to call from any thread, failures print why on std::cout and leave the mesh empty
+bool LoadMesh(const std::string& filepath, MeshData& mesh, WorkerPool* workers = nullptr);
+//the same on the file's contents already in memory, filepath picks the importer and resolves
+//relative glTF buffers
+bool LoadMesh(const std::string& filepath, const unsigned char* data, size_t size, MeshData& mesh,
+	WorkerPool* workers = nullptr);
+
+//Wavefront OBJ: v/vt/vn/f and usemtl, polygons are fanned into triangles and identical
+//position/uv/normal corners are welded into one vertex. missing normals are smoothed per position
+bool LoadObj(const char* text, size_t size, MeshData& mesh, WorkerPool* workers = nullptr);
+
+//glTF 2.0, JSON or GLB. directory resolves relative buffer URIs. every triangle primitive of the
+//default scene is baked into one mesh in world space, texture coordinates are flipped to the
+//bottom-up convention of Image
+bool LoadGltf(const unsigned char* data, size_t size, const std::string& directory, MeshData& mesh,
+	WorkerPool* workers = nullptr);
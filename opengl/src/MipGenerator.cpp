@@ -0,0 +1,270 @@
+#include "MipGenerator.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIP_GENERATOR_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace {
+
+    //one RGBA pixel as floats
+    struct Pixel
+    {
+#ifdef MIP_GENERATOR_SSE2
+        __m128 V;
+#else
+        float V[4];
+#endif
+    };
+
+#ifdef MIP_GENERATOR_SSE2
+    inline Pixel Zero() { return { _mm_setzero_ps() }; }
+    inline Pixel Load(const float* values) { return { _mm_loadu_ps(values) }; }
+    inline void Store(Pixel pixel, float* values) { _mm_storeu_ps(values, pixel.V); }
+    inline Pixel MultiplyAdd(Pixel sum, Pixel pixel, float weight) { return { _mm_add_ps(sum.V, _mm_mul_ps(pixel.V, _mm_set1_ps(weight))) }; }
+    inline Pixel Saturate(Pixel pixel) { return { _mm_min_ps(_mm_max_ps(pixel.V, _mm_setzero_ps()), _mm_set1_ps(1.0f)) }; }
+#else
+    inline Pixel Zero() { return { { 0.0f, 0.0f, 0.0f, 0.0f } }; }
+    inline Pixel Load(const float* values) { Pixel pixel; std::memcpy(pixel.V, values, sizeof(pixel.V)); return pixel; }
+    inline void Store(Pixel pixel, float* values) { std::memcpy(values, pixel.V, sizeof(pixel.V)); }
+    inline Pixel MultiplyAdd(Pixel sum, Pixel pixel, float weight)
+    {
+        for (unsigned int c = 0; c < 4; c++)
+            sum.V[c] += pixel.V[c] * weight;
+        return sum;
+    }
+    inline Pixel Saturate(Pixel pixel)
+    {
+        for (float& value : pixel.V)
+            value = std::min(std::max(value, 0.0f), 1.0f);
+        return pixel;
+    }
+#endif
+
+    constexpr unsigned int s_EncodeSteps{ 8192 };
+
+    struct Tables
+    {
+        float Linear[256];              //byte / 255
+        float SrgbToLinear[256];
+        unsigned char LinearToSrgb[s_EncodeSteps + 1];
+
+        Tables()
+        {
+            for (unsigned int i = 0; i < 256; i++)
+            {
+                float value{ i / 255.0f };
+                Linear[i] = value;
+                SrgbToLinear[i] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+            }
+            for (unsigned int i = 0; i <= s_EncodeSteps; i++)
+            {
+                float value{ (float)i / s_EncodeSteps };
+                float srgb{ value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f };
+                LinearToSrgb[i] = (unsigned char)std::lround(srgb * 255.0f);
+            }
+        }
+    };
+
+    const Tables& GetTables()
+    {
+        static const Tables s_Tables;
+        return s_Tables;
+    }
+
+    struct Kernel
+    {
+        unsigned int Taps;
+        float Weights[8];
+    };
+
+    float BesselI0(float x)
+    {
+        float sum{ 1.0f }, term{ 1.0f };
+        for (unsigned int k = 1; k < 16; k++)
+        {
+            term *= (x / (2.0f * k)) * (x / (2.0f * k));
+            sum += term;
+        }
+        return sum;
+    }
+
+    //taps sit at -3.5 .. 3.5 source pixels from the destination pixel center
+    const Kernel& GetKernel(MipFilter filter)
+    {
+        static const Kernel s_Box{ 2, { 0.5f, 0.5f } };
+        static const Kernel s_Kaiser{ []() {
+            const float pi{ 3.14159265358979f }, alpha{ 4.0f }, radius{ 4.0f };
+            Kernel kernel{ 8, {} };
+            float sum{ 0.0f };
+            for (unsigned int k = 0; k < 8; k++)
+            {
+                float t{ k - 3.5f };
+                float sinc{ std::sin(pi * t * 0.5f) / (pi * t * 0.5f) };
+                float window{ BesselI0(alpha * std::sqrt(1.0f - (t / radius) * (t / radius))) / BesselI0(alpha) };
+                kernel.Weights[k] = sinc * window;
+                sum += kernel.Weights[k];
+            }
+            for (float& weight : kernel.Weights)
+                weight /= sum;
+            return kernel;
+        }() };
+        return filter == MipFilter::Kaiser ? s_Kaiser : s_Box;
+    }
+
+    inline unsigned int ClampIndex(int index, unsigned int size)
+    {
+        return (unsigned int)std::min(std::max(index, 0), (int)size - 1);
+    }
+
+    //2x2 average of 8 bit pixels with rounding, rows [begin, end) of destination
+    void DownsampleBoxRows(const Image& source, Image& destination, unsigned int begin, unsigned int end)
+    {
+        size_t sourceRow{ source.GetRowSize() };
+        //a 1 pixel wide or high source averages with itself
+        unsigned int stepX{ source.Width > 1 ? 4u : 0u };
+        for (unsigned int y = begin; y < end; y++)
+        {
+            const unsigned char* top{ source.Pixels.data() + ClampIndex(2 * y, source.Height) * sourceRow };
+            const unsigned char* bottom{ source.Pixels.data() + ClampIndex(2 * y + 1, source.Height) * sourceRow };
+            unsigned char* dst{ destination.Pixels.data() + y * destination.GetRowSize() };
+            unsigned int x{ 0 };
+            if (stepX)
+            {
+#ifdef __AVX2__
+                const __m256i wideRound{ _mm256_set1_epi16(2) };
+                const __m256i wideZero{ _mm256_setzero_si256() };
+                for (; x + 8 <= destination.Width; x += 8)
+                {
+                    __m256i sums[2];
+                    for (unsigned int half = 0; half < 2; half++)
+                    {
+                        __m256i a{ _mm256_loadu_si256((const __m256i*)(top + (x + half * 4) * 8)) };
+                        __m256i b{ _mm256_loadu_si256((const __m256i*)(bottom + (x + half * 4) * 8)) };
+                        __m256i low{ _mm256_add_epi16(_mm256_unpacklo_epi8(a, wideZero), _mm256_unpacklo_epi8(b, wideZero)) };
+                        __m256i high{ _mm256_add_epi16(_mm256_unpackhi_epi8(a, wideZero), _mm256_unpackhi_epi8(b, wideZero)) };
+                        __m256i sum{ _mm256_add_epi16(_mm256_unpacklo_epi64(low, high), _mm256_unpackhi_epi64(low, high)) };
+                        sums[half] = _mm256_srli_epi16(_mm256_add_epi16(sum, wideRound), 2);
+                    }
+                    //the packs work per 128 bit lane, put the pixels back in order
+                    __m256i packed{ _mm256_permute4x64_epi64(_mm256_packus_epi16(sums[0], sums[1]), 0xd8) };
+                    _mm256_storeu_si256((__m256i*)(dst + x * 4), packed);
+                }
+#endif
+#ifdef MIP_GENERATOR_SSE2
+                const __m128i round{ _mm_set1_epi16(2) };
+                const __m128i zero{ _mm_setzero_si128() };
+                for (; x + 4 <= destination.Width; x += 4)
+                {
+                    __m128i sums[2];
+                    for (unsigned int half = 0; half < 2; half++)
+                    {
+                        //four source pixels of each row; lanes of the sum are 16 bit channels
+                        __m128i a{ _mm_loadu_si128((const __m128i*)(top + (x + half * 2) * 8)) };
+                        __m128i b{ _mm_loadu_si128((const __m128i*)(bottom + (x + half * 2) * 8)) };
+                        __m128i low{ _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero)) };
+                        __m128i high{ _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero)) };
+                        __m128i sum{ _mm_add_epi16(_mm_unpacklo_epi64(low, high), _mm_unpackhi_epi64(low, high)) };
+                        sums[half] = _mm_srli_epi16(_mm_add_epi16(sum, round), 2);
+                    }
+                    _mm_storeu_si128((__m128i*)(dst + x * 4), _mm_packus_epi16(sums[0], sums[1]));
+                }
+#endif
+            }
+            for (; x < destination.Width; x++)
+            {
+                const unsigned char* a{ top + x * 8 };
+                const unsigned char* b{ bottom + x * 8 };
+                for (unsigned int c = 0; c < 4; c++)
+                    dst[x * 4 + c] = (unsigned char)((a[c] + a[c + stepX] + b[c] + b[c + stepX] + 2) / 4);
+            }
+        }
+    }
+
+    //separable filter in floats: the kernel's rows are summed into one linear row, which the
+    //kernel then reduces horizontally
+    void DownsampleFilteredRows(const Image& source, Image& destination, const MipOptions& options,
+        unsigned int begin, unsigned int end)
+    {
+        const Tables& tables{ GetTables() };
+        const float* colorTable{ options.Srgb ? tables.SrgbToLinear : tables.Linear };
+        const Kernel& kernel{ GetKernel(options.Filter) };
+        int firstTap{ 1 - (int)kernel.Taps / 2 };
+        size_t sourceRow{ source.GetRowSize() };
+        std::vector<float> row((size_t)source.Width * 4);
+
+        for (unsigned int y = begin; y < end; y++)
+        {
+            std::fill(row.begin(), row.end(), 0.0f);
+            for (unsigned int tap = 0; tap < kernel.Taps; tap++)
+            {
+                const unsigned char* src{ source.Pixels.data() + ClampIndex(2 * (int)y + firstTap + (int)tap, source.Height) * sourceRow };
+                float weight{ kernel.Weights[tap] };
+                for (unsigned int x = 0; x < source.Width; x++, src += 4)
+                {
+                    float linear[4]{ colorTable[src[0]], colorTable[src[1]], colorTable[src[2]], tables.Linear[src[3]] };
+                    Store(MultiplyAdd(Load(&row[x * 4]), Load(linear), weight), &row[x * 4]);
+                }
+            }
+
+            unsigned char* dst{ destination.Pixels.data() + y * destination.GetRowSize() };
+            for (unsigned int x = 0; x < destination.Width; x++, dst += 4)
+            {
+                Pixel sum{ Zero() };
+                for (unsigned int tap = 0; tap < kernel.Taps; tap++)
+                    sum = MultiplyAdd(sum, Load(&row[ClampIndex(2 * (int)x + firstTap + (int)tap, source.Width) * 4]), kernel.Weights[tap]);
+                float values[4];
+                Store(Saturate(sum), values);
+                for (unsigned int c = 0; c < 3; c++)
+                {
+                    dst[c] = options.Srgb
+                        ? tables.LinearToSrgb[(unsigned int)(values[c] * s_EncodeSteps + 0.5f)]
+                        : (unsigned char)(values[c] * 255.0f + 0.5f);
+                }
+                dst[3] = (unsigned char)(values[3] * 255.0f + 0.5f);
+            }
+        }
+    }
+
+}
+
+void DownsampleImage(const Image& source, Image& destination, const MipOptions& options, WorkerPool* workers)
+{
+    destination.Width = std::max(source.Width / 2, 1u);
+    destination.Height = std::max(source.Height / 2, 1u);
+    destination.Pixels.resize(destination.GetRowSize() * destination.Height);
+
+    auto downsampleRows = [&](unsigned int begin, unsigned int end) {
+        if (options.Filter == MipFilter::Box && !options.Srgb)
+            DownsampleBoxRows(source, destination, begin, end);
+        else
+            DownsampleFilteredRows(source, destination, options, begin, end);
+    };
+    //chunks of roughly 16K destination pixels, small levels stay on this thread
+    if (workers)
+        workers->ParallelFor(destination.Height, std::max(16384 / destination.Width, 1u), downsampleRows);
+    else
+        downsampleRows(0, destination.Height);
+}
+
+void GenerateMipChain(const Image& base, std::vector<Image>& mips, const MipOptions& options, WorkerPool* workers)
+{
+    unsigned int width{ base.Width }, height{ base.Height }, levels{ 0 };
+    while (base.IsValid() && (width > 1 || height > 1))
+    {
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+        levels++;
+    }
+    mips.resize(levels);
+    for (unsigned int level = 0; level < levels; level++)
+        DownsampleImage(level ? mips[level - 1] : base, mips[level], options, workers);
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Image.h"
+
+#include <vector>
+
+class WorkerPool;
+
+enum class MipFilter
+{
+	Box,        //2x2 average
+	Kaiser      //8 tap Kaiser windowed sinc, keeps detail a box filter blurs away
+};
+
+struct MipOptions
+{
+	MipFilter Filter { MipFilter::Box };
+	bool Srgb { false };                //color channels are sRGB encoded and get filtered in linear light, alpha never is
+};
+
+//the CPU side of mipmapping, so the cost does not hide inside glGenerateMipmap. the linear box
+//filter works on 8 bit integers (SSE2, or AVX2 with OPENGL_ENABLE_AVX2), sRGB and Kaiser go
+//through floats one pixel per SSE register. with workers the rows of a level are spread over
+//the pool and the calling thread helps; levels still run one after another
+
+//half the size of source in each dimension, rounded down and at least 1
+void DownsampleImage(const Image& source, Image& destination, const MipOptions& options = {}, WorkerPool* workers = nullptr);
+
+//levels 1.. of base down to 1x1, each made from the one above it
+void GenerateMipChain(const Image& base, std::vector<Image>& mips, const MipOptions& options = {}, WorkerPool* workers = nullptr);
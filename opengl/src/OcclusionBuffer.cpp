@@ -0,0 +1,375 @@
+#include "OcclusionBuffer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+static const ProfilerCounter s_Triangles("Occlusion triangles");
+static const ProfilerCounter s_Occluded("Occlusion objects occluded");
+static const ProfilerCounter s_OcclusionTime("Occlusion us");
+
+//closer to the camera than this (in w) is treated as crossing the near plane
+static const float s_MinW{ 1e-4f };
+//occludees per Cull() job
+static const unsigned int s_BatchSize{ 1024 };
+
+//floor of a screen coordinate clamped to [-1, size] on both sides before the cast, one past the
+//edge is enough to tell a box that leaves the screen. NaN ends up at -1
+static int ToPixel(float value, unsigned int size)
+{
+    return (int)std::min(std::max(-1.0f, std::floor(value)), (float)size);
+}
+
+static unsigned long long MicrosecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return (unsigned long long)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+OcclusionBuffer::OcclusionBuffer(unsigned int width, unsigned int height)
+    : m_TilesX((std::max(width, 1u) + s_TileWidth - 1) / s_TileWidth), m_TilesY((std::max(height, 1u) + s_TileHeight - 1) / s_TileHeight),
+      m_ViewProjection(Mat4::Identity()), m_Stats{}
+{
+    m_Width = m_TilesX * s_TileWidth;
+    m_Height = m_TilesY * s_TileHeight;
+    m_Depth.assign((size_t)m_Width * m_Height, 1.0f);
+    m_TileMax.assign(m_TilesX * m_TilesY, 1.0f);
+    m_Bins.resize(m_TilesX * m_TilesY);
+}
+
+void OcclusionBuffer::Begin(const Mat4& viewProjection)
+{
+    m_ViewProjection = viewProjection;
+    m_Triangles.clear();
+    for (std::vector<unsigned int>& bin : m_Bins)
+        bin.clear();
+    m_Stats = {};
+}
+
+void OcclusionBuffer::AddOccluder(const Vec3* vertices, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount, const Mat4& model)
+{
+    if (m_Clip.size() < vertexCount)
+        m_Clip.resize(vertexCount);
+    ProjectPoints(m_ViewProjection * model, vertices, m_Clip.data(), vertexCount);
+
+    for (unsigned int i = 0; i + 2 < indexCount; i += 3)
+    {
+        float x[3], y[3], z[3];
+        bool clipped{ false };
+        for (unsigned int corner = 0; corner < 3; corner++)
+        {
+            const Vec4& clip{ m_Clip[indices[i + corner]] };
+            if (clip.W < s_MinW)
+            {
+                clipped = true;
+                break;
+            }
+            float inverseW{ 1.0f / clip.W };
+            x[corner] = (clip.X * inverseW * 0.5f + 0.5f) * m_Width;
+            y[corner] = (clip.Y * inverseW * 0.5f + 0.5f) * m_Height;
+            z[corner] = clip.Z * inverseW * 0.5f + 0.5f;
+        }
+        if (clipped)
+            continue;
+
+        //both windings are drawn, counter-clockwise from here on
+        float area{ (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]) };
+        if (area < 0.0f)
+        {
+            std::swap(x[1], x[2]);
+            std::swap(y[1], y[2]);
+            std::swap(z[1], z[2]);
+            area = -area;
+        }
+        if (!(area > 0.0f))
+            continue;
+
+        //pixel centers at + 0.5
+        float minX{ std::ceil(std::min({ x[0], x[1], x[2] }) - 0.5f) }, maxX{ std::floor(std::max({ x[0], x[1], x[2] }) - 0.5f) };
+        float minY{ std::ceil(std::min({ y[0], y[1], y[2] }) - 0.5f) }, maxY{ std::floor(std::max({ y[0], y[1], y[2] }) - 0.5f) };
+        minX = std::max(minX, 0.0f);
+        minY = std::max(minY, 0.0f);
+        maxX = std::min(maxX, (float)m_Width - 1.0f);
+        maxY = std::min(maxY, (float)m_Height - 1.0f);
+        if (minX > maxX || minY > maxY)
+            continue;
+
+        Triangle triangle;
+        for (unsigned int edge = 0; edge < 3; edge++)
+        {
+            unsigned int a{ edge }, b{ (edge + 1) % 3 };
+            triangle.A[edge] = y[a] - y[b];
+            triangle.B[edge] = x[b] - x[a];
+            triangle.C[edge] = -(triangle.A[edge] * x[a] + triangle.B[edge] * y[a]);
+        }
+        //edge 1 (v1 v2) weighs v0, edge 2 (v2 v0) weighs v1, edge 0 (v0 v1) weighs v2
+        float dz1{ (z[1] - z[0]) / area }, dz2{ (z[2] - z[0]) / area };
+        triangle.ZX = triangle.A[2] * dz1 + triangle.A[0] * dz2;
+        triangle.ZY = triangle.B[2] * dz1 + triangle.B[0] * dz2;
+        triangle.ZC = z[0] + triangle.C[2] * dz1 + triangle.C[0] * dz2;
+        triangle.MinX = (unsigned int)minX;
+        triangle.MinY = (unsigned int)minY;
+        triangle.MaxX = (unsigned int)maxX;
+        triangle.MaxY = (unsigned int)maxY;
+
+        unsigned int index{ (unsigned int)m_Triangles.size() };
+        m_Triangles.push_back(triangle);
+        for (unsigned int tileY = triangle.MinY / s_TileHeight; tileY <= triangle.MaxY / s_TileHeight; tileY++)
+        {
+            for (unsigned int tileX = triangle.MinX / s_TileWidth; tileX <= triangle.MaxX / s_TileWidth; tileX++)
+                m_Bins[tileY * m_TilesX + tileX].push_back(index);
+        }
+    }
+}
+
+void OcclusionBuffer::Rasterize(WorkerPool* workers)
+{
+    auto start{ std::chrono::steady_clock::now() };
+    unsigned int tiles{ m_TilesX * m_TilesY };
+    if (workers && workers->GetThreadCount() > 0 && !m_Triangles.empty())
+    {
+        workers->ParallelFor(tiles, 1, [this](unsigned int begin, unsigned int end) {
+            for (unsigned int tile = begin; tile < end; tile++)
+                RasterizeTile(tile);
+        });
+    }
+    else
+    {
+        for (unsigned int tile = 0; tile < tiles; tile++)
+            RasterizeTile(tile);
+    }
+    m_Stats.Triangles = (unsigned int)m_Triangles.size();
+    m_Stats.RasterMicroseconds = MicrosecondsSince(start);
+    s_Triangles.Add(m_Stats.Triangles);
+    s_OcclusionTime.Add(m_Stats.RasterMicroseconds);
+}
+
+void OcclusionBuffer::RasterizeTile(unsigned int tile)
+{
+    unsigned int tileX{ tile % m_TilesX * s_TileWidth }, tileY{ tile / m_TilesX * s_TileHeight };
+    for (unsigned int y = tileY; y < tileY + s_TileHeight; y++)
+        std::fill_n(&m_Depth[(size_t)y * m_Width + tileX], s_TileWidth, 1.0f);
+
+    for (unsigned int index : m_Bins[tile])
+    {
+        const Triangle& triangle{ m_Triangles[index] };
+        unsigned int x0{ std::max(triangle.MinX, tileX) }, x1{ std::min(triangle.MaxX, tileX + s_TileWidth - 1) };
+        unsigned int y0{ std::max(triangle.MinY, tileY) }, y1{ std::min(triangle.MaxY, tileY + s_TileHeight - 1) };
+        for (unsigned int y = y0; y <= y1; y++)
+        {
+            float* row{ &m_Depth[(size_t)y * m_Width] };
+            float py{ y + 0.5f };
+            unsigned int x{ x0 };
+            //pixels left of the triangle in the first block fail an edge test, the tile width is
+            //a multiple of the block so blocks never leave the tile
+#if defined(__AVX2__)
+            {
+                __m256 offsets{ _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f) };
+                __m256 zero{ _mm256_setzero_ps() };
+                __m256 a0{ _mm256_set1_ps(triangle.A[0]) }, a1{ _mm256_set1_ps(triangle.A[1]) }, a2{ _mm256_set1_ps(triangle.A[2]) };
+                __m256 r0{ _mm256_set1_ps(triangle.B[0] * py + triangle.C[0]) };
+                __m256 r1{ _mm256_set1_ps(triangle.B[1] * py + triangle.C[1]) };
+                __m256 r2{ _mm256_set1_ps(triangle.B[2] * py + triangle.C[2]) };
+                __m256 zx{ _mm256_set1_ps(triangle.ZX) }, zr{ _mm256_set1_ps(triangle.ZY * py + triangle.ZC) };
+                for (x = x0 & ~7u; x <= x1; x += 8)
+                {
+                    __m256 px{ _mm256_add_ps(_mm256_set1_ps((float)x), offsets) };
+                    __m256 inside{ _mm256_and_ps(_mm256_and_ps(
+                        _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(a0, px), r0), zero, _CMP_GE_OQ),
+                        _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(a1, px), r1), zero, _CMP_GE_OQ)),
+                        _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(a2, px), r2), zero, _CMP_GE_OQ)) };
+                    __m256 depth{ _mm256_loadu_ps(row + x) };
+                    __m256 z{ _mm256_add_ps(_mm256_mul_ps(zx, px), zr) };
+                    _mm256_storeu_ps(row + x, _mm256_blendv_ps(depth, _mm256_min_ps(depth, z), inside));
+                }
+            }
+#elif defined(VECTOR_MATH_SSE2)
+            {
+                __m128 offsets{ _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f) };
+                __m128 zero{ _mm_setzero_ps() };
+                __m128 a0{ _mm_set1_ps(triangle.A[0]) }, a1{ _mm_set1_ps(triangle.A[1]) }, a2{ _mm_set1_ps(triangle.A[2]) };
+                __m128 r0{ _mm_set1_ps(triangle.B[0] * py + triangle.C[0]) };
+                __m128 r1{ _mm_set1_ps(triangle.B[1] * py + triangle.C[1]) };
+                __m128 r2{ _mm_set1_ps(triangle.B[2] * py + triangle.C[2]) };
+                __m128 zx{ _mm_set1_ps(triangle.ZX) }, zr{ _mm_set1_ps(triangle.ZY * py + triangle.ZC) };
+                for (x = x0 & ~3u; x <= x1; x += 4)
+                {
+                    __m128 px{ _mm_add_ps(_mm_set1_ps((float)x), offsets) };
+                    __m128 inside{ _mm_and_ps(_mm_and_ps(
+                        _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a0, px), r0), zero),
+                        _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a1, px), r1), zero)),
+                        _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a2, px), r2), zero)) };
+                    __m128 depth{ _mm_loadu_ps(row + x) };
+                    __m128 z{ _mm_min_ps(depth, _mm_add_ps(_mm_mul_ps(zx, px), zr)) };
+                    _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, z), _mm_andnot_ps(inside, depth)));
+                }
+            }
+#endif
+            for (; x <= x1; x++)
+            {
+                float px{ x + 0.5f };
+                if (triangle.A[0] * px + triangle.B[0] * py + triangle.C[0] >= 0.0f &&
+                    triangle.A[1] * px + triangle.B[1] * py + triangle.C[1] >= 0.0f &&
+                    triangle.A[2] * px + triangle.B[2] * py + triangle.C[2] >= 0.0f)
+                    row[x] = std::min(row[x], triangle.ZX * px + triangle.ZY * py + triangle.ZC);
+            }
+        }
+    }
+
+    float farthest{ 0.0f };
+    for (unsigned int y = tileY; y < tileY + s_TileHeight; y++)
+    {
+        const float* row{ &m_Depth[(size_t)y * m_Width + tileX] };
+        for (unsigned int x = 0; x < s_TileWidth; x++)
+            farthest = std::max(farthest, row[x]);
+    }
+    m_TileMax[tile] = farthest;
+}
+
+bool OcclusionBuffer::ProjectBox(const Vec3& center, const Vec3& extents, int& minX, int& minY, int& maxX, int& maxY, float& nearest) const
+{
+    Vec3 corners[8];
+    for (unsigned int i = 0; i < 8; i++)
+    {
+        corners[i] = { center.X + (i & 1 ? extents.X : -extents.X), center.Y + (i & 2 ? extents.Y : -extents.Y),
+            center.Z + (i & 4 ? extents.Z : -extents.Z) };
+    }
+    Vec4 clip[8];
+    ProjectPoints(m_ViewProjection, corners, clip, 8);
+
+    unsigned int behind{ 0 };
+    for (const Vec4& corner : clip)
+        behind += corner.W < s_MinW;
+    if (behind == 8)
+    {
+        //all of it behind the camera, an empty rectangle
+        minX = minY = 0;
+        maxX = maxY = -1;
+        nearest = 1.0f;
+        return true;
+    }
+    if (behind > 0)
+        return false;
+
+    float lowX{ 1e30f }, lowY{ 1e30f }, highX{ -1e30f }, highY{ -1e30f };
+    nearest = 1e30f;
+    for (const Vec4& corner : clip)
+    {
+        float inverseW{ 1.0f / corner.W };
+        float x{ (corner.X * inverseW * 0.5f + 0.5f) * m_Width }, y{ (corner.Y * inverseW * 0.5f + 0.5f) * m_Height };
+        lowX = std::min(lowX, x);
+        highX = std::max(highX, x);
+        lowY = std::min(lowY, y);
+        highY = std::max(highY, y);
+        nearest = std::min(nearest, corner.Z * inverseW * 0.5f + 0.5f);
+    }
+    //every pixel the box touches, not only those whose centers it covers
+    minX = ToPixel(lowX, m_Width);
+    minY = ToPixel(lowY, m_Height);
+    maxX = ToPixel(highX, m_Width);
+    maxY = ToPixel(highY, m_Height);
+    return true;
+}
+
+bool OcclusionBuffer::TestBox(const Vec3& center, const Vec3& extents) const
+{
+    int minX, minY, maxX, maxY;
+    float nearest;
+    if (!ProjectBox(center, extents, minX, minY, maxX, maxY, nearest))
+        return true;
+    minX = std::max(minX, 0);
+    minY = std::max(minY, 0);
+    maxX = std::min(maxX, (int)m_Width - 1);
+    maxY = std::min(maxY, (int)m_Height - 1);
+    if (minX > maxX || minY > maxY)
+        return false;
+
+    //visible as soon as one pixel's occluders are farther than the box's nearest point
+    for (unsigned int tileY = minY / s_TileHeight; tileY <= maxY / s_TileHeight; tileY++)
+    {
+        for (unsigned int tileX = minX / s_TileWidth; tileX <= maxX / s_TileWidth; tileX++)
+        {
+            if (m_TileMax[tileY * m_TilesX + tileX] <= nearest)
+                continue;
+            unsigned int x0{ std::max((unsigned int)minX, tileX * s_TileWidth) }, x1{ std::min((unsigned int)maxX, (tileX + 1) * s_TileWidth - 1) };
+            unsigned int y0{ std::max((unsigned int)minY, tileY * s_TileHeight) }, y1{ std::min((unsigned int)maxY, (tileY + 1) * s_TileHeight - 1) };
+            for (unsigned int y = y0; y <= y1; y++)
+            {
+                const float* row{ &m_Depth[(size_t)y * m_Width] };
+                unsigned int x{ x0 };
+#ifdef VECTOR_MATH_SSE2
+                __m128 z{ _mm_set1_ps(nearest) };
+                for (; x + 4 <= x1 + 1; x += 4)
+                {
+                    if (_mm_movemask_ps(_mm_cmpgt_ps(_mm_loadu_ps(row + x), z)))
+                        return true;
+                }
+#endif
+                for (; x <= x1; x++)
+                {
+                    if (row[x] > nearest)
+                        return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+bool OcclusionBuffer::IsVisible(const Vec3& center, const Vec3& extents)
+{
+    bool visible{ TestBox(center, extents) };
+    m_Stats.Tested++;
+    if (!visible)
+    {
+        m_Stats.Occluded++;
+        s_Occluded.Increment();
+    }
+    return visible;
+}
+
+unsigned int OcclusionBuffer::Cull(const Vec3* centers, const Vec3* extents, const unsigned int* objects, unsigned int count, unsigned int* out, WorkerPool* workers)
+{
+    auto start{ std::chrono::steady_clock::now() };
+    //each batch keeps its visible objects at the front of its own range of out, reading objects
+    //no faster than it writes, then the batches are pulled together
+    unsigned int batches{ (count + s_BatchSize - 1) / s_BatchSize };
+    m_BatchVisible.assign(batches, 0);
+    auto run = [&](unsigned int begin, unsigned int end) {
+        for (unsigned int batch = begin; batch < end; batch++)
+        {
+            unsigned int first{ batch * s_BatchSize }, last{ std::min(count, first + s_BatchSize) };
+            unsigned int visible{ 0 };
+            for (unsigned int i = first; i < last; i++)
+            {
+                unsigned int object{ objects[i] };
+                if (TestBox(centers[object], extents[object]))
+                    out[first + visible++] = object;
+            }
+            m_BatchVisible[batch] = visible;
+        }
+    };
+    if (workers && workers->GetThreadCount() > 0 && batches > 1)
+        workers->ParallelFor(batches, 1, run);
+    else
+        run(0, batches);
+
+    unsigned int visible{ 0 };
+    for (unsigned int batch = 0; batch < batches; batch++)
+    {
+        if (visible != batch * s_BatchSize)
+            std::memmove(out + visible, out + batch * s_BatchSize, m_BatchVisible[batch] * sizeof(unsigned int));
+        visible += m_BatchVisible[batch];
+    }
+
+    m_Stats.Tested += count;
+    m_Stats.Occluded += count - visible;
+    m_Stats.TestMicroseconds += MicrosecondsSince(start);
+    s_Occluded.Add(count - visible);
+    s_OcclusionTime.Add(MicrosecondsSince(start));
+    return visible;
+}
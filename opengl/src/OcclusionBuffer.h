@@ -0,0 +1,79 @@
+#pragma once
+
+#include "VectorMath.h"
+#include "WorkerPool.h"
+
+#include <vector>
+
+struct OcclusionStats
+{
+	unsigned int Triangles;             //binned, after near plane and degenerate rejection
+	unsigned int Tested;
+	unsigned int Occluded;
+	unsigned long long RasterMicroseconds;
+	unsigned long long TestMicroseconds;
+};
+
+//coarse CPU occlusion culling. a few large occluder meshes are rasterized into a low resolution
+//depth buffer split in tiles, the tiles in parallel on a WorkerPool with SIMD over the pixels of
+//a row. every tile also keeps its farthest depth, so testing an occludee box against the buffer
+//mostly stops at the tile level before reading pixels. no GL involved.
+//
+//per frame: Begin(viewProjection), AddOccluder() for each occluder, Rasterize(), then
+//IsVisible()/Cull() for the occludees. depth is z/w mapped to 0 (near) .. 1 (far). occluder
+//triangles crossing the near plane are dropped and occludees crossing it count as visible,
+//either way an object is never hidden by mistake because of it
+class OcclusionBuffer
+{
+public:
+	static constexpr unsigned int s_TileWidth{ 32 };
+	static constexpr unsigned int s_TileHeight{ 16 };
+private:
+	//edge functions A * x + B * y + C >= 0 inside, depth ZX * x + ZY * y + ZC, both in pixels
+	struct Triangle
+	{
+		float A[3], B[3], C[3];
+		float ZX, ZY, ZC;
+		unsigned int MinX, MinY, MaxX, MaxY;    //pixels whose centers it may cover, inclusive
+	};
+
+	unsigned int m_Width;
+	unsigned int m_Height;
+	unsigned int m_TilesX;
+	unsigned int m_TilesY;
+	std::vector<float> m_Depth;                 //row by row
+	std::vector<float> m_TileMax;               //the farthest depth of every tile
+	std::vector<Triangle> m_Triangles;
+	std::vector<std::vector<unsigned int>> m_Bins;      //per tile, into m_Triangles
+	std::vector<Vec4> m_Clip;                   //AddOccluder() scratch
+	std::vector<unsigned int> m_BatchVisible;   //per Cull() batch
+	Mat4 m_ViewProjection;
+	OcclusionStats m_Stats;
+
+	void RasterizeTile(unsigned int tile);
+	//inclusive pixel rectangle and nearest depth of a box, empty when it is all behind the camera.
+	//false when it crosses the near plane
+	bool ProjectBox(const Vec3& center, const Vec3& extents, int& minX, int& minY, int& maxX, int& maxY, float& nearest) const;
+	bool TestBox(const Vec3& center, const Vec3& extents) const;
+public:
+	//both sizes are rounded up to whole tiles, the viewport covers the rounded size
+	OcclusionBuffer(unsigned int width, unsigned int height);
+
+	//clears the depth and the occluders of the previous frame
+	void Begin(const Mat4& viewProjection);
+	//an indexed triangle mesh placed with model. only bins the triangles
+	void AddOccluder(const Vec3* vertices, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount, const Mat4& model);
+	//fills the depth buffer, the tiles spread over workers when given
+	void Rasterize(WorkerPool* workers = nullptr);
+
+	//world space box, false when every pixel it covers is behind the occluders (or off screen)
+	bool IsVisible(const Vec3& center, const Vec3& extents);
+	//keeps the visible ones of objects (indices into centers and extents) in out and returns how
+	//many. out may be objects itself, so it can filter FrustumCuller's visible list in place
+	unsigned int Cull(const Vec3* centers, const Vec3* extents, const unsigned int* objects, unsigned int count, unsigned int* out, WorkerPool* workers = nullptr);
+
+	inline const float* GetDepth() const { return m_Depth.data(); }
+	inline unsigned int GetWidth() const { return m_Width; }
+	inline unsigned int GetHeight() const { return m_Height; }
+	inline const OcclusionStats& GetStats() const { return m_Stats; }
+};
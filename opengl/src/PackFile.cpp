@@ -0,0 +1,256 @@
+#include "PackFile.h"
+#include "Lz4.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+static const char s_Magic[4]{ 'P', 'A', 'C', 'K' };
+static const unsigned int s_Version{ 1 };
+static const unsigned int s_Compressed{ 1 };
+//every entry starts on a page, an uncompressed one maps like a file of its own
+static const unsigned long long s_EntryAlignment{ 4096 };
+
+static unsigned long long AlignUp(unsigned long long value, unsigned long long alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+PackFile::PackFile()
+    : m_Names(nullptr)
+{
+}
+
+bool PackFile::Write(const std::string& packPath, const std::string& directory, WorkerPool* workers, bool compress)
+{
+    struct Source
+    {
+        std::string Name;
+        std::vector<unsigned char> Data;
+        std::vector<unsigned char> Compressed;
+    };
+    std::vector<Source> sources;
+    std::error_code error;
+    for (std::filesystem::recursive_directory_iterator it(directory, error), end; !error && it != end; it.increment(error))
+    {
+        if (it->is_regular_file(error))
+            sources.push_back({ std::filesystem::relative(it->path(), directory, error).generic_string(), {}, {} });
+    }
+    if (error)
+    {
+        std::cout << "Failed to list " << directory << ": " << error.message() << std::endl;
+        return false;
+    }
+    std::sort(sources.begin(), sources.end(), [](const Source& a, const Source& b) { return a.Name < b.Name; });
+
+    //read and compress one entry per job, a failed read leaves the name empty
+    auto prepare = [&sources, &directory, compress](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; i++)
+        {
+            Source& source{ sources[i] };
+            std::ifstream stream(std::filesystem::path(directory) / source.Name, std::ios::binary | std::ios::ate);
+            if (!stream)
+            {
+                source.Name.clear();
+                continue;
+            }
+            source.Data.resize((size_t)stream.tellg());
+            stream.seekg(0);
+            stream.read((char*)source.Data.data(), source.Data.size());
+            if (!stream)
+            {
+                source.Name.clear();
+                continue;
+            }
+            //only worth a decompression when it saves at least an eighth
+            if (compress)
+                Lz4Compress(source.Data.data(), source.Data.size(), source.Compressed);
+            if (source.Compressed.size() + source.Data.size() / 8 > source.Data.size())
+                source.Compressed = std::vector<unsigned char>();
+        }
+    };
+    if (workers)
+        workers->ParallelFor((unsigned int)sources.size(), 1, prepare);
+    else
+        prepare(0, (unsigned int)sources.size());
+
+    std::string names;
+    std::vector<Entry> entries;
+    for (const Source& source : sources)
+    {
+        if (source.Name.empty())
+        {
+            std::cout << "Failed to read a file under " << directory << std::endl;
+            return false;
+        }
+        Entry entry{};
+        entry.PathHash = HashPath(source.Name);
+        entry.Size = source.Data.size();
+        entry.StoredSize = source.Compressed.empty() ? source.Data.size() : source.Compressed.size();
+        entry.Flags = source.Compressed.empty() ? 0 : s_Compressed;
+        entry.NameOffset = (unsigned int)names.size();
+        entry.NameLength = (unsigned int)source.Name.size();
+        names += source.Name;
+        entries.push_back(entry);
+    }
+
+    Header header{};
+    std::copy_n(s_Magic, 4, header.Magic);
+    header.Version = s_Version;
+    header.EntryCount = (unsigned int)entries.size();
+    header.NamesSize = (unsigned int)names.size();
+    header.EntriesOffset = sizeof(Header);
+    header.NamesOffset = header.EntriesOffset + entries.size() * sizeof(Entry);
+    unsigned long long offset{ header.NamesOffset + names.size() };
+    for (Entry& entry : entries)
+    {
+        offset = AlignUp(offset, s_EntryAlignment);
+        entry.Offset = offset;
+        offset += entry.StoredSize;
+    }
+
+    //data stays in name order, the table is sorted for the binary search in Find()
+    std::vector<unsigned int> order(entries.size());
+    for (unsigned int i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&entries, &sources](unsigned int a, unsigned int b) {
+        if (entries[a].PathHash != entries[b].PathHash)
+            return entries[a].PathHash < entries[b].PathHash;
+        return sources[a].Name < sources[b].Name;
+    });
+
+    std::ofstream stream(packPath, std::ios::binary);
+    if (!stream)
+    {
+        std::cout << "Failed to write pack " << packPath << std::endl;
+        return false;
+    }
+    auto pad = [&stream](unsigned long long to) {
+        static const char s_Zeros[s_EntryAlignment]{};
+        stream.write(s_Zeros, (std::streamsize)(to - (unsigned long long)stream.tellp()));
+    };
+    stream.write((const char*)&header, sizeof(header));
+    for (unsigned int i : order)
+        stream.write((const char*)&entries[i], sizeof(Entry));
+    stream.write(names.data(), names.size());
+    for (unsigned int i = 0; i < entries.size(); i++)
+    {
+        const std::vector<unsigned char>& data{ sources[i].Compressed.empty() ? sources[i].Data : sources[i].Compressed };
+        pad(entries[i].Offset);
+        stream.write((const char*)data.data(), data.size());
+    }
+    if (!stream)
+    {
+        std::cout << "Failed to write pack " << packPath << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool PackFile::Open(const std::string& filepath)
+{
+    Close();
+    if (!m_File.Open(filepath))
+    {
+        std::cout << "Failed to open pack " << filepath << std::endl;
+        return false;
+    }
+
+    const unsigned char* data{ m_File.GetData() };
+    unsigned long long size{ m_File.GetSize() };
+    auto fail = [this, &filepath](const char* reason) {
+        std::cout << "Bad pack " << filepath << ": " << reason << std::endl;
+        Close();
+        return false;
+    };
+    Header header;
+    if (size < sizeof(Header))
+        return fail("truncated header");
+    std::memcpy(&header, data, sizeof(Header));
+    if (std::memcmp(header.Magic, s_Magic, sizeof(s_Magic)) != 0)
+        return fail("not a pack");
+    if (header.Version != s_Version)
+        return fail("unsupported version");
+    if (header.EntriesOffset > size || header.EntryCount > (size - header.EntriesOffset) / sizeof(Entry) ||
+        header.NamesOffset > size || header.NamesSize > size - header.NamesOffset)
+        return fail("table of contents outside of the file");
+
+    m_Entries.resize(header.EntryCount);
+    if (header.EntryCount)
+        std::memcpy(m_Entries.data(), data + header.EntriesOffset, header.EntryCount * sizeof(Entry));
+    m_Names = (const char*)data + header.NamesOffset;
+    for (unsigned int i = 0; i < header.EntryCount; i++)
+    {
+        const Entry& entry{ m_Entries[i] };
+        if (entry.Offset > size || entry.StoredSize > size - entry.Offset ||
+            entry.NameOffset > header.NamesSize || entry.NameLength > header.NamesSize - entry.NameOffset ||
+            entry.Flags & ~s_Compressed || (!(entry.Flags & s_Compressed) && entry.StoredSize != entry.Size) ||
+            entry.Size / 255 > entry.StoredSize)    //more than LZ4 can expand to
+            return fail("bad entry");
+        if (i > 0 && entry.PathHash < m_Entries[i - 1].PathHash)
+            return fail("table of contents not sorted");
+    }
+    return true;
+}
+
+void PackFile::Close()
+{
+    m_File.Close();
+    m_Entries.clear();
+    m_Names = nullptr;
+}
+
+int PackFile::Find(const std::string& path) const
+{
+    unsigned long long hash{ HashPath(path) };
+    auto it{ std::lower_bound(m_Entries.begin(), m_Entries.end(), hash,
+        [](const Entry& entry, unsigned long long value) { return entry.PathHash < value; }) };
+    for (; it != m_Entries.end() && it->PathHash == hash; ++it)
+    {
+        if (it->NameLength == path.size() && std::memcmp(m_Names + it->NameOffset, path.data(), path.size()) == 0)
+            return (int)(it - m_Entries.begin());
+    }
+    return -1;
+}
+
+std::string PackFile::GetName(unsigned int index) const
+{
+    return std::string(m_Names + m_Entries[index].NameOffset, m_Entries[index].NameLength);
+}
+
+bool PackFile::IsCompressed(unsigned int index) const
+{
+    return (m_Entries[index].Flags & s_Compressed) != 0;
+}
+
+const unsigned char* PackFile::GetData(unsigned int index) const
+{
+    return IsCompressed(index) ? nullptr : m_File.GetData() + m_Entries[index].Offset;
+}
+
+bool PackFile::Read(unsigned int index, unsigned char* out) const
+{
+    const Entry& entry{ m_Entries[index] };
+    const unsigned char* stored{ m_File.GetData() + entry.Offset };
+    if (!IsCompressed(index))
+    {
+        if (entry.Size)
+            std::memcpy(out, stored, (size_t)entry.Size);
+        return true;
+    }
+    return Lz4Decompress(out, (size_t)entry.Size, stored, (size_t)entry.StoredSize);
+}
+
+//FNV-1a, paths are short
+unsigned long long PackFile::HashPath(const std::string& path)
+{
+    unsigned long long hash{ 0xcbf29ce484222325ull };
+    for (char c : path)
+    {
+        hash ^= (unsigned char)c;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "MappedFile.h"
+#include "WorkerPool.h"
+
+#include <string>
+#include <vector>
+
+//many files in one read-only archive: a table of contents sorted by path hash, a names
+//section, then every entry's data on its own 4096 byte aligned offset. entries are stored
+//LZ4 compressed when that saves enough, as they are otherwise; those are read straight out
+//of the mapping. paths are relative to the packed directory with '/' separators
+class PackFile
+{
+private:
+	struct Header
+	{
+		char Magic[4];
+		unsigned int Version;
+		unsigned int EntryCount;
+		unsigned int NamesSize;
+		unsigned long long EntriesOffset;
+		unsigned long long NamesOffset;
+	};
+
+	struct Entry
+	{
+		unsigned long long PathHash;
+		unsigned long long Offset;
+		unsigned long long Size;                //of the file
+		unsigned long long StoredSize;          //in the pack, == Size unless compressed
+		unsigned int NameOffset;                //into the names section
+		unsigned int NameLength;
+		unsigned int Flags;
+		unsigned int Reserved;
+	};
+
+	MappedFile m_File;
+	std::vector<Entry> m_Entries;
+	const char* m_Names;
+public:
+	PackFile();
+
+	PackFile(const PackFile&) = delete;
+	PackFile& operator=(const PackFile&) = delete;
+
+	//packs every regular file under directory. with workers the entries are compressed on the
+	//pool, the pack is the same either way. false (and prints why) when a file cannot be read
+	static bool Write(const std::string& packPath, const std::string& directory, WorkerPool* workers = nullptr,
+		bool compress = true);
+
+	//maps the pack and checks the table of contents. false (and prints why) otherwise
+	bool Open(const std::string& filepath);
+	void Close();
+	inline bool IsOpen() const { return m_File.IsOpen(); }
+
+	//index of the entry, -1 when there is none. path is in the pack's form ("shader/Basic.shader")
+	int Find(const std::string& path) const;
+
+	inline unsigned int GetEntryCount() const { return (unsigned int)m_Entries.size(); }
+	std::string GetName(unsigned int index) const;
+	inline size_t GetSize(unsigned int index) const { return (size_t)m_Entries[index].Size; }
+	inline size_t GetStoredSize(unsigned int index) const { return (size_t)m_Entries[index].StoredSize; }
+	bool IsCompressed(unsigned int index) const;
+	//the bytes of an uncompressed entry in the mapping, nullptr for compressed ones
+	const unsigned char* GetData(unsigned int index) const;
+	//copies or decompresses the entry into out, which holds GetSize() bytes. safe from any thread
+	bool Read(unsigned int index, unsigned char* out) const;
+
+	static unsigned long long HashPath(const std::string& path);
+};
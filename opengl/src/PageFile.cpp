@@ -0,0 +1,135 @@
+#include "PageFile.h"
+#include "MipGenerator.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+static const char s_Magic[4]{ 'V', 'T', 'P', 'F' };
+static const unsigned int s_Version{ 1 };
+//far above any texture size, keeps the padded page size and its byte count from overflowing
+static const unsigned int s_MaxPageSize{ 1u << 16 };
+
+PageFile::PageFile()
+    : m_Header()
+{
+}
+
+//the padded page at (x, y) of level, the border clamps at the edges of the level
+static void CopyPage(const Image& level, unsigned int x, unsigned int y, unsigned int pageSize, unsigned int border,
+    std::vector<unsigned char>& page)
+{
+    unsigned int padded{ pageSize + 2 * border };
+    for (unsigned int row = 0; row < padded; row++)
+    {
+        int sourceY{ std::min(std::max((int)(y * pageSize + row) - (int)border, 0), (int)level.Height - 1) };
+        const unsigned char* source{ level.Pixels.data() + sourceY * level.GetRowSize() };
+        unsigned char* destination{ page.data() + (size_t)row * padded * 4 };
+        for (unsigned int column = 0; column < padded; column++)
+        {
+            int sourceX{ std::min(std::max((int)(x * pageSize + column) - (int)border, 0), (int)level.Width - 1) };
+            std::memcpy(destination + column * 4, source + sourceX * 4, 4);
+        }
+    }
+}
+
+bool PageFile::Write(const std::string& filepath, const Image& source, unsigned int pageSize, unsigned int border, WorkerPool* workers)
+{
+    unsigned int pages{ pageSize ? source.Width / pageSize : 0 };
+    if (!source.IsValid() || source.Width != source.Height || pages * pageSize != source.Width || (pages & (pages - 1)))
+    {
+        std::cout << "Page file source must be square with a side of " << pageSize << " * 2^n, got "
+            << source.Width << "x" << source.Height << std::endl;
+        return false;
+    }
+    std::ofstream stream(filepath, std::ios::binary);
+    if (!stream)
+    {
+        std::cout << "Failed to create page file " << filepath << std::endl;
+        return false;
+    }
+
+    Header header{ { s_Magic[0], s_Magic[1], s_Magic[2], s_Magic[3] }, s_Version, source.Width, pageSize, border, 1 };
+    while ((pages >> (header.Levels - 1)) > 1)
+        header.Levels++;
+    stream.write((const char*)&header, sizeof(header));
+
+    std::vector<Image> mips;
+    GenerateMipChain(source, mips, {}, workers);
+    std::vector<unsigned char> page((size_t)(pageSize + 2 * border) * (pageSize + 2 * border) * 4);
+    for (unsigned int level = 0; level < header.Levels; level++)
+    {
+        const Image& image{ level ? mips[level - 1] : source };
+        unsigned int side{ pages >> level };
+        for (unsigned int y = 0; y < side; y++)
+        {
+            for (unsigned int x = 0; x < side; x++)
+            {
+                CopyPage(image, x, y, pageSize, border, page);
+                stream.write((const char*)page.data(), page.size());
+            }
+        }
+    }
+    return (bool)stream;
+}
+
+bool PageFile::Open(const std::string& filepath)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_LevelOffsets.clear();
+    m_Stream.close();
+    m_Stream.clear();
+    m_Stream.open(filepath, std::ios::binary);
+    if (!m_Stream)
+    {
+        std::cout << "Failed to open page file " << filepath << std::endl;
+        return false;
+    }
+    m_Stream.read((char*)&m_Header, sizeof(m_Header));
+    if (!m_Stream || std::memcmp(m_Header.Magic, s_Magic, sizeof(s_Magic)) != 0 || m_Header.Version != s_Version
+        || !m_Header.PageSize || !m_Header.Levels)
+    {
+        std::cout << "Not a page file: " << filepath << std::endl;
+        return false;
+    }
+    //the chain ends at a single page, which also keeps GetPagesPerSide() shifts below 32
+    unsigned int pages{ m_Header.Size / m_Header.PageSize };
+    unsigned int maxLevels{ 1 };
+    while ((pages >> (maxLevels - 1)) > 1)
+        maxLevels++;
+    if (!pages || m_Header.Levels > maxLevels || m_Header.PageSize > s_MaxPageSize || m_Header.Border > m_Header.PageSize)
+    {
+        std::cout << "Bad page file header: " << filepath << std::endl;
+        return false;
+    }
+
+    m_Stream.seekg(0, std::ios::end);
+    unsigned long long length{ m_Stream ? (unsigned long long)m_Stream.tellg() : 0 };
+    unsigned long long offset{ sizeof(Header) };
+    for (unsigned int level = 0; level < m_Header.Levels; level++)
+    {
+        //compared by division so a huge header cannot wrap the offset
+        unsigned long long side{ GetPagesPerSide(level) };
+        if (offset > length || side * side > (length - offset) / GetPageBytes())
+        {
+            std::cout << "Truncated page file: " << filepath << std::endl;
+            m_LevelOffsets.clear();
+            return false;
+        }
+        m_LevelOffsets.push_back(offset);
+        offset += side * side * GetPageBytes();
+    }
+    return true;
+}
+
+bool PageFile::ReadPage(unsigned int level, unsigned int x, unsigned int y, unsigned char* out)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (level >= m_LevelOffsets.size() || x >= GetPagesPerSide(level) || y >= GetPagesPerSide(level))
+        return false;
+    unsigned long long offset{ m_LevelOffsets[level] + ((unsigned long long)y * GetPagesPerSide(level) + x) * GetPageBytes() };
+    m_Stream.clear();
+    m_Stream.seekg((std::streamoff)offset);
+    m_Stream.read((char*)out, GetPageBytes());
+    return (bool)m_Stream;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Image.h"
+
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class WorkerPool;
+
+//a virtual texture on disk: every mip level cut into square pages, each padded with a border
+//copied from its neighbours so bilinear filtering never reads across a page edge. pages are
+//uncompressed RGBA8 of the same size, so a page's offset follows from its coordinates alone.
+//levels go from full size down to a single page, pages and rows bottom to top like Image
+class PageFile
+{
+private:
+	struct Header
+	{
+		char Magic[4];
+		unsigned int Version;
+		unsigned int Size;              //texels per side of level 0
+		unsigned int PageSize;          //texels per side of a page, without the border
+		unsigned int Border;
+		unsigned int Levels;
+	};
+
+	std::ifstream m_Stream;
+	std::mutex m_Mutex;
+	Header m_Header;
+	std::vector<unsigned long long> m_LevelOffsets;     //first page of every level
+public:
+	PageFile();
+
+	PageFile(const PageFile&) = delete;
+	PageFile& operator=(const PageFile&) = delete;
+
+	//source must be square with a side of pageSize * 2^n. the mip chain is built with
+	//MipGenerator, so the whole source has to fit in memory once, at build time
+	static bool Write(const std::string& filepath, const Image& source, unsigned int pageSize = 128,
+		unsigned int border = 4, WorkerPool* workers = nullptr);
+
+	//false (and prints why) when the file is missing or not a page file
+	bool Open(const std::string& filepath);
+	inline bool IsOpen() const { return !m_LevelOffsets.empty(); }
+
+	//safe from any thread, out must hold GetPageBytes()
+	bool ReadPage(unsigned int level, unsigned int x, unsigned int y, unsigned char* out);
+
+	inline unsigned int GetSize() const { return m_Header.Size; }
+	inline unsigned int GetPageSize() const { return m_Header.PageSize; }
+	inline unsigned int GetBorder() const { return m_Header.Border; }
+	inline unsigned int GetLevels() const { return m_Header.Levels; }
+	inline unsigned int GetPagesPerSide(unsigned int level) const { return (m_Header.Size / m_Header.PageSize) >> level; }
+	//side of a page in texels including both borders
+	inline unsigned int GetPaddedPageSize() const { return m_Header.PageSize + 2 * m_Header.Border; }
+	inline size_t GetPageBytes() const { return (size_t)GetPaddedPageSize() * GetPaddedPageSize() * 4; }
+};
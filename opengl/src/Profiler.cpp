@@ -0,0 +1,89 @@
+#include "Profiler.h"
+#include "Renderer.h"
+
+#include <cstring>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+
+static std::mutex s_RegisterMutex;
+
+ProfilerCounter::ProfilerCounter(const char* name)
+    : m_Index(Profiler::Get().Register(name))
+{
+}
+
+void ProfilerCounter::Add(unsigned long long value) const
+{
+    Profiler::Get().GetCounter(m_Index).Current.fetch_add(value, std::memory_order_relaxed);
+}
+
+unsigned long long ProfilerCounter::GetLastFrame() const
+{
+    return Profiler::Get().GetCounter(m_Index).LastFrame;
+}
+
+unsigned long long ProfilerCounter::GetTotal() const
+{
+    return Profiler::Get().GetCounter(m_Index).Total;
+}
+
+Profiler::Profiler()
+    : m_CounterCount(0), m_FrameIndex(0)
+{
+    for (Counter& counter : m_Counters)
+    {
+        counter.Name = nullptr;
+        counter.Current = 0;
+        counter.LastFrame = counter.Total = counter.Peak = 0;
+    }
+}
+
+Profiler& Profiler::Get()
+{
+    static Profiler s_Instance;
+    return s_Instance;
+}
+
+unsigned int Profiler::Register(const char* name)
+{
+    std::lock_guard<std::mutex> lock(s_RegisterMutex);
+    unsigned int count{ m_CounterCount.load(std::memory_order_relaxed) };
+    for (unsigned int i = 0; i < count; i++)
+    {
+        if (!std::strcmp(m_Counters[i].Name, name))
+            return i;
+    }
+    ASSERT(count < s_MaxCounters);
+    m_Counters[count].Name = name;
+    m_CounterCount.store(count + 1, std::memory_order_release);
+    return count;
+}
+
+void Profiler::EndFrame()
+{
+    unsigned int count{ GetCounterCount() };
+    for (unsigned int i = 0; i < count; i++)
+    {
+        Counter& counter{ m_Counters[i] };
+        counter.LastFrame = counter.Current.exchange(0, std::memory_order_relaxed);
+        counter.Total += counter.LastFrame;
+        if (counter.LastFrame > counter.Peak)
+            counter.Peak = counter.LastFrame;
+    }
+    m_FrameIndex++;
+}
+
+void Profiler::Report(std::ostream& out) const
+{
+    out << "Profiler (" << m_FrameIndex << " frames)" << std::endl;
+    unsigned int count{ GetCounterCount() };
+    for (unsigned int i = 0; i < count; i++)
+    {
+        const Counter& counter{ m_Counters[i] };
+        out << "  " << std::left << std::setw(32) << counter.Name << std::right
+            << " last " << std::setw(12) << counter.LastFrame
+            << " avg " << std::setw(12) << (m_FrameIndex ? counter.Total / m_FrameIndex : 0)
+            << " peak " << std::setw(12) << counter.Peak << std::endl;
+    }
+}
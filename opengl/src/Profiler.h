@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <iosfwd>
+
+//named per-frame counters. a ProfilerCounter is usually a function/file static; Add() is a
+//relaxed atomic add, so it is safe from any thread and never allocates
+class ProfilerCounter
+{
+private:
+	unsigned int m_Index;
+public:
+	explicit ProfilerCounter(const char* name);
+
+	void Add(unsigned long long value) const;
+	inline void Increment() const { Add(1); }
+	unsigned long long GetLastFrame() const;
+	unsigned long long GetTotal() const;
+};
+
+class Profiler
+{
+public:
+	static constexpr unsigned int s_MaxCounters{ 64 };
+
+	struct Counter
+	{
+		const char* Name;
+		std::atomic<unsigned long long> Current;
+		unsigned long long LastFrame;
+		unsigned long long Total;
+		unsigned long long Peak;        //highest single frame value
+	};
+private:
+	Counter m_Counters[s_MaxCounters];
+	std::atomic<unsigned int> m_CounterCount;
+	unsigned long long m_FrameIndex;
+
+	Profiler();
+public:
+	static Profiler& Get();
+
+	//returns the index of the counter with this name, registering it the first time
+	unsigned int Register(const char* name);
+	inline Counter& GetCounter(unsigned int index) { return m_Counters[index]; }
+	inline unsigned int GetCounterCount() const { return m_CounterCount.load(std::memory_order_acquire); }
+
+	//closes the frame: Current becomes LastFrame and starts again at 0
+	void EndFrame();
+	inline unsigned long long GetFrameIndex() const { return m_FrameIndex; }
+
+	//last frame, per frame average and peak of every counter
+	void Report(std::ostream& out) const;
+};
@@ -0,0 +1,221 @@
+#include "RangeAllocator.h"
+
+#include <algorithm>
+
+static unsigned int HighestBit(unsigned int value)
+{
+    unsigned int bit{ 0 };
+    while (value >>= 1)
+        bit++;
+    return bit;
+}
+
+static unsigned int LowestBit(uint64_t value)
+{
+    unsigned int bit{ 0 };
+    while (!(value & 1))
+    {
+        value >>= 1;
+        bit++;
+    }
+    return bit;
+}
+
+//bin whose smallest size is <= size (where a free range of this size is stored)
+static unsigned int BinRoundDown(unsigned int size, unsigned int subBits)
+{
+    unsigned int subCount{ 1u << subBits };
+    if (size < subCount)
+        return size;
+    unsigned int top{ HighestBit(size) };
+    unsigned int sub{ (size >> (top - subBits)) & (subCount - 1) };
+    return (top - subBits + 1) * subCount + sub;
+}
+
+//first bin where every range is >= size (where a request of this size may look)
+static unsigned int BinRoundUp(unsigned int size, unsigned int subBits)
+{
+    if (size < (1u << subBits))
+        return size;
+    unsigned int top{ HighestBit(size) };
+    uint64_t mask{ (1ull << (top - subBits)) - 1 };
+    uint64_t rounded{ (size & mask) ? ((uint64_t)size | mask) + 1 : size };
+    if (rounded > 0xffffffffull)
+        return BinRoundDown(0xffffffffu, subBits) + 1;
+    return BinRoundDown((unsigned int)rounded, subBits);
+}
+
+RangeAllocator::RangeAllocator(unsigned int capacity)
+{
+    Reset(capacity);
+}
+
+void RangeAllocator::Reset(unsigned int capacity)
+{
+    m_Capacity = capacity;
+    m_UsedSize = 0;
+    m_Allocations = 0;
+    m_Nodes.clear();
+    m_UnusedNodes.clear();
+    std::fill(std::begin(m_BinHeads), std::end(m_BinHeads), s_Invalid);
+    std::fill(std::begin(m_BinMask), std::end(m_BinMask), 0);
+
+    if (capacity)
+        InsertFree(NewNode(0, capacity));
+}
+
+unsigned int RangeAllocator::NewNode(unsigned int offset, unsigned int size)
+{
+    Node node{ offset, size, s_Invalid, s_Invalid, s_Invalid, s_Invalid, false };
+    if (!m_UnusedNodes.empty())
+    {
+        unsigned int index{ m_UnusedNodes.back() };
+        m_UnusedNodes.pop_back();
+        m_Nodes[index] = node;
+        return index;
+    }
+    m_Nodes.push_back(node);
+    return (unsigned int)m_Nodes.size() - 1;
+}
+
+void RangeAllocator::InsertFree(unsigned int index)
+{
+    Node& node{ m_Nodes[index] };
+    unsigned int bin{ BinRoundDown(node.Size, s_SubBits) };
+    node.Used = false;
+    node.PrevFree = s_Invalid;
+    node.NextFree = m_BinHeads[bin];
+    if (node.NextFree != s_Invalid)
+        m_Nodes[node.NextFree].PrevFree = index;
+    m_BinHeads[bin] = index;
+    m_BinMask[bin / 64] |= 1ull << (bin % 64);
+}
+
+void RangeAllocator::RemoveFree(unsigned int index)
+{
+    Node& node{ m_Nodes[index] };
+    if (node.PrevFree != s_Invalid)
+        m_Nodes[node.PrevFree].NextFree = node.NextFree;
+    else
+    {
+        unsigned int bin{ BinRoundDown(node.Size, s_SubBits) };
+        m_BinHeads[bin] = node.NextFree;
+        if (node.NextFree == s_Invalid)
+            m_BinMask[bin / 64] &= ~(1ull << (bin % 64));
+    }
+    if (node.NextFree != s_Invalid)
+        m_Nodes[node.NextFree].PrevFree = node.PrevFree;
+    node.PrevFree = node.NextFree = s_Invalid;
+}
+
+unsigned int RangeAllocator::FindFreeBin(unsigned int firstBin) const
+{
+    for (unsigned int word = firstBin / 64; word < sizeof(m_BinMask) / sizeof(m_BinMask[0]); word++)
+    {
+        uint64_t bits{ m_BinMask[word] };
+        if (word == firstBin / 64)
+            bits &= ~0ull << (firstBin % 64);
+        if (bits)
+            return word * 64 + LowestBit(bits);
+    }
+    return s_Invalid;
+}
+
+RangeAllocation RangeAllocator::Allocate(unsigned int size)
+{
+    if (size == 0)
+        size = 1;
+
+    //any range in the rounded up bin fits; if that finds nothing the bin the size itself
+    //falls in may still hold a large enough range, so walk that one list as a fallback
+    unsigned int node{ s_Invalid };
+    unsigned int bin{ BinRoundUp(size, s_SubBits) };
+    if (bin < s_BinCount)
+    {
+        bin = FindFreeBin(bin);
+        if (bin != s_Invalid)
+            node = m_BinHeads[bin];
+    }
+    if (node == s_Invalid)
+    {
+        for (unsigned int i = m_BinHeads[BinRoundDown(size, s_SubBits)]; i != s_Invalid; i = m_Nodes[i].NextFree)
+        {
+            if (m_Nodes[i].Size >= size)
+            {
+                node = i;
+                break;
+            }
+        }
+    }
+    if (node == s_Invalid)
+        return { 0, 0, s_Invalid };
+
+    RemoveFree(node);
+    if (m_Nodes[node].Size > size)
+    {
+        //split, the remainder stays free right behind the allocation
+        unsigned int rest{ NewNode(m_Nodes[node].Offset + size, m_Nodes[node].Size - size) };
+        Node& allocated{ m_Nodes[node] };
+        m_Nodes[rest].PrevPhysical = node;
+        m_Nodes[rest].NextPhysical = allocated.NextPhysical;
+        if (allocated.NextPhysical != s_Invalid)
+            m_Nodes[allocated.NextPhysical].PrevPhysical = rest;
+        allocated.NextPhysical = rest;
+        allocated.Size = size;
+        InsertFree(rest);
+    }
+
+    m_Nodes[node].Used = true;
+    m_UsedSize += size;
+    m_Allocations++;
+    return { m_Nodes[node].Offset, size, node };
+}
+
+void RangeAllocator::Free(const RangeAllocation& allocation)
+{
+    if (!allocation.IsValid() || allocation.Node >= m_Nodes.size() || !m_Nodes[allocation.Node].Used)
+        return;
+
+    unsigned int index{ allocation.Node };
+    m_UsedSize -= m_Nodes[index].Size;
+    m_Allocations--;
+    m_Nodes[index].Used = false;
+
+    //merge with the free neighbours, the surviving node is always the leftmost one
+    unsigned int prev{ m_Nodes[index].PrevPhysical };
+    if (prev != s_Invalid && !m_Nodes[prev].Used)
+    {
+        RemoveFree(prev);
+        m_Nodes[prev].Size += m_Nodes[index].Size;
+        m_Nodes[prev].NextPhysical = m_Nodes[index].NextPhysical;
+        if (m_Nodes[index].NextPhysical != s_Invalid)
+            m_Nodes[m_Nodes[index].NextPhysical].PrevPhysical = prev;
+        m_UnusedNodes.push_back(index);
+        index = prev;
+    }
+    unsigned int next{ m_Nodes[index].NextPhysical };
+    if (next != s_Invalid && !m_Nodes[next].Used)
+    {
+        RemoveFree(next);
+        m_Nodes[index].Size += m_Nodes[next].Size;
+        m_Nodes[index].NextPhysical = m_Nodes[next].NextPhysical;
+        if (m_Nodes[next].NextPhysical != s_Invalid)
+            m_Nodes[m_Nodes[next].NextPhysical].PrevPhysical = index;
+        m_UnusedNodes.push_back(next);
+    }
+    InsertFree(index);
+}
+
+RangeAllocatorStats RangeAllocator::GetStats() const
+{
+    RangeAllocatorStats stats{ m_Capacity, m_UsedSize, m_Capacity - m_UsedSize, 0, 0, m_Allocations };
+    for (unsigned int bin = 0; bin < s_BinCount; bin++)
+    {
+        for (unsigned int i = m_BinHeads[bin]; i != s_Invalid; i = m_Nodes[i].NextFree)
+        {
+            stats.FreeRanges++;
+            stats.LargestFreeRange = std::max(stats.LargestFreeRange, m_Nodes[i].Size);
+        }
+    }
+    return stats;
+}
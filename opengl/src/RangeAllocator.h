@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+struct RangeAllocation
+{
+	unsigned int Offset;
+	unsigned int Size;
+	unsigned int Node;                  //internal, RangeAllocator::s_Invalid when the allocation failed
+
+	inline bool IsValid() const { return Node != 0xffffffffu; }
+};
+
+struct RangeAllocatorStats
+{
+	unsigned int Capacity;
+	unsigned int UsedSize;
+	unsigned int FreeSize;
+	unsigned int LargestFreeRange;
+	unsigned int FreeRanges;
+	unsigned int Allocations;
+
+	//0 when all free space is one range, towards 1 the more it is split up
+	inline float Fragmentation() const { return FreeSize ? 1.0f - (float)LargestFreeRange / FreeSize : 0.0f; }
+};
+
+//hands out [offset, offset + size) ranges of an abstract capacity (bytes, vertices, indices..)
+//using a two level segregated fit (TLSF) free list: O(1) allocate and free, neighbouring
+//free ranges are merged on free. it never touches the memory it manages
+class RangeAllocator
+{
+public:
+	static constexpr unsigned int s_Invalid{ 0xffffffffu };
+private:
+	static constexpr unsigned int s_SubBits{ 3 };
+	static constexpr unsigned int s_SubCount{ 1u << s_SubBits };
+	static constexpr unsigned int s_BinCount{ (32 - s_SubBits + 1) * s_SubCount };
+
+	struct Node
+	{
+		unsigned int Offset;
+		unsigned int Size;
+		unsigned int PrevPhysical;
+		unsigned int NextPhysical;
+		unsigned int PrevFree;
+		unsigned int NextFree;
+		bool Used;
+	};
+
+	unsigned int m_Capacity;
+	unsigned int m_UsedSize;
+	unsigned int m_Allocations;
+	std::vector<Node> m_Nodes;
+	std::vector<unsigned int> m_UnusedNodes;
+	unsigned int m_BinHeads[s_BinCount];
+	uint64_t m_BinMask[(s_BinCount + 63) / 64];
+
+	unsigned int NewNode(unsigned int offset, unsigned int size);
+	void InsertFree(unsigned int node);
+	void RemoveFree(unsigned int node);
+	unsigned int FindFreeBin(unsigned int firstBin) const;
+public:
+	explicit RangeAllocator(unsigned int capacity = 0);
+
+	//drops every allocation and starts over with one free range of the given capacity
+	void Reset(unsigned int capacity);
+
+	//returns an invalid allocation when no free range is large enough
+	RangeAllocation Allocate(unsigned int size);
+	void Free(const RangeAllocation& allocation);
+
+	inline unsigned int GetCapacity() const { return m_Capacity; }
+	RangeAllocatorStats GetStats() const;
+};
@@ -1,4 +1,5 @@
 #include "Renderer.h"
+#include "AllocationTracker.h"
 #include <iostream>
 
 void GLClearError()
@@ -9,6 +10,7 @@ void GLClearError()
 
 bool GLLogCall(const char* function, const char* file, int line)
 {
+    ALLOCATION_SCOPE("GLLogCall");
     while (GLenum error = glGetError()) {
         std::cout << "OpenGL Error: (0x" << std::hex << error
             << std::dec << ")" << "\nFUNCTION: " << function << "\nFILE: " << file
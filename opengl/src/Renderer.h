@@ -1,9 +1,23 @@
 #pragma once
 
+//glew on windows (and anywhere it is asked for), otherwise link straight against the
+//system libOpenGL and let glext.h declare the core entry points
+#if defined(_WIN32) || defined(OPENGL_USE_GLEW)
 #include <GL/glew.h>
+#else
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#endif
 
 //error checking macro
-#define ASSERT(x) if (!(x)) __debugbreak();
+#if defined(_MSC_VER)
+#define DEBUG_BREAK() __debugbreak()
+#else
+#define DEBUG_BREAK() __builtin_trap()
+#endif
+
+#define ASSERT(x) if (!(x)) DEBUG_BREAK();
 #define GLCall(x) GLClearError();\
     x;\
     ASSERT(GLLogCall(#x, __FILE__, __LINE__))
@@ -0,0 +1,223 @@
+#include "ResourceManager.h"
+#include "Renderer.h"
+#include "FrameArena.h"
+#include "AllocationTracker.h"
+
+#include <algorithm>
+#include <cstring>
+
+ResourceManager::ResourceManager(unsigned int framesInFlight)
+    : m_FramesInFlight(framesInFlight), m_FrameIndex(0), m_LastFrameUploadBytes(0)
+{
+}
+
+ResourceManager::~ResourceManager()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_RetiredVertexBuffers.clear();
+    m_RetiredIndexBuffers.clear();
+    m_VertexBuffers.Clear();
+    m_IndexBuffers.Clear();
+}
+
+VertexBufferHandle ResourceManager::RequestVertexBuffer(const void* data, unsigned int size, bool dynamic)
+{
+    ALLOCATION_SCOPE("ResourceManager");
+    std::vector<unsigned char> copy(size);
+    if (data && size)
+        std::memcpy(copy.data(), data, size);
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    VertexBufferHandle handle{ m_VertexBuffers.Allocate() };
+    m_VertexBufferRequests.push_back({ handle, std::move(copy), dynamic });
+    return handle;
+}
+
+IndexBufferHandle ResourceManager::RequestIndexBuffer(const unsigned int* data, unsigned int count, bool dynamic)
+{
+    ALLOCATION_SCOPE("ResourceManager");
+    std::vector<unsigned int> copy(data, data + count);
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    IndexBufferHandle handle{ m_IndexBuffers.Allocate() };
+    m_IndexBufferRequests.push_back({ handle, std::move(copy), dynamic });
+    return handle;
+}
+
+VertexBufferHandle ResourceManager::CreateVertexBuffer(const void* data, unsigned int size, bool dynamic)
+{
+    ALLOCATION_SCOPE("ResourceManager");
+    VertexBuffer buffer(data, size, dynamic);
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    VertexBufferHandle handle{ m_VertexBuffers.Allocate() };
+    m_VertexBuffers.Emplace(handle, std::move(buffer));
+    if (dynamic)
+        m_DynamicVertexBuffers.push_back(handle);
+    return handle;
+}
+
+IndexBufferHandle ResourceManager::CreateIndexBuffer(const unsigned int* data, unsigned int count, bool dynamic)
+{
+    ALLOCATION_SCOPE("ResourceManager");
+    IndexBuffer buffer(data, count, dynamic);
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    IndexBufferHandle handle{ m_IndexBuffers.Allocate() };
+    m_IndexBuffers.Emplace(handle, std::move(buffer));
+    if (dynamic)
+        m_DynamicIndexBuffers.push_back(handle);
+    return handle;
+}
+
+void ResourceManager::Update(VertexBufferHandle handle, unsigned int offset, const void* data, unsigned int size)
+{
+    ALLOCATION_SCOPE("ResourceManager");
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    VertexBuffer* buffer{ m_VertexBuffers.Get(handle) };
+    if (buffer)
+        buffer->Update(offset, data, size);
+}
+
+void ResourceManager::Update(IndexBufferHandle handle, unsigned int first, const unsigned int* data, unsigned int count)
+{
+    ALLOCATION_SCOPE("ResourceManager");
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    IndexBuffer* buffer{ m_IndexBuffers.Get(handle) };
+    if (buffer)
+        buffer->Update(first, data, count);
+}
+
+void ResourceManager::Release(VertexBufferHandle handle)
+{
+    ALLOCATION_SCOPE("ResourceManager");
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_VertexBuffers.Remove(handle, [this](VertexBuffer&& buffer) {
+        m_RetiredVertexBuffers.push_back({ m_FrameIndex, std::move(buffer) });
+    });
+}
+
+void ResourceManager::Release(IndexBufferHandle handle)
+{
+    ALLOCATION_SCOPE("ResourceManager");
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_IndexBuffers.Remove(handle, [this](IndexBuffer&& buffer) {
+        m_RetiredIndexBuffers.push_back({ m_FrameIndex, std::move(buffer) });
+    });
+}
+
+VertexBuffer* ResourceManager::Get(VertexBufferHandle handle)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_VertexBuffers.Get(handle);
+}
+
+IndexBuffer* ResourceManager::Get(IndexBufferHandle handle)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_IndexBuffers.Get(handle);
+}
+
+bool ResourceManager::IsAlive(VertexBufferHandle handle) const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_VertexBuffers.IsAlive(handle);
+}
+
+bool ResourceManager::IsAlive(IndexBufferHandle handle) const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_IndexBuffers.IsAlive(handle);
+}
+
+void ResourceManager::ProcessRequests()
+{
+    ALLOCATION_SCOPE("ResourceManager");
+    //take the queues so the GL calls below run without holding the lock
+    std::vector<VertexBufferRequest> vertexRequests;
+    std::vector<IndexBufferRequest> indexRequests;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        vertexRequests.swap(m_VertexBufferRequests);
+        indexRequests.swap(m_IndexBufferRequests);
+    }
+
+    for (VertexBufferRequest& request : vertexRequests)
+    {
+        if (!IsAlive(request.Target))
+            continue;   //released before it was ever created
+        VertexBuffer buffer(request.Data.data(), (unsigned int)request.Data.size(), request.Dynamic);
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_VertexBuffers.Emplace(request.Target, std::move(buffer));
+        if (request.Dynamic)
+            m_DynamicVertexBuffers.push_back(request.Target);
+    }
+
+    for (IndexBufferRequest& request : indexRequests)
+    {
+        if (!IsAlive(request.Target))
+            continue;
+        IndexBuffer buffer(request.Data.data(), (unsigned int)request.Data.size(), request.Dynamic);
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_IndexBuffers.Emplace(request.Target, std::move(buffer));
+        if (request.Dynamic)
+            m_DynamicIndexBuffers.push_back(request.Target);
+    }
+}
+
+void ResourceManager::EndFrame()
+{
+    ALLOCATION_SCOPE("ResourceManager");
+    //pop under the lock, destroy outside of it. the temporaries live in frame scratch memory
+    ArenaVector<VertexBuffer> vertexBuffers{ ArenaAllocator<VertexBuffer>(FrameArena::Get()) };
+    ArenaVector<IndexBuffer> indexBuffers{ ArenaAllocator<IndexBuffer>(FrameArena::Get()) };
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
+        //released buffers fail the lookup and leave the list, their pending writes die with them
+        m_LastFrameUploadBytes = 0;
+        m_DynamicVertexBuffers.erase(std::remove_if(m_DynamicVertexBuffers.begin(), m_DynamicVertexBuffers.end(),
+            [this](VertexBufferHandle handle) {
+                VertexBuffer* buffer{ m_VertexBuffers.Get(handle) };
+                if (buffer && buffer->IsDirty())
+                    m_LastFrameUploadBytes += buffer->Flush();
+                return !buffer;
+            }), m_DynamicVertexBuffers.end());
+        m_DynamicIndexBuffers.erase(std::remove_if(m_DynamicIndexBuffers.begin(), m_DynamicIndexBuffers.end(),
+            [this](IndexBufferHandle handle) {
+                IndexBuffer* buffer{ m_IndexBuffers.Get(handle) };
+                if (buffer && buffer->IsDirty())
+                    m_LastFrameUploadBytes += buffer->Flush();
+                return !buffer;
+            }), m_DynamicIndexBuffers.end());
+
+        m_FrameIndex++;
+        while (!m_RetiredVertexBuffers.empty() && m_RetiredVertexBuffers.front().Frame + m_FramesInFlight <= m_FrameIndex)
+        {
+            vertexBuffers.push_back(std::move(m_RetiredVertexBuffers.front().Object));
+            m_RetiredVertexBuffers.pop_front();
+        }
+        while (!m_RetiredIndexBuffers.empty() && m_RetiredIndexBuffers.front().Frame + m_FramesInFlight <= m_FrameIndex)
+        {
+            indexBuffers.push_back(std::move(m_RetiredIndexBuffers.front().Object));
+            m_RetiredIndexBuffers.pop_front();
+        }
+    }
+}
+
+void ResourceManager::FlushRetired()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_RetiredVertexBuffers.clear();
+    m_RetiredIndexBuffers.clear();
+}
+
+size_t ResourceManager::GetRetiredCount() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_RetiredVertexBuffers.size() + m_RetiredIndexBuffers.size();
+}
+
+size_t ResourceManager::GetLiveCount() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_VertexBuffers.Size() + m_IndexBuffers.Size();
+}
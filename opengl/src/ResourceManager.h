@@ -0,0 +1,99 @@
+#pragma once
+
+#include "ResourcePool.h"
+#include "VertexBuffer.h"
+#include "IndexBuffer.h"
+
+#include <deque>
+#include <mutex>
+#include <vector>
+
+using VertexBufferHandle = Handle<VertexBuffer>;
+using IndexBufferHandle = Handle<IndexBuffer>;
+
+//owns every VertexBuffer/IndexBuffer and hands out handles instead of GL names.
+//requests and releases may come from any thread; GL work only happens in the calls
+//marked "GL thread". a released object is kept alive for FramesInFlight more frames
+//so a frame the GPU is still working on never sees its buffers deleted underneath it
+class ResourceManager
+{
+private:
+	struct VertexBufferRequest
+	{
+		VertexBufferHandle Target;
+		std::vector<unsigned char> Data;
+		bool Dynamic;
+	};
+	struct IndexBufferRequest
+	{
+		IndexBufferHandle Target;
+		std::vector<unsigned int> Data;
+		bool Dynamic;
+	};
+	template<typename T>
+	struct Retired
+	{
+		unsigned long long Frame;
+		T Object;
+	};
+
+	mutable std::mutex m_Mutex;
+	unsigned int m_FramesInFlight;
+	unsigned long long m_FrameIndex;
+
+	ResourcePool<VertexBuffer> m_VertexBuffers;
+	ResourcePool<IndexBuffer> m_IndexBuffers;
+	std::vector<VertexBufferRequest> m_VertexBufferRequests;
+	std::vector<IndexBufferRequest> m_IndexBufferRequests;
+	std::deque<Retired<VertexBuffer>> m_RetiredVertexBuffers;
+	std::deque<Retired<IndexBuffer>> m_RetiredIndexBuffers;
+	//every dynamic buffer, EndFrame() flushes the dirty ones however they were updated
+	std::vector<VertexBufferHandle> m_DynamicVertexBuffers;
+	std::vector<IndexBufferHandle> m_DynamicIndexBuffers;
+	unsigned int m_LastFrameUploadBytes;
+public:
+	explicit ResourceManager(unsigned int framesInFlight = 3);
+	//destroys everything right away, the context must still be current
+	~ResourceManager();
+
+	ResourceManager(const ResourceManager&) = delete;
+	ResourceManager& operator=(const ResourceManager&) = delete;
+
+	//any thread: data is copied, the buffer appears at the next ProcessRequests()
+	VertexBufferHandle RequestVertexBuffer(const void* data, unsigned int size, bool dynamic = false);
+	IndexBufferHandle RequestIndexBuffer(const unsigned int* data, unsigned int count, bool dynamic = false);
+
+	//GL thread: created immediately
+	VertexBufferHandle CreateVertexBuffer(const void* data, unsigned int size, bool dynamic = false);
+	IndexBufferHandle CreateIndexBuffer(const unsigned int* data, unsigned int count, bool dynamic = false);
+
+	//partial update (bytes / indices). dynamic buffers may be updated from any thread and are
+	//flushed by EndFrame(), static ones upload immediately and so need the GL thread
+	void Update(VertexBufferHandle handle, unsigned int offset, const void* data, unsigned int size);
+	void Update(IndexBufferHandle handle, unsigned int first, const unsigned int* data, unsigned int count);
+
+	//any thread: the handle is dead from now on, the GL object is deleted once retired
+	void Release(VertexBufferHandle handle);
+	void Release(IndexBufferHandle handle);
+
+	//nullptr for dead or still pending handles. the pointer is only good until the
+	//next create/release/ProcessRequests
+	VertexBuffer* Get(VertexBufferHandle handle);
+	IndexBuffer* Get(IndexBufferHandle handle);
+	bool IsAlive(VertexBufferHandle handle) const;
+	bool IsAlive(IndexBufferHandle handle) const;
+
+	//GL thread: creates the GL objects for all queued requests
+	void ProcessRequests();
+	//GL thread: uploads the dirty ranges of dynamic buffers, advances the frame index and
+	//deletes objects that are no longer in flight
+	void EndFrame();
+	//GL thread: deletes all retired objects now (shutdown / after a glFinish)
+	void FlushRetired();
+
+	inline unsigned long long GetFrameIndex() const { return m_FrameIndex; }
+	//bytes the last EndFrame() flushed out of dirty buffers
+	inline unsigned int GetLastFrameUploadBytes() const { return m_LastFrameUploadBytes; }
+	size_t GetRetiredCount() const;
+	size_t GetLiveCount() const;
+};
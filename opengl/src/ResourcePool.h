@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+//8 byte value type naming an object inside a ResourcePool<T>. copying it is free and
+//a stale handle (object released, slot reused) just fails the generation check
+template<typename T>
+struct Handle
+{
+	unsigned int Index { 0 };
+	unsigned int Generation { 0 };      //0 is never handed out, so a default handle is invalid
+
+	inline bool IsValid() const { return Generation != 0; }
+	inline bool operator==(const Handle& other) const { return Index == other.Index && Generation == other.Generation; }
+	inline bool operator!=(const Handle& other) const { return !(*this == other); }
+};
+
+//objects live densely packed in one vector, handles go through a slot table so lookup is O(1)
+//and removal is a swap with the last object. pointers returned by Get() are only good
+//until the next Emplace/Remove
+template<typename T>
+class ResourcePool
+{
+private:
+	static constexpr unsigned int s_Pending{ 0xffffffffu };
+
+	struct Slot
+	{
+		unsigned int Generation;
+		unsigned int Dense;             //index into m_Objects, s_Pending while reserved but empty
+	};
+
+	std::vector<Slot> m_Slots;
+	std::vector<unsigned int> m_FreeSlots;
+	std::vector<T> m_Objects;
+	std::vector<unsigned int> m_DenseToSlot;
+public:
+	//reserves a slot, the handle is alive but Get() returns nullptr until Emplace()
+	Handle<T> Allocate()
+	{
+		unsigned int index;
+		if (!m_FreeSlots.empty())
+		{
+			index = m_FreeSlots.back();
+			m_FreeSlots.pop_back();
+		}
+		else
+		{
+			index = (unsigned int)m_Slots.size();
+			m_Slots.push_back({ 1, s_Pending });
+		}
+		m_Slots[index].Dense = s_Pending;
+		return { index, m_Slots[index].Generation };
+	}
+
+	bool Emplace(Handle<T> handle, T&& object)
+	{
+		if (!IsAlive(handle) || m_Slots[handle.Index].Dense != s_Pending)
+			return false;
+		m_Slots[handle.Index].Dense = (unsigned int)m_Objects.size();
+		m_Objects.push_back(std::move(object));
+		m_DenseToSlot.push_back(handle.Index);
+		return true;
+	}
+
+	inline bool IsAlive(Handle<T> handle) const
+	{
+		return handle.Index < m_Slots.size() && m_Slots[handle.Index].Generation == handle.Generation;
+	}
+
+	T* Get(Handle<T> handle)
+	{
+		if (!IsAlive(handle) || m_Slots[handle.Index].Dense == s_Pending)
+			return nullptr;
+		return &m_Objects[m_Slots[handle.Index].Dense];
+	}
+
+	//invalidates the handle; if an object was attached it is handed to retire(T&&) before it
+	//leaves the pool, which is where deferred destruction takes ownership
+	template<typename RetireFn>
+	bool Remove(Handle<T> handle, RetireFn&& retire)
+	{
+		if (!IsAlive(handle))
+			return false;
+
+		Slot& slot{ m_Slots[handle.Index] };
+		bool hadObject{ slot.Dense != s_Pending };
+		if (hadObject)
+		{
+			unsigned int dense{ slot.Dense };
+			unsigned int last{ (unsigned int)m_Objects.size() - 1 };
+			retire(std::move(m_Objects[dense]));
+			if (dense != last)
+			{
+				m_Objects[dense] = std::move(m_Objects[last]);
+				m_DenseToSlot[dense] = m_DenseToSlot[last];
+				m_Slots[m_DenseToSlot[dense]].Dense = dense;
+			}
+			m_Objects.pop_back();
+			m_DenseToSlot.pop_back();
+		}
+
+		slot.Dense = s_Pending;
+		if (++slot.Generation == 0)
+			slot.Generation = 1;
+		m_FreeSlots.push_back(handle.Index);
+		return hadObject;
+	}
+
+	bool Remove(Handle<T> handle)
+	{
+		return Remove(handle, [](T&&) {});
+	}
+
+	//dense iteration over the live objects
+	inline T* begin() { return m_Objects.data(); }
+	inline T* end() { return m_Objects.data() + m_Objects.size(); }
+	inline size_t Size() const { return m_Objects.size(); }
+
+	void Clear()
+	{
+		m_Objects.clear();
+		m_DenseToSlot.clear();
+		m_FreeSlots.clear();
+		for (unsigned int i = 0; i < m_Slots.size(); i++)
+		{
+			m_Slots[i].Dense = s_Pending;
+			if (++m_Slots[i].Generation == 0)
+				m_Slots[i].Generation = 1;
+			m_FreeSlots.push_back(i);
+		}
+	}
+};
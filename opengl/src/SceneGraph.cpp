@@ -0,0 +1,463 @@
+#include "SceneGraph.h"
+
+#include <algorithm>
+#include <iostream>
+
+static const ProfilerCounter s_NodesUpdated("Scene nodes updated");
+
+//less than two of these per level is not worth handing to the workers
+static const unsigned int s_ParallelGrain{ 4096 };
+
+//new[i] = old[order[i]]
+template<typename T>
+static void Permute(std::vector<T>& values, const std::vector<unsigned int>& order)
+{
+    std::vector<T> sorted;
+    sorted.reserve(order.size());
+    for (unsigned int slot : order)
+        sorted.push_back(values[slot]);
+    values.swap(sorted);
+}
+
+SceneGraph::SceneGraph()
+    : m_FirstChild{ 0 }, m_LevelStart{ 0 }, m_OrderDirty(false), m_Epoch(1)
+{
+}
+
+unsigned int SceneGraph::GetSlot(SceneNode node) const
+{
+    if (!IsAlive(node))
+        return s_None;
+    return m_Ids[node.Index].Slot;
+}
+
+unsigned int SceneGraph::GetLevel(unsigned int slot) const
+{
+    return (unsigned int)(std::upper_bound(m_LevelStart.begin(), m_LevelStart.end(), slot) - m_LevelStart.begin()) - 1;
+}
+
+bool SceneGraph::IsAlive(SceneNode node) const
+{
+    return node.Index < m_Ids.size() && m_Ids[node.Index].Generation == node.Generation;
+}
+
+void SceneGraph::MarkDirty(unsigned int slot)
+{
+    if (m_Flags[slot] & s_LocalDirty)
+        return;
+    m_Flags[slot] |= s_LocalDirty;
+    //Sort() collects them again from the flags
+    m_Dirty.push_back(slot);
+}
+
+SceneNode SceneGraph::Create(SceneNode parent, const Vec3& translation, const Quat& rotation, const Vec3& scale)
+{
+    unsigned int parentSlot{ s_None };
+    if (parent.IsValid())
+    {
+        parentSlot = GetSlot(parent);
+        if (parentSlot == s_None)
+        {
+            std::cout << "SceneGraph: parent node is not alive" << std::endl;
+            return {};
+        }
+    }
+
+    unsigned int id;
+    if (!m_FreeIds.empty())
+    {
+        id = m_FreeIds.back();
+        m_FreeIds.pop_back();
+    }
+    else
+    {
+        id = (unsigned int)m_Ids.size();
+        m_Ids.push_back({ 1, s_None });
+    }
+    unsigned int slot{ (unsigned int)m_World.size() };
+    m_Ids[id].Slot = slot;
+
+    //placed into its level by the next Sort()
+    m_Translations.push_back(translation);
+    m_Rotations.push_back(rotation);
+    m_Scales.push_back(scale);
+    m_Local.push_back(Mat4::Identity());
+    m_World.push_back(Mat4::Identity());
+    m_Parents.push_back(parentSlot);
+    m_Flags.push_back(s_LocalDirty);
+    m_UpdatedIn.push_back(0);
+    m_SlotToId.push_back(id);
+    m_OrderDirty = true;
+    return { id, m_Ids[id].Generation };
+}
+
+bool SceneGraph::Destroy(SceneNode node)
+{
+    unsigned int slot{ GetSlot(node) };
+    if (slot == s_None)
+        return false;
+
+    //the slot stays until Sort(), the id can be handed out again right away
+    m_Flags[slot] |= s_Removed;
+    m_SlotToId[slot] = s_None;
+    Id& id{ m_Ids[node.Index] };
+    id.Slot = s_None;
+    if (++id.Generation == 0)
+        id.Generation = 1;
+    m_FreeIds.push_back(node.Index);
+    m_OrderDirty = true;
+    return true;
+}
+
+bool SceneGraph::SetParent(SceneNode node, SceneNode parent)
+{
+    unsigned int slot{ GetSlot(node) };
+    if (slot == s_None)
+        return false;
+    unsigned int parentSlot{ s_None };
+    if (parent.IsValid())
+    {
+        parentSlot = GetSlot(parent);
+        if (parentSlot == s_None)
+            return false;
+    }
+    for (unsigned int at = parentSlot; at != s_None; at = m_Parents[at])
+    {
+        if (at == slot)
+        {
+            std::cout << "SceneGraph: a node cannot become a child of its own subtree" << std::endl;
+            return false;
+        }
+    }
+    if (m_Parents[slot] == parentSlot)
+        return true;
+
+    m_Parents[slot] = parentSlot;
+    m_OrderDirty = true;
+    MarkDirty(slot);
+    return true;
+}
+
+SceneNode SceneGraph::GetParent(SceneNode node) const
+{
+    unsigned int slot{ GetSlot(node) };
+    if (slot == s_None || m_Parents[slot] == s_None)
+        return {};
+    unsigned int id{ m_SlotToId[m_Parents[slot]] };
+    if (id == s_None)
+        return {};
+    return { id, m_Ids[id].Generation };
+}
+
+void SceneGraph::SetTranslation(SceneNode node, const Vec3& translation)
+{
+    unsigned int slot{ GetSlot(node) };
+    if (slot == s_None)
+        return;
+    m_Translations[slot] = translation;
+    MarkDirty(slot);
+}
+
+void SceneGraph::SetRotation(SceneNode node, const Quat& rotation)
+{
+    unsigned int slot{ GetSlot(node) };
+    if (slot == s_None)
+        return;
+    m_Rotations[slot] = rotation;
+    MarkDirty(slot);
+}
+
+void SceneGraph::SetScale(SceneNode node, const Vec3& scale)
+{
+    unsigned int slot{ GetSlot(node) };
+    if (slot == s_None)
+        return;
+    m_Scales[slot] = scale;
+    MarkDirty(slot);
+}
+
+void SceneGraph::SetTransform(SceneNode node, const Vec3& translation, const Quat& rotation, const Vec3& scale)
+{
+    unsigned int slot{ GetSlot(node) };
+    if (slot == s_None)
+        return;
+    m_Translations[slot] = translation;
+    m_Rotations[slot] = rotation;
+    m_Scales[slot] = scale;
+    MarkDirty(slot);
+}
+
+const Vec3& SceneGraph::GetTranslation(SceneNode node) const
+{
+    static const Vec3 s_Zero{ 0.0f, 0.0f, 0.0f };
+    unsigned int slot{ GetSlot(node) };
+    return slot == s_None ? s_Zero : m_Translations[slot];
+}
+
+const Quat& SceneGraph::GetRotation(SceneNode node) const
+{
+    static const Quat s_Identity{ Quat::Identity() };
+    unsigned int slot{ GetSlot(node) };
+    return slot == s_None ? s_Identity : m_Rotations[slot];
+}
+
+const Vec3& SceneGraph::GetScale(SceneNode node) const
+{
+    static const Vec3 s_One{ 1.0f, 1.0f, 1.0f };
+    unsigned int slot{ GetSlot(node) };
+    return slot == s_None ? s_One : m_Scales[slot];
+}
+
+const Mat4& SceneGraph::GetWorld(SceneNode node) const
+{
+    static const Mat4 s_Identity{ Mat4::Identity() };
+    unsigned int slot{ GetSlot(node) };
+    return slot == s_None ? s_Identity : m_World[slot];
+}
+
+bool SceneGraph::WasUpdated(SceneNode node) const
+{
+    unsigned int slot{ GetSlot(node) };
+    return slot != s_None && m_UpdatedIn[slot] == m_Epoch;
+}
+
+void SceneGraph::Sort()
+{
+    unsigned int count{ (unsigned int)m_World.size() };
+
+    //children of every old slot, removed ones left out
+    std::vector<unsigned int> childStart(count + 1, 0);
+    for (unsigned int slot = 0; slot < count; slot++)
+    {
+        if (!(m_Flags[slot] & s_Removed) && m_Parents[slot] != s_None)
+            childStart[m_Parents[slot] + 1]++;
+    }
+    for (unsigned int slot = 0; slot < count; slot++)
+        childStart[slot + 1] += childStart[slot];
+    std::vector<unsigned int> children(childStart[count]);
+    std::vector<unsigned int> next(childStart.begin(), childStart.end() - 1);
+    for (unsigned int slot = 0; slot < count; slot++)
+    {
+        if (!(m_Flags[slot] & s_Removed) && m_Parents[slot] != s_None)
+            children[next[m_Parents[slot]]++] = slot;
+    }
+
+    //breadth first from the roots, one level at a time. what is never reached was destroyed
+    //or sits below a destroyed node
+    std::vector<unsigned int> order;
+    order.reserve(count);
+    for (unsigned int slot = 0; slot < count; slot++)
+    {
+        if (!(m_Flags[slot] & s_Removed) && m_Parents[slot] == s_None)
+            order.push_back(slot);
+    }
+    std::vector<unsigned int> firstChild;
+    firstChild.reserve(count + 1);
+    m_LevelStart.assign(1, 0);
+    size_t levelBegin{ 0 };
+    while (levelBegin < order.size())
+    {
+        size_t levelEnd{ order.size() };
+        for (size_t i = levelBegin; i < levelEnd; i++)
+        {
+            firstChild.push_back((unsigned int)order.size());
+            unsigned int slot{ order[i] };
+            order.insert(order.end(), children.begin() + childStart[slot], children.begin() + childStart[slot + 1]);
+        }
+        m_LevelStart.push_back((unsigned int)levelEnd);
+        levelBegin = levelEnd;
+    }
+    firstChild.push_back((unsigned int)order.size());
+
+    std::vector<unsigned int> newSlots(count, s_None);
+    for (unsigned int i = 0; i < (unsigned int)order.size(); i++)
+        newSlots[order[i]] = i;
+    for (unsigned int slot = 0; slot < count; slot++)
+    {
+        //descendants of a destroyed node die here, the node's own id is already free
+        unsigned int id{ m_SlotToId[slot] };
+        if (newSlots[slot] == s_None && id != s_None)
+        {
+            m_Ids[id].Slot = s_None;
+            if (++m_Ids[id].Generation == 0)
+                m_Ids[id].Generation = 1;
+            m_FreeIds.push_back(id);
+        }
+    }
+
+    Permute(m_Translations, order);
+    Permute(m_Rotations, order);
+    Permute(m_Scales, order);
+    Permute(m_Local, order);
+    Permute(m_World, order);
+    Permute(m_Parents, order);
+    Permute(m_Flags, order);
+    Permute(m_UpdatedIn, order);
+    Permute(m_SlotToId, order);
+    m_FirstChild.swap(firstChild);
+
+    m_Dirty.clear();
+    for (unsigned int slot = 0; slot < (unsigned int)order.size(); slot++)
+    {
+        if (m_Parents[slot] != s_None)
+            m_Parents[slot] = newSlots[m_Parents[slot]];
+        m_Ids[m_SlotToId[slot]].Slot = slot;
+        if (m_Flags[slot] & s_LocalDirty)
+            m_Dirty.push_back(slot);
+    }
+    m_OrderDirty = false;
+}
+
+size_t SceneGraph::MergeDirty(size_t dirty, unsigned int levelEnd)
+{
+    m_NextRanges.clear();
+    auto add = [this](Range range) {
+        if (!m_NextRanges.empty() && range.Begin <= m_NextRanges.back().End)
+            m_NextRanges.back().End = std::max(m_NextRanges.back().End, range.End);
+        else
+            m_NextRanges.push_back(range);
+    };
+
+    size_t range{ 0 };
+    while (range < m_Ranges.size() || (dirty < m_Dirty.size() && m_Dirty[dirty] < levelEnd))
+    {
+        bool takeDirty{ dirty < m_Dirty.size() && m_Dirty[dirty] < levelEnd &&
+            (range == m_Ranges.size() || m_Dirty[dirty] < m_Ranges[range].Begin) };
+        if (takeDirty)
+        {
+            add({ m_Dirty[dirty], m_Dirty[dirty] + 1 });
+            dirty++;
+        }
+        else
+            add(m_Ranges[range++]);
+    }
+    m_Ranges.swap(m_NextRanges);
+    return dirty;
+}
+
+void SceneGraph::UpdateRange(unsigned int begin, unsigned int end)
+{
+    //new local transforms first, dirty ones next to each other go through one compose
+    for (unsigned int i = begin; i < end;)
+    {
+        if (!(m_Flags[i] & s_LocalDirty))
+        {
+            i++;
+            continue;
+        }
+        unsigned int dirtyEnd{ i + 1 };
+        while (dirtyEnd < end && (m_Flags[dirtyEnd] & s_LocalDirty))
+            dirtyEnd++;
+        ComposeMatrices(&m_Translations[i], &m_Rotations[i], &m_Scales[i], &m_Local[i], dirtyEnd - i);
+        for (; i < dirtyEnd; i++)
+            m_Flags[i] &= ~s_LocalDirty;
+    }
+
+    //a level holds either only roots or no roots at all
+    if (m_Parents[begin] == s_None)
+        std::copy(m_Local.begin() + begin, m_Local.begin() + end, m_World.begin() + begin);
+    else
+    {
+        //siblings sit next to each other and share one parent matrix
+        for (unsigned int i = begin; i < end;)
+        {
+            unsigned int siblingsEnd{ i + 1 };
+            while (siblingsEnd < end && m_Parents[siblingsEnd] == m_Parents[i])
+                siblingsEnd++;
+            MultiplyMatrices(m_World[m_Parents[i]], &m_Local[i], &m_World[i], siblingsEnd - i);
+            i = siblingsEnd;
+        }
+    }
+    std::fill(m_UpdatedIn.begin() + begin, m_UpdatedIn.begin() + end, m_Epoch);
+}
+
+unsigned int SceneGraph::Update(WorkerPool* workers)
+{
+    if (m_OrderDirty)
+        Sort();
+    //a new epoch even when nothing moved, so WasUpdated() forgets the previous Update()
+    if (++m_Epoch == 0)
+    {
+        std::fill(m_UpdatedIn.begin(), m_UpdatedIn.end(), 0);
+        m_Epoch = 1;
+    }
+    if (m_Dirty.empty())
+        return 0;
+
+    //a level only reads the one above it, which is final by the time it starts
+    //sorted by slot. when a good part of the scene moved one pass over the flags beats sorting
+    if (m_Dirty.size() > m_World.size() / 16)
+    {
+        m_Dirty.clear();
+        for (unsigned int slot = 0; slot < (unsigned int)m_Flags.size(); slot++)
+        {
+            if (m_Flags[slot] & s_LocalDirty)
+                m_Dirty.push_back(slot);
+        }
+    }
+    else
+        std::sort(m_Dirty.begin(), m_Dirty.end());
+    m_Ranges.clear();
+    size_t dirty{ 0 };
+    unsigned int updated{ 0 };
+    unsigned int level{ GetLevel(m_Dirty[0]) };
+    while (level < GetLevelCount())
+    {
+        dirty = MergeDirty(dirty, m_LevelStart[level + 1]);
+        if (m_Ranges.empty())
+        {
+            //nothing to carry down, go straight to the next level with new local transforms
+            if (dirty == m_Dirty.size())
+                break;
+            level = GetLevel(m_Dirty[dirty]);
+            continue;
+        }
+
+        unsigned int total{ 0 };
+        m_RangeOffsets.clear();
+        for (const Range& range : m_Ranges)
+        {
+            m_RangeOffsets.push_back(total);
+            total += range.End - range.Begin;
+        }
+        if (workers && workers->GetThreadCount() != 0 && total >= 2 * s_ParallelGrain)
+        {
+            //chunks of the concatenated ranges
+            workers->ParallelFor(total, s_ParallelGrain, [this](unsigned int first, unsigned int last) {
+                size_t range{ (size_t)(std::upper_bound(m_RangeOffsets.begin(), m_RangeOffsets.end(), first) - m_RangeOffsets.begin()) - 1 };
+                while (first < last)
+                {
+                    unsigned int begin{ m_Ranges[range].Begin + (first - m_RangeOffsets[range]) };
+                    unsigned int end{ std::min(m_Ranges[range].End, begin + (last - first)) };
+                    UpdateRange(begin, end);
+                    first += end - begin;
+                    range++;
+                }
+            });
+        }
+        else
+        {
+            for (const Range& range : m_Ranges)
+                UpdateRange(range.Begin, range.End);
+        }
+        updated += total;
+
+        //the children of a run of slots are one run on the next level
+        m_NextRanges.clear();
+        for (const Range& range : m_Ranges)
+        {
+            Range children{ m_FirstChild[range.Begin], m_FirstChild[range.End] };
+            if (children.Begin == children.End)
+                continue;
+            if (!m_NextRanges.empty() && m_NextRanges.back().End == children.Begin)
+                m_NextRanges.back().End = children.End;
+            else
+                m_NextRanges.push_back(children);
+        }
+        m_Ranges.swap(m_NextRanges);
+        level++;
+    }
+    m_Dirty.clear();
+    s_NodesUpdated.Add(updated);
+    return updated;
+}
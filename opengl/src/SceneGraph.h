@@ -0,0 +1,117 @@
+#pragma once
+
+#include "ResourcePool.h"
+#include "VectorMath.h"
+#include "WorkerPool.h"
+
+#include <vector>
+
+struct SceneNodeTag;
+using SceneNode = Handle<SceneNodeTag>;
+
+//transform hierarchy stored as structure of arrays. nodes are kept in breadth-first order
+//(every root, then the children of the first root, those of the second, ...), so parents come
+//before their children, each level is one contiguous range and so are the children of any run
+//of nodes. Update() starts from the nodes with a new local transform and pushes ranges down one
+//level at a time: a range gets its world matrices from batch multiplies (MultiplyMatrices, one
+//per group of siblings) and its children become the range of the next level. large levels are
+//split over the WorkerPool, which covers independent roots as well as wide subtrees.
+//
+//only nodes whose local transform changed, and the subtrees below them, are recomputed.
+//creating, destroying or reparenting nodes re-sorts the arrays on the next Update(). one thread
+//at a time, world matrices are those of the last Update()
+class SceneGraph
+{
+private:
+	static constexpr unsigned int s_None{ 0xffffffffu };
+
+	//Flags
+	static constexpr unsigned char s_LocalDirty{ 1 };
+	static constexpr unsigned char s_Removed{ 2 };
+
+	struct Id
+	{
+		unsigned int Generation;
+		unsigned int Slot;
+	};
+
+	//[Begin, End) of slots
+	struct Range
+	{
+		unsigned int Begin;
+		unsigned int End;
+	};
+
+	std::vector<Id> m_Ids;
+	std::vector<unsigned int> m_FreeIds;
+
+	//per slot, in breadth-first order once sorted
+	std::vector<Vec3> m_Translations;
+	std::vector<Quat> m_Rotations;
+	std::vector<Vec3> m_Scales;
+	std::vector<Mat4> m_Local;
+	std::vector<Mat4> m_World;
+	std::vector<unsigned int> m_Parents;        //slot, s_None for roots
+	std::vector<unsigned int> m_FirstChild;     //children of slot i are [m_FirstChild[i], m_FirstChild[i + 1])
+	std::vector<unsigned char> m_Flags;
+	std::vector<unsigned int> m_UpdatedIn;      //m_Epoch of the Update() that last wrote the world matrix
+	std::vector<unsigned int> m_SlotToId;       //s_None once destroyed
+
+	std::vector<unsigned int> m_LevelStart;     //first slot of every level, then the slot count
+	bool m_OrderDirty;                          //slots were added, removed or reparented
+	std::vector<unsigned int> m_Dirty;          //slots with s_LocalDirty, in no particular order
+	unsigned int m_Epoch;
+
+	//Update() scratch, kept to not allocate every frame
+	std::vector<Range> m_Ranges;
+	std::vector<Range> m_NextRanges;
+	std::vector<unsigned int> m_RangeOffsets;
+
+	unsigned int GetSlot(SceneNode node) const;
+	unsigned int GetLevel(unsigned int slot) const;
+	void MarkDirty(unsigned int slot);
+	//breadth-first order again, drops removed slots along with everything below them
+	void Sort();
+	//m_Ranges plus the dirty slots m_Dirty[dirty..] of this level, merged into sorted disjoint
+	//ranges. returns where the dirty slots of the next levels start
+	size_t MergeDirty(size_t dirty, unsigned int levelEnd);
+	//new world matrices for every slot of [begin, end), which lies within one level
+	void UpdateRange(unsigned int begin, unsigned int end);
+public:
+	SceneGraph();
+
+	SceneGraph(const SceneGraph&) = delete;
+	SceneGraph& operator=(const SceneGraph&) = delete;
+
+	//parent may be a default handle for a new root. rotation must be unit length
+	SceneNode Create(SceneNode parent = {}, const Vec3& translation = { 0.0f, 0.0f, 0.0f },
+		const Quat& rotation = Quat::Identity(), const Vec3& scale = { 1.0f, 1.0f, 1.0f });
+	//the node's handle dies right away, its descendants' on the next Update()
+	bool Destroy(SceneNode node);
+	//keeps the local transform. fails for dead handles and when parent is inside node's subtree
+	bool SetParent(SceneNode node, SceneNode parent);
+	SceneNode GetParent(SceneNode node) const;
+	bool IsAlive(SceneNode node) const;
+
+	void SetTranslation(SceneNode node, const Vec3& translation);
+	void SetRotation(SceneNode node, const Quat& rotation);
+	void SetScale(SceneNode node, const Vec3& scale);
+	void SetTransform(SceneNode node, const Vec3& translation, const Quat& rotation, const Vec3& scale);
+	const Vec3& GetTranslation(SceneNode node) const;
+	const Quat& GetRotation(SceneNode node) const;
+	const Vec3& GetScale(SceneNode node) const;
+
+	//recomputes the dirty local and world matrices, on workers as well when given. returns how
+	//many world matrices changed
+	unsigned int Update(WorkerPool* workers = nullptr);
+
+	//as of the last Update()
+	const Mat4& GetWorld(SceneNode node) const;
+	//whether the last Update() changed the node's world matrix, e.g. to upload only those
+	bool WasUpdated(SceneNode node) const;
+
+	//every world matrix in breadth-first order, for whole-scene passes (culling, instance uploads)
+	inline const Mat4* GetWorldMatrices() const { return m_World.data(); }
+	inline unsigned int GetNodeCount() const { return (unsigned int)m_World.size(); }
+	inline unsigned int GetLevelCount() const { return (unsigned int)m_LevelStart.size() - 1; }
+};
@@ -0,0 +1,130 @@
+#include "Shader.h"
+#include "Renderer.h"
+#include "FileSystem.h"
+#include "AllocationTracker.h"
+
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+ShaderProgramSource ParseShader(const std::string& filepath) 
+{
+    //split in place straight out of the mapped file (or pack entry), so the only heap
+    //allocations left are the two result strings
+    VirtualFile file;
+    if (!FileSystem::Get().Open(filepath, file))
+        return {};
+    return ParseShader((const char*)file.GetData(), file.GetSize());
+}
+
+ShaderProgramSource ParseShader(const char* text, size_t size)
+{
+    ALLOCATION_SCOPE("Shader");
+    enum class ShaderType
+    {
+        NONE = -1, VERTEX = 0, FRAGMENT = 1
+    };
+    //CHANGE CLASS TO STATIC TO BE ABLE TO CALL FUNCTIONS OUTSIDE OF SCOPE(?)
+
+    ShaderProgramSource source;
+    source.VertexSource.reserve(size);
+    source.FragmentSouce.reserve(size);
+    std::string* targets[2] { &source.VertexSource, &source.FragmentSouce };
+    ShaderType type {ShaderType::NONE};
+
+    std::string_view remaining(text, size);
+    while (!remaining.empty())
+    {
+        size_t end{ remaining.find('\n') };
+        std::string_view line{ remaining.substr(0, end) };
+        remaining.remove_prefix(end == std::string_view::npos ? remaining.size() : end + 1);
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+
+        if (line.find("#shader") != std::string_view::npos)
+        {
+            if (line.find("vertex") != std::string_view::npos)
+            {
+                //set mode to vertex
+                type = ShaderType::VERTEX;
+            }
+            else if (line.find("fragment") != std::string_view::npos)
+            {
+                //set mode to fragment
+                type = ShaderType::FRAGMENT;
+            }
+        }
+        else if (type != ShaderType::NONE)
+        {
+            targets[(int)type]->append(line).push_back('\n');
+        }
+    }
+
+    return source;
+}
+
+unsigned int CompileShader(unsigned int type, const std::string& source)
+{
+    unsigned int id { glCreateShader(type) };
+    const char* src { source.c_str() };
+    GLCall(glShaderSource(id, 1, &src, nullptr));
+    GLCall(glCompileShader(id));
+   
+    //glGetShaderiv(id, GL_COMPILE_STATUS, &result);
+    //if(result)
+
+    //TODO:ERROR HANDLING
+    //query to check if ID is good
+    int result;
+    GLCall(glGetShaderiv(id, GL_COMPILE_STATUS, &result));
+    //std::cout << (type == GL_VERTEX_SHADER ? "vertex" : "fragment") << "shader compile status" << result << std::endl;
+    if (result == GL_FALSE)
+    {
+        //print the error message
+        int length;
+        GLCall(glGetShaderiv(id, GL_INFO_LOG_LENGTH, &length));
+        //char message[length];
+
+        std::vector<char> message(length > 0 ? length : 1);
+        GLCall(glGetShaderInfoLog(id, length, &length, message.data()));
+        std::cout << "FAILED TO COMPILE SHADER:" << 
+            (type == GL_VERTEX_SHADER ? "vertex" : "fragment") << " shader" << std::endl;
+        std::cout << message.data() << std::endl;
+        GLCall(glDeleteShader(id));
+        return 0;
+    }
+
+    return id;
+}
+
+unsigned int CreateShader(const std::string& vertexShader, const std::string& fragmentShader)
+{
+    ALLOCATION_SCOPE("Shader");
+    unsigned int program{ glCreateProgram() };
+    unsigned int vs{ CompileShader(GL_VERTEX_SHADER, vertexShader) };
+    unsigned int fs{ CompileShader(GL_FRAGMENT_SHADER, fragmentShader) };
+
+    GLCall(glAttachShader(program, vs));
+    GLCall(glAttachShader(program, fs));
+    GLCall(glLinkProgram(program));
+
+    GLint program_linked;
+
+    GLCall(glGetProgramiv(program, GL_LINK_STATUS, &program_linked));
+    std::cout << "Program link status: " << program_linked << std::endl;
+    if (program_linked != GL_TRUE)
+    {
+        GLsizei log_length{ 0 };
+        GLchar message[1024];
+        glGetProgramInfoLog(program, 1024, &log_length, message);
+        std::cout << "Failed to link program" << std::endl;
+        std::cout << message << std::endl;
+    }
+
+    GLCall(glValidateProgram(program));
+
+    GLCall(glDeleteShader(vs));
+    GLCall(glDeleteShader(fs));
+
+    return program;
+}
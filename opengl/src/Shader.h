@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+struct ShaderProgramSource
+{
+	std::string VertexSource;
+	std::string FragmentSouce;
+};
+
+//splits a .shader file on its "#shader vertex" / "#shader fragment" markers
+ShaderProgramSource ParseShader(const std::string& filepath);
+//the same on the file's contents already in memory, safe from any thread
+ShaderProgramSource ParseShader(const char* text, size_t size);
+
+//returns 0 if the stage failed to compile (the log is printed)
+unsigned int CompileShader(unsigned int type, const std::string& source);
+unsigned int CreateShader(const std::string& vertexShader, const std::string& fragmentShader);
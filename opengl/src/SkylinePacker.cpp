@@ -0,0 +1,94 @@
+#include "SkylinePacker.h"
+
+#include <algorithm>
+
+SkylinePacker::SkylinePacker(unsigned int width, unsigned int height)
+    : m_Width(width), m_Height(height), m_UsedArea(0)
+{
+    Reset();
+}
+
+void SkylinePacker::Reset()
+{
+    m_Skyline.clear();
+    m_Skyline.push_back({ 0, 0, m_Width });
+    m_UsedArea = 0;
+}
+
+bool SkylinePacker::Fit(size_t index, unsigned int width, unsigned int height, unsigned int& y) const
+{
+    if (m_Skyline[index].X + width > m_Width)
+        return false;
+
+    //the rectangle rests on the highest segment it spans
+    y = 0;
+    unsigned int remaining{ width };
+    for (size_t i = index; remaining > 0; i++)
+    {
+        y = std::max(y, m_Skyline[i].Y);
+        if (y + height > m_Height)
+            return false;
+        remaining -= std::min(remaining, m_Skyline[i].Width);
+    }
+    return true;
+}
+
+bool SkylinePacker::Insert(unsigned int width, unsigned int height, unsigned int& x, unsigned int& y)
+{
+    if (!width || !height || width > m_Width || height > m_Height)
+        return false;
+
+    //bottom-left: lowest resulting top edge, ties go to the narrower segment (less wasted gap)
+    size_t best{ m_Skyline.size() };
+    unsigned int bestTop{ 0xffffffffu };
+    unsigned int bestWidth{ 0xffffffffu };
+    for (size_t i = 0; i < m_Skyline.size(); i++)
+    {
+        unsigned int fitY;
+        if (!Fit(i, width, height, fitY))
+            continue;
+        unsigned int top{ fitY + height };
+        if (top < bestTop || (top == bestTop && m_Skyline[i].Width < bestWidth))
+        {
+            best = i;
+            bestTop = top;
+            bestWidth = m_Skyline[i].Width;
+            y = fitY;
+        }
+    }
+    if (best == m_Skyline.size())
+        return false;
+    x = m_Skyline[best].X;
+
+    //the new segment replaces whatever part of the skyline it covers
+    m_Skyline.insert(m_Skyline.begin() + best, { x, bestTop, width });
+    for (size_t i = best + 1; i < m_Skyline.size();)
+    {
+        Segment& segment{ m_Skyline[i] };
+        unsigned int end{ x + width };
+        if (segment.X >= end)
+            break;
+        unsigned int shrink{ std::min(end - segment.X, segment.Width) };
+        segment.X += shrink;
+        segment.Width -= shrink;
+        if (segment.Width == 0)
+            m_Skyline.erase(m_Skyline.begin() + i);
+        else
+            i++;
+    }
+
+    //merge neighbours at the same height
+    for (size_t i = 0; i + 1 < m_Skyline.size();)
+    {
+        if (m_Skyline[i].Y == m_Skyline[i + 1].Y)
+        {
+            m_Skyline[i].Width += m_Skyline[i + 1].Width;
+            m_Skyline.erase(m_Skyline.begin() + i + 1);
+        }
+        else
+            i++;
+    }
+
+    m_UsedArea += (unsigned long long)width * height;
+    return true;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+//packs rectangles into a fixed width x height area by tracking the skyline (the top edge of
+//everything placed so far) and putting each rectangle where its top ends up lowest.
+//insert only: space of removed rectangles comes back by resetting and packing again
+class SkylinePacker
+{
+private:
+	struct Segment
+	{
+		unsigned int X;
+		unsigned int Y;
+		unsigned int Width;
+	};
+
+	std::vector<Segment> m_Skyline;     //sorted by X, covering the full width
+	unsigned int m_Width;
+	unsigned int m_Height;
+	unsigned long long m_UsedArea;
+
+	//lowest y a width wide rectangle can sit at when starting at segment index, false if it sticks out
+	bool Fit(size_t index, unsigned int width, unsigned int height, unsigned int& y) const;
+public:
+	SkylinePacker(unsigned int width, unsigned int height);
+
+	void Reset();
+	bool Insert(unsigned int width, unsigned int height, unsigned int& x, unsigned int& y);
+
+	inline unsigned int GetWidth() const { return m_Width; }
+	inline unsigned int GetHeight() const { return m_Height; }
+	inline unsigned long long GetUsedArea() const { return m_UsedArea; }
+	inline float GetOccupancy() const { return (float)m_UsedArea / ((float)m_Width * m_Height); }
+};
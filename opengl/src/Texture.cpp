@@ -0,0 +1,182 @@
+#include "Texture.h"
+#include "GpuMemory.h"
+#include "CompressedImage.h"
+
+#include <algorithm>
+
+static unsigned int GetBytesPerPixel(unsigned int internalFormat)
+{
+    switch (internalFormat)
+    {
+        case GL_R8:             return 1;
+        case GL_RG8:            return 2;
+        case GL_RGB8:           return 3;
+        case GL_RGBA16F:        return 8;
+        case GL_RGBA32F:        return 16;
+        default:                return 4;   //GL_RGBA8, GL_SRGB8_ALPHA8
+    }
+}
+
+unsigned int GetBlockBytes(unsigned int internalFormat)
+{
+    switch (internalFormat)
+    {
+        case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_RED_RGTC1:
+        case GL_COMPRESSED_SIGNED_RED_RGTC1:
+            return 8;
+        case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+        case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+        case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT:
+        case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+        case GL_COMPRESSED_RG_RGTC2:
+        case GL_COMPRESSED_SIGNED_RG_RGTC2:
+        case GL_COMPRESSED_RGBA_BPTC_UNORM:
+        case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+        case GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT:
+        case GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT:
+            return 16;
+        default:
+            return 0;
+    }
+}
+
+bool IsBlockCompressed(unsigned int internalFormat)
+{
+    return GetBlockBytes(internalFormat) != 0;
+}
+
+unsigned long long GetImageSize(unsigned int internalFormat, unsigned int width, unsigned int height)
+{
+    unsigned int blockBytes{ GetBlockBytes(internalFormat) };
+    if (blockBytes)
+        return (unsigned long long)((width + 3) / 4) * ((height + 3) / 4) * blockBytes;
+    return (unsigned long long)width * height * GetBytesPerPixel(internalFormat);
+}
+
+Texture::Texture(unsigned int width, unsigned int height, unsigned int levels, unsigned int internalFormat)
+    : m_RendererID(0), m_Width(width), m_Height(height),
+      m_Levels(levels ? std::min(levels, GetFullMipCount(width, height)) : GetFullMipCount(width, height)),
+      m_InternalFormat(internalFormat)
+{
+    GLCall(glGenTextures(1, &m_RendererID));
+    GLCall(glBindTexture(GL_TEXTURE_2D, m_RendererID));
+    GLCall(glTexStorage2D(GL_TEXTURE_2D, m_Levels, internalFormat, width, height));
+
+    GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, m_Levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR));
+    GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+    GpuMemory::Get().Track(GpuMemoryCategory::Texture, m_RendererID, GetMemorySize());
+}
+
+//the levels of a compressed image, 0 would ask the delegated constructor for a full chain the
+//image has no data for
+static unsigned int GetStoredLevels(const CompressedImage& image)
+{
+    ASSERT(image.IsValid());
+    return (unsigned int)image.Levels.size();
+}
+
+Texture::Texture(const CompressedImage& image)
+    : Texture(image.Width, image.Height, GetStoredLevels(image), image.InternalFormat)
+{
+    for (unsigned int level = 0; level < m_Levels; level++)
+    {
+        const CompressedLevel& data{ image.Levels[level] };
+        SetCompressedData(level, 0, 0, data.Width, data.Height, image.GetLevelData(level), (unsigned int)data.Size);
+    }
+}
+
+Texture::~Texture()
+{
+    if (m_RendererID)
+    {
+        GpuMemory::Get().Untrack(GpuMemoryCategory::Texture, m_RendererID);
+        GLCall(glDeleteTextures(1, &m_RendererID));
+    }
+}
+
+Texture::Texture(Texture&& other) noexcept
+    : m_RendererID(other.m_RendererID), m_Width(other.m_Width), m_Height(other.m_Height),
+      m_Levels(other.m_Levels), m_InternalFormat(other.m_InternalFormat)
+{
+    other.m_RendererID = 0;
+}
+
+Texture& Texture::operator=(Texture&& other) noexcept
+{
+    if (this != &other)
+    {
+        if (m_RendererID)
+        {
+            GpuMemory::Get().Untrack(GpuMemoryCategory::Texture, m_RendererID);
+            GLCall(glDeleteTextures(1, &m_RendererID));
+        }
+        m_RendererID = other.m_RendererID;
+        m_Width = other.m_Width;
+        m_Height = other.m_Height;
+        m_Levels = other.m_Levels;
+        m_InternalFormat = other.m_InternalFormat;
+        other.m_RendererID = 0;
+    }
+    return *this;
+}
+
+void Texture::SetData(unsigned int level, unsigned int x, unsigned int y, unsigned int width, unsigned int height, const void* data)
+{
+    ASSERT(level < m_Levels);
+    GLCall(glBindTexture(GL_TEXTURE_2D, m_RendererID));
+    GLCall(glTexSubImage2D(GL_TEXTURE_2D, level, x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, data));
+}
+
+void Texture::SetCompressedData(unsigned int level, unsigned int x, unsigned int y, unsigned int width, unsigned int height,
+    const void* data, unsigned int size)
+{
+    ASSERT(level < m_Levels && IsBlockCompressed(m_InternalFormat));
+    GLCall(glBindTexture(GL_TEXTURE_2D, m_RendererID));
+    GLCall(glCompressedTexSubImage2D(GL_TEXTURE_2D, level, x, y, width, height, m_InternalFormat, size, data));
+}
+
+void Texture::GenerateMipmaps()
+{
+    if (m_Levels < 2 || IsBlockCompressed(m_InternalFormat))
+        return;
+    GLCall(glBindTexture(GL_TEXTURE_2D, m_RendererID));
+    GLCall(glGenerateMipmap(GL_TEXTURE_2D));
+}
+
+void Texture::Bind(unsigned int slot) const
+{
+    GLCall(glActiveTexture(GL_TEXTURE0 + slot));
+    GLCall(glBindTexture(GL_TEXTURE_2D, m_RendererID));
+}
+
+void Texture::Unbind() const
+{
+    GLCall(glBindTexture(GL_TEXTURE_2D, 0));
+}
+
+unsigned long long Texture::GetMemorySize() const
+{
+    unsigned long long size{ 0 };
+    unsigned int width{ m_Width }, height{ m_Height };
+    for (unsigned int level = 0; level < m_Levels; level++)
+    {
+        size += GetImageSize(m_InternalFormat, width, height);
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+    return size;
+}
+
+unsigned int Texture::GetFullMipCount(unsigned int width, unsigned int height)
+{
+    unsigned int levels{ 1 };
+    for (unsigned int size = std::max(width, height); size > 1; size /= 2)
+        levels++;
+    return levels;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Renderer.h"
+
+struct CompressedImage;
+
+//block compressed formats (S3TC/RGTC/BPTC) are 4x4 texel blocks of 8 or 16 bytes
+bool IsBlockCompressed(unsigned int internalFormat);
+//bytes of one block, 0 for uncompressed formats
+unsigned int GetBlockBytes(unsigned int internalFormat);
+//bytes of one width x height image in this format
+unsigned long long GetImageSize(unsigned int internalFormat, unsigned int width, unsigned int height);
+
+//2D texture with immutable storage: glTexStorage2D allocates every mip level once, only the
+//contents change afterwards. compressed internal formats work the same way
+class Texture
+{
+private:
+	unsigned int m_RendererID;
+	unsigned int m_Width;
+	unsigned int m_Height;
+	unsigned int m_Levels;
+	unsigned int m_InternalFormat;
+public:
+	//levels == 0 allocates the full mip chain; contents are undefined until uploaded
+	Texture(unsigned int width, unsigned int height, unsigned int levels = 1, unsigned int internalFormat = GL_RGBA8);
+	//storage in the image's format, every level it carries uploaded as is
+	explicit Texture(const CompressedImage& image);
+	~Texture();
+
+	Texture(const Texture&) = delete;
+	Texture& operator=(const Texture&) = delete;
+	Texture(Texture&& other) noexcept;
+	Texture& operator=(Texture&& other) noexcept;
+
+	//RGBA8 pixels into a region of one level. with a GL_PIXEL_UNPACK_BUFFER bound, data is a
+	//byte offset into that buffer and the call does not wait on client memory
+	void SetData(unsigned int level, unsigned int x, unsigned int y, unsigned int width, unsigned int height, const void* data);
+	//already compressed blocks for a block aligned region, size in bytes
+	void SetCompressedData(unsigned int level, unsigned int x, unsigned int y, unsigned int width, unsigned int height,
+		const void* data, unsigned int size);
+	//fills levels 1.. from level 0 on the GPU, not possible for compressed formats
+	void GenerateMipmaps();
+
+	void Bind(unsigned int slot = 0) const;
+	void Unbind() const;
+
+	inline unsigned int GetWidth() const { return m_Width; }
+	inline unsigned int GetHeight() const { return m_Height; }
+	inline unsigned int GetLevels() const { return m_Levels; }
+	inline unsigned int GetInternalFormat() const { return m_InternalFormat; }
+	inline unsigned int GetRendererID() const { return m_RendererID; }
+	unsigned long long GetMemorySize() const;
+
+	//number of levels down to 1x1
+	static unsigned int GetFullMipCount(unsigned int width, unsigned int height);
+};
@@ -0,0 +1,288 @@
+#include "TextureAtlas.h"
+#include "GpuMemory.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+TextureAtlas::TextureAtlas(unsigned int size, unsigned int layers, unsigned int padding, unsigned int levels, WorkerPool* workers)
+    : m_RendererID(0), m_Size(size), m_Layers(layers), m_Levels(std::max(levels, 1u)), m_Padding(padding), m_Workers(workers),
+      m_DeadArea(0), m_UsedArea(0), m_RepackThreshold(0.3f), m_MipsDirty(false), m_Repacks(0), m_Serial(0),
+      m_Removals(0), m_FailedRemovals(~0ull)
+{
+    m_Packers.assign(layers, SkylinePacker(size, size));
+
+    GLCall(glGenTextures(1, &m_RendererID));
+    GLCall(glBindTexture(GL_TEXTURE_2D_ARRAY, m_RendererID));
+    GLCall(glTexStorage3D(GL_TEXTURE_2D_ARRAY, m_Levels, GL_RGBA8, size, size, layers));
+    GLCall(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, m_Levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR));
+    GLCall(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    GLCall(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    GLCall(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+
+    unsigned long long bytes{ 0 };
+    for (unsigned int level = 0, levelSize = size; level < m_Levels; level++, levelSize = std::max(levelSize / 2, 1u))
+        bytes += (unsigned long long)levelSize * levelSize * 4 * layers;
+    GpuMemory::Get().Track(GpuMemoryCategory::Texture, m_RendererID, bytes);
+}
+
+TextureAtlas::~TextureAtlas()
+{
+    //the repack job reads this object, the counter is done only once the job has let go of it
+    if (m_Workers)
+        m_Workers->WaitFor(m_RepackJob);
+
+    GpuMemory::Get().Untrack(GpuMemoryCategory::Texture, m_RendererID);
+    GLCall(glDeleteTextures(1, &m_RendererID));
+}
+
+bool TextureAtlas::Place(std::vector<SkylinePacker>& packers, unsigned int width, unsigned int height, AtlasRegion& region) const
+{
+    for (unsigned int layer = 0; layer < (unsigned int)packers.size(); layer++)
+    {
+        unsigned int x, y;
+        if (!packers[layer].Insert(width + 2 * m_Padding, height + 2 * m_Padding, x, y))
+            continue;
+        region.Layer = layer;
+        region.X = x + m_Padding;
+        region.Y = y + m_Padding;
+        region.Width = width;
+        region.Height = height;
+        region.U0 = (float)region.X / m_Size;
+        region.V0 = (float)region.Y / m_Size;
+        region.U1 = (float)(region.X + width) / m_Size;
+        region.V1 = (float)(region.Y + height) / m_Size;
+        return true;
+    }
+    return false;
+}
+
+void TextureAtlas::Compose(const Image& image, unsigned char* block, size_t stride) const
+{
+    //border rows repeat the first/last row, border columns the first/last texel of each row
+    unsigned int rows{ image.Height + 2 * m_Padding };
+    for (unsigned int row = 0; row < rows; row++)
+    {
+        unsigned int source{ row < m_Padding ? 0 : std::min(row - m_Padding, image.Height - 1) };
+        const unsigned char* src{ image.Pixels.data() + source * image.GetRowSize() };
+        unsigned char* dst{ block + row * stride };
+        for (unsigned int i = 0; i < m_Padding; i++, dst += 4)
+            std::memcpy(dst, src, 4);
+        std::memcpy(dst, src, image.GetRowSize());
+        dst += image.GetRowSize();
+        for (unsigned int i = 0; i < m_Padding; i++, dst += 4)
+            std::memcpy(dst, src + image.GetRowSize() - 4, 4);
+    }
+}
+
+void TextureAtlas::Upload(const Image& image, const AtlasRegion& region)
+{
+    unsigned int width{ image.Width + 2 * m_Padding };
+    unsigned int height{ image.Height + 2 * m_Padding };
+    std::vector<unsigned char> block((size_t)width * height * 4);
+    Compose(image, block.data(), (size_t)width * 4);
+
+    GLCall(glBindTexture(GL_TEXTURE_2D_ARRAY, m_RendererID));
+    GLCall(glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, region.X - m_Padding, region.Y - m_Padding, region.Layer,
+        width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, block.data()));
+    m_MipsDirty = true;
+}
+
+AtlasHandle TextureAtlas::Insert(Image image)
+{
+    if (!image.IsValid() || image.Width + 2 * m_Padding > m_Size || image.Height + 2 * m_Padding > m_Size)
+    {
+        std::cout << "Image " << image.Width << "x" << image.Height << " does not fit a " << m_Size << " atlas" << std::endl;
+        return {};
+    }
+
+    AtlasRegion region;
+    if (!Place(m_Packers, image.Width, image.Height, region))
+    {
+        //full, but maybe only because of holes big enough to hold it
+        if (m_DeadArea >= (unsigned long long)(image.Width + 2 * m_Padding) * (image.Height + 2 * m_Padding) && CanRepack())
+            Compact();
+        if (!Place(m_Packers, image.Width, image.Height, region))
+        {
+            std::cout << "Texture atlas full (" << m_Entries.Size() << " images)" << std::endl;
+            return {};
+        }
+    }
+
+    AtlasHandle handle{ m_Entries.Allocate() };
+    std::shared_ptr<const Image> pixels{ std::make_shared<const Image>(std::move(image)) };
+    Upload(*pixels, region);
+    m_Entries.Emplace(handle, { region, std::move(pixels), handle, m_Serial++ });
+    m_UsedArea += (unsigned long long)(region.Width + 2 * m_Padding) * (region.Height + 2 * m_Padding);
+    return handle;
+}
+
+void TextureAtlas::Remove(AtlasHandle handle)
+{
+    AtlasEntry* entry{ m_Entries.Get(handle) };
+    if (!entry)
+        return;
+    m_DeadArea += (unsigned long long)(entry->Region.Width + 2 * m_Padding) * (entry->Region.Height + 2 * m_Padding);
+    m_Entries.Remove(handle);
+    m_Removals++;
+}
+
+const AtlasRegion* TextureAtlas::Get(AtlasHandle handle)
+{
+    AtlasEntry* entry{ m_Entries.Get(handle) };
+    return entry ? &entry->Region : nullptr;
+}
+
+std::unique_ptr<TextureAtlas::Repack> TextureAtlas::BuildRepack(
+    std::vector<std::pair<AtlasHandle, std::shared_ptr<const Image>>> images, unsigned long long serial,
+    unsigned long long removals) const
+{
+    std::unique_ptr<Repack> repack{ std::make_unique<Repack>() };
+    repack->Serial = serial;
+    repack->Removals = removals;
+    repack->Complete = true;
+    repack->Packers.assign(m_Layers, SkylinePacker(m_Size, m_Size));
+
+    //tallest first packs a skyline much tighter than insertion order
+    std::sort(images.begin(), images.end(), [](const auto& a, const auto& b) {
+        return a.second->Height != b.second->Height ? a.second->Height > b.second->Height : a.second->Width > b.second->Width;
+    });
+
+    size_t stride{ (size_t)m_Size * 4 };
+    for (const auto& image : images)
+    {
+        AtlasRegion region;
+        if (!Place(repack->Packers, image.second->Width, image.second->Height, region))
+        {
+            repack->Complete = false;
+            return repack;
+        }
+        if (repack->Layers.size() <= region.Layer)
+            repack->Layers.resize(region.Layer + 1);
+        std::vector<unsigned char>& layer{ repack->Layers[region.Layer] };
+        if (layer.empty())
+            layer.resize(stride * m_Size);
+        Compose(*image.second, layer.data() + (region.Y - m_Padding) * stride + (region.X - m_Padding) * 4, stride);
+        repack->Regions.push_back({ image.first, region });
+    }
+    return repack;
+}
+
+void TextureAtlas::StartRepack(bool background)
+{
+    std::vector<std::pair<AtlasHandle, std::shared_ptr<const Image>>> images;
+    images.reserve(m_Entries.Size());
+    for (const AtlasEntry& entry : m_Entries)
+        images.push_back({ entry.Self, entry.Pixels });
+
+    if (!background)
+    {
+        ApplyRepack(BuildRepack(std::move(images), m_Serial, m_Removals));
+        return;
+    }
+
+    //the images are immutable and shared, so the worker can compose pages while we keep inserting
+    unsigned long long serial{ m_Serial };
+    unsigned long long removals{ m_Removals };
+    m_Workers->Submit([this, images = std::move(images), serial, removals]() mutable {
+        std::unique_ptr<Repack> repack{ BuildRepack(std::move(images), serial, removals) };
+        std::lock_guard<std::mutex> lock(m_RepackMutex);
+        m_RepackResult = std::move(repack);
+    }, &m_RepackJob);
+}
+
+void TextureAtlas::ApplyRepack(std::unique_ptr<Repack> repack)
+{
+    if (!repack->Complete)
+    {
+        //keep the current layout, it still holds everything. the same images would fail again
+        m_FailedRemovals = repack->Removals;
+        return;
+    }
+
+    m_Packers = std::move(repack->Packers);
+    m_UsedArea = 0;
+    m_DeadArea = 0;
+    for (const auto& placed : repack->Regions)
+    {
+        unsigned long long area{ (unsigned long long)(placed.second.Width + 2 * m_Padding) * (placed.second.Height + 2 * m_Padding) };
+        m_UsedArea += area;
+        if (AtlasEntry* entry = m_Entries.Get(placed.first))
+            entry->Region = placed.second;
+        else
+            m_DeadArea += area;     //removed while the repack ran
+    }
+
+    GLCall(glBindTexture(GL_TEXTURE_2D_ARRAY, m_RendererID));
+    for (unsigned int layer = 0; layer < (unsigned int)repack->Layers.size(); layer++)
+    {
+        if (repack->Layers[layer].empty())
+            continue;
+        GLCall(glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, m_Size, m_Size, 1, GL_RGBA, GL_UNSIGNED_BYTE, repack->Layers[layer].data()));
+    }
+    m_MipsDirty = true;
+    m_Repacks++;
+
+    //inserted after the snapshot: place them into the new layout
+    std::vector<AtlasHandle> dropped;
+    for (AtlasEntry& entry : m_Entries)
+    {
+        if (entry.Serial < repack->Serial)
+            continue;
+        if (!Place(m_Packers, entry.Region.Width, entry.Region.Height, entry.Region))
+        {
+            dropped.push_back(entry.Self);
+            continue;
+        }
+        Upload(*entry.Pixels, entry.Region);
+        m_UsedArea += (unsigned long long)(entry.Region.Width + 2 * m_Padding) * (entry.Region.Height + 2 * m_Padding);
+    }
+    for (AtlasHandle handle : dropped)
+    {
+        std::cout << "Texture atlas full after repack, dropping an image" << std::endl;
+        m_Entries.Remove(handle);
+    }
+}
+
+void TextureAtlas::Update()
+{
+    std::unique_ptr<Repack> repack;
+    {
+        std::lock_guard<std::mutex> lock(m_RepackMutex);
+        repack = std::move(m_RepackResult);
+    }
+    if (repack)
+        ApplyRepack(std::move(repack));
+    else if (m_RepackJob.IsDone() && GetFragmentation() > m_RepackThreshold && CanRepack())
+        StartRepack(m_Workers != nullptr);
+
+    if (m_MipsDirty && m_Levels > 1)
+    {
+        GLCall(glBindTexture(GL_TEXTURE_2D_ARRAY, m_RendererID));
+        GLCall(glGenerateMipmap(GL_TEXTURE_2D_ARRAY));
+    }
+    m_MipsDirty = false;
+}
+
+void TextureAtlas::Compact()
+{
+    //a result still in flight was built from an older snapshot, drop it
+    if (m_Workers)
+        m_Workers->WaitFor(m_RepackJob);
+    {
+        std::lock_guard<std::mutex> lock(m_RepackMutex);
+        m_RepackResult.reset();
+    }
+    StartRepack(false);
+}
+
+void TextureAtlas::Bind(unsigned int slot) const
+{
+    GLCall(glActiveTexture(GL_TEXTURE0 + slot));
+    GLCall(glBindTexture(GL_TEXTURE_2D_ARRAY, m_RendererID));
+}
+
+float TextureAtlas::GetFragmentation() const
+{
+    return m_UsedArea ? (float)m_DeadArea / m_UsedArea : 0.0f;
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "Image.h"
+#include "ResourcePool.h"
+#include "Renderer.h"
+#include "SkylinePacker.h"
+#include "WorkerPool.h"
+
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+//where an image ended up: layer of the array texture and its rectangle without the padding
+struct AtlasRegion
+{
+	unsigned int Layer;
+	unsigned int X, Y, Width, Height;   //texels
+	float U0, V0, U1, V1;
+};
+
+struct AtlasEntry;
+using AtlasHandle = Handle<AtlasEntry>;
+
+struct AtlasEntry
+{
+	AtlasRegion Region;
+	std::shared_ptr<const Image> Pixels;    //kept for repacking
+	AtlasHandle Self;
+	unsigned long long Serial;              //insertion order, tells a repack which entries it has not seen
+};
+
+//packs many small images into the layers of one GL_TEXTURE_2D_ARRAY so sprites with different
+//images still share a single bind. every image gets a border of extruded edge texels so
+//filtering and mip levels do not bleed in neighbours. removing images leaves holes in the
+//skyline; once too much of the atlas is dead a repack runs on the WorkerPool and is swapped
+//in by a later Update(). regions move when that happens, so look them up per draw.
+//all calls are GL thread only
+class TextureAtlas
+{
+private:
+	struct Repack
+	{
+		std::vector<std::pair<AtlasHandle, AtlasRegion>> Regions;
+		std::vector<SkylinePacker> Packers;
+		std::vector<std::vector<unsigned char>> Layers;
+		unsigned long long Serial;      //entries inserted from here on are not in this layout
+		unsigned long long Removals;    //m_Removals when the snapshot was taken
+		bool Complete;                  //false when the live images no longer fit
+	};
+
+	unsigned int m_RendererID;
+	unsigned int m_Size;
+	unsigned int m_Layers;
+	unsigned int m_Levels;
+	unsigned int m_Padding;
+	WorkerPool* m_Workers;
+
+	ResourcePool<AtlasEntry> m_Entries;
+	std::vector<SkylinePacker> m_Packers;
+	unsigned long long m_DeadArea;      //padded area of removed images still taking up space
+	unsigned long long m_UsedArea;
+	float m_RepackThreshold;
+	bool m_MipsDirty;
+	unsigned int m_Repacks;
+	unsigned long long m_Serial;
+	unsigned long long m_Removals;          //Remove() calls so far
+	unsigned long long m_FailedRemovals;    //m_Removals of the last repack that did not fit, ~0 if none
+
+	JobCounter m_RepackJob;             //the background repack until it has run
+	std::mutex m_RepackMutex;
+	std::unique_ptr<Repack> m_RepackResult;
+
+	bool Place(std::vector<SkylinePacker>& packers, unsigned int width, unsigned int height, AtlasRegion& region) const;
+	//writes image plus its extruded border into the block, which starts at the padding corner
+	void Compose(const Image& image, unsigned char* block, size_t stride) const;
+	void Upload(const Image& image, const AtlasRegion& region);
+	std::unique_ptr<Repack> BuildRepack(std::vector<std::pair<AtlasHandle, std::shared_ptr<const Image>>> images, unsigned long long serial,
+		unsigned long long removals) const;
+	void ApplyRepack(std::unique_ptr<Repack> repack);
+	void StartRepack(bool background);
+	//false after a repack that did not fit until something is removed, the same images would
+	//not fit again
+	inline bool CanRepack() const { return m_Removals != m_FailedRemovals; }
+public:
+	//padding is in texels on every side, for levels > 1 use at least 1 << (levels - 1)
+	TextureAtlas(unsigned int size = 2048, unsigned int layers = 4, unsigned int padding = 2,
+		unsigned int levels = 1, WorkerPool* workers = nullptr);
+	~TextureAtlas();
+
+	TextureAtlas(const TextureAtlas&) = delete;
+	TextureAtlas& operator=(const TextureAtlas&) = delete;
+
+	//invalid handle when the image does not fit even after repacking
+	AtlasHandle Insert(Image image);
+	void Remove(AtlasHandle handle);
+	const AtlasRegion* Get(AtlasHandle handle);
+
+	//once per frame: swaps in a finished background repack and regenerates mips
+	void Update();
+	//repacks right away, blocking
+	void Compact();
+
+	void Bind(unsigned int slot = 0) const;
+
+	//share of the used area that belongs to removed images
+	float GetFragmentation() const;
+	inline void SetRepackThreshold(float fragmentation) { m_RepackThreshold = fragmentation; }
+	inline unsigned int GetRepackCount() const { return m_Repacks; }
+	inline bool IsRepacking() const { return !m_RepackJob.IsDone(); }
+	inline size_t GetImageCount() const { return m_Entries.Size(); }
+	inline unsigned int GetSize() const { return m_Size; }
+	inline unsigned int GetLayerCount() const { return m_Layers; }
+	inline unsigned int GetRendererID() const { return m_RendererID; }
+};
@@ -0,0 +1,448 @@
+#include "TextureResidency.h"
+#include "MipGenerator.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+
+static const ProfilerCounter s_UploadBytes("Residency upload bytes");
+static const ProfilerCounter s_EvictedBytes("Residency evicted bytes");
+static const ProfilerCounter s_PendingRequests("Residency pending requests");
+
+namespace {
+
+    bool HasExtension(const std::string& filepath, const char* extension)
+    {
+        size_t length{ std::char_traits<char>::length(extension) };
+        if (filepath.size() < length)
+            return false;
+        for (size_t i = 0; i < length; i++)
+        {
+            if (std::tolower((unsigned char)filepath[filepath.size() - length + i]) != extension[i])
+                return false;
+        }
+        return true;
+    }
+
+    //the first level no larger than tailSize on its longest side, or the last one
+    unsigned int FindTailLevel(unsigned int width, unsigned int height, unsigned int levels, unsigned int tailSize)
+    {
+        unsigned int level{ 0 };
+        while (level + 1 < levels && std::max(width >> level, height >> level) > tailSize)
+            level++;
+        return level;
+    }
+
+    std::shared_ptr<MipChain> MakeChain(Image image, WorkerPool* workers)
+    {
+        std::vector<Image> mips;
+        GenerateMipChain(image, mips, {}, workers);
+        std::shared_ptr<MipChain> chain{ std::make_shared<MipChain>() };
+        chain->Levels.push_back({ image.Width, image.Height, std::move(image.Pixels) });
+        for (Image& mip : mips)
+            chain->Levels.push_back({ mip.Width, mip.Height, std::move(mip.Pixels) });
+        return chain;
+    }
+
+    std::shared_ptr<MipChain> MakeChain(const CompressedImage& image)
+    {
+        std::shared_ptr<MipChain> chain{ std::make_shared<MipChain>() };
+        chain->InternalFormat = image.InternalFormat;
+        for (unsigned int level = 0; level < image.Levels.size(); level++)
+        {
+            const unsigned char* data{ image.GetLevelData(level) };
+            chain->Levels.push_back({ image.Levels[level].Width, image.Levels[level].Height,
+                std::vector<unsigned char>(data, data + image.Levels[level].Size) });
+        }
+        return chain;
+    }
+
+}
+
+TextureResidency::TextureResidency(WorkerPool& workers, unsigned long long budget, unsigned long long frameBudget, unsigned int tailSize)
+    : m_Workers(workers), m_Budget(budget), m_FrameBudget(frameBudget), m_TailSize(std::max(tailSize, 1u)), m_MaxInFlight(8),
+      m_Frame(0), m_Loading(0), m_Pending(0), m_CopyFramebuffers{ 0, 0 }, m_CopyImage(false), m_ResidentBytes(0),
+      m_ReservedBytes(0), m_LastFrameUploadBytes(0), m_LastFrameEvictedBytes(0), m_TotalUploadBytes(0)
+{
+    int major{ 0 }, minor{ 0 };
+    GLCall(glGetIntegerv(GL_MAJOR_VERSION, &major));
+    GLCall(glGetIntegerv(GL_MINOR_VERSION, &minor));
+    m_CopyImage = major > 4 || (major == 4 && minor >= 3);
+}
+
+TextureResidency::~TextureResidency()
+{
+    //the load jobs hold this pointer
+    while (m_Loading.load() != 0)
+        m_Workers.Wait();
+    if (m_CopyFramebuffers[0])
+    {
+        GLCall(glDeleteFramebuffers(2, m_CopyFramebuffers));
+    }
+}
+
+unsigned int TextureResidency::GetTailLevel(const ResidentTexture& texture) const
+{
+    return FindTailLevel(texture.Width, texture.Height, texture.Levels, m_TailSize);
+}
+
+//about one texel per pixel, textures not drawn this frame only need their tail
+unsigned int TextureResidency::GetWantedLevel(const ResidentTexture& texture) const
+{
+    unsigned int tail{ GetTailLevel(texture) };
+    if (texture.LastUsed != m_Frame || texture.ScreenSize <= 0.0f)
+        return tail;
+    float ratio{ std::max(texture.Width, texture.Height) / texture.ScreenSize };
+    if (ratio <= 1.0f)
+        return 0;
+    return std::min((unsigned int)std::floor(std::log2(ratio)), tail);
+}
+
+unsigned long long TextureResidency::GetChainSize(const ResidentTexture& texture, unsigned int first) const
+{
+    unsigned long long size{ 0 };
+    for (unsigned int level = first; level < texture.Levels; level++)
+        size += GetImageSize(texture.InternalFormat, std::max(texture.Width >> level, 1u), std::max(texture.Height >> level, 1u));
+    return size;
+}
+
+void TextureResidency::SortByUse()
+{
+    m_Order.clear();
+    for (ResidentTexture& texture : m_Textures)
+    {
+        if (texture.Gpu)
+            m_Order.push_back(&texture);
+    }
+    std::sort(m_Order.begin(), m_Order.end(), [](const ResidentTexture* a, const ResidentTexture* b) { return a->LastUsed < b->LastUsed; });
+}
+
+ResidentTextureHandle TextureResidency::Load(const std::string& filepath)
+{
+    ResidentTextureHandle handle{ m_Textures.Allocate() };
+    m_Textures.Emplace(handle, { handle, filepath, nullptr, nullptr, 0, 0, 0, 0, s_None, s_None, 0, 0, 0.0f });
+    m_Pending++;
+    m_Loading.fetch_add(1);
+    m_Workers.Submit([this, handle, filepath]() { LoadFile(handle, filepath, s_None); });
+    return handle;
+}
+
+ResidentTextureHandle TextureResidency::Load(Image image)
+{
+    ResidentTextureHandle handle{ m_Textures.Allocate() };
+    m_Textures.Emplace(handle, { handle, std::string(), nullptr, nullptr, 0, 0, 0, 0, s_None, s_None, 0, 0, 0.0f });
+    m_Pending++;
+    m_Loading.fetch_add(1);
+    std::shared_ptr<Image> pending{ std::make_shared<Image>(std::move(image)) };
+    m_Workers.Submit([this, handle, pending]() {
+        std::shared_ptr<MipChain> chain;
+        if (pending->IsValid())
+            chain = MakeChain(std::move(*pending), &m_Workers);
+        unsigned int first{ chain ? FindTailLevel(chain->Levels[0].Width, chain->Levels[0].Height, (unsigned int)chain->Levels.size(), m_TailSize) : 0 };
+        Finish({ handle, first, chain });
+    });
+    return handle;
+}
+
+ResidentTextureHandle TextureResidency::Load(CompressedImage image)
+{
+    ResidentTextureHandle handle{ m_Textures.Allocate() };
+    m_Textures.Emplace(handle, { handle, std::string(), nullptr, nullptr, 0, 0, 0, 0, s_None, s_None, 0, 0, 0.0f });
+    m_Pending++;
+    //nothing to decode, straight to the upload queue
+    std::shared_ptr<MipChain> chain;
+    if (image.IsValid())
+        chain = MakeChain(image);
+    unsigned int first{ chain ? FindTailLevel(image.Width, image.Height, (unsigned int)image.Levels.size(), m_TailSize) : 0 };
+    m_Ready.push_back({ handle, first, chain });
+    return handle;
+}
+
+void TextureResidency::LoadFile(ResidentTextureHandle target, std::string filepath, unsigned int first)
+{
+    std::shared_ptr<MipChain> chain;
+    if (HasExtension(filepath, ".dds") || HasExtension(filepath, ".ktx"))
+    {
+        CompressedImage image;
+        if (LoadCompressedImage(filepath, image))
+            chain = MakeChain(image);
+    }
+    else
+    {
+        Image image;
+        if (DecodeImage(filepath, image))
+            chain = MakeChain(std::move(image), &m_Workers);
+    }
+
+    if (chain)
+    {
+        if (first == s_None)
+            first = FindTailLevel(chain->Levels[0].Width, chain->Levels[0].Height, (unsigned int)chain->Levels.size(), m_TailSize);
+        //only the requested levels travel on
+        for (unsigned int level = 0; level < first && level < chain->Levels.size(); level++)
+            std::vector<unsigned char>().swap(chain->Levels[level].Bytes);
+    }
+    Finish({ target, first, chain });
+}
+
+void TextureResidency::Finish(Loaded loaded)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_LoadedMutex);
+        m_Loaded.push_back(std::move(loaded));
+    }
+    m_Loading.fetch_sub(1);
+}
+
+unsigned long long TextureResidency::ApplyLoaded(unsigned long long limit)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_LoadedMutex);
+        for (Loaded& loaded : m_Loaded)
+            m_Ready.push_back(std::move(loaded));
+        m_Loaded.clear();
+    }
+
+    unsigned long long uploaded{ 0 };
+    size_t taken{ 0 };
+    for (; taken < m_Ready.size(); taken++)
+    {
+        Loaded& loaded{ m_Ready[taken] };
+        ResidentTexture* texture{ m_Textures.Get(loaded.Target) };
+        if (texture && loaded.Chain && !texture->Levels)
+        {
+            //first load, the chain tells what the texture is
+            const MipChain& chain{ *loaded.Chain };
+            texture->InternalFormat = chain.InternalFormat;
+            texture->Width = chain.Levels[0].Width;
+            texture->Height = chain.Levels[0].Height;
+            texture->Levels = (unsigned int)chain.Levels.size();
+            if (texture->Path.empty())
+                texture->Source = loaded.Chain;
+        }
+        unsigned long long size{ texture && loaded.Chain ? GetChainSize(*texture, loaded.First) : 0 };
+        if (limit && uploaded && uploaded + size > limit)
+            break;
+
+        m_Pending--;
+        if (!texture)
+            continue;   //released meanwhile
+        m_ReservedBytes -= texture->Reserved;
+        texture->Reserved = 0;
+        texture->RequestedLevel = s_None;
+        if (!loaded.Chain || (texture->Gpu && loaded.First >= texture->ResidentLevel))
+            continue;
+
+        //other textures may have grown since the request, tails always go in
+        unsigned long long current{ texture->Gpu ? texture->Gpu->GetMemorySize() : 0 };
+        unsigned long long total{ m_ResidentBytes + m_ReservedBytes - current + size };
+        if (texture->Gpu && total > m_Budget && Evict(total - m_Budget, texture) < total - m_Budget)
+            continue;
+
+        const MipChain& chain{ *loaded.Chain };
+        unsigned int first{ loaded.First };
+        std::unique_ptr<Texture> gpu{ std::make_unique<Texture>(chain.Levels[first].Width, chain.Levels[first].Height,
+            texture->Levels - first, texture->InternalFormat) };
+        for (unsigned int level = first; level < texture->Levels; level++)
+        {
+            const MipChain::Level& data{ chain.Levels[level] };
+            if (IsBlockCompressed(texture->InternalFormat))
+                gpu->SetCompressedData(level - first, 0, 0, data.Width, data.Height, data.Bytes.data(), (unsigned int)data.Bytes.size());
+            else
+                gpu->SetData(level - first, 0, 0, data.Width, data.Height, data.Bytes.data());
+        }
+        m_ResidentBytes += gpu->GetMemorySize() - current;
+        texture->Gpu = std::move(gpu);
+        texture->ResidentLevel = first;
+        uploaded += size;
+    }
+    m_Ready.erase(m_Ready.begin(), m_Ready.begin() + taken);
+    return uploaded;
+}
+
+unsigned long long TextureResidency::Evict(unsigned long long bytes, const ResidentTexture* keep)
+{
+    unsigned long long freed{ 0 };
+    for (ResidentTexture* texture : m_Order)
+    {
+        if (freed >= bytes)
+            break;
+        unsigned int limit{ GetWantedLevel(*texture) };
+        if (texture == keep || !texture->Gpu || limit <= texture->ResidentLevel)
+            continue;
+
+        //one level at a time until enough is freed, in a single reallocation
+        unsigned long long current{ texture->Gpu->GetMemorySize() };
+        unsigned int first{ texture->ResidentLevel };
+        while (first < limit && current - GetChainSize(*texture, first) < bytes - freed)
+            first++;
+        Shrink(*texture, first);
+        freed += current - texture->Gpu->GetMemorySize();
+    }
+    return freed;
+}
+
+void TextureResidency::Shrink(ResidentTexture& texture, unsigned int first)
+{
+    const Texture& previous{ *texture.Gpu };
+    std::unique_ptr<Texture> gpu{ std::make_unique<Texture>(std::max(texture.Width >> first, 1u), std::max(texture.Height >> first, 1u),
+        texture.Levels - first, texture.InternalFormat) };
+    for (unsigned int level = first; level < texture.Levels; level++)
+        CopyLevel(previous, level - texture.ResidentLevel, *gpu, level - first);
+
+    unsigned long long freed{ previous.GetMemorySize() - gpu->GetMemorySize() };
+    m_ResidentBytes -= freed;
+    m_LastFrameEvictedBytes += freed;
+    s_EvictedBytes.Add(freed);
+    texture.Gpu = std::move(gpu);
+    texture.ResidentLevel = first;
+}
+
+//glCopyImageSubData where there is GL 4.3, a framebuffer blit otherwise. GL 3.3 cannot blit
+//compressed formats, those take a round trip through client memory
+void TextureResidency::CopyLevel(const Texture& source, unsigned int sourceLevel, const Texture& destination, unsigned int destinationLevel)
+{
+    unsigned int width{ std::max(source.GetWidth() >> sourceLevel, 1u) };
+    unsigned int height{ std::max(source.GetHeight() >> sourceLevel, 1u) };
+    if (m_CopyImage)
+    {
+        GLCall(glCopyImageSubData(source.GetRendererID(), GL_TEXTURE_2D, sourceLevel, 0, 0, 0,
+            destination.GetRendererID(), GL_TEXTURE_2D, destinationLevel, 0, 0, 0, width, height, 1));
+    }
+    else if (!IsBlockCompressed(source.GetInternalFormat()))
+    {
+        int readFramebuffer{ 0 }, drawFramebuffer{ 0 };
+        GLCall(glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFramebuffer));
+        GLCall(glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &drawFramebuffer));
+        if (!m_CopyFramebuffers[0])
+        {
+            GLCall(glGenFramebuffers(2, m_CopyFramebuffers));
+        }
+        GLCall(glBindFramebuffer(GL_READ_FRAMEBUFFER, m_CopyFramebuffers[0]));
+        GLCall(glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, source.GetRendererID(), sourceLevel));
+        GLCall(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_CopyFramebuffers[1]));
+        GLCall(glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, destination.GetRendererID(), destinationLevel));
+        GLCall(glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST));
+        GLCall(glBindFramebuffer(GL_READ_FRAMEBUFFER, readFramebuffer));
+        GLCall(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, drawFramebuffer));
+    }
+    else
+    {
+        std::vector<unsigned char> blocks(GetImageSize(source.GetInternalFormat(), width, height));
+        source.Bind();
+        GLCall(glGetCompressedTexImage(GL_TEXTURE_2D, sourceLevel, blocks.data()));
+        const_cast<Texture&>(destination).SetCompressedData(destinationLevel, 0, 0, width, height, blocks.data(), (unsigned int)blocks.size());
+    }
+}
+
+void TextureResidency::Request(ResidentTexture& texture, unsigned int first)
+{
+    texture.Reserved = GetChainSize(texture, first) - texture.Gpu->GetMemorySize();
+    texture.RequestedLevel = first;
+    m_ReservedBytes += texture.Reserved;
+    m_Pending++;
+    if (texture.Source)
+    {
+        m_Ready.push_back({ texture.Self, first, texture.Source });
+        return;
+    }
+    m_Loading.fetch_add(1);
+    m_Workers.Submit([this, target = texture.Self, filepath = texture.Path, first]() { LoadFile(target, filepath, first); });
+}
+
+void TextureResidency::Rebalance()
+{
+    if (m_ResidentBytes + m_ReservedBytes > m_Budget)
+        Evict(m_ResidentBytes + m_ReservedBytes - m_Budget, nullptr);
+
+    //largest on screen first, each gets the finest level that still fits the budget
+    m_Wanted.clear();
+    for (ResidentTexture* texture : m_Order)
+    {
+        if (texture->RequestedLevel == s_None && GetWantedLevel(*texture) < texture->ResidentLevel)
+            m_Wanted.push_back(texture);
+    }
+    std::sort(m_Wanted.begin(), m_Wanted.end(), [](const ResidentTexture* a, const ResidentTexture* b) { return a->ScreenSize > b->ScreenSize; });
+    for (ResidentTexture* texture : m_Wanted)
+    {
+        if (m_Pending >= m_MaxInFlight)
+            break;
+        unsigned long long current{ texture->Gpu->GetMemorySize() };
+        unsigned int first{ GetWantedLevel(*texture) };
+        unsigned long long needed{ m_ResidentBytes + m_ReservedBytes + GetChainSize(*texture, first) - current };
+        if (needed > m_Budget)
+            Evict(needed - m_Budget, texture);
+        while (first < texture->ResidentLevel && m_ResidentBytes + m_ReservedBytes + GetChainSize(*texture, first) - current > m_Budget)
+            first++;
+        if (first < texture->ResidentLevel)
+            Request(*texture, first);
+    }
+}
+
+void TextureResidency::Touch(ResidentTextureHandle handle, float screenSize)
+{
+    ResidentTexture* texture{ m_Textures.Get(handle) };
+    if (!texture)
+        return;
+    if (texture->LastUsed != m_Frame)
+        texture->ScreenSize = screenSize;
+    else
+        texture->ScreenSize = std::max(texture->ScreenSize, screenSize);
+    texture->LastUsed = m_Frame;
+}
+
+void TextureResidency::Update()
+{
+    m_LastFrameEvictedBytes = 0;
+    SortByUse();
+    m_LastFrameUploadBytes = ApplyLoaded(m_FrameBudget);
+    m_TotalUploadBytes += m_LastFrameUploadBytes;
+    s_UploadBytes.Add(m_LastFrameUploadBytes);
+    SortByUse();
+    Rebalance();
+    s_PendingRequests.Add(m_Pending);
+    m_Frame++;
+}
+
+void TextureResidency::Flush()
+{
+    //a round that uploads nothing twice in a row means the rest does not fit the budget
+    unsigned int idleRounds{ 0 };
+    while (m_Pending && idleRounds < 2)
+    {
+        while (m_Loading.load() != 0)
+            m_Workers.Wait();
+        SortByUse();
+        unsigned long long uploaded{ ApplyLoaded(0) };
+        m_TotalUploadBytes += uploaded;
+        s_UploadBytes.Add(uploaded);
+        SortByUse();
+        Rebalance();
+        idleRounds = uploaded ? 0 : idleRounds + 1;
+    }
+}
+
+Texture* TextureResidency::Get(ResidentTextureHandle handle)
+{
+    ResidentTexture* texture{ m_Textures.Get(handle) };
+    return texture ? texture->Gpu.get() : nullptr;
+}
+
+unsigned int TextureResidency::GetResidentLevel(ResidentTextureHandle handle)
+{
+    ResidentTexture* texture{ m_Textures.Get(handle) };
+    return texture && texture->Gpu ? texture->ResidentLevel : s_None;
+}
+
+void TextureResidency::Release(ResidentTextureHandle handle)
+{
+    ResidentTexture* texture{ m_Textures.Get(handle) };
+    if (!texture)
+        return;
+    //loads still on their way find the handle dead and are dropped
+    if (texture->Gpu)
+        m_ResidentBytes -= texture->Gpu->GetMemorySize();
+    m_ReservedBytes -= texture->Reserved;
+    m_Textures.Remove(handle);
+}
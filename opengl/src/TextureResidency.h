@@ -0,0 +1,152 @@
+#pragma once
+
+#include "CompressedImage.h"
+#include "Image.h"
+#include "ResourcePool.h"
+#include "Texture.h"
+#include "WorkerPool.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+//a texture's levels in system memory, level 0 first. Bytes are RGBA8 pixels or compressed
+//blocks in InternalFormat, levels nobody asked for are left empty
+struct MipChain
+{
+	struct Level
+	{
+		unsigned int Width;
+		unsigned int Height;
+		std::vector<unsigned char> Bytes;
+	};
+
+	unsigned int InternalFormat { GL_RGBA8 };
+	std::vector<Level> Levels;
+};
+
+struct ResidentTexture;
+using ResidentTextureHandle = Handle<ResidentTexture>;
+
+struct ResidentTexture
+{
+	ResidentTextureHandle Self;
+	std::string Path;                           //reloaded for every residency change, empty for memory sources
+	std::shared_ptr<const MipChain> Source;     //the whole chain of a memory source
+	std::unique_ptr<Texture> Gpu;               //levels ResidentLevel.. of the chain, nullptr until the tail is in
+	unsigned int InternalFormat;
+	unsigned int Width, Height, Levels;         //of the full chain, 0 until the first load finished
+	unsigned int ResidentLevel;                 //finest level on the GPU
+	unsigned int RequestedLevel;                //of the load in flight
+	unsigned long long Reserved;                //budget held for the load in flight
+	unsigned long long LastUsed;                //frame of the last Touch()
+	float ScreenSize;                           //largest footprint touched in that frame
+};
+
+//keeps every registered texture partly resident: the tail of the mip chain (levels no larger
+//than tailSize) is loaded first, finer levels follow once Touch() reports a footprint that
+//needs them, and when the GPU budget runs out the least recently used textures lose their
+//finest levels again. a residency change allocates a texture of the new size, new levels are
+//uploaded from the source, kept ones are copied on the GPU. files are decoded again on the
+//WorkerPool for every step up, so keep large assets in DDS/KTX with their mips baked in.
+//all calls belong to the GL thread
+class TextureResidency
+{
+private:
+	struct Loaded
+	{
+		ResidentTextureHandle Target;
+		unsigned int First;
+		std::shared_ptr<const MipChain> Chain;
+	};
+
+	WorkerPool& m_Workers;
+	ResourcePool<ResidentTexture> m_Textures;
+	unsigned long long m_Budget;
+	unsigned long long m_FrameBudget;
+	unsigned int m_TailSize;
+	unsigned int m_MaxInFlight;
+	unsigned long long m_Frame;
+
+	std::mutex m_LoadedMutex;
+	std::vector<Loaded> m_Loaded;               //filled by the workers
+	std::vector<Loaded> m_Ready;                //waiting for upload bandwidth
+	std::atomic<unsigned int> m_Loading;       //on the workers
+	unsigned int m_Pending;                     //requested and not uploaded yet
+	std::vector<ResidentTexture*> m_Order;      //least recently used first, rebuilt every Update()
+	std::vector<ResidentTexture*> m_Wanted;     //footprint asks for finer levels than resident
+
+	unsigned int m_CopyFramebuffers[2];
+	bool m_CopyImage;                           //glCopyImageSubData, GL 4.3
+
+	unsigned long long m_ResidentBytes;
+	unsigned long long m_ReservedBytes;
+	unsigned long long m_LastFrameUploadBytes;
+	unsigned long long m_LastFrameEvictedBytes;
+	unsigned long long m_TotalUploadBytes;
+
+	unsigned int GetTailLevel(const ResidentTexture& texture) const;
+	unsigned int GetWantedLevel(const ResidentTexture& texture) const;
+	unsigned long long GetChainSize(const ResidentTexture& texture, unsigned int first) const;
+	void SortByUse();
+	//worker side
+	void LoadFile(ResidentTextureHandle target, std::string filepath, unsigned int first);
+	void Finish(Loaded loaded);
+
+	//uploads ready loads until limit bytes (0 == no limit) went to the GPU
+	unsigned long long ApplyLoaded(unsigned long long limit);
+	void Rebalance();
+	//drops levels of textures in least recently used order, never below what their current
+	//footprint wants, until bytes are freed. returns what was freed
+	unsigned long long Evict(unsigned long long bytes, const ResidentTexture* keep);
+	//reallocates with levels first.. and moves the kept ones over on the GPU
+	void Shrink(ResidentTexture& texture, unsigned int first);
+	void CopyLevel(const Texture& source, unsigned int sourceLevel, const Texture& destination, unsigned int destinationLevel);
+	void Request(ResidentTexture& texture, unsigned int first);
+public:
+	static constexpr unsigned int s_None{ 0xffffffffu };
+
+	//budget is for the textures this manager owns, frameBudget limits the upload bytes per Update()
+	//(0 == unlimited). tails ignore the budget, every texture keeps at least those
+	TextureResidency(WorkerPool& workers, unsigned long long budget, unsigned long long frameBudget = 8 * 1024 * 1024,
+		unsigned int tailSize = 64);
+	//waits for outstanding loads, the context must still be current
+	~TextureResidency();
+
+	TextureResidency(const TextureResidency&) = delete;
+	TextureResidency& operator=(const TextureResidency&) = delete;
+
+	//.dds and .ktx as they are, anything else through DecodeImage and a CPU mip chain
+	ResidentTextureHandle Load(const std::string& filepath);
+	//memory sources stay in system memory as the backing store, the chain is built on a worker
+	ResidentTextureHandle Load(Image image);
+	ResidentTextureHandle Load(CompressedImage image);
+	void Release(ResidentTextureHandle handle);
+
+	//the texture is drawn this frame with its longest side covering screenSize pixels
+	void Touch(ResidentTextureHandle handle, float screenSize);
+
+	//once per frame after the draws: uploads finished loads within the frame budget, trims
+	//least recently used textures while over the budget and requests the levels footprints want
+	void Update();
+	//blocks until every load that fits the budget is resident
+	void Flush();
+
+	//nullptr until the tail is resident. good until the next Update()
+	Texture* Get(ResidentTextureHandle handle);
+	//level of the full chain that the texture's level 0 is, s_None while not resident
+	unsigned int GetResidentLevel(ResidentTextureHandle handle);
+
+	inline void SetBudget(unsigned long long bytes) { m_Budget = bytes; }
+	inline void SetFrameBudget(unsigned long long bytes) { m_FrameBudget = bytes; }
+	inline unsigned long long GetBudget() const { return m_Budget; }
+	inline unsigned long long GetResidentBytes() const { return m_ResidentBytes; }
+	inline unsigned long long GetLastFrameUploadBytes() const { return m_LastFrameUploadBytes; }
+	inline unsigned long long GetLastFrameEvictedBytes() const { return m_LastFrameEvictedBytes; }
+	inline unsigned long long GetTotalUploadBytes() const { return m_TotalUploadBytes; }
+	//loads being decoded or waiting for upload bandwidth
+	inline unsigned int GetPendingRequests() const { return m_Pending; }
+	inline unsigned int GetTextureCount() const { return (unsigned int)m_Textures.Size(); }
+};
@@ -0,0 +1,242 @@
+#include "TextureStreamer.h"
+#include "GpuMemory.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+static const ProfilerCounter s_UploadBytes("Texture upload bytes");
+static const ProfilerCounter s_UploadStalls("Texture upload stalls");
+
+TextureStreamer::TextureStreamer(WorkerPool& workers, unsigned long long frameBudget, unsigned int stagingSize, unsigned int stagingBuffers)
+    : m_Workers(workers), m_StagingSize(stagingSize), m_NextStaging(0), m_Decoding(0),
+      m_FrameBudget(frameBudget), m_LastFrameUploadBytes(0), m_CpuMipmaps(false)
+{
+    m_Staging.resize(std::max(stagingBuffers, 1u));
+    for (Staging& staging : m_Staging)
+    {
+        GLCall(glGenBuffers(1, &staging.Buffer));
+        GLCall(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging.Buffer));
+        GLCall(glBufferData(GL_PIXEL_UNPACK_BUFFER, stagingSize, nullptr, GL_STREAM_DRAW));
+        GpuMemory::Get().Track(GpuMemoryCategory::Other, staging.Buffer, stagingSize);
+        staging.Fence = nullptr;
+    }
+    GLCall(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    //the decode jobs hold this pointer
+    while (m_Decoding.load() != 0)
+        m_Workers.Wait();
+
+    for (Staging& staging : m_Staging)
+    {
+        if (staging.Fence)
+        {
+            GLCall(glDeleteSync(staging.Fence));
+        }
+        GpuMemory::Get().Untrack(GpuMemoryCategory::Other, staging.Buffer);
+        GLCall(glDeleteBuffers(1, &staging.Buffer));
+    }
+}
+
+TextureHandle TextureStreamer::Load(const std::string& filepath, bool mipmaps)
+{
+    TextureHandle handle{ m_Textures.Allocate() };
+    m_Decoding.fetch_add(1);
+    m_Workers.Submit([this, handle, filepath, mipmaps, cpuMipmaps = m_CpuMipmaps, options = m_MipOptions]() {
+        Upload upload{ handle, Image(), 0, mipmaps, {}, 0 };
+        DecodeImage(filepath, upload.Pixels);
+        FinishDecode(std::move(upload), cpuMipmaps, options);
+    });
+    return handle;
+}
+
+TextureHandle TextureStreamer::Load(Image image, bool mipmaps)
+{
+    TextureHandle handle{ m_Textures.Allocate() };
+    Load(handle, std::move(image), mipmaps);
+    return handle;
+}
+
+void TextureStreamer::Load(TextureHandle handle, Image image, bool mipmaps)
+{
+    Upload upload{ handle, std::move(image), 0, mipmaps, {}, 0 };
+    if (mipmaps && m_CpuMipmaps)
+    {
+        //nothing to decode, but the chain is still built off the GL thread
+        m_Decoding.fetch_add(1);
+        std::shared_ptr<Upload> pending{ std::make_shared<Upload>(std::move(upload)) };
+        m_Workers.Submit([this, pending, options = m_MipOptions]() {
+            FinishDecode(std::move(*pending), true, options);
+        });
+        return;
+    }
+    if (BeginUpload(upload))
+        m_Uploads.push_back(std::move(upload));
+}
+
+void TextureStreamer::FinishDecode(Upload upload, bool cpuMipmaps, const MipOptions& options)
+{
+    if (upload.Mipmaps && cpuMipmaps)
+        GenerateMipChain(upload.Pixels, upload.Mips, options, &m_Workers);
+    {
+        std::lock_guard<std::mutex> lock(m_DecodedMutex);
+        m_Decoded.push_back(std::move(upload));
+    }
+    m_Decoding.fetch_sub(1);
+}
+
+void TextureStreamer::TakeDecoded()
+{
+    std::vector<Upload> decoded;
+    {
+        std::lock_guard<std::mutex> lock(m_DecodedMutex);
+        decoded.swap(m_Decoded);
+    }
+    for (Upload& upload : decoded)
+    {
+        if (BeginUpload(upload))
+            m_Uploads.push_back(std::move(upload));
+    }
+}
+
+//allocates the storage, the pixels follow row by row
+bool TextureStreamer::BeginUpload(Upload& upload)
+{
+    if (!m_Textures.IsAlive(upload.Target))
+        return false;   //released while decoding
+    if (!upload.Pixels.IsValid())
+    {
+        m_Textures.Remove(upload.Target);
+        return false;
+    }
+    const Image& image{ upload.Pixels };
+    m_Textures.Emplace(upload.Target, Texture(image.Width, image.Height, upload.Mipmaps ? 0 : 1));
+    return true;
+}
+
+bool TextureStreamer::UploadRows(Upload& upload, unsigned long long maxBytes, bool wait, unsigned long long& uploaded)
+{
+    Texture* texture{ m_Textures.Get(upload.Target) };
+    const Image& image{ upload.GetLevel() };
+    size_t rowSize{ image.GetRowSize() };
+    unsigned int rows{ (unsigned int)std::min<unsigned long long>(image.Height - upload.NextRow,
+        std::max<unsigned long long>(std::min<unsigned long long>(m_StagingSize, maxBytes) / rowSize, 1)) };
+
+    if (rowSize > m_StagingSize)
+    {
+        //a single row does not fit a staging buffer, upload it straight from the image
+        texture->SetData(upload.Level, 0, upload.NextRow, image.Width, 1, image.Pixels.data() + upload.NextRow * rowSize);
+        upload.NextRow++;
+        uploaded += rowSize;
+        return true;
+    }
+
+    Staging& staging{ m_Staging[m_NextStaging] };
+    if (staging.Fence)
+    {
+        GLenum status{ glClientWaitSync(staging.Fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? 1000000000ull : 0) };
+        if (status == GL_TIMEOUT_EXPIRED)
+        {
+            s_UploadStalls.Increment();
+            return false;
+        }
+        GLCall(glDeleteSync(staging.Fence));
+        staging.Fence = nullptr;
+    }
+
+    //the fence has passed, so nothing reads this buffer any more and the map can skip syncing
+    size_t bytes{ rows * rowSize };
+    GLCall(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging.Buffer));
+    GLCall(void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+    std::memcpy(mapped, image.Pixels.data() + upload.NextRow * rowSize, bytes);
+    GLCall(glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER));
+    texture->SetData(upload.Level, 0, upload.NextRow, image.Width, rows, nullptr);
+    GLCall(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+    GLCall(staging.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+
+    m_NextStaging = (m_NextStaging + 1) % (unsigned int)m_Staging.size();
+    upload.NextRow += rows;
+    uploaded += bytes;
+    return true;
+}
+
+unsigned long long TextureStreamer::Pump(unsigned long long budget, bool wait)
+{
+    TakeDecoded();
+
+    unsigned long long uploaded{ 0 };
+    while (!m_Uploads.empty() && (budget == 0 || uploaded < budget))
+    {
+        Upload& upload{ m_Uploads.front() };
+        if (!m_Textures.IsAlive(upload.Target))
+        {
+            m_Uploads.pop_front();
+            continue;
+        }
+
+        unsigned long long maxBytes{ budget ? budget - uploaded : m_StagingSize };
+        if (!UploadRows(upload, maxBytes, wait, uploaded))
+            break;
+
+        if (upload.NextRow == upload.GetLevel().Height && upload.Level < upload.Mips.size())
+        {
+            upload.Level++;
+            upload.NextRow = 0;
+        }
+        else if (upload.NextRow == upload.GetLevel().Height)
+        {
+            if (upload.Mips.empty())
+                m_Textures.Get(upload.Target)->GenerateMipmaps();
+            if (m_ReadyGeneration.size() <= upload.Target.Index)
+                m_ReadyGeneration.resize(upload.Target.Index + 1, 0);
+            m_ReadyGeneration[upload.Target.Index] = upload.Target.Generation;
+            m_Uploads.pop_front();
+        }
+    }
+    s_UploadBytes.Add(uploaded);
+    return uploaded;
+}
+
+void TextureStreamer::Update()
+{
+    m_LastFrameUploadBytes = Pump(m_FrameBudget, false);
+}
+
+void TextureStreamer::Flush()
+{
+    m_Workers.Wait();
+    while (m_Decoding.load() != 0 || !m_Uploads.empty() || GetPendingCount())
+    {
+        m_Workers.Wait();
+        Pump(0, true);
+    }
+}
+
+Texture* TextureStreamer::Get(TextureHandle handle)
+{
+    return IsReady(handle) ? m_Textures.Get(handle) : nullptr;
+}
+
+bool TextureStreamer::IsReady(TextureHandle handle) const
+{
+    return m_Textures.IsAlive(handle) && handle.Index < m_ReadyGeneration.size()
+        && m_ReadyGeneration[handle.Index] == handle.Generation;
+}
+
+void TextureStreamer::Release(TextureHandle handle)
+{
+    //rows already queued on the GPU keep the texture alive on the driver side
+    m_Textures.Remove(handle);
+}
+
+size_t TextureStreamer::GetPendingCount()
+{
+    std::lock_guard<std::mutex> lock(m_DecodedMutex);
+    return m_Uploads.size() + m_Decoded.size() + m_Decoding.load();
+}
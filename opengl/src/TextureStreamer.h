@@ -0,0 +1,103 @@
+#pragma once
+
+#include "Image.h"
+#include "MipGenerator.h"
+#include "ResourcePool.h"
+#include "Texture.h"
+#include "WorkerPool.h"
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using TextureHandle = Handle<Texture>;
+
+//loads textures without hitching the frame: files decode on the WorkerPool, pixels go to the
+//GPU through a ring of pixel buffer objects so glTexSubImage2D never waits on client memory,
+//and Update() stops once the frame's upload budget is spent. mip chains come from
+//glGenerateMipmap, or with SetCpuMipmaps() from MipGenerator on the workers and are streamed
+//like the base level. everything except the decode jobs runs on the GL thread
+class TextureStreamer
+{
+private:
+	struct Staging
+	{
+		unsigned int Buffer;
+		GLsync Fence;                   //signalled once the GPU has consumed the last upload
+	};
+	struct Upload
+	{
+		TextureHandle Target;
+		Image Pixels;
+		unsigned int NextRow;
+		bool Mipmaps;
+		std::vector<Image> Mips;        //levels 1.. when built on the CPU
+		unsigned int Level;             //being uploaded, 0 == Pixels
+
+		inline const Image& GetLevel() const { return Level ? Mips[Level - 1] : Pixels; }
+	};
+
+	WorkerPool& m_Workers;
+	ResourcePool<Texture> m_Textures;
+	std::vector<unsigned int> m_ReadyGeneration;    //per slot, == handle generation once uploaded
+	std::vector<Staging> m_Staging;
+	unsigned int m_StagingSize;
+	unsigned int m_NextStaging;
+	std::deque<Upload> m_Uploads;
+
+	std::mutex m_DecodedMutex;
+	std::vector<Upload> m_Decoded;                  //filled by the workers
+	std::atomic<unsigned int> m_Decoding;
+
+	unsigned long long m_FrameBudget;
+	unsigned long long m_LastFrameUploadBytes;
+	bool m_CpuMipmaps;
+	MipOptions m_MipOptions;
+
+	//worker side: builds the CPU mip chain when asked to and hands the upload to the GL thread
+	void FinishDecode(Upload upload, bool cpuMipmaps, const MipOptions& options);
+	void TakeDecoded();
+	bool BeginUpload(Upload& upload);
+	//returns false when the next staging buffer is still in use by the GPU
+	bool UploadRows(Upload& upload, unsigned long long maxBytes, bool wait, unsigned long long& uploaded);
+	unsigned long long Pump(unsigned long long budget, bool wait);
+public:
+	//frameBudget 0 == unlimited. stagingSize is the size of one PBO, a row never spans two
+	TextureStreamer(WorkerPool& workers, unsigned long long frameBudget = 8 * 1024 * 1024,
+		unsigned int stagingSize = 4 * 1024 * 1024, unsigned int stagingBuffers = 3);
+	//waits for outstanding decode jobs, the context must still be current
+	~TextureStreamer();
+
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+	//returns immediately, the file is decoded on a worker and uploaded by later Update() calls
+	TextureHandle Load(const std::string& filepath, bool mipmaps = true);
+	//already decoded pixels, only the upload is streamed
+	TextureHandle Load(Image image, bool mipmaps = true);
+	//a handle now, the pixels later through Load(handle, image) (or Release() when they never
+	//come). for loaders that decode on their own
+	inline TextureHandle Reserve() { return m_Textures.Allocate(); }
+	void Load(TextureHandle handle, Image image, bool mipmaps = true);
+
+	//once per frame: starts uploads for finished decodes and streams rows until the budget is spent
+	void Update();
+	//blocks until every queued load is decoded and uploaded (loading screens, shutdown)
+	void Flush();
+
+	//nullptr until every row is uploaded (or when the load failed / the handle was released)
+	Texture* Get(TextureHandle handle);
+	bool IsReady(TextureHandle handle) const;
+	//false once released, or when the file could not be decoded
+	inline bool IsAlive(TextureHandle handle) const { return m_Textures.IsAlive(handle); }
+	void Release(TextureHandle handle);
+
+	inline void SetFrameBudget(unsigned long long bytes) { m_FrameBudget = bytes; }
+	//applies to loads started afterwards
+	inline void SetCpuMipmaps(bool enabled, const MipOptions& options = {}) { m_CpuMipmaps = enabled; m_MipOptions = options; }
+	inline unsigned long long GetLastFrameUploadBytes() const { return m_LastFrameUploadBytes; }
+	//loads not uploaded yet, decoding or waiting for budget
+	size_t GetPendingCount();
+};
@@ -0,0 +1,517 @@
+#include "VectorMath.h"
+
+#include <algorithm>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace {
+
+#ifdef VECTOR_MATH_SSE2
+    //four xyz points (v0 = x0 y0 z0 x1, v1 = y1 z1 x2 y2, v2 = z2 x3 y3 z3) into x, y and z lanes
+    inline void Deinterleave(__m128 v0, __m128 v1, __m128 v2, __m128& x, __m128& y, __m128& z)
+    {
+        __m128 xTail{ _mm_shuffle_ps(v1, v2, _MM_SHUFFLE(1, 1, 2, 2)) };
+        x = _mm_shuffle_ps(v0, xTail, _MM_SHUFFLE(2, 0, 3, 0));
+        __m128 yHead{ _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(0, 0, 1, 1)) };
+        __m128 yTail{ _mm_shuffle_ps(v1, v2, _MM_SHUFFLE(2, 2, 3, 3)) };
+        y = _mm_shuffle_ps(yHead, yTail, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 zHead{ _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(1, 1, 2, 2)) };
+        z = _mm_shuffle_ps(zHead, v2, _MM_SHUFFLE(3, 0, 2, 0));
+    }
+
+    inline void Interleave(__m128 x, __m128 y, __m128 z, __m128& v0, __m128& v1, __m128& v2)
+    {
+        v0 = _mm_shuffle_ps(_mm_shuffle_ps(x, y, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_ps(z, x, _MM_SHUFFLE(1, 1, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+        v1 = _mm_shuffle_ps(_mm_shuffle_ps(y, z, _MM_SHUFFLE(1, 1, 1, 1)), _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 2, 2, 2)), _MM_SHUFFLE(2, 0, 2, 0));
+        v2 = _mm_shuffle_ps(_mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 3, 2, 2)), _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+    }
+
+    inline __m128 MulAdd(__m128 a, __m128 b, __m128 c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+
+    //the matrix as 16 broadcast lanes, Rows[r][c] == m.Columns[c] component r
+    struct Broadcast4
+    {
+        __m128 Rows[4][4];
+
+        explicit Broadcast4(const Mat4& m)
+        {
+            for (unsigned int c = 0; c < 4; c++)
+            {
+                const float* column{ &m.Columns[c].X };
+                for (unsigned int r = 0; r < 4; r++)
+                    Rows[r][c] = _mm_set1_ps(column[r]);
+            }
+        }
+
+        //row r of m * (x, y, z, 1)
+        inline __m128 Row(unsigned int r, __m128 x, __m128 y, __m128 z) const
+        {
+            return MulAdd(Rows[r][0], x, MulAdd(Rows[r][1], y, MulAdd(Rows[r][2], z, Rows[r][3])));
+        }
+    };
+
+    inline void MultiplyColumns(__m128 a0, __m128 a1, __m128 a2, __m128 a3, const Mat4& b, Mat4& out)
+    {
+        __m128 columns[4];
+        for (unsigned int i = 0; i < 4; i++)
+        {
+            __m128 column{ _mm_load_ps(&b.Columns[i].X) };
+            __m128 sum{ _mm_mul_ps(a0, _mm_shuffle_ps(column, column, _MM_SHUFFLE(0, 0, 0, 0))) };
+            sum = MulAdd(a1, _mm_shuffle_ps(column, column, _MM_SHUFFLE(1, 1, 1, 1)), sum);
+            sum = MulAdd(a2, _mm_shuffle_ps(column, column, _MM_SHUFFLE(2, 2, 2, 2)), sum);
+            columns[i] = MulAdd(a3, _mm_shuffle_ps(column, column, _MM_SHUFFLE(3, 3, 3, 3)), sum);
+        }
+        //all read before the first store, out may be b
+        for (unsigned int i = 0; i < 4; i++)
+            _mm_store_ps(&out.Columns[i].X, columns[i]);
+    }
+#endif
+
+#ifdef __AVX2__
+    //the same per 128 bit lane: the low lane holds items i..i+3, the high lane i+4..i+7
+    inline __m256 Load2(const float* low, const float* high)
+    {
+        return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(low)), _mm_loadu_ps(high), 1);
+    }
+
+    inline void Store2(float* low, float* high, __m256 v)
+    {
+        _mm_storeu_ps(low, _mm256_castps256_ps128(v));
+        _mm_storeu_ps(high, _mm256_extractf128_ps(v, 1));
+    }
+
+    inline void Deinterleave(__m256 v0, __m256 v1, __m256 v2, __m256& x, __m256& y, __m256& z)
+    {
+        __m256 xTail{ _mm256_shuffle_ps(v1, v2, _MM_SHUFFLE(1, 1, 2, 2)) };
+        x = _mm256_shuffle_ps(v0, xTail, _MM_SHUFFLE(2, 0, 3, 0));
+        __m256 yHead{ _mm256_shuffle_ps(v0, v1, _MM_SHUFFLE(0, 0, 1, 1)) };
+        __m256 yTail{ _mm256_shuffle_ps(v1, v2, _MM_SHUFFLE(2, 2, 3, 3)) };
+        y = _mm256_shuffle_ps(yHead, yTail, _MM_SHUFFLE(2, 0, 2, 0));
+        __m256 zHead{ _mm256_shuffle_ps(v0, v1, _MM_SHUFFLE(1, 1, 2, 2)) };
+        z = _mm256_shuffle_ps(zHead, v2, _MM_SHUFFLE(3, 0, 2, 0));
+    }
+
+    inline void Interleave(__m256 x, __m256 y, __m256 z, __m256& v0, __m256& v1, __m256& v2)
+    {
+        v0 = _mm256_shuffle_ps(_mm256_shuffle_ps(x, y, _MM_SHUFFLE(0, 0, 0, 0)), _mm256_shuffle_ps(z, x, _MM_SHUFFLE(1, 1, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+        v1 = _mm256_shuffle_ps(_mm256_shuffle_ps(y, z, _MM_SHUFFLE(1, 1, 1, 1)), _mm256_shuffle_ps(x, y, _MM_SHUFFLE(2, 2, 2, 2)), _MM_SHUFFLE(2, 0, 2, 0));
+        v2 = _mm256_shuffle_ps(_mm256_shuffle_ps(z, x, _MM_SHUFFLE(3, 3, 2, 2)), _mm256_shuffle_ps(y, z, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+    }
+
+    //4x4 transpose within each lane
+    inline void Transpose(__m256& r0, __m256& r1, __m256& r2, __m256& r3)
+    {
+        __m256 t0{ _mm256_unpacklo_ps(r0, r1) }, t1{ _mm256_unpacklo_ps(r2, r3) };
+        __m256 t2{ _mm256_unpackhi_ps(r0, r1) }, t3{ _mm256_unpackhi_ps(r2, r3) };
+        r0 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+        r1 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+        r2 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+        r3 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+    }
+
+#ifdef __FMA__
+    inline __m256 MulAdd(__m256 a, __m256 b, __m256 c) { return _mm256_fmadd_ps(a, b, c); }
+#else
+    inline __m256 MulAdd(__m256 a, __m256 b, __m256 c) { return _mm256_add_ps(_mm256_mul_ps(a, b), c); }
+#endif
+
+    struct Broadcast8
+    {
+        __m256 Rows[4][4];
+
+        explicit Broadcast8(const Mat4& m)
+        {
+            for (unsigned int c = 0; c < 4; c++)
+            {
+                const float* column{ &m.Columns[c].X };
+                for (unsigned int r = 0; r < 4; r++)
+                    Rows[r][c] = _mm256_set1_ps(column[r]);
+            }
+        }
+
+        inline __m256 Row(unsigned int r, __m256 x, __m256 y, __m256 z) const
+        {
+            return MulAdd(Rows[r][0], x, MulAdd(Rows[r][1], y, MulAdd(Rows[r][2], z, Rows[r][3])));
+        }
+    };
+
+    //two result columns per register: a's columns are in both lanes, b's columns 2h and 2h+1
+    //are split over the lanes and each lane broadcasts its own components
+    inline void MultiplyColumns(__m256 a0, __m256 a1, __m256 a2, __m256 a3, const Mat4& b, Mat4& out)
+    {
+        __m256 halves[2];
+        for (unsigned int h = 0; h < 2; h++)
+        {
+            __m256 columns{ _mm256_loadu_ps(&b.Columns[2 * h].X) };
+            __m256 sum{ _mm256_mul_ps(a0, _mm256_shuffle_ps(columns, columns, _MM_SHUFFLE(0, 0, 0, 0))) };
+            sum = MulAdd(a1, _mm256_shuffle_ps(columns, columns, _MM_SHUFFLE(1, 1, 1, 1)), sum);
+            sum = MulAdd(a2, _mm256_shuffle_ps(columns, columns, _MM_SHUFFLE(2, 2, 2, 2)), sum);
+            halves[h] = MulAdd(a3, _mm256_shuffle_ps(columns, columns, _MM_SHUFFLE(3, 3, 3, 3)), sum);
+        }
+        _mm256_storeu_ps(&out.Columns[0].X, halves[0]);
+        _mm256_storeu_ps(&out.Columns[2].X, halves[1]);
+    }
+
+    inline __m256 Broadcast2(const Vec4& v) { return _mm256_broadcast_ps((const __m128*)&v.X); }
+#endif
+
+}
+
+Quat Quat::FromAxisAngle(const Vec3& axis, float radians)
+{
+    float s{ std::sin(radians * 0.5f) };
+    return { axis.X * s, axis.Y * s, axis.Z * s, std::cos(radians * 0.5f) };
+}
+
+Mat4 Mat4::Identity()
+{
+    return { { { 1.0f, 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 0.0f, 1.0f } } };
+}
+
+Mat4 Mat4::Translation(const Vec3& translation)
+{
+    Mat4 result{ Identity() };
+    result.Columns[3] = { translation.X, translation.Y, translation.Z, 1.0f };
+    return result;
+}
+
+Mat4 Mat4::Scaling(const Vec3& scale)
+{
+    return { { { scale.X, 0.0f, 0.0f, 0.0f }, { 0.0f, scale.Y, 0.0f, 0.0f }, { 0.0f, 0.0f, scale.Z, 0.0f }, { 0.0f, 0.0f, 0.0f, 1.0f } } };
+}
+
+Mat4 Mat4::Rotation(const Quat& rotation)
+{
+    return Compose({ 0.0f, 0.0f, 0.0f }, rotation, { 1.0f, 1.0f, 1.0f });
+}
+
+Mat4 Mat4::Compose(const Vec3& translation, const Quat& rotation, const Vec3& scale)
+{
+    const Quat& q{ rotation };
+    float xx{ q.X * q.X }, yy{ q.Y * q.Y }, zz{ q.Z * q.Z };
+    float xy{ q.X * q.Y }, xz{ q.X * q.Z }, yz{ q.Y * q.Z };
+    float wx{ q.W * q.X }, wy{ q.W * q.Y }, wz{ q.W * q.Z };
+    return { {
+        { (1.0f - 2.0f * (yy + zz)) * scale.X, 2.0f * (xy + wz) * scale.X, 2.0f * (xz - wy) * scale.X, 0.0f },
+        { 2.0f * (xy - wz) * scale.Y, (1.0f - 2.0f * (xx + zz)) * scale.Y, 2.0f * (yz + wx) * scale.Y, 0.0f },
+        { 2.0f * (xz + wy) * scale.Z, 2.0f * (yz - wx) * scale.Z, (1.0f - 2.0f * (xx + yy)) * scale.Z, 0.0f },
+        { translation.X, translation.Y, translation.Z, 1.0f } } };
+}
+
+Mat4 Mat4::Perspective(float fovYRadians, float aspect, float nearPlane, float farPlane)
+{
+    float f{ 1.0f / std::tan(fovYRadians * 0.5f) };
+    float depth{ 1.0f / (nearPlane - farPlane) };
+    return { {
+        { f / aspect, 0.0f, 0.0f, 0.0f },
+        { 0.0f, f, 0.0f, 0.0f },
+        { 0.0f, 0.0f, (farPlane + nearPlane) * depth, -1.0f },
+        { 0.0f, 0.0f, 2.0f * farPlane * nearPlane * depth, 0.0f } } };
+}
+
+Mat4 Mat4::Orthographic(float left, float right, float bottom, float top, float nearPlane, float farPlane)
+{
+    return { {
+        { 2.0f / (right - left), 0.0f, 0.0f, 0.0f },
+        { 0.0f, 2.0f / (top - bottom), 0.0f, 0.0f },
+        { 0.0f, 0.0f, -2.0f / (farPlane - nearPlane), 0.0f },
+        { -(right + left) / (right - left), -(top + bottom) / (top - bottom), -(farPlane + nearPlane) / (farPlane - nearPlane), 1.0f } } };
+}
+
+Mat4 Mat4::LookAt(const Vec3& eye, const Vec3& target, const Vec3& up)
+{
+    Vec3 f{ Normalize(target - eye) };
+    Vec3 s{ Normalize(Cross(f, up)) };
+    Vec3 u{ Cross(s, f) };
+    return { {
+        { s.X, u.X, -f.X, 0.0f },
+        { s.Y, u.Y, -f.Y, 0.0f },
+        { s.Z, u.Z, -f.Z, 0.0f },
+        { -Dot(s, eye), -Dot(u, eye), Dot(f, eye), 1.0f } } };
+}
+
+Mat4 Inverse(const Mat4& m)
+{
+    //cofactor expansion, the same for either storage order
+    const float* a{ &m.Columns[0].X };
+    float inv[16];
+    inv[0] = a[5] * a[10] * a[15] - a[5] * a[11] * a[14] - a[9] * a[6] * a[15] + a[9] * a[7] * a[14] + a[13] * a[6] * a[11] - a[13] * a[7] * a[10];
+    inv[4] = -a[4] * a[10] * a[15] + a[4] * a[11] * a[14] + a[8] * a[6] * a[15] - a[8] * a[7] * a[14] - a[12] * a[6] * a[11] + a[12] * a[7] * a[10];
+    inv[8] = a[4] * a[9] * a[15] - a[4] * a[11] * a[13] - a[8] * a[5] * a[15] + a[8] * a[7] * a[13] + a[12] * a[5] * a[11] - a[12] * a[7] * a[9];
+    inv[12] = -a[4] * a[9] * a[14] + a[4] * a[10] * a[13] + a[8] * a[5] * a[14] - a[8] * a[6] * a[13] - a[12] * a[5] * a[10] + a[12] * a[6] * a[9];
+    inv[1] = -a[1] * a[10] * a[15] + a[1] * a[11] * a[14] + a[9] * a[2] * a[15] - a[9] * a[3] * a[14] - a[13] * a[2] * a[11] + a[13] * a[3] * a[10];
+    inv[5] = a[0] * a[10] * a[15] - a[0] * a[11] * a[14] - a[8] * a[2] * a[15] + a[8] * a[3] * a[14] + a[12] * a[2] * a[11] - a[12] * a[3] * a[10];
+    inv[9] = -a[0] * a[9] * a[15] + a[0] * a[11] * a[13] + a[8] * a[1] * a[15] - a[8] * a[3] * a[13] - a[12] * a[1] * a[11] + a[12] * a[3] * a[9];
+    inv[13] = a[0] * a[9] * a[14] - a[0] * a[10] * a[13] - a[8] * a[1] * a[14] + a[8] * a[2] * a[13] + a[12] * a[1] * a[10] - a[12] * a[2] * a[9];
+    inv[2] = a[1] * a[6] * a[15] - a[1] * a[7] * a[14] - a[5] * a[2] * a[15] + a[5] * a[3] * a[14] + a[13] * a[2] * a[7] - a[13] * a[3] * a[6];
+    inv[6] = -a[0] * a[6] * a[15] + a[0] * a[7] * a[14] + a[4] * a[2] * a[15] - a[4] * a[3] * a[14] - a[12] * a[2] * a[7] + a[12] * a[3] * a[6];
+    inv[10] = a[0] * a[5] * a[15] - a[0] * a[7] * a[13] - a[4] * a[1] * a[15] + a[4] * a[3] * a[13] + a[12] * a[1] * a[7] - a[12] * a[3] * a[5];
+    inv[14] = -a[0] * a[5] * a[14] + a[0] * a[6] * a[13] + a[4] * a[1] * a[14] - a[4] * a[2] * a[13] - a[12] * a[1] * a[6] + a[12] * a[2] * a[5];
+    inv[3] = -a[1] * a[6] * a[11] + a[1] * a[7] * a[10] + a[5] * a[2] * a[11] - a[5] * a[3] * a[10] - a[9] * a[2] * a[7] + a[9] * a[3] * a[6];
+    inv[7] = a[0] * a[6] * a[11] - a[0] * a[7] * a[10] - a[4] * a[2] * a[11] + a[4] * a[3] * a[10] + a[8] * a[2] * a[7] - a[8] * a[3] * a[6];
+    inv[11] = -a[0] * a[5] * a[11] + a[0] * a[7] * a[9] + a[4] * a[1] * a[11] - a[4] * a[3] * a[9] - a[8] * a[1] * a[7] + a[8] * a[3] * a[5];
+    inv[15] = a[0] * a[5] * a[10] - a[0] * a[6] * a[9] - a[4] * a[1] * a[10] + a[4] * a[2] * a[9] + a[8] * a[1] * a[6] - a[8] * a[2] * a[5];
+
+    float determinant{ a[0] * inv[0] + a[1] * inv[4] + a[2] * inv[8] + a[3] * inv[12] };
+    if (determinant == 0.0f)
+        return Mat4::Identity();
+    float scale{ 1.0f / determinant };
+    Mat4 result;
+    float* out{ &result.Columns[0].X };
+    for (unsigned int i = 0; i < 16; i++)
+        out[i] = inv[i] * scale;
+    return result;
+}
+
+Mat4 InverseAffine(const Mat4& m)
+{
+    //inverse of the 3x3 part through its adjugate (scale may be non-uniform), then -inverse * t
+    const Vec4* c{ m.Columns };
+    Vec3 c0{ c[0].X, c[0].Y, c[0].Z }, c1{ c[1].X, c[1].Y, c[1].Z }, c2{ c[2].X, c[2].Y, c[2].Z };
+    Vec3 r0{ Cross(c1, c2) }, r1{ Cross(c2, c0) }, r2{ Cross(c0, c1) };
+    float determinant{ Dot(c0, r0) };
+    if (determinant == 0.0f)
+        return Mat4::Identity();
+    float scale{ 1.0f / determinant };
+    r0 = r0 * scale;
+    r1 = r1 * scale;
+    r2 = r2 * scale;
+    //r0..r2 are the rows of the inverse
+    Vec3 t{ c[3].X, c[3].Y, c[3].Z };
+    return { {
+        { r0.X, r1.X, r2.X, 0.0f },
+        { r0.Y, r1.Y, r2.Y, 0.0f },
+        { r0.Z, r1.Z, r2.Z, 0.0f },
+        { -Dot(r0, t), -Dot(r1, t), -Dot(r2, t), 1.0f } } };
+}
+
+Quat Normalize(const Quat& q)
+{
+    float length{ std::sqrt(Dot(q, q)) };
+    if (length == 0.0f)
+        return Quat::Identity();
+    float scale{ 1.0f / length };
+    return { q.X * scale, q.Y * scale, q.Z * scale, q.W * scale };
+}
+
+Quat Slerp(const Quat& a, const Quat& b, float t)
+{
+    float cosine{ Dot(a, b) };
+    Quat to{ b };
+    if (cosine < 0.0f)
+    {
+        cosine = -cosine;
+        to = { -b.X, -b.Y, -b.Z, -b.W };
+    }
+
+    float wa, wb;
+    if (cosine > 0.9995f)
+    {
+        wa = 1.0f - t;
+        wb = t;
+    }
+    else
+    {
+        float angle{ std::acos(cosine) };
+        float inverseSine{ 1.0f / std::sin(angle) };
+        wa = std::sin((1.0f - t) * angle) * inverseSine;
+        wb = std::sin(t * angle) * inverseSine;
+    }
+    return Normalize(Quat{ a.X * wa + to.X * wb, a.Y * wa + to.Y * wb, a.Z * wa + to.Z * wb, a.W * wa + to.W * wb });
+}
+
+void TransformPoints(const Mat4& m, const Vec3* points, Vec3* out, size_t count)
+{
+    size_t i{ 0 };
+#ifdef __AVX2__
+    {
+        Broadcast8 matrix(m);
+        for (; i + 8 <= count; i += 8)
+        {
+            const float* source{ &points[i].X };
+            __m256 x, y, z;
+            Deinterleave(Load2(source, source + 12), Load2(source + 4, source + 16), Load2(source + 8, source + 20), x, y, z);
+            __m256 v0, v1, v2;
+            Interleave(matrix.Row(0, x, y, z), matrix.Row(1, x, y, z), matrix.Row(2, x, y, z), v0, v1, v2);
+            float* destination{ &out[i].X };
+            Store2(destination, destination + 12, v0);
+            Store2(destination + 4, destination + 16, v1);
+            Store2(destination + 8, destination + 20, v2);
+        }
+    }
+#endif
+#ifdef VECTOR_MATH_SSE2
+    {
+        Broadcast4 matrix(m);
+        for (; i + 4 <= count; i += 4)
+        {
+            const float* source{ &points[i].X };
+            __m128 x, y, z;
+            Deinterleave(_mm_loadu_ps(source), _mm_loadu_ps(source + 4), _mm_loadu_ps(source + 8), x, y, z);
+            __m128 v0, v1, v2;
+            Interleave(matrix.Row(0, x, y, z), matrix.Row(1, x, y, z), matrix.Row(2, x, y, z), v0, v1, v2);
+            float* destination{ &out[i].X };
+            _mm_storeu_ps(destination, v0);
+            _mm_storeu_ps(destination + 4, v1);
+            _mm_storeu_ps(destination + 8, v2);
+        }
+    }
+#endif
+    for (; i < count; i++)
+        out[i] = TransformPoint(m, points[i]);
+}
+
+void ProjectPoints(const Mat4& m, const Vec3* points, Vec4* out, size_t count)
+{
+    size_t i{ 0 };
+#ifdef __AVX2__
+    {
+        Broadcast8 matrix(m);
+        for (; i + 8 <= count; i += 8)
+        {
+            const float* source{ &points[i].X };
+            __m256 x, y, z;
+            Deinterleave(Load2(source, source + 12), Load2(source + 4, source + 16), Load2(source + 8, source + 20), x, y, z);
+            __m256 r0{ matrix.Row(0, x, y, z) }, r1{ matrix.Row(1, x, y, z) }, r2{ matrix.Row(2, x, y, z) }, r3{ matrix.Row(3, x, y, z) };
+            Transpose(r0, r1, r2, r3);
+            Store2(&out[i].X, &out[i + 4].X, r0);
+            Store2(&out[i + 1].X, &out[i + 5].X, r1);
+            Store2(&out[i + 2].X, &out[i + 6].X, r2);
+            Store2(&out[i + 3].X, &out[i + 7].X, r3);
+        }
+    }
+#endif
+#ifdef VECTOR_MATH_SSE2
+    {
+        Broadcast4 matrix(m);
+        for (; i + 4 <= count; i += 4)
+        {
+            const float* source{ &points[i].X };
+            __m128 x, y, z;
+            Deinterleave(_mm_loadu_ps(source), _mm_loadu_ps(source + 4), _mm_loadu_ps(source + 8), x, y, z);
+            __m128 r0{ matrix.Row(0, x, y, z) }, r1{ matrix.Row(1, x, y, z) }, r2{ matrix.Row(2, x, y, z) }, r3{ matrix.Row(3, x, y, z) };
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+            _mm_store_ps(&out[i].X, r0);
+            _mm_store_ps(&out[i + 1].X, r1);
+            _mm_store_ps(&out[i + 2].X, r2);
+            _mm_store_ps(&out[i + 3].X, r3);
+        }
+    }
+#endif
+    for (; i < count; i++)
+        out[i] = m * Vec4{ points[i].X, points[i].Y, points[i].Z, 1.0f };
+}
+
+void MultiplyMatrices(const Mat4& a, const Mat4* b, Mat4* out, size_t count)
+{
+#if defined(__AVX2__)
+    __m256 a0{ Broadcast2(a.Columns[0]) }, a1{ Broadcast2(a.Columns[1]) }, a2{ Broadcast2(a.Columns[2]) }, a3{ Broadcast2(a.Columns[3]) };
+    for (size_t i = 0; i < count; i++)
+        MultiplyColumns(a0, a1, a2, a3, b[i], out[i]);
+#elif defined(VECTOR_MATH_SSE2)
+    __m128 a0{ LoadVec4(a.Columns[0]) }, a1{ LoadVec4(a.Columns[1]) }, a2{ LoadVec4(a.Columns[2]) }, a3{ LoadVec4(a.Columns[3]) };
+    for (size_t i = 0; i < count; i++)
+        MultiplyColumns(a0, a1, a2, a3, b[i], out[i]);
+#else
+    for (size_t i = 0; i < count; i++)
+        out[i] = a * b[i];
+#endif
+}
+
+void MultiplyMatrices(const Mat4* a, const Mat4* b, Mat4* out, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+#if defined(__AVX2__)
+        MultiplyColumns(Broadcast2(a[i].Columns[0]), Broadcast2(a[i].Columns[1]), Broadcast2(a[i].Columns[2]), Broadcast2(a[i].Columns[3]), b[i], out[i]);
+#elif defined(VECTOR_MATH_SSE2)
+        MultiplyColumns(LoadVec4(a[i].Columns[0]), LoadVec4(a[i].Columns[1]), LoadVec4(a[i].Columns[2]), LoadVec4(a[i].Columns[3]), b[i], out[i]);
+#else
+        out[i] = a[i] * b[i];
+#endif
+    }
+}
+
+void ComposeMatrices(const Vec3* translations, const Quat* rotations, const Vec3* scales, Mat4* out, size_t count)
+{
+    size_t i{ 0 };
+#ifdef __AVX2__
+    {
+        const __m256 one{ _mm256_set1_ps(1.0f) };
+        const __m256 two{ _mm256_set1_ps(2.0f) };
+        const __m256 zero{ _mm256_setzero_ps() };
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256 qx{ Load2(&rotations[i].X, &rotations[i + 4].X) };
+            __m256 qy{ Load2(&rotations[i + 1].X, &rotations[i + 5].X) };
+            __m256 qz{ Load2(&rotations[i + 2].X, &rotations[i + 6].X) };
+            __m256 qw{ Load2(&rotations[i + 3].X, &rotations[i + 7].X) };
+            Transpose(qx, qy, qz, qw);
+            const float* s{ &scales[i].X };
+            __m256 sx, sy, sz;
+            Deinterleave(Load2(s, s + 12), Load2(s + 4, s + 16), Load2(s + 8, s + 20), sx, sy, sz);
+            const float* t{ &translations[i].X };
+            __m256 tx, ty, tz;
+            Deinterleave(Load2(t, t + 12), Load2(t + 4, t + 16), Load2(t + 8, t + 20), tx, ty, tz);
+
+            __m256 x2{ _mm256_mul_ps(qx, two) }, y2{ _mm256_mul_ps(qy, two) }, z2{ _mm256_mul_ps(qz, two) };
+            __m256 xx{ _mm256_mul_ps(qx, x2) }, yy{ _mm256_mul_ps(qy, y2) }, zz{ _mm256_mul_ps(qz, z2) };
+            __m256 xy{ _mm256_mul_ps(qx, y2) }, xz{ _mm256_mul_ps(qx, z2) }, yz{ _mm256_mul_ps(qy, z2) };
+            __m256 wx{ _mm256_mul_ps(qw, x2) }, wy{ _mm256_mul_ps(qw, y2) }, wz{ _mm256_mul_ps(qw, z2) };
+
+            __m256 columns[4][4] {
+                { _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(yy, zz)), sx), _mm256_mul_ps(_mm256_add_ps(xy, wz), sx), _mm256_mul_ps(_mm256_sub_ps(xz, wy), sx), zero },
+                { _mm256_mul_ps(_mm256_sub_ps(xy, wz), sy), _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, zz)), sy), _mm256_mul_ps(_mm256_add_ps(yz, wx), sy), zero },
+                { _mm256_mul_ps(_mm256_add_ps(xz, wy), sz), _mm256_mul_ps(_mm256_sub_ps(yz, wx), sz), _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, yy)), sz), zero },
+                { tx, ty, tz, one } };
+            for (unsigned int c = 0; c < 4; c++)
+            {
+                Transpose(columns[c][0], columns[c][1], columns[c][2], columns[c][3]);
+                for (unsigned int j = 0; j < 4; j++)
+                    Store2(&out[i + j].Columns[c].X, &out[i + 4 + j].Columns[c].X, columns[c][j]);
+            }
+        }
+    }
+#endif
+#ifdef VECTOR_MATH_SSE2
+    {
+        const __m128 one{ _mm_set1_ps(1.0f) };
+        const __m128 two{ _mm_set1_ps(2.0f) };
+        const __m128 zero{ _mm_setzero_ps() };
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 qx{ _mm_load_ps(&rotations[i].X) }, qy{ _mm_load_ps(&rotations[i + 1].X) };
+            __m128 qz{ _mm_load_ps(&rotations[i + 2].X) }, qw{ _mm_load_ps(&rotations[i + 3].X) };
+            _MM_TRANSPOSE4_PS(qx, qy, qz, qw);
+            const float* s{ &scales[i].X };
+            __m128 sx, sy, sz;
+            Deinterleave(_mm_loadu_ps(s), _mm_loadu_ps(s + 4), _mm_loadu_ps(s + 8), sx, sy, sz);
+            const float* t{ &translations[i].X };
+            __m128 tx, ty, tz;
+            Deinterleave(_mm_loadu_ps(t), _mm_loadu_ps(t + 4), _mm_loadu_ps(t + 8), tx, ty, tz);
+
+            __m128 x2{ _mm_mul_ps(qx, two) }, y2{ _mm_mul_ps(qy, two) }, z2{ _mm_mul_ps(qz, two) };
+            __m128 xx{ _mm_mul_ps(qx, x2) }, yy{ _mm_mul_ps(qy, y2) }, zz{ _mm_mul_ps(qz, z2) };
+            __m128 xy{ _mm_mul_ps(qx, y2) }, xz{ _mm_mul_ps(qx, z2) }, yz{ _mm_mul_ps(qy, z2) };
+            __m128 wx{ _mm_mul_ps(qw, x2) }, wy{ _mm_mul_ps(qw, y2) }, wz{ _mm_mul_ps(qw, z2) };
+
+            //component r of column c for four matrices, transposed into one column per matrix
+            __m128 columns[4][4] {
+                { _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), sx), _mm_mul_ps(_mm_add_ps(xy, wz), sx), _mm_mul_ps(_mm_sub_ps(xz, wy), sx), zero },
+                { _mm_mul_ps(_mm_sub_ps(xy, wz), sy), _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), sy), _mm_mul_ps(_mm_add_ps(yz, wx), sy), zero },
+                { _mm_mul_ps(_mm_add_ps(xz, wy), sz), _mm_mul_ps(_mm_sub_ps(yz, wx), sz), _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), sz), zero },
+                { tx, ty, tz, one } };
+            for (unsigned int c = 0; c < 4; c++)
+            {
+                _MM_TRANSPOSE4_PS(columns[c][0], columns[c][1], columns[c][2], columns[c][3]);
+                for (unsigned int j = 0; j < 4; j++)
+                    _mm_store_ps(&out[i + j].Columns[c].X, columns[c][j]);
+            }
+        }
+    }
+#endif
+    for (; i < count; i++)
+        out[i] = Mat4::Compose(translations[i], rotations[i], scales[i]);
+}
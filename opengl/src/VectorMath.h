@@ -0,0 +1,201 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VECTOR_MATH_SSE2
+#include <emmintrin.h>
+#endif
+
+//3 floats for storage (positions, scales, normals). single Vec3 maths is scalar, the batch
+//kernels at the bottom are where SIMD pays off
+struct Vec3
+{
+	float X, Y, Z;
+};
+
+struct alignas(16) Vec4
+{
+	float X, Y, Z, W;
+};
+
+//unit quaternion for rotations, W is the real part
+struct alignas(16) Quat
+{
+	float X, Y, Z, W;
+
+	static Quat Identity() { return { 0.0f, 0.0f, 0.0f, 1.0f }; }
+	//axis must be unit length
+	static Quat FromAxisAngle(const Vec3& axis, float radians);
+};
+
+//column-major like GL, Columns[3] is the translation. upload with
+//glUniformMatrix4fv(location, 1, GL_FALSE, &m.Columns[0].X)
+struct alignas(16) Mat4
+{
+	Vec4 Columns[4];
+
+	static Mat4 Identity();
+	static Mat4 Translation(const Vec3& translation);
+	static Mat4 Scaling(const Vec3& scale);
+	static Mat4 Rotation(const Quat& rotation);
+	//translation * rotation * scale, the usual model matrix
+	static Mat4 Compose(const Vec3& translation, const Quat& rotation, const Vec3& scale);
+	//right handed, clip z in [-1, 1] like glm/gluPerspective
+	static Mat4 Perspective(float fovYRadians, float aspect, float nearPlane, float farPlane);
+	static Mat4 Orthographic(float left, float right, float bottom, float top, float nearPlane, float farPlane);
+	static Mat4 LookAt(const Vec3& eye, const Vec3& target, const Vec3& up);
+};
+
+inline Vec3 operator+(const Vec3& a, const Vec3& b) { return { a.X + b.X, a.Y + b.Y, a.Z + b.Z }; }
+inline Vec3 operator-(const Vec3& a, const Vec3& b) { return { a.X - b.X, a.Y - b.Y, a.Z - b.Z }; }
+inline Vec3 operator-(const Vec3& a) { return { -a.X, -a.Y, -a.Z }; }
+inline Vec3 operator*(const Vec3& a, float s) { return { a.X * s, a.Y * s, a.Z * s }; }
+inline Vec3 operator*(float s, const Vec3& a) { return a * s; }
+//component-wise
+inline Vec3 operator*(const Vec3& a, const Vec3& b) { return { a.X * b.X, a.Y * b.Y, a.Z * b.Z }; }
+
+inline float Dot(const Vec3& a, const Vec3& b) { return a.X * b.X + a.Y * b.Y + a.Z * b.Z; }
+inline Vec3 Cross(const Vec3& a, const Vec3& b)
+{
+	return { a.Y * b.Z - a.Z * b.Y, a.Z * b.X - a.X * b.Z, a.X * b.Y - a.Y * b.X };
+}
+inline float Length(const Vec3& a) { return std::sqrt(Dot(a, a)); }
+//the zero vector stays zero
+inline Vec3 Normalize(const Vec3& a)
+{
+	float length{ Length(a) };
+	return length > 0.0f ? a * (1.0f / length) : a;
+}
+
+#ifdef VECTOR_MATH_SSE2
+inline __m128 LoadVec4(const Vec4& v) { return _mm_load_ps(&v.X); }
+inline Vec4 StoreVec4(__m128 v)
+{
+	Vec4 result;
+	_mm_store_ps(&result.X, v);
+	return result;
+}
+
+inline Vec4 operator+(const Vec4& a, const Vec4& b) { return StoreVec4(_mm_add_ps(LoadVec4(a), LoadVec4(b))); }
+inline Vec4 operator-(const Vec4& a, const Vec4& b) { return StoreVec4(_mm_sub_ps(LoadVec4(a), LoadVec4(b))); }
+inline Vec4 operator*(const Vec4& a, float s) { return StoreVec4(_mm_mul_ps(LoadVec4(a), _mm_set1_ps(s))); }
+inline Vec4 operator*(const Vec4& a, const Vec4& b) { return StoreVec4(_mm_mul_ps(LoadVec4(a), LoadVec4(b))); }
+inline float Dot(const Vec4& a, const Vec4& b)
+{
+	__m128 product{ _mm_mul_ps(LoadVec4(a), LoadVec4(b)) };
+	__m128 pairs{ _mm_add_ps(product, _mm_shuffle_ps(product, product, _MM_SHUFFLE(2, 3, 0, 1))) };
+	return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_movehl_ps(pairs, pairs)));
+}
+
+inline Vec4 operator*(const Mat4& m, const Vec4& v)
+{
+	__m128 result{ _mm_mul_ps(LoadVec4(m.Columns[0]), _mm_set1_ps(v.X)) };
+	result = _mm_add_ps(result, _mm_mul_ps(LoadVec4(m.Columns[1]), _mm_set1_ps(v.Y)));
+	result = _mm_add_ps(result, _mm_mul_ps(LoadVec4(m.Columns[2]), _mm_set1_ps(v.Z)));
+	result = _mm_add_ps(result, _mm_mul_ps(LoadVec4(m.Columns[3]), _mm_set1_ps(v.W)));
+	return StoreVec4(result);
+}
+
+inline Mat4 operator*(const Mat4& a, const Mat4& b)
+{
+	__m128 a0{ LoadVec4(a.Columns[0]) }, a1{ LoadVec4(a.Columns[1]) }, a2{ LoadVec4(a.Columns[2]) }, a3{ LoadVec4(a.Columns[3]) };
+	Mat4 result;
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		__m128 column{ LoadVec4(b.Columns[i]) };
+		__m128 sum{ _mm_mul_ps(a0, _mm_shuffle_ps(column, column, _MM_SHUFFLE(0, 0, 0, 0))) };
+		sum = _mm_add_ps(sum, _mm_mul_ps(a1, _mm_shuffle_ps(column, column, _MM_SHUFFLE(1, 1, 1, 1))));
+		sum = _mm_add_ps(sum, _mm_mul_ps(a2, _mm_shuffle_ps(column, column, _MM_SHUFFLE(2, 2, 2, 2))));
+		sum = _mm_add_ps(sum, _mm_mul_ps(a3, _mm_shuffle_ps(column, column, _MM_SHUFFLE(3, 3, 3, 3))));
+		_mm_store_ps(&result.Columns[i].X, sum);
+	}
+	return result;
+}
+
+inline Mat4 Transpose(const Mat4& m)
+{
+	__m128 c0{ LoadVec4(m.Columns[0]) }, c1{ LoadVec4(m.Columns[1]) }, c2{ LoadVec4(m.Columns[2]) }, c3{ LoadVec4(m.Columns[3]) };
+	_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+	return { { StoreVec4(c0), StoreVec4(c1), StoreVec4(c2), StoreVec4(c3) } };
+}
+#else
+inline Vec4 operator+(const Vec4& a, const Vec4& b) { return { a.X + b.X, a.Y + b.Y, a.Z + b.Z, a.W + b.W }; }
+inline Vec4 operator-(const Vec4& a, const Vec4& b) { return { a.X - b.X, a.Y - b.Y, a.Z - b.Z, a.W - b.W }; }
+inline Vec4 operator*(const Vec4& a, float s) { return { a.X * s, a.Y * s, a.Z * s, a.W * s }; }
+inline Vec4 operator*(const Vec4& a, const Vec4& b) { return { a.X * b.X, a.Y * b.Y, a.Z * b.Z, a.W * b.W }; }
+inline float Dot(const Vec4& a, const Vec4& b) { return a.X * b.X + a.Y * b.Y + a.Z * b.Z + a.W * b.W; }
+
+inline Vec4 operator*(const Mat4& m, const Vec4& v)
+{
+	return m.Columns[0] * v.X + m.Columns[1] * v.Y + m.Columns[2] * v.Z + m.Columns[3] * v.W;
+}
+
+inline Mat4 operator*(const Mat4& a, const Mat4& b)
+{
+	return { { a * b.Columns[0], a * b.Columns[1], a * b.Columns[2], a * b.Columns[3] } };
+}
+
+inline Mat4 Transpose(const Mat4& m)
+{
+	const Vec4* c{ m.Columns };
+	return { {
+		{ c[0].X, c[1].X, c[2].X, c[3].X },
+		{ c[0].Y, c[1].Y, c[2].Y, c[3].Y },
+		{ c[0].Z, c[1].Z, c[2].Z, c[3].Z },
+		{ c[0].W, c[1].W, c[2].W, c[3].W } } };
+}
+#endif
+
+//w == 1, no divide: for affine matrices
+inline Vec3 TransformPoint(const Mat4& m, const Vec3& p)
+{
+	Vec4 result{ m * Vec4{ p.X, p.Y, p.Z, 1.0f } };
+	return { result.X, result.Y, result.Z };
+}
+inline Vec3 TransformVector(const Mat4& m, const Vec3& v)
+{
+	Vec4 result{ m * Vec4{ v.X, v.Y, v.Z, 0.0f } };
+	return { result.X, result.Y, result.Z };
+}
+
+//general inverse, the identity when m is singular
+Mat4 Inverse(const Mat4& m);
+//for rotation/scale/translation matrices only, a lot cheaper than Inverse()
+Mat4 InverseAffine(const Mat4& m);
+
+inline Quat operator*(const Quat& a, const Quat& b)
+{
+	return {
+		a.W * b.X + a.X * b.W + a.Y * b.Z - a.Z * b.Y,
+		a.W * b.Y - a.X * b.Z + a.Y * b.W + a.Z * b.X,
+		a.W * b.Z + a.X * b.Y - a.Y * b.X + a.Z * b.W,
+		a.W * b.W - a.X * b.X - a.Y * b.Y - a.Z * b.Z };
+}
+inline Quat Conjugate(const Quat& q) { return { -q.X, -q.Y, -q.Z, q.W }; }
+inline float Dot(const Quat& a, const Quat& b) { return a.X * b.X + a.Y * b.Y + a.Z * b.Z + a.W * b.W; }
+Quat Normalize(const Quat& q);
+//shortest path, falls back to a normalized lerp when the two are nearly the same
+Quat Slerp(const Quat& a, const Quat& b, float t);
+inline Vec3 Rotate(const Quat& q, const Vec3& v)
+{
+	//v + 2w(u x v) + 2u x (u x v)
+	Vec3 u{ q.X, q.Y, q.Z };
+	Vec3 t{ Cross(u, v) * 2.0f };
+	return v + t * q.W + Cross(u, t);
+}
+
+//batch kernels over arrays, SSE2 four items at a time (AVX2 eight with OPENGL_ENABLE_AVX2) with
+//a scalar tail. out may be the input array itself
+
+//out[i] = m * (points[i], 1), xyz only: world positions, bounds corners
+void TransformPoints(const Mat4& m, const Vec3* points, Vec3* out, size_t count);
+//out[i] = m * (points[i], 1) kept homogeneous: clip space positions
+void ProjectPoints(const Mat4& m, const Vec3* points, Vec4* out, size_t count);
+//out[i] = a * b[i]: model-view-projection matrices from one view-projection and the models
+void MultiplyMatrices(const Mat4& a, const Mat4* b, Mat4* out, size_t count);
+//out[i] = a[i] * b[i]: parent world * local
+void MultiplyMatrices(const Mat4* a, const Mat4* b, Mat4* out, size_t count);
+//out[i] = Mat4::Compose(translations[i], rotations[i], scales[i])
+void ComposeMatrices(const Vec3* translations, const Quat* rotations, const Vec3* scales, Mat4* out, size_t count);
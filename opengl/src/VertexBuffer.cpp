@@ -1,17 +1,51 @@
 #include "VertexBuffer.h"
 #include "Renderer.h"
+#include "GpuMemory.h"
 
 
-VertexBuffer::VertexBuffer(const void* data, unsigned int size)
+VertexBuffer::VertexBuffer(const void* data, unsigned int size, bool dynamic)
+    : m_Size(size)
 {
     GLCall(glGenBuffers(1, &m_RendererID));                                       //sending the address of buffer to fill with and ID of 1
     GLCall(glBindBuffer(GL_ARRAY_BUFFER, m_RendererID));                          //<--- create buffer of memory and then put data in buffer
-    GLCall(glBufferData(GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW));
+    GLCall(glBufferData(GL_ARRAY_BUFFER, size, data, dynamic ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW));
+    GpuMemory::Get().Track(GpuMemoryCategory::VertexBuffer, m_RendererID, size);
             //^^^^ == (target, size, data, usage) 6 vertices to make triangle, 12 to make square
+    if (dynamic)
+        m_Shadow = std::make_unique<BufferShadow>(data, size);
 }
 VertexBuffer::~VertexBuffer()
 {
-    GLCall(glDeleteBuffers(1, &m_RendererID));
+    if (m_RendererID)
+    {
+        GpuMemory::Get().Untrack(GpuMemoryCategory::VertexBuffer, m_RendererID);
+        GLCall(glDeleteBuffers(1, &m_RendererID));
+    }
+}
+
+VertexBuffer::VertexBuffer(VertexBuffer&& other) noexcept
+    : m_RendererID(other.m_RendererID), m_Size(other.m_Size), m_Shadow(std::move(other.m_Shadow))
+{
+    other.m_RendererID = 0;
+    other.m_Size = 0;
+}
+
+VertexBuffer& VertexBuffer::operator=(VertexBuffer&& other) noexcept
+{
+    if (this != &other)
+    {
+        if (m_RendererID)
+        {
+            GpuMemory::Get().Untrack(GpuMemoryCategory::VertexBuffer, m_RendererID);
+            GLCall(glDeleteBuffers(1, &m_RendererID));
+        }
+        m_RendererID = other.m_RendererID;
+        m_Size = other.m_Size;
+        m_Shadow = std::move(other.m_Shadow);
+        other.m_RendererID = 0;
+        other.m_Size = 0;
+    }
+    return *this;
 }
 
 void VertexBuffer::Bind()
@@ -21,4 +55,19 @@ void VertexBuffer::Bind()
 void VertexBuffer::Unbind()
 {
     GLCall(glBindBuffer(GL_ARRAY_BUFFER, 0));
-}
\ No newline at end of file
+}
+
+void VertexBuffer::Update(unsigned int offset, const void* data, unsigned int size)
+{
+    ASSERT((unsigned long long)offset + size <= m_Size);
+    if (m_Shadow)
+        m_Shadow->Write(offset, data, size);
+    else
+        BufferShadow::Upload(m_RendererID, offset, data, size);
+}
+
+unsigned int VertexBuffer::Flush()
+{
+    //copy target so the GL_ARRAY_BUFFER binding is left alone
+    return m_Shadow ? m_Shadow->Flush(GL_COPY_WRITE_BUFFER, m_RendererID) : 0;
+}
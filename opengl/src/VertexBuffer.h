@@ -1,13 +1,36 @@
 #pragma once
 
+#include <memory>
+
+#include "BufferShadow.h"
+
 class VertexBuffer
 {
 private:
 	unsigned int m_RendererID;
+	unsigned int m_Size;
+	std::unique_ptr<BufferShadow> m_Shadow;     //only for dynamic buffers
 public:
-	VertexBuffer(const void* data, unsigned int size);
+	//dynamic buffers keep a CPU copy; Update() only marks bytes dirty and Flush() uploads them
+	VertexBuffer(const void* data, unsigned int size, bool dynamic = false);
 	~VertexBuffer();
 
+	//owns a GL buffer name, so it can be moved but never copied
+	VertexBuffer(const VertexBuffer&) = delete;
+	VertexBuffer& operator=(const VertexBuffer&) = delete;
+	VertexBuffer(VertexBuffer&& other) noexcept;
+	VertexBuffer& operator=(VertexBuffer&& other) noexcept;
+
 	void Bind();
 	void Unbind();
+
+	//byte offset/size. static buffers upload right away, dynamic ones on the next Flush()
+	void Update(unsigned int offset, const void* data, unsigned int size);
+	//returns the number of bytes uploaded
+	unsigned int Flush();
+
+	inline bool IsDynamic() const { return m_Shadow != nullptr; }
+	inline bool IsDirty() const { return m_Shadow && m_Shadow->IsDirty(); }
+	inline unsigned int GetSize() const { return m_Size; }
+	inline unsigned int GetRendererID() const { return m_RendererID; }
 };
\ No newline at end of file
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <vector>
+
+#include "Renderer.h"
+
+struct VertexBufferElement
+{
+	unsigned int type;
+	unsigned int count;
+	unsigned char normalized;
+
+	static unsigned int GetSizeOfType(unsigned int type)
+	{
+		switch (type)
+		{
+			case GL_FLOAT:          return 4;
+			case GL_UNSIGNED_INT:   return 4;
+			case GL_UNSIGNED_BYTE:  return 1;
+		}
+		ASSERT(false);
+		return 0;
+	}
+};
+
+//describes one interleaved vertex: Push<float>(2) == vec2 position etc.
+class VertexBufferLayout
+{
+private:
+	std::vector<VertexBufferElement> m_Elements;
+	unsigned int m_Stride;
+public:
+	VertexBufferLayout()
+		: m_Stride(0) {}
+
+	template<typename T>
+	void Push(unsigned int count);
+
+	//enables and points attributes firstAttribute.. at the currently bound GL_ARRAY_BUFFER, starting
+	//baseOffset bytes in. divisor 1 steps them once per instance instead of once per vertex
+	void Apply(unsigned int firstAttribute = 0, unsigned long long baseOffset = 0, unsigned int divisor = 0) const
+	{
+		unsigned long long offset{ baseOffset };
+		for (unsigned int i = 0; i < m_Elements.size(); i++)
+		{
+			const VertexBufferElement& element{ m_Elements[i] };
+			unsigned int attribute{ firstAttribute + i };
+			GLCall(glEnableVertexAttribArray(attribute));
+			if (element.type == GL_UNSIGNED_INT && !element.normalized)
+			{
+				GLCall(glVertexAttribIPointer(attribute, element.count, element.type, m_Stride, (const void*)offset));
+			}
+			else
+			{
+				GLCall(glVertexAttribPointer(attribute, element.count, element.type, element.normalized, m_Stride, (const void*)offset));
+			}
+			GLCall(glVertexAttribDivisor(attribute, divisor));
+			offset += element.count * VertexBufferElement::GetSizeOfType(element.type);
+		}
+	}
+
+	inline const std::vector<VertexBufferElement>& GetElements() const { return m_Elements; }
+	inline unsigned int GetStride() const { return m_Stride; }
+
+	inline bool operator==(const VertexBufferLayout& other) const
+	{
+		if (m_Stride != other.m_Stride || m_Elements.size() != other.m_Elements.size())
+			return false;
+		for (unsigned int i = 0; i < m_Elements.size(); i++)
+		{
+			const VertexBufferElement& a{ m_Elements[i] };
+			const VertexBufferElement& b{ other.m_Elements[i] };
+			if (a.type != b.type || a.count != b.count || a.normalized != b.normalized)
+				return false;
+		}
+		return true;
+	}
+};
+
+template<>
+inline void VertexBufferLayout::Push<float>(unsigned int count)
+{
+	m_Elements.push_back({ GL_FLOAT, count, GL_FALSE });
+	m_Stride += count * VertexBufferElement::GetSizeOfType(GL_FLOAT);
+}
+
+template<>
+inline void VertexBufferLayout::Push<unsigned int>(unsigned int count)
+{
+	m_Elements.push_back({ GL_UNSIGNED_INT, count, GL_FALSE });
+	m_Stride += count * VertexBufferElement::GetSizeOfType(GL_UNSIGNED_INT);
+}
+
+template<>
+inline void VertexBufferLayout::Push<unsigned char>(unsigned int count)
+{
+	m_Elements.push_back({ GL_UNSIGNED_BYTE, count, GL_TRUE });
+	m_Stride += count * VertexBufferElement::GetSizeOfType(GL_UNSIGNED_BYTE);
+}
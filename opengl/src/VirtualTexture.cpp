@@ -0,0 +1,386 @@
+#include "VirtualTexture.h"
+#include "GpuMemory.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iostream>
+
+static const ProfilerCounter s_PageUploads("Virtual texture page uploads");
+static const ProfilerCounter s_Evictions("Virtual texture evictions");
+
+//the coarsest page is loaded up front and never evicted, every page table entry can fall back to it
+static const unsigned long long s_Pinned{ ~0ull };
+static const unsigned int s_Readbacks{ 2 };
+
+VirtualTexture::VirtualTexture(const std::string& pageFile, WorkerPool& workers, unsigned int cacheSide,
+    unsigned int feedbackWidth, unsigned int feedbackHeight)
+    : m_Workers(workers), m_File(std::make_unique<PageFile>()), m_CacheSide(std::max(cacheSide, 1u)), m_TableDirty(false),
+      m_FeedbackWidth(std::max(feedbackWidth, 1u)), m_FeedbackHeight(std::max(feedbackHeight, 1u)), m_FeedbackFramebuffer(0),
+      m_FeedbackDepth(0), m_NextReadback(0), m_PreviousFramebuffer(0), m_PreviousViewport{ 0, 0, 0, 0 }, m_Waiting(0),
+      m_Reading(0), m_Frame(0), m_MaxInFlight(16), m_UploadsPerFrame(8), m_LastFrameUploads(0), m_Evictions(0)
+{
+    if (!m_File->Open(pageFile))
+        return;
+    unsigned int pages{ m_File->GetPagesPerSide(0) };
+    if (pages > 256 || m_File->GetPagesPerSide(m_File->GetLevels() - 1) != 1)
+    {
+        std::cout << "Page file " << pageFile << " has " << pages << " pages per side, at most 256 fit the feedback" << std::endl;
+        return;
+    }
+
+    unsigned int levels{ m_File->GetLevels() };
+    m_PageTable = std::make_unique<Texture>(pages, pages, levels, GL_RGBA8);
+    m_TableLevels.resize(levels);
+    for (unsigned int level = 0; level < levels; level++)
+        m_TableLevels[level].resize((size_t)m_File->GetPagesPerSide(level) * m_File->GetPagesPerSide(level) * 4, 0);
+    m_Slots.assign(m_CacheSide * m_CacheSide, { s_NoPage, 0 });
+
+    m_FeedbackColor = std::make_unique<Texture>(m_FeedbackWidth, m_FeedbackHeight, 1, GL_RGBA8);
+    GLCall(glGenRenderbuffers(1, &m_FeedbackDepth));
+    GLCall(glBindRenderbuffer(GL_RENDERBUFFER, m_FeedbackDepth));
+    GLCall(glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, m_FeedbackWidth, m_FeedbackHeight));
+    GLCall(glBindRenderbuffer(GL_RENDERBUFFER, 0));
+    GpuMemory::Get().Track(GpuMemoryCategory::Renderbuffer, m_FeedbackDepth, (unsigned long long)m_FeedbackWidth * m_FeedbackHeight * 4);
+
+    GLCall(glGenFramebuffers(1, &m_FeedbackFramebuffer));
+    GLCall(glBindFramebuffer(GL_FRAMEBUFFER, m_FeedbackFramebuffer));
+    GLCall(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_FeedbackColor->GetRendererID(), 0));
+    GLCall(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_FeedbackDepth));
+    GLCall(GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER));
+    GLCall(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "Virtual texture feedback framebuffer incomplete: " << status << std::endl;
+        return;
+    }
+
+    size_t readbackSize{ (size_t)m_FeedbackWidth * m_FeedbackHeight * 4 };
+    m_Readbacks.resize(s_Readbacks);
+    for (Readback& readback : m_Readbacks)
+    {
+        GLCall(glGenBuffers(1, &readback.Buffer));
+        GLCall(glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.Buffer));
+        GLCall(glBufferData(GL_PIXEL_PACK_BUFFER, readbackSize, nullptr, GL_STREAM_READ));
+        GpuMemory::Get().Track(GpuMemoryCategory::Other, readback.Buffer, readbackSize);
+        readback.Fence = nullptr;
+    }
+    GLCall(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+    m_Requested.reserve(readbackSize / 4);
+    m_Candidates.reserve(readbackSize / 4);
+
+    unsigned int padded{ m_File->GetPaddedPageSize() };
+    m_Cache = std::make_unique<Texture>(m_CacheSide * padded, m_CacheSide * padded, 1, GL_RGBA8);
+    std::vector<unsigned char> pixels(m_File->GetPageBytes());
+    unsigned int top{ MakeKey(levels - 1, 0, 0) };
+    if (!m_File->ReadPage(levels - 1, 0, 0, pixels.data()) || !UploadPage(top, pixels.data()))
+    {
+        std::cout << "Failed to read the top page of " << pageFile << std::endl;
+        m_Cache.reset();
+        return;
+    }
+    m_Slots[m_Resident[top]].LastUsed = s_Pinned;
+    RebuildPageTable();
+}
+
+VirtualTexture::~VirtualTexture()
+{
+    //the read jobs hold this pointer
+    while (m_Reading.load() != 0)
+        m_Workers.Wait();
+
+    for (Readback& readback : m_Readbacks)
+    {
+        if (readback.Fence)
+        {
+            GLCall(glDeleteSync(readback.Fence));
+        }
+        GpuMemory::Get().Untrack(GpuMemoryCategory::Other, readback.Buffer);
+        GLCall(glDeleteBuffers(1, &readback.Buffer));
+    }
+    if (m_FeedbackFramebuffer)
+    {
+        GLCall(glDeleteFramebuffers(1, &m_FeedbackFramebuffer));
+    }
+    if (m_FeedbackDepth)
+    {
+        GpuMemory::Get().Untrack(GpuMemoryCategory::Renderbuffer, m_FeedbackDepth);
+        GLCall(glDeleteRenderbuffers(1, &m_FeedbackDepth));
+    }
+}
+
+void VirtualTexture::SetUniforms(unsigned int program, bool feedback, float lodBias) const
+{
+    GLCall(glUniform1f(glGetUniformLocation(program, "u_VirtualSize"), (float)m_File->GetSize()));
+    GLCall(glUniform1f(glGetUniformLocation(program, "u_PageSize"), (float)m_File->GetPageSize()));
+    GLCall(glUniform1f(glGetUniformLocation(program, "u_PageBorder"), (float)m_File->GetBorder()));
+    GLCall(glUniform1f(glGetUniformLocation(program, "u_CacheSize"), (float)m_Cache->GetWidth()));
+    GLCall(glUniform1f(glGetUniformLocation(program, "u_MaxLevel"), (float)(m_File->GetLevels() - 1)));
+    GLCall(glUniform1f(glGetUniformLocation(program, "u_LodBias"), lodBias));
+    GLCall(glUniform1i(glGetUniformLocation(program, "u_Feedback"), feedback ? 1 : 0));
+}
+
+void VirtualTexture::BeginFeedback(unsigned int program, unsigned int viewportWidth)
+{
+    GLCall(glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &m_PreviousFramebuffer));
+    GLCall(glGetIntegerv(GL_VIEWPORT, m_PreviousViewport));
+    GLCall(glBindFramebuffer(GL_FRAMEBUFFER, m_FeedbackFramebuffer));
+    GLCall(glViewport(0, 0, m_FeedbackWidth, m_FeedbackHeight));
+    //alpha 0 marks pixels nothing virtual was drawn to
+    const float clearColor[4]{ 0.0f, 0.0f, 0.0f, 0.0f };
+    const float clearDepth{ 1.0f };
+    GLCall(glClearBufferfv(GL_COLOR, 0, clearColor));
+    GLCall(glClearBufferfv(GL_DEPTH, 0, &clearDepth));
+
+    //derivatives are larger in the small target, the negative bias brings them back to the real pass
+    GLCall(glUseProgram(program));
+    SetUniforms(program, true, std::log2((float)m_FeedbackWidth / std::max(viewportWidth, 1u)));
+}
+
+void VirtualTexture::EndFeedback()
+{
+    Readback& readback{ m_Readbacks[m_NextReadback] };
+    if (readback.Fence)
+    {
+        //never consumed, the newer feedback replaces it
+        GLCall(glDeleteSync(readback.Fence));
+        readback.Fence = nullptr;
+    }
+    GLCall(glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.Buffer));
+    GLCall(glReadPixels(0, 0, m_FeedbackWidth, m_FeedbackHeight, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+    GLCall(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+    GLCall(readback.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+    m_NextReadback = (m_NextReadback + 1) % (unsigned int)m_Readbacks.size();
+
+    GLCall(glBindFramebuffer(GL_FRAMEBUFFER, m_PreviousFramebuffer));
+    GLCall(glViewport(m_PreviousViewport[0], m_PreviousViewport[1], m_PreviousViewport[2], m_PreviousViewport[3]));
+}
+
+//oldest first, so the newest finished feedback is the one that stays in m_Requested
+void VirtualTexture::ReadFeedback(bool wait)
+{
+    size_t bytes{ (size_t)m_FeedbackWidth * m_FeedbackHeight * 4 };
+    for (unsigned int i = 0; i < m_Readbacks.size(); i++)
+    {
+        Readback& readback{ m_Readbacks[(m_NextReadback + i) % m_Readbacks.size()] };
+        if (!readback.Fence)
+            continue;
+        GLenum status{ glClientWaitSync(readback.Fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? 1000000000ull : 0) };
+        if (status == GL_TIMEOUT_EXPIRED)
+            continue;
+        GLCall(glDeleteSync(readback.Fence));
+        readback.Fence = nullptr;
+
+        GLCall(glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.Buffer));
+        GLCall(const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT));
+        if (mapped)
+            ConsumeFeedback((const unsigned char*)mapped);
+        GLCall(glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+        GLCall(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+    }
+}
+
+void VirtualTexture::ConsumeFeedback(const unsigned char* pixels)
+{
+    m_Requested.clear();
+    unsigned int previous{ s_NoPage };
+    size_t count{ (size_t)m_FeedbackWidth * m_FeedbackHeight };
+    for (size_t i = 0; i < count; i++, pixels += 4)
+    {
+        if (pixels[3] == 0 || pixels[2] >= m_File->GetLevels())
+            continue;
+        //neighbouring pixels mostly want the same page, skip those before sorting
+        unsigned int key{ MakeKey(pixels[2], pixels[0], pixels[1]) };
+        if (key != previous)
+            m_Requested.push_back(key);
+        previous = key;
+    }
+    std::sort(m_Requested.begin(), m_Requested.end());
+    m_Requested.erase(std::unique(m_Requested.begin(), m_Requested.end()), m_Requested.end());
+}
+
+void VirtualTexture::RequestPages()
+{
+    m_Candidates.clear();
+    for (unsigned int key : m_Requested)
+    {
+        auto resident{ m_Resident.find(key) };
+        if (resident != m_Resident.end())
+        {
+            Slot& slot{ m_Slots[resident->second] };
+            if (slot.LastUsed != s_Pinned)
+                slot.LastUsed = m_Frame;
+        }
+        else if (!m_InFlight.count(key))
+        {
+            m_Candidates.push_back(key);
+        }
+    }
+
+    //the level is the top byte of the key, coarse pages first: they cover more and fill in the fallback
+    std::sort(m_Candidates.begin(), m_Candidates.end(), std::greater<unsigned int>());
+    unsigned int submitted{ 0 };
+    for (unsigned int key : m_Candidates)
+    {
+        if (m_InFlight.size() >= m_MaxInFlight)
+            break;
+        m_InFlight.insert(key);
+        m_Reading.fetch_add(1);
+        m_Workers.Submit([this, key]() {
+            LoadedPage page{ key, std::vector<unsigned char>(m_File->GetPageBytes()) };
+            if (!m_File->ReadPage(key >> 24, key & 0xfff, (key >> 12) & 0xfff, page.Pixels.data()))
+                page.Pixels.clear();
+            {
+                std::lock_guard<std::mutex> lock(m_LoadedMutex);
+                m_Loaded.push_back(std::move(page));
+            }
+            m_Reading.fetch_sub(1);
+        });
+        submitted++;
+    }
+    m_Waiting = (unsigned int)m_Candidates.size() - submitted;
+}
+
+unsigned int VirtualTexture::UploadLoaded(unsigned int limit)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_LoadedMutex);
+        for (LoadedPage& page : m_Loaded)
+            m_Ready.push_back(std::move(page));
+        m_Loaded.clear();
+    }
+    std::sort(m_Ready.begin(), m_Ready.end(), [](const LoadedPage& a, const LoadedPage& b) { return a.Page > b.Page; });
+
+    unsigned int uploads{ 0 };
+    size_t taken{ 0 };
+    for (; taken < m_Ready.size() && (limit == 0 || uploads < limit); taken++)
+    {
+        LoadedPage& page{ m_Ready[taken] };
+        m_InFlight.erase(page.Page);
+        //a failed read or no slot to spare: the next feedback asks again
+        if (!page.Pixels.empty() && UploadPage(page.Page, page.Pixels.data()))
+            uploads++;
+    }
+    m_Ready.erase(m_Ready.begin(), m_Ready.begin() + taken);
+    s_PageUploads.Add(uploads);
+    return uploads;
+}
+
+bool VirtualTexture::UploadPage(unsigned int page, const unsigned char* pixels)
+{
+    if (m_Resident.count(page))
+        return false;
+    unsigned int index{ FindSlot() };
+    if (index == s_NoPage)
+        return false;
+
+    Slot& slot{ m_Slots[index] };
+    if (slot.Page != s_NoPage)
+    {
+        m_Resident.erase(slot.Page);
+        m_Evictions++;
+        s_Evictions.Increment();
+    }
+    slot.Page = page;
+    slot.LastUsed = m_Frame;
+    m_Resident[page] = index;
+
+    unsigned int padded{ m_File->GetPaddedPageSize() };
+    m_Cache->SetData(0, (index % m_CacheSide) * padded, (index / m_CacheSide) * padded, padded, padded, pixels);
+    m_TableDirty = true;
+    return true;
+}
+
+//a free slot, else the least recently used one that the current frame does not need
+unsigned int VirtualTexture::FindSlot() const
+{
+    unsigned int best{ s_NoPage };
+    for (unsigned int i = 0; i < m_Slots.size(); i++)
+    {
+        const Slot& slot{ m_Slots[i] };
+        if (slot.Page == s_NoPage)
+            return i;
+        if (slot.LastUsed < m_Frame && (best == s_NoPage || slot.LastUsed < m_Slots[best].LastUsed))
+            best = i;
+    }
+    return best;
+}
+
+//coarse to fine, so a page that is not resident copies the entry its parent already resolved
+void VirtualTexture::RebuildPageTable()
+{
+    unsigned int levels{ m_File->GetLevels() };
+    for (unsigned int level = levels; level-- > 0;)
+    {
+        unsigned int side{ m_File->GetPagesPerSide(level) };
+        std::vector<unsigned char>& table{ m_TableLevels[level] };
+        for (unsigned int y = 0; y < side; y++)
+        {
+            for (unsigned int x = 0; x < side; x++)
+            {
+                unsigned char* entry{ &table[((size_t)y * side + x) * 4] };
+                auto resident{ m_Resident.find(MakeKey(level, x, y)) };
+                if (resident != m_Resident.end())
+                {
+                    entry[0] = (unsigned char)(resident->second % m_CacheSide);
+                    entry[1] = (unsigned char)(resident->second / m_CacheSide);
+                    entry[2] = (unsigned char)level;
+                    entry[3] = 255;
+                }
+                else if (level + 1 < levels)
+                {
+                    const unsigned char* parent{ &m_TableLevels[level + 1][((size_t)(y / 2) * (side / 2) + x / 2) * 4] };
+                    std::copy(parent, parent + 4, entry);
+                }
+            }
+        }
+        m_PageTable->SetData(level, 0, 0, side, side, table.data());
+    }
+    m_TableDirty = false;
+}
+
+void VirtualTexture::Update()
+{
+    m_Frame++;
+    ReadFeedback(false);
+    RequestPages();
+    m_LastFrameUploads = UploadLoaded(m_UploadsPerFrame);
+    if (m_TableDirty)
+        RebuildPageTable();
+}
+
+void VirtualTexture::Flush()
+{
+    m_Frame++;
+    ReadFeedback(true);
+    m_LastFrameUploads = 0;
+    //stops early when the cache cannot hold everything the frame wants
+    while (true)
+    {
+        RequestPages();
+        while (m_Reading.load() != 0)
+            m_Workers.Wait();
+        unsigned int uploads{ UploadLoaded(0) };
+        m_LastFrameUploads += uploads;
+        if (m_InFlight.empty() && (m_Waiting == 0 || uploads == 0))
+            break;
+    }
+    if (m_TableDirty)
+        RebuildPageTable();
+}
+
+void VirtualTexture::Bind(unsigned int program, unsigned int pageTableSlot, unsigned int cacheSlot) const
+{
+    m_PageTable->Bind(pageTableSlot);
+    m_Cache->Bind(cacheSlot);
+    GLCall(glUseProgram(program));
+    GLCall(glUniform1i(glGetUniformLocation(program, "u_PageTable"), pageTableSlot));
+    GLCall(glUniform1i(glGetUniformLocation(program, "u_PageCache"), cacheSlot));
+    SetUniforms(program, false, 0.0f);
+}
+
+unsigned int VirtualTexture::GetPendingPages() const
+{
+    return m_Waiting + (unsigned int)m_InFlight.size();
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "PageFile.h"
+#include "Texture.h"
+#include "WorkerPool.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+//virtual texturing in plain shaders and buffers, no ARB_sparse_texture:
+//- a physical page cache texture holds the resident pages, replaced least recently used first
+//- a page table texture with one texel per virtual page (and a mip per level) maps every page
+//  to its cache slot, or to the closest resident ancestor so something coarser shows meanwhile
+//- a feedback pass renders the scene into a small target with the page each pixel wants, the
+//  readback goes through a PBO and is consumed a frame or two later without stalling
+//- missing pages are read from the PageFile on the WorkerPool, the GL thread uploads a few per frame
+//
+//per frame: BeginFeedback(), draw with res/shader/VirtualTexture.shader, EndFeedback(), Update(),
+//then Bind() and draw the same geometry for real. all calls belong to the GL thread
+class VirtualTexture
+{
+private:
+	struct Slot
+	{
+		unsigned int Page;                  //key of the page in it, s_NoPage when free
+		unsigned long long LastUsed;        //frame
+	};
+	struct LoadedPage
+	{
+		unsigned int Page;
+		std::vector<unsigned char> Pixels;
+	};
+	struct Readback
+	{
+		unsigned int Buffer;
+		GLsync Fence;
+	};
+
+	static constexpr unsigned int s_NoPage{ 0xffffffffu };
+
+	WorkerPool& m_Workers;
+	std::unique_ptr<PageFile> m_File;
+	std::unique_ptr<Texture> m_PageTable;
+	std::unique_ptr<Texture> m_Cache;
+	unsigned int m_CacheSide;               //slots per side
+	std::vector<Slot> m_Slots;
+	std::unordered_map<unsigned int, unsigned int> m_Resident;  //page key to slot
+	std::vector<std::vector<unsigned char>> m_TableLevels;      //CPU copy of the page table
+	bool m_TableDirty;
+
+	unsigned int m_FeedbackWidth;
+	unsigned int m_FeedbackHeight;
+	unsigned int m_FeedbackFramebuffer;
+	std::unique_ptr<Texture> m_FeedbackColor;
+	unsigned int m_FeedbackDepth;
+	std::vector<Readback> m_Readbacks;
+	unsigned int m_NextReadback;
+	int m_PreviousFramebuffer;
+	int m_PreviousViewport[4];
+
+	std::vector<unsigned int> m_Requested;          //latest feedback, deduplicated page keys
+	std::vector<unsigned int> m_Candidates;
+	unsigned int m_Waiting;                         //requested, not resident and not submitted yet
+	std::unordered_set<unsigned int> m_InFlight;    //submitted until uploaded or dropped
+	std::mutex m_LoadedMutex;
+	std::vector<LoadedPage> m_Loaded;               //filled by the read jobs
+	std::vector<LoadedPage> m_Ready;                //taken from m_Loaded, waiting for upload budget
+	std::atomic<unsigned int> m_Reading;
+
+	unsigned long long m_Frame;
+	unsigned int m_MaxInFlight;
+	unsigned int m_UploadsPerFrame;
+	unsigned int m_LastFrameUploads;
+	unsigned long long m_Evictions;
+
+	static inline unsigned int MakeKey(unsigned int level, unsigned int x, unsigned int y) { return (level << 24) | (y << 12) | x; }
+
+	void SetUniforms(unsigned int program, bool feedback, float lodBias) const;
+	void ReadFeedback(bool wait);
+	void ConsumeFeedback(const unsigned char* pixels);
+	void RequestPages();
+	//returns the number of pages that went into the cache
+	unsigned int UploadLoaded(unsigned int limit);
+	bool UploadPage(unsigned int page, const unsigned char* pixels);
+	unsigned int FindSlot() const;
+	void RebuildPageTable();
+public:
+	//cacheSide * cacheSide pages are resident at most, the page file may have up to 256 pages per
+	//side (they are 8 bit in the feedback). the feedback target is that many texels,
+	//a small fraction of the screen is plenty
+	VirtualTexture(const std::string& pageFile, WorkerPool& workers, unsigned int cacheSide = 8,
+		unsigned int feedbackWidth = 160, unsigned int feedbackHeight = 90);
+	//waits for outstanding page reads, the context must still be current
+	~VirtualTexture();
+
+	VirtualTexture(const VirtualTexture&) = delete;
+	VirtualTexture& operator=(const VirtualTexture&) = delete;
+
+	inline bool IsValid() const { return m_Cache != nullptr; }
+
+	//binds the feedback target and sets the feedback uniforms on program. viewportWidth is the
+	//width of the real pass, the mip selection is biased by how much smaller the target is
+	void BeginFeedback(unsigned int program, unsigned int viewportWidth);
+	//queues the readback and restores the previous framebuffer and viewport
+	void EndFeedback();
+
+	//consumes finished feedback, requests missing pages, uploads loaded ones and updates the table
+	void Update();
+	//blocks until the requested pages are all resident, ignoring the per frame upload limit
+	void Flush();
+
+	//page table and cache to two texture slots, uniforms for the normal pass on program
+	void Bind(unsigned int program, unsigned int pageTableSlot = 1, unsigned int cacheSlot = 2) const;
+
+	inline void SetUploadsPerFrame(unsigned int pages) { m_UploadsPerFrame = pages; }
+	inline unsigned int GetResidentPages() const { return (unsigned int)m_Resident.size(); }
+	inline unsigned int GetCapacity() const { return (unsigned int)m_Slots.size(); }
+	inline unsigned int GetLastFrameUploads() const { return m_LastFrameUploads; }
+	inline unsigned long long GetEvictions() const { return m_Evictions; }
+	//pages wanted by the last feedback that are not resident yet, including those being read
+	unsigned int GetPendingPages() const;
+};
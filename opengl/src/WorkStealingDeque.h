@@ -0,0 +1,115 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+//Chase-Lev deque of pointers (with the C11 orderings of Le et al.). one owner thread pushes and
+//pops at the bottom, LIFO so it keeps working on what it just split off; any thread steals the
+//oldest item from the top. grows without bound, retired arrays are kept until destruction
+//because a thief may still be reading one
+template<typename T>
+class WorkStealingDeque
+{
+private:
+	struct Array
+	{
+		long long Capacity;             //power of two
+		std::unique_ptr<std::atomic<T*>[]> Items;
+
+		explicit Array(long long capacity)
+			: Capacity(capacity), Items(new std::atomic<T*>[capacity])
+		{
+		}
+
+		inline T* Get(long long i) const { return Items[i & (Capacity - 1)].load(std::memory_order_relaxed); }
+		inline void Put(long long i, T* item) { Items[i & (Capacity - 1)].store(item, std::memory_order_relaxed); }
+	};
+
+	std::atomic<long long> m_Top;
+	std::atomic<long long> m_Bottom;
+	std::atomic<Array*> m_Array;
+	std::vector<std::unique_ptr<Array>> m_Arrays;   //owner only
+
+	Array* Grow(Array* array, long long bottom, long long top)
+	{
+		m_Arrays.push_back(std::make_unique<Array>(array->Capacity * 2));
+		Array* grown{ m_Arrays.back().get() };
+		for (long long i = top; i < bottom; i++)
+			grown->Put(i, array->Get(i));
+		return grown;
+	}
+public:
+	explicit WorkStealingDeque(long long capacity = 256)
+		: m_Top(0), m_Bottom(0)
+	{
+		m_Arrays.push_back(std::make_unique<Array>(capacity));
+		m_Array.store(m_Arrays.back().get(), std::memory_order_relaxed);
+	}
+
+	WorkStealingDeque(const WorkStealingDeque&) = delete;
+	WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+	//owner only
+	void Push(T* item)
+	{
+		long long bottom{ m_Bottom.load(std::memory_order_relaxed) };
+		long long top{ m_Top.load(std::memory_order_acquire) };
+		Array* array{ m_Array.load(std::memory_order_relaxed) };
+		if (bottom - top > array->Capacity - 1)
+		{
+			array = Grow(array, bottom, top);
+			m_Array.store(array, std::memory_order_release);
+		}
+		array->Put(bottom, item);
+		std::atomic_thread_fence(std::memory_order_release);
+		m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+	}
+
+	//owner only, nullptr when empty
+	T* Pop()
+	{
+		long long bottom{ m_Bottom.load(std::memory_order_relaxed) - 1 };
+		Array* array{ m_Array.load(std::memory_order_relaxed) };
+		m_Bottom.store(bottom, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		long long top{ m_Top.load(std::memory_order_relaxed) };
+
+		if (top > bottom)
+		{
+			m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+		T* item{ array->Get(bottom) };
+		if (top == bottom)
+		{
+			//the last item, a thief may be after it as well
+			if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				item = nullptr;
+			m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+		}
+		return item;
+	}
+
+	//any thread, nullptr when empty or when another thread won the race for the item
+	T* Steal()
+	{
+		long long top{ m_Top.load(std::memory_order_acquire) };
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		long long bottom{ m_Bottom.load(std::memory_order_acquire) };
+		if (top >= bottom)
+			return nullptr;
+
+		Array* array{ m_Array.load(std::memory_order_acquire) };
+		T* item{ array->Get(top) };
+		if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			return nullptr;
+		return item;
+	}
+
+	//a snapshot, only a hint while other threads are at work
+	inline bool IsEmpty() const
+	{
+		return m_Bottom.load(std::memory_order_relaxed) <= m_Top.load(std::memory_order_relaxed);
+	}
+};
@@ -0,0 +1,370 @@
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+static const ProfilerCounter s_JobsRun("Jobs run");
+static const ProfilerCounter s_JobsStolen("Jobs stolen");
+
+//workers past this many add to the last one's counter, the profiler only has so many
+static const unsigned int s_MaxCountedWorkers{ 16 };
+
+//which pool's worker the calling thread is, if any
+static thread_local const WorkerPool* s_CurrentPool{ nullptr };
+static thread_local int s_CurrentIndex{ -1 };
+
+//ProfilerCounter keeps the name pointer, so generated names live for the whole run
+static const char* PersistentName(const std::string& name)
+{
+    static std::mutex s_Mutex;
+    static std::deque<std::string> s_Names;
+    std::lock_guard<std::mutex> lock(s_Mutex);
+    for (const std::string& existing : s_Names)
+    {
+        if (existing == name)
+            return existing.c_str();
+    }
+    s_Names.push_back(name);
+    return s_Names.back().c_str();
+}
+
+//xorshift, picks where a thief starts looking
+static unsigned int NextVictim()
+{
+    static thread_local unsigned int s_State{ (unsigned int)std::hash<std::thread::id>()(std::this_thread::get_id()) | 1u };
+    s_State ^= s_State << 13;
+    s_State ^= s_State >> 17;
+    s_State ^= s_State << 5;
+    return s_State;
+}
+
+JobCounter::JobCounter()
+    : m_Count(0)
+{
+}
+
+void JobCounter::Add(unsigned int count)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Count += count;
+}
+
+void JobCounter::Done()
+{
+    std::vector<std::function<void()>> continuations;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (--m_Count == 0)
+            continuations.swap(m_Continuations);
+    }
+    for (std::function<void()>& continuation : continuations)
+        continuation();
+}
+
+void JobCounter::Then(std::function<void()> continuation)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (m_Count != 0)
+        {
+            m_Continuations.push_back(std::move(continuation));
+            return;
+        }
+    }
+    continuation();
+}
+
+bool JobCounter::IsDone() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Count == 0;
+}
+
+unsigned int JobCounter::GetCount() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Count;
+}
+
+WorkerPool::WorkerPool(unsigned int threads, const char* name)
+    : m_MainThread(std::this_thread::get_id()), m_Queued(0), m_MainQueued(0), m_Outstanding(0),
+      m_Sleeping(0), m_Waiting(0), m_Stopping(false)
+{
+    if (threads == 0)
+        threads = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    m_Workers.reserve(threads);
+    for (unsigned int i = 0; i < threads; i++)
+    {
+        std::string counter{ std::string(name) + " " + std::to_string(std::min(i, s_MaxCountedWorkers - 1)) + " busy us" };
+        m_Workers.push_back(std::make_unique<Worker>(PersistentName(counter)));
+    }
+    //every deque exists before the first thread goes looking for work to steal
+    for (unsigned int i = 0; i < threads; i++)
+        m_Workers[i]->Thread = std::thread(&WorkerPool::WorkerLoop, this, i);
+}
+
+WorkerPool::~WorkerPool()
+{
+    Wait();
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stopping = true;
+    }
+    m_Wake.notify_all();
+    for (std::unique_ptr<Worker>& worker : m_Workers)
+        worker->Thread.join();
+
+    for (Job* job : m_MainJobs)
+        delete job;
+}
+
+int WorkerPool::GetWorkerIndex() const
+{
+    return s_CurrentPool == this ? s_CurrentIndex : -1;
+}
+
+void WorkerPool::Submit(std::function<void()> job, JobCounter* signal, JobCounter* after)
+{
+    m_Outstanding.fetch_add(1);
+    if (signal)
+        signal->Add();
+    Job* pending{ new Job{ std::move(job), signal } };
+    if (after)
+        after->Then([this, pending]() { Enqueue(pending); });
+    else
+        Enqueue(pending);
+}
+
+void WorkerPool::SubmitMain(std::function<void()> job, JobCounter* signal, JobCounter* after)
+{
+    if (signal)
+        signal->Add();
+    Job* pending{ new Job{ std::move(job), signal } };
+    if (after)
+        after->Then([this, pending]() { EnqueueMain(pending); });
+    else
+        EnqueueMain(pending);
+}
+
+void WorkerPool::Enqueue(Job* job)
+{
+    //counted first, a thief must not take it off before it was added
+    m_Queued.fetch_add(1);
+    int index{ GetWorkerIndex() };
+    if (index >= 0)
+        m_Workers[index]->Jobs.Push(job);
+    else
+    {
+        std::lock_guard<std::mutex> lock(m_InjectedMutex);
+        m_Injected.push_back(job);
+    }
+
+    //a sleeper counts itself in before it checks m_Queued, so one of the two sees the other
+    if (m_Sleeping.load() != 0)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+        }
+        m_Wake.notify_one();
+    }
+    WakeWaiters();
+}
+
+void WorkerPool::EnqueueMain(Job* job)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_MainMutex);
+        m_MainJobs.push_back(job);
+    }
+    m_MainQueued.fetch_add(1);
+    WakeWaiters();
+}
+
+void WorkerPool::WakeWaiters()
+{
+    if (m_Waiting.load() == 0)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+    }
+    m_Progress.notify_all();
+}
+
+WorkerPool::Job* WorkerPool::FindJob(int index)
+{
+    if (m_Queued.load() == 0)
+        return nullptr;
+
+    if (index >= 0)
+    {
+        if (Job* job = m_Workers[index]->Jobs.Pop())
+        {
+            m_Queued.fetch_sub(1);
+            return job;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_InjectedMutex);
+        if (!m_Injected.empty())
+        {
+            Job* job{ m_Injected.front() };
+            m_Injected.pop_front();
+            m_Queued.fetch_sub(1);
+            return job;
+        }
+    }
+
+    unsigned int count{ GetThreadCount() };
+    unsigned int start{ count ? NextVictim() % count : 0 };
+    for (unsigned int i = 0; i < count; i++)
+    {
+        unsigned int victim{ (start + i) % count };
+        if ((int)victim == index)
+            continue;
+        if (Job* job = m_Workers[victim]->Jobs.Steal())
+        {
+            m_Queued.fetch_sub(1);
+            s_JobsStolen.Increment();
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+void WorkerPool::Run(Job* job, int index)
+{
+    if (index >= 0)
+    {
+        auto start{ std::chrono::steady_clock::now() };
+        job->Function();
+        auto elapsed{ std::chrono::steady_clock::now() - start };
+        m_Workers[index]->Busy.Add((unsigned long long)std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+    }
+    else
+        job->Function();
+    s_JobsRun.Increment();
+
+    if (job->Signal)
+        job->Signal->Done();
+    delete job;
+    m_Outstanding.fetch_sub(1);
+    WakeWaiters();
+}
+
+void WorkerPool::WorkerLoop(unsigned int index)
+{
+    s_CurrentPool = this;
+    s_CurrentIndex = (int)index;
+    while (true)
+    {
+        if (Job* job = FindJob((int)index))
+        {
+            Run(job, (int)index);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_Sleeping.fetch_add(1);
+        m_Wake.wait(lock, [this]() { return m_Stopping || m_Queued.load() != 0; });
+        m_Sleeping.fetch_sub(1);
+        //the destructor waited for everything, so there is nothing left to drain
+        if (m_Stopping)
+            return;
+    }
+}
+
+void WorkerPool::HelpUntil(const std::function<bool()>& done)
+{
+    int index{ GetWorkerIndex() };
+    bool main{ std::this_thread::get_id() == m_MainThread };
+    while (!done())
+    {
+        if (main && RunMainThreadJobs() != 0)
+            continue;
+        if (Job* job = FindJob(index))
+        {
+            Run(job, index);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_Waiting.fetch_add(1);
+        //counters driven by hand (Add()/Done() outside a job) wake nobody, hence the timeout
+        m_Progress.wait_for(lock, std::chrono::milliseconds(1), [&]() {
+            return done() || m_Queued.load() != 0 || (main && m_MainQueued.load() != 0);
+        });
+        m_Waiting.fetch_sub(1);
+    }
+}
+
+unsigned int WorkerPool::RunMainThreadJobs()
+{
+    if (m_MainQueued.load() == 0)
+        return 0;
+    std::vector<Job*> jobs;
+    {
+        std::lock_guard<std::mutex> lock(m_MainMutex);
+        jobs.swap(m_MainJobs);
+    }
+    m_MainQueued.fetch_sub((unsigned int)jobs.size());
+    //jobs queued while these run wait for the next call
+    for (Job* job : jobs)
+    {
+        job->Function();
+        s_JobsRun.Increment();
+        if (job->Signal)
+            job->Signal->Done();
+        delete job;
+    }
+    if (!jobs.empty())
+        WakeWaiters();
+    return (unsigned int)jobs.size();
+}
+
+void WorkerPool::Wait()
+{
+    HelpUntil([this]() { return m_Outstanding.load() == 0; });
+}
+
+void WorkerPool::WaitFor(JobCounter& counter)
+{
+    HelpUntil([&counter]() { return counter.IsDone(); });
+}
+
+void WorkerPool::ParallelFor(unsigned int count, unsigned int grain, const std::function<void(unsigned int, unsigned int)>& body)
+{
+    //automatic grain: a few chunks per participant, enough for stealing to even out uneven items
+    if (grain == 0)
+        grain = count / ((GetThreadCount() + 1) * 4);
+    grain = std::max(grain, 1u);
+    unsigned int chunks{ (count + grain - 1) / grain };
+    if (chunks == 0)
+        return;
+
+    //every participant grabs the next chunk until none are left, so a busy pool only
+    //means the calling thread does more of the work itself
+    struct Shared
+    {
+        std::atomic<unsigned int> Next{ 0 };
+        std::atomic<unsigned int> Done{ 0 };
+    };
+    std::shared_ptr<Shared> shared{ std::make_shared<Shared>() };
+    auto work = [shared, chunks, count, grain, &body]() {
+        unsigned int chunk;
+        while ((chunk = shared->Next.fetch_add(1)) < chunks)
+        {
+            body(chunk * grain, std::min(count, (chunk + 1) * grain));
+            shared->Done.fetch_add(1);
+        }
+    };
+
+    unsigned int helpers{ std::min(chunks - 1, GetThreadCount()) };
+    for (unsigned int i = 0; i < helpers; i++)
+        Submit(work);
+    work();
+
+    //the last chunks may still run elsewhere, help with other jobs meanwhile. the helper that
+    //finishes the last one wakes us when its job returns
+    HelpUntil([&shared, chunks]() { return shared->Done.load() == chunks; });
+}
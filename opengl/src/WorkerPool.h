@@ -0,0 +1,127 @@
+#pragma once
+
+#include "Profiler.h"
+#include "WorkStealingDeque.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//counts jobs that have not run yet. Submit() with it as signal adds one and takes it off once the
+//job has run; Submit() with it as dependency holds the job back until the count is zero. reuse
+//a counter only once it is done
+class JobCounter
+{
+private:
+	//everything under the lock: a Done() is finished with the counter once it unlocks, so
+	//whoever sees zero (a waiter, a dependent job) may destroy it right away
+	mutable std::mutex m_Mutex;
+	unsigned int m_Count;
+	std::vector<std::function<void()>> m_Continuations;
+public:
+	JobCounter();
+
+	JobCounter(const JobCounter&) = delete;
+	JobCounter& operator=(const JobCounter&) = delete;
+
+	void Add(unsigned int count = 1);
+	//the one that reaches zero runs the continuations, on the calling thread
+	void Done();
+	//right away when already at zero
+	void Then(std::function<void()> continuation);
+
+	bool IsDone() const;
+	unsigned int GetCount() const;
+};
+
+//work-stealing scheduler for CPU work that must stay off the GL thread (decoding, parsing,
+//culling). every worker owns a Chase-Lev deque: jobs submitted from a job go to the bottom of
+//its own deque, idle workers steal from the top of the others, jobs from other threads enter
+//through a shared queue. main thread jobs (GL work) queue separately and run in
+//RunMainThreadJobs() on the thread that created the pool. worker jobs must not touch GL
+class WorkerPool
+{
+private:
+	struct Job
+	{
+		std::function<void()> Function;
+		JobCounter* Signal;
+	};
+
+	struct Worker
+	{
+		std::thread Thread;
+		WorkStealingDeque<Job> Jobs;
+		ProfilerCounter Busy;
+
+		explicit Worker(const char* counterName)
+			: Busy(counterName)
+		{
+		}
+	};
+
+	std::vector<std::unique_ptr<Worker>> m_Workers;
+	std::thread::id m_MainThread;
+
+	std::mutex m_InjectedMutex;
+	std::deque<Job*> m_Injected;        //from threads that are not workers of this pool
+	std::mutex m_MainMutex;
+	std::vector<Job*> m_MainJobs;
+
+	std::atomic<unsigned int> m_Queued;         //in a deque or m_Injected
+	std::atomic<unsigned int> m_MainQueued;
+	std::atomic<unsigned int> m_Outstanding;    //submitted worker jobs that have not run yet
+
+	//sleeping workers wait on m_Wake, threads in Wait()/WaitFor() on m_Progress
+	std::mutex m_Mutex;
+	std::condition_variable m_Wake;
+	std::condition_variable m_Progress;
+	std::atomic<unsigned int> m_Sleeping;
+	std::atomic<unsigned int> m_Waiting;
+	bool m_Stopping;
+
+	void WorkerLoop(unsigned int index);
+	//index of the calling thread among this pool's workers, -1 for other threads
+	int GetWorkerIndex() const;
+	void Enqueue(Job* job);
+	void EnqueueMain(Job* job);
+	Job* FindJob(int index);
+	void Run(Job* job, int index);
+	void WakeWaiters();
+	//runs jobs (and main thread jobs on the main thread) until done() says so
+	void HelpUntil(const std::function<bool()>& done);
+public:
+	//0 threads == one per hardware thread minus the one running the frame loop. the profiler
+	//gets "<name> <i> busy us" per worker: microseconds spent in jobs that frame
+	explicit WorkerPool(unsigned int threads = 0, const char* name = "Worker");
+	//runs what is still queued, then joins
+	~WorkerPool();
+
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	//signal (optional) counts the job until it has run, it is queued only once after (optional)
+	//is done
+	void Submit(std::function<void()> job, JobCounter* signal = nullptr, JobCounter* after = nullptr);
+	//the same for a job that has to run on the main thread
+	void SubmitMain(std::function<void()> job, JobCounter* signal = nullptr, JobCounter* after = nullptr);
+	//main thread, once per frame. returns how many ran
+	unsigned int RunMainThreadJobs();
+
+	//blocks until every submitted worker job has run, running jobs meanwhile. not from a job
+	void Wait();
+	//runs jobs until counter is done, safe from a job
+	void WaitFor(JobCounter& counter);
+
+	//runs body(begin, end) over [0, count) split into chunks of grain items (0 == picked from
+	//count and the thread count), on the workers and the calling thread, and returns once every
+	//chunk is done. safe to call from a job
+	void ParallelFor(unsigned int count, unsigned int grain, const std::function<void(unsigned int, unsigned int)>& body);
+
+	inline unsigned int GetThreadCount() const { return (unsigned int)m_Workers.size(); }
+};
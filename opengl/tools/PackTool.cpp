@@ -0,0 +1,47 @@
+#include "PackFile.h"
+#include "WorkerPool.h"
+
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+//builds a pack out of a directory tree (normally res/) for FileSystem::Mount(), then lists it
+static void PrintUsage()
+{
+    std::cerr << "usage: opengl_pack <directory> <out.pack> [--store]\n"
+        "entries are LZ4 compressed where that saves at least an eighth, --store keeps them all\n"
+        "uncompressed so every one is read straight out of the mapping" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3 || argc > 4 || (argc == 4 && std::strcmp(argv[3], "--store") != 0))
+    {
+        PrintUsage();
+        return 1;
+    }
+    std::string directory{ argv[1] };
+    std::string packPath{ argv[2] };
+    bool compress{ argc == 3 };
+
+    {
+        WorkerPool workers;
+        if (!PackFile::Write(packPath, directory, &workers, compress))
+            return 1;
+    }
+
+    PackFile pack;
+    if (!pack.Open(packPath))
+        return 1;
+    size_t size{ 0 }, stored{ 0 };
+    for (unsigned int i = 0; i < pack.GetEntryCount(); i++)
+    {
+        std::cerr << std::left << std::setw(48) << pack.GetName(i) << std::right << std::setw(10) << pack.GetSize(i)
+            << std::setw(10) << pack.GetStoredSize(i) << (pack.IsCompressed(i) ? "  lz4" : "") << std::endl;
+        size += pack.GetSize(i);
+        stored += pack.GetStoredSize(i);
+    }
+    std::cerr << pack.GetEntryCount() << " files, " << size << " bytes, " << stored << " stored" << std::endl;
+    return 0;
+}